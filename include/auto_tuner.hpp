@@ -0,0 +1,117 @@
+#ifndef KV_STORE_AUTO_TUNER_HPP
+#define KV_STORE_AUTO_TUNER_HPP
+
+#include <algorithm>
+#include <thread>
+#include <cstdint>
+#include "types.hpp"
+
+namespace kvstore {
+
+// Sizing policy for Config::auto_tune. At startup it derives the segment
+// and worker counts from the hardware and the expected key count; at run
+// time it is fed each map's size and lock counters and picks a new
+// segment count for ConcurrentHashMap::resize().
+//
+// Two signals drive the segment count: the load factor (every lookup
+// scans a bucket's list, so it is the mean lookup cost) and the share of
+// bucket lock acquisitions that had to wait. Counts are powers of two
+// within [min_segments, max_segments].
+class AutoTuner {
+public:
+    static constexpr size_t kSegmentsPerThread = 16;    // Keeps threads apart at startup
+    static constexpr double kTargetLoadFactor = 2.0;    // Grow to this
+    static constexpr double kMaxLoadFactor = 8.0;       // Grow above this
+    static constexpr double kMinLoadFactor = 0.25;      // Shrink below this
+    static constexpr double kMaxContention = 0.02;      // Grow above this waiting share
+    static constexpr uint64_t kMinAcquisitions = 1000;  // Per interval, to trust the share
+
+private:
+    size_t min_segments;
+    size_t max_segments;
+    size_t floor;                   // Never shrink below this
+    uint64_t last_acquisitions = 0;
+    uint64_t last_contended = 0;
+
+    static size_t roundUpPow2(size_t n) {
+        size_t pow2 = 1;
+        while (pow2 < n) {
+            pow2 <<= 1;
+        }
+        return pow2;
+    }
+
+    // Smallest doubling of segments that brings the load to the target
+    size_t grownFor(size_t items, size_t segments) const {
+        size_t target = segments;
+        while (target < max_segments && items / kTargetLoadFactor > target) {
+            target *= 2;
+        }
+        return std::min(target, max_segments);
+    }
+
+public:
+    AutoTuner(const Config& config, size_t initial_segments)
+        : min_segments(std::max<size_t>(config.min_segments, 1)),
+          max_segments(std::max(config.max_segments, min_segments)),
+          floor(std::max(initial_segments, min_segments)) {}
+
+    // config with num_segments and num_workers chosen for this machine
+    // if auto_tune is set. Connections run on their own threads and the
+    // workers only serve the accept loop, so a quarter of the cores is
+    // plenty there.
+    static Config startupConfig(Config config,
+                                size_t hardware_threads = std::thread::hardware_concurrency()) {
+        if (!config.auto_tune) {
+            return config;
+        }
+
+        size_t threads = std::max<size_t>(hardware_threads, 1);
+        size_t min_segments = std::max<size_t>(config.min_segments, 1);
+        size_t max_segments = std::max(config.max_segments, min_segments);
+
+        size_t segments = std::max(threads * kSegmentsPerThread,
+                                   static_cast<size_t>(config.expected_keys / kTargetLoadFactor));
+        config.num_segments = std::clamp(roundUpPow2(segments), min_segments, max_segments);
+
+        size_t min_workers = std::max<size_t>(config.min_workers, 1);
+        config.num_workers = std::clamp((threads + 3) / 4, min_workers,
+                                        std::max(config.max_workers, min_workers));
+        return config;
+    }
+
+    // Segment count to resize to, or the current one. acquisitions and
+    // contended are the map's running totals (see getLockStatistics()).
+    size_t targetSegments(size_t items, size_t segments,
+                          uint64_t acquisitions, uint64_t contended) {
+        uint64_t interval_acquisitions = acquisitions - last_acquisitions;
+        uint64_t interval_contended = contended - last_contended;
+        last_acquisitions = acquisitions;
+        last_contended = contended;
+
+        double load = static_cast<double>(items) / segments;
+        bool contention_known = interval_acquisitions >= kMinAcquisitions;
+        double contention = contention_known
+            ? static_cast<double>(interval_contended) / interval_acquisitions : 0.0;
+
+        if (segments < max_segments && contention > kMaxContention) {
+            // Spreading the locks wider helps only if waits stay rare, so
+            // do not shrink back below this later
+            size_t target = std::min(segments * 2, max_segments);
+            floor = std::max(floor, target);
+            return grownFor(items, target);
+        }
+        if (segments < max_segments && load > kMaxLoadFactor) {
+            return grownFor(items, segments);
+        }
+        if (segments > floor && load < kMinLoadFactor &&
+            (!contention_known || contention < kMaxContention / 4)) {
+            return std::max(segments / 2, floor);
+        }
+        return segments;
+    }
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_AUTO_TUNER_HPP
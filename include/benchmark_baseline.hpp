@@ -0,0 +1,319 @@
+#ifndef KV_STORE_BENCHMARK_BASELINE_HPP
+#define KV_STORE_BENCHMARK_BASELINE_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+namespace kvstore {
+
+// Repeated-trial benchmark results that can be saved as a baseline and
+// compared against later. Each metric holds one sample per trial; a
+// comparison runs Welch's t-test on the two sample sets and flags a
+// change only when it is both statistically significant (95%) and at
+// least the given relative threshold, so one noisy run cannot fail a
+// comparison on its own.
+
+// Two-sided 95% critical value of Student's t for df degrees of freedom
+inline double studentT95(double df) {
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+
+    if (!(df >= 1.0)) {
+        return table[0];
+    }
+    // Round down: fewer degrees of freedom is the conservative choice
+    if (df < 31.0) {
+        return table[static_cast<size_t>(df) - 1];
+    }
+    if (df < 40.0) return 2.042;
+    if (df < 60.0) return 2.021;
+    if (df < 120.0) return 2.000;
+    return 1.980;
+}
+
+struct SampleSummary {
+    size_t count = 0;
+    double mean = 0.0;
+    double stddev = 0.0;
+    double ci95 = 0.0;      // Half-width of the 95% confidence interval of the mean
+
+    static SampleSummary of(const std::vector<double>& samples) {
+        SampleSummary summary;
+        summary.count = samples.size();
+        if (samples.empty()) {
+            return summary;
+        }
+
+        double sum = 0.0;
+        for (double sample : samples) {
+            sum += sample;
+        }
+        summary.mean = sum / samples.size();
+
+        if (samples.size() > 1) {
+            double squares = 0.0;
+            for (double sample : samples) {
+                squares += (sample - summary.mean) * (sample - summary.mean);
+            }
+            summary.stddev = std::sqrt(squares / (samples.size() - 1));
+            summary.ci95 = studentT95(static_cast<double>(samples.size() - 1)) *
+                           summary.stddev / std::sqrt(static_cast<double>(samples.size()));
+        }
+        return summary;
+    }
+};
+
+class BenchmarkBaseline {
+public:
+    struct Metric {
+        bool higher_is_better = true;
+        std::vector<double> samples;
+    };
+
+    enum class Verdict {
+        UNCHANGED,
+        IMPROVED,
+        REGRESSED,
+        NEW             // Not in the baseline
+    };
+
+    struct Comparison {
+        std::string name;
+        SampleSummary baseline;
+        SampleSummary current;
+        double change = 0.0;        // Relative change of the mean
+        double change_ci95 = 0.0;   // Half-width of its 95% interval
+        Verdict verdict = Verdict::UNCHANGED;
+    };
+
+private:
+    std::map<std::string, Metric> metrics;
+
+    static const char* verdictName(Verdict verdict) {
+        switch (verdict) {
+            case Verdict::UNCHANGED: return "~";
+            case Verdict::IMPROVED: return "improved";
+            case Verdict::REGRESSED: return "REGRESSED";
+            case Verdict::NEW: return "new";
+        }
+        return "?";
+    }
+
+public:
+    // Record one trial's value of a metric
+    void add(const std::string& name, double value, bool higher_is_better) {
+        auto& metric = metrics[name];
+        metric.higher_is_better = higher_is_better;
+        metric.samples.push_back(value);
+    }
+
+    bool empty() const {
+        return metrics.empty();
+    }
+
+    const std::map<std::string, Metric>& getMetrics() const {
+        return metrics;
+    }
+
+    // One metric per line: "name": {"higher_is_better": true, "samples": [...]}
+    bool save(const std::string& filename) const {
+        std::ofstream out(filename);
+        if (!out) {
+            return false;
+        }
+
+        out << std::setprecision(10) << "{\n  \"metrics\": {";
+        bool first = true;
+        for (const auto& [name, metric] : metrics) {
+            out << (first ? "\n" : ",\n") << "    \"" << name << "\": {\"higher_is_better\": "
+                << (metric.higher_is_better ? "true" : "false") << ", \"samples\": [";
+            for (size_t i = 0; i < metric.samples.size(); ++i) {
+                out << (i == 0 ? "" : ", ") << metric.samples[i];
+            }
+            out << "]}";
+            first = false;
+        }
+        out << "\n  }\n}\n";
+        return static_cast<bool>(out);
+    }
+
+    // Read a file written by save()
+    bool load(const std::string& filename) {
+        std::ifstream in(filename);
+        if (!in) {
+            return false;
+        }
+
+        metrics.clear();
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t samples_at = line.find("\"samples\"");
+            if (samples_at == std::string::npos) {
+                continue;
+            }
+
+            size_t name_begin = line.find('"') + 1;
+            size_t name_end = line.find('"', name_begin);
+            size_t open = line.find('[', samples_at);
+            size_t close = line.find(']', open);
+            if (name_end == std::string::npos || open == std::string::npos ||
+                close == std::string::npos) {
+                return false;
+            }
+
+            Metric metric;
+            metric.higher_is_better = line.find("\"higher_is_better\": true") != std::string::npos;
+
+            std::istringstream values(line.substr(open + 1, close - open - 1));
+            std::string value;
+            while (std::getline(values, value, ',')) {
+                metric.samples.push_back(std::stod(value));
+            }
+            metrics[line.substr(name_begin, name_end - name_begin)] = std::move(metric);
+        }
+        return true;
+    }
+
+    // Compare these results against baseline. A metric is improved or
+    // regressed only if Welch's t-test rejects equal means at 95% and the
+    // mean moved by at least threshold (relative, e.g. 0.05).
+    std::vector<Comparison> compare(const BenchmarkBaseline& baseline, double threshold) const {
+        std::vector<Comparison> comparisons;
+
+        for (const auto& [name, metric] : metrics) {
+            Comparison comparison;
+            comparison.name = name;
+            comparison.current = SampleSummary::of(metric.samples);
+
+            auto it = baseline.metrics.find(name);
+            if (it == baseline.metrics.end() || it->second.samples.empty()) {
+                comparison.verdict = Verdict::NEW;
+                comparisons.push_back(comparison);
+                continue;
+            }
+
+            const auto& before = comparison.baseline = SampleSummary::of(it->second.samples);
+            const auto& after = comparison.current;
+
+            double var_before = before.count > 1 ? before.stddev * before.stddev / before.count : 0.0;
+            double var_after = after.count > 1 ? after.stddev * after.stddev / after.count : 0.0;
+            double se = std::sqrt(var_before + var_after);
+            double diff = after.mean - before.mean;
+
+            // Welch-Satterthwaite degrees of freedom
+            double df = 1.0;
+            if (se > 0.0) {
+                double denominator = 0.0;
+                if (before.count > 1) {
+                    denominator += var_before * var_before / (before.count - 1);
+                }
+                if (after.count > 1) {
+                    denominator += var_after * var_after / (after.count - 1);
+                }
+                df = denominator > 0.0 ? (se * se) * (se * se) / denominator : 1.0;
+            }
+
+            double margin = studentT95(df) * se;
+            if (before.mean != 0.0) {
+                comparison.change = diff / std::fabs(before.mean);
+                comparison.change_ci95 = margin / std::fabs(before.mean);
+            }
+
+            bool significant = std::fabs(diff) > margin &&
+                               std::fabs(comparison.change) >= threshold;
+            if (significant) {
+                bool better = metric.higher_is_better ? diff > 0 : diff < 0;
+                comparison.verdict = better ? Verdict::IMPROVED : Verdict::REGRESSED;
+            }
+            comparisons.push_back(comparison);
+        }
+        return comparisons;
+    }
+
+    // Print a comparison table; returns the number of regressions
+    static size_t printComparison(const std::vector<Comparison>& comparisons,
+                                  std::ostream& out = std::cout) {
+        size_t width = 6;
+        for (const auto& comparison : comparisons) {
+            width = std::max(width, comparison.name.size());
+        }
+
+        auto interval = [](const SampleSummary& summary) {
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(std::fabs(summary.mean) >= 100.0 ? 0 : 2)
+                << summary.mean << " ±" << summary.ci95;
+            return oss.str();
+        };
+
+        out << std::left << std::setw(width + 2) << "Metric" << std::right
+            << std::setw(22) << "Baseline" << std::setw(22) << "Current"
+            << std::setw(18) << "Change" << "  Verdict" << std::endl;
+
+        size_t regressions = 0;
+        for (const auto& comparison : comparisons) {
+            std::ostringstream change;
+            if (comparison.verdict != Verdict::NEW) {
+                change << std::fixed << std::setprecision(1) << std::showpos
+                       << comparison.change * 100.0 << std::noshowpos
+                       << "% ±" << comparison.change_ci95 * 100.0 << "%";
+            }
+
+            out << std::left << std::setw(width + 2) << comparison.name << std::right
+                << std::setw(22)
+                << (comparison.verdict == Verdict::NEW ? "-" : interval(comparison.baseline))
+                << std::setw(22) << interval(comparison.current)
+                << std::setw(18) << change.str()
+                << "  " << verdictName(comparison.verdict) << std::endl;
+
+            if (comparison.verdict == Verdict::REGRESSED) {
+                regressions++;
+            }
+        }
+
+        out << "\n" << regressions << " regression(s) in " << comparisons.size()
+            << " metric(s)" << std::endl;
+        return regressions;
+    }
+
+    // Shared end of a benchmark run: save the results as a baseline and/or
+    // compare them to one. Returns the exit code: 0, 1 on a file error,
+    // 2 if anything regressed.
+    int saveOrCompare(const std::string& save_file, const std::string& compare_file,
+                      double threshold) const {
+        if (!save_file.empty()) {
+            if (!save(save_file)) {
+                std::cerr << "Cannot write baseline " << save_file << std::endl;
+                return 1;
+            }
+            std::cout << "\nBaseline saved to " << save_file << std::endl;
+        }
+
+        if (compare_file.empty()) {
+            return 0;
+        }
+
+        BenchmarkBaseline baseline;
+        if (!baseline.load(compare_file)) {
+            std::cerr << "Cannot read baseline " << compare_file << std::endl;
+            return 1;
+        }
+
+        std::cout << "\nCompared with " << compare_file << " (95% confidence, threshold "
+                  << threshold * 100.0 << "%)\n" << std::endl;
+        return printComparison(compare(baseline, threshold)) > 0 ? 2 : 0;
+    }
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_BENCHMARK_BASELINE_HPP
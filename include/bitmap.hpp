@@ -0,0 +1,139 @@
+#ifndef KV_STORE_BITMAP_HPP
+#define KV_STORE_BITMAP_HPP
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__POPCNT__)
+#include <nmmintrin.h>
+#endif
+
+namespace kvstore {
+
+enum class BitOp {
+    AND,
+    OR,
+    XOR,
+    NOT
+};
+
+// Kernels for the bitmap commands (SETBIT, BITCOUNT, BITPOS, BITOP) over
+// string values. Bit 0 is the most significant bit of byte 0, so a
+// bitmap reads left to right in a hex dump. Counting and scanning read
+// 8 bytes at a time, and the BITOP loops are plain byte loops that -O3
+// vectorizes.
+class Bitmap {
+public:
+    static bool get(const std::string& bytes, uint64_t offset) {
+        size_t byte = offset / 8;
+        return byte < bytes.size() &&
+               (static_cast<unsigned char>(bytes[byte]) >> (7 - offset % 8)) & 1;
+    }
+
+    // Set or clear one bit of bytes, which must hold offset; returns the
+    // previous bit
+    static bool set(std::string& bytes, uint64_t offset, bool bit) {
+        auto& byte = reinterpret_cast<unsigned char&>(bytes[offset / 8]);
+        unsigned char mask = static_cast<unsigned char>(0x80 >> (offset % 8));
+        bool previous = (byte & mask) != 0;
+        byte = static_cast<unsigned char>(bit ? byte | mask : byte & ~mask);
+        return previous;
+    }
+
+    // The POPCNT instruction when the build targets it (-mpopcnt,
+    // -march=native), otherwise the SWAR bit count, which still beats a
+    // table lookup per byte
+    static uint64_t popcount64(uint64_t word) {
+#if defined(__POPCNT__)
+        return static_cast<uint64_t>(_mm_popcnt_u64(word));
+#else
+        word = word - ((word >> 1) & 0x5555555555555555ULL);
+        word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+        word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        return (word * 0x0101010101010101ULL) >> 56;
+#endif
+    }
+
+    // Set bits in size bytes at data. Four independent sums per 32 bytes
+    // keep the popcounts from waiting on one another.
+    static uint64_t count(const unsigned char* data, size_t size) {
+        uint64_t sums[4] = {0, 0, 0, 0};
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            uint64_t words[4];
+            std::memcpy(words, data + i, sizeof(words));
+            for (size_t lane = 0; lane < 4; ++lane) {
+                sums[lane] += popcount64(words[lane]);
+            }
+        }
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            sums[0] += popcount64(word);
+        }
+        for (; i < size; ++i) {
+            sums[0] += popcount64(data[i]);
+        }
+        return sums[0] + sums[1] + sums[2] + sums[3];
+    }
+
+    // Index of the first bit equal to bit in size bytes at data, or -1.
+    // Whole words of the other value are skipped 8 bytes at a time.
+    static int64_t position(const unsigned char* data, size_t size, bool bit) {
+        const uint64_t skip = bit ? 0 : ~uint64_t(0);
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            if (word != skip) {
+                break;
+            }
+        }
+        const unsigned char skip_byte = bit ? 0x00 : 0xff;
+        for (; i < size; ++i) {
+            if (data[i] != skip_byte) {
+                unsigned char byte = bit ? data[i] : static_cast<unsigned char>(~data[i]);
+                int leading = 0;
+                while (!(byte & (0x80 >> leading))) {
+                    leading++;
+                }
+                return static_cast<int64_t>(i * 8) + leading;
+            }
+        }
+        return -1;
+    }
+
+    // target = target op source over size bytes (NOT ignores source).
+    // Each case is its own loop so the compiler vectorizes it.
+    static void combine(BitOp op, unsigned char* target, const unsigned char* source,
+                        size_t size) {
+        switch (op) {
+            case BitOp::AND:
+                for (size_t i = 0; i < size; ++i) {
+                    target[i] &= source[i];
+                }
+                break;
+            case BitOp::OR:
+                for (size_t i = 0; i < size; ++i) {
+                    target[i] |= source[i];
+                }
+                break;
+            case BitOp::XOR:
+                for (size_t i = 0; i < size; ++i) {
+                    target[i] ^= source[i];
+                }
+                break;
+            case BitOp::NOT:
+                for (size_t i = 0; i < size; ++i) {
+                    target[i] = static_cast<unsigned char>(~target[i]);
+                }
+                break;
+        }
+    }
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_BITMAP_HPP
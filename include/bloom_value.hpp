@@ -0,0 +1,253 @@
+#ifndef KV_STORE_BLOOM_VALUE_HPP
+#define KV_STORE_BLOOM_VALUE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include "types.hpp"
+
+namespace kvstore {
+
+// Probabilistic membership stored at a key (BF.ADD/BF.EXISTS): a
+// scalable Bloom filter. It answers "maybe present" or "definitely
+// absent", with false positives bounded by error_rate. Items go into the
+// newest layer; once that layer holds its capacity, a layer expansion
+// times larger with half the error rate is added, so the total stays
+// below error_rate however many items arrive (Almeida et al., "Scalable
+// Bloom Filters", 2007). Lookups check every layer, so a filter sized
+// right at BF.RESERVE stays at one layer and one probe sequence.
+class BloomFilter : public Collection {
+public:
+    // An item's two hashes; probe i is at (h1 + i * h2) mod bits
+    // (Kirsch and Mitzenmacher), so one hash pass serves every layer
+    struct Hash {
+        uint64_t h1;
+        uint64_t h2;
+    };
+
+    static constexpr size_t kHashBytes = sizeof(uint64_t) * 2;
+    static constexpr uint32_t kMaxExpansion = 1024;
+    static constexpr double kMaxLayerBits = 4294967296.0;  // 512MB; larger layers hold fewer items
+
+private:
+    struct Layer {
+        uint64_t capacity;
+        uint64_t count = 0;     // Items added to this layer
+        uint32_t probes;
+        uint64_t bits;
+        std::vector<uint64_t> words;
+
+        bool contains(const Hash& hash) const {
+            uint64_t position = hash.h1;
+            for (uint32_t i = 0; i < probes; ++i, position += hash.h2) {
+                uint64_t bit = position % bits;
+                if ((words[bit / 64] & (uint64_t(1) << (bit % 64))) == 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void insert(const Hash& hash) {
+            uint64_t position = hash.h1;
+            for (uint32_t i = 0; i < probes; ++i, position += hash.h2) {
+                uint64_t bit = position % bits;
+                words[bit / 64] |= uint64_t(1) << (bit % 64);
+            }
+            count++;
+        }
+    };
+
+    double error_rate;
+    uint64_t capacity;
+    uint32_t expansion;
+    std::vector<Layer> layers;
+
+    // m = -n ln p / (ln 2)^2 bits (and log2(1/p) probes) minimize the
+    // bits for error p at n items
+    static double layerBits(double capacity, double error) {
+        double ln2 = std::log(2.0);
+        return std::ceil(-capacity * std::log(error) / (ln2 * ln2));
+    }
+
+    void addLayer() {
+        size_t index = layers.size();
+        double layer_error = std::max(
+            error_rate * std::pow(0.5, static_cast<double>(index + 1)), 1e-15);
+        double layer_capacity = static_cast<double>(capacity) *
+                                std::pow(static_cast<double>(expansion), static_cast<double>(index));
+        double bits = layerBits(layer_capacity, layer_error);
+        if (bits > kMaxLayerBits) {
+            layer_capacity = std::floor(kMaxLayerBits / layerBits(1.0, layer_error));
+            bits = kMaxLayerBits;
+        }
+
+        Layer layer;
+        layer.capacity = std::max<uint64_t>(1, static_cast<uint64_t>(layer_capacity));
+        layer.bits = std::max<uint64_t>(64, static_cast<uint64_t>(bits));
+        layer.probes = std::max<uint32_t>(1, static_cast<uint32_t>(
+            std::ceil(-std::log2(layer_error))));
+        layer.words.assign((layer.bits + 63) / 64, 0);
+        layers.push_back(std::move(layer));
+    }
+
+    template<typename T>
+    static void appendField(std::string& bytes, T field) {
+        bytes.append(reinterpret_cast<const char*>(&field), sizeof(field));
+    }
+
+    template<typename T>
+    static bool readField(std::string_view bytes, size_t& pos, T& field) {
+        if (bytes.size() - pos < sizeof(field)) {
+            return false;
+        }
+        std::memcpy(&field, bytes.data() + pos, sizeof(field));
+        pos += sizeof(field);
+        return true;
+    }
+
+public:
+    BloomFilter(double error_rate, uint64_t capacity, uint32_t expansion)
+        : error_rate(error_rate), capacity(capacity), expansion(expansion) {}
+
+    ValueType type() const override {
+        return ValueType::BLOOM;
+    }
+
+    size_t memoryUsage() const override {
+        return bytes() + layers.size() * sizeof(Layer);
+    }
+
+    // Parameters BF.RESERVE accepts: error rate in (0, 1), a capacity
+    // whose first layer fits in kMaxLayerBits, expansion 1..kMaxExpansion
+    static bool validParameters(double error_rate, uint64_t capacity, uint32_t expansion) {
+        return error_rate > 0.0 && error_rate < 1.0 && capacity > 0 &&
+               expansion > 0 && expansion <= kMaxExpansion &&
+               layerBits(static_cast<double>(capacity), error_rate / 2) <= kMaxLayerBits;
+    }
+
+    static Hash hash(std::string_view item) {
+        uint64_t h1 = mixedHash(item);
+        return {h1, mixHash(h1 ^ 0x9e3779b97f4a7c15ULL) | 1};
+    }
+
+    bool contains(const Hash& hash) const {
+        for (const auto& layer : layers) {
+            if (layer.contains(hash)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Add an item unless it may already be present; true if added
+    bool add(const Hash& hash) {
+        if (contains(hash)) {
+            return false;
+        }
+        if (layers.empty() || layers.back().count >= layers.back().capacity) {
+            addLayer();
+        }
+        layers.back().insert(hash);
+        return true;
+    }
+
+    // Items added across all layers
+    uint64_t size() const {
+        uint64_t total = 0;
+        for (const auto& layer : layers) {
+            total += layer.count;
+        }
+        return total;
+    }
+
+    size_t layerCount() const {
+        return layers.size();
+    }
+
+    // Bytes of filter bits
+    size_t bytes() const {
+        size_t total = 0;
+        for (const auto& layer : layers) {
+            total += layer.words.size() * sizeof(uint64_t);
+        }
+        return total;
+    }
+
+    // BFADD records: the item hashes, 16 bytes each
+    static void appendHash(std::string& record, const Hash& hash) {
+        appendField(record, hash.h1);
+        appendField(record, hash.h2);
+    }
+
+    static bool decodeHashes(std::string_view record, std::vector<Hash>& hashes) {
+        if (record.size() % kHashBytes != 0) {
+            return false;
+        }
+        hashes.clear();
+        for (size_t pos = 0; pos < record.size(); ) {
+            Hash hash{};
+            readField(record, pos, hash.h1);
+            readField(record, pos, hash.h2);
+            hashes.push_back(hash);
+        }
+        return true;
+    }
+
+    // BFRESERVE records: error rate (8-byte double), capacity (8 bytes),
+    // expansion (4 bytes), host order
+    std::string encodeParameters() const {
+        std::string bytes;
+        appendField(bytes, error_rate);
+        appendField(bytes, capacity);
+        appendField(bytes, expansion);
+        return bytes;
+    }
+
+    static bool decodeParameters(std::string_view bytes, double& error_rate,
+                                 uint64_t& capacity, uint32_t& expansion) {
+        size_t pos = 0;
+        return readField(bytes, pos, error_rate) && readField(bytes, pos, capacity) &&
+               readField(bytes, pos, expansion) && pos == bytes.size() &&
+               validParameters(error_rate, capacity, expansion);
+    }
+
+    // BFLOAD records, one per layer in a checkpoint: capacity, count,
+    // bits (8 bytes each), probes (4 bytes), then the bit words
+    std::string encodeLayer(size_t index) const {
+        const Layer& layer = layers[index];
+        std::string bytes;
+        bytes.reserve(28 + layer.words.size() * sizeof(uint64_t));
+        appendField(bytes, layer.capacity);
+        appendField(bytes, layer.count);
+        appendField(bytes, layer.bits);
+        appendField(bytes, layer.probes);
+        bytes.append(reinterpret_cast<const char*>(layer.words.data()),
+                     layer.words.size() * sizeof(uint64_t));
+        return bytes;
+    }
+
+    // Append a layer written by encodeLayer; false if malformed
+    bool loadLayer(std::string_view bytes) {
+        Layer layer;
+        size_t pos = 0;
+        if (!readField(bytes, pos, layer.capacity) || !readField(bytes, pos, layer.count) ||
+            !readField(bytes, pos, layer.bits) || !readField(bytes, pos, layer.probes) ||
+            layer.bits == 0 || layer.bits > kMaxLayerBits || layer.probes == 0 ||
+            bytes.size() - pos != (layer.bits + 63) / 64 * sizeof(uint64_t)) {
+            return false;
+        }
+        layer.words.resize((layer.bits + 63) / 64);
+        std::memcpy(layer.words.data(), bytes.data() + pos, bytes.size() - pos);
+        layers.push_back(std::move(layer));
+        return true;
+    }
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_BLOOM_VALUE_HPP
@@ -0,0 +1,91 @@
+#ifndef KV_STORE_CLIENT_TRACKER_HPP
+#define KV_STORE_CLIENT_TRACKER_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include "types.hpp"
+
+namespace kvstore {
+
+// Server-side tracking table for client near caches.
+// Remembers which connections may hold a cached copy of each key so a
+// PUT/DELETE can push invalidations to them. Tracking is one-shot: a
+// connection is forgotten for a key once it has been invalidated, and
+// re-registers on its next GET. Ids of closed connections are dropped
+// lazily when the key is next written.
+class ClientTracker {
+private:
+    struct Shard {
+        std::unordered_map<std::string, std::vector<uint64_t>> subscribers;
+        std::mutex mutex;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    StringHasher hasher;
+
+    Shard& getShard(const std::string& key) {
+        return *shards[hasher(key) % shards.size()];
+    }
+
+public:
+    ClientTracker(size_t num_shards = 64) {
+        shards.reserve(num_shards);
+        for (size_t i = 0; i < num_shards; ++i) {
+            shards.push_back(std::make_unique<Shard>());
+        }
+    }
+
+    ClientTracker(const ClientTracker&) = delete;
+    ClientTracker& operator=(const ClientTracker&) = delete;
+
+    // Record that connection_id may cache key
+    void track(const std::string& key, uint64_t connection_id) {
+        auto& shard = getShard(key);
+        std::lock_guard lock(shard.mutex);
+
+        auto& ids = shard.subscribers[key];
+        if (std::find(ids.begin(), ids.end(), connection_id) == ids.end()) {
+            ids.push_back(connection_id);
+        }
+    }
+
+    // Remove and return every connection tracking key
+    std::vector<uint64_t> take(const std::string& key) {
+        auto& shard = getShard(key);
+        std::lock_guard lock(shard.mutex);
+
+        auto it = shard.subscribers.find(key);
+        if (it == shard.subscribers.end()) {
+            return {};
+        }
+
+        std::vector<uint64_t> ids = std::move(it->second);
+        shard.subscribers.erase(it);
+        return ids;
+    }
+
+    void clear() {
+        for (auto& shard : shards) {
+            std::lock_guard lock(shard->mutex);
+            shard->subscribers.clear();
+        }
+    }
+
+    // Number of keys currently tracked
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& shard : shards) {
+            std::lock_guard lock(shard->mutex);
+            total += shard->subscribers.size();
+        }
+        return total;
+    }
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_CLIENT_TRACKER_HPP
@@ -3,20 +3,47 @@
 
 #include <vector>
 #include <list>
+#include <mutex>
 #include <shared_mutex>
 #include <atomic>
 #include <memory>
 #include <functional>
+#include <optional>
+#include <algorithm>
+#include <iterator>
+#include "tracer.hpp"
 #include "types.hpp"
 
 namespace kvstore {
 
-template<typename Key, typename Value, typename Hash = StringHasher>
+// Each bucket is a list under its own reader/writer lock. The bucket
+// array can be resized online: resize() takes every bucket lock of the
+// current table, moves the items into a new one and retires the old one.
+// Operations that locked a bucket of a retired table simply retry on the
+// new table. Retired tables hold only empty buckets, but a thread may
+// still be waiting on one of their locks: each operation pins the map
+// (a per-thread slot count) from loading the table pointer until it
+// releases the bucket lock, and retired tables are freed as soon as no
+// thread is pinned, by resize() or by the last operation to unpin.
+//
+// A Weigher gives each item a weight (e.g. its approximate bytes); the
+// map keeps the running total, adjusted under the bucket lock whenever
+// an item is added, changed or removed. The default weighs nothing.
+struct NoWeight {
+    template<typename Key, typename Value>
+    size_t operator()(const Key&, const Value&) const {
+        return 0;
+    }
+};
+
+template<typename Key, typename Value, typename Hash = StringHasher, typename Weigher = NoWeight>
 class ConcurrentHashMap {
 private:
     struct Bucket {
         std::list<std::pair<Key, Value>> items;
         mutable std::shared_mutex mutex;
+        std::atomic<uint64_t> acquisitions{0};  // Lock acquisitions
+        std::atomic<uint64_t> contended{0};     // ... that had to wait
         
         typename std::list<std::pair<Key, Value>>::iterator find(const Key& key) {
             return std::find_if(items.begin(), items.end(),
@@ -29,26 +56,125 @@ private:
         }
     };
     
-    std::vector<std::unique_ptr<Bucket>> buckets;
+    struct Table {
+        std::vector<std::unique_ptr<Bucket>> buckets;
+        bool retired = false;   // Written and read only under the bucket locks
+        
+        explicit Table(size_t num_buckets) {
+            buckets.reserve(num_buckets);
+            for (size_t i = 0; i < num_buckets; ++i) {
+                buckets.push_back(std::make_unique<Bucket>());
+            }
+        }
+    };
+    
+    // Threads that may hold a table pointer, spread over cache lines so
+    // operations on different threads do not contend on one counter
+    struct alignas(64) PinSlot {
+        std::atomic<size_t> count{0};
+    };
+    static constexpr size_t kPinSlots = 16;
+    
+    std::atomic<Table*> table;
+    mutable std::vector<std::unique_ptr<Table>> tables;  // Retired, then the current one last
+    mutable std::mutex tables_mutex;    // Guards tables
+    mutable std::atomic<size_t> retired_tables{0};
+    mutable PinSlot pins[kPinSlots];
+    mutable std::mutex resize_mutex;    // Pins the current table for whole-map operations
     Hash hasher;
+    Weigher weigher;
     std::atomic<size_t> item_count{0};
+    std::atomic<size_t> total_weight{0};
+    std::atomic<uint64_t> resizes{0};
+    
+    // Lock counters of retired tables
+    uint64_t retired_acquisitions = 0;
+    uint64_t retired_contended = 0;
+    
+    static size_t pinSlot() {
+        static std::atomic<size_t> next_slot{0};
+        thread_local size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % kPinSlots;
+        return slot;
+    }
+    
+    // Held from before the table pointer is loaded until after the bucket
+    // lock is released (declare it before the lock). Pinning is sequentially
+    // consistent with the table swap in resize(): a thread pinned after a
+    // reclaim saw every slot empty loads the new table.
+    class Pin {
+        const ConcurrentHashMap& map;
+        PinSlot& slot;
+        
+    public:
+        explicit Pin(const ConcurrentHashMap& map)
+            : map(map), slot(map.pins[pinSlot()]) {
+            slot.count.fetch_add(1);
+        }
+        
+        ~Pin() {
+            slot.count.fetch_sub(1, std::memory_order_release);
+            if (map.retired_tables.load(std::memory_order_relaxed) > 0) {
+                std::unique_lock lock(map.tables_mutex, std::try_to_lock);
+                if (lock.owns_lock()) {
+                    map.reclaimRetired();
+                }
+            }
+        }
+        
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+    };
     
-    Bucket& getBucket(const Key& key) {
-        size_t index = hasher(key) % buckets.size();
-        return *buckets[index];
+    // Free the retired tables if no thread is pinned. Needs tables_mutex.
+    void reclaimRetired() const {
+        if (tables.size() == 1) {
+            return;
+        }
+        for (const auto& slot : pins) {
+            if (slot.count.load() != 0) {
+                return;
+            }
+        }
+        tables.erase(tables.begin(), tables.end() - 1);
+        retired_tables.store(0, std::memory_order_relaxed);
     }
     
-    const Bucket& getBucket(const Key& key) const {
-        size_t index = hasher(key) % buckets.size();
-        return *buckets[index];
+    // Lock key's bucket in the current table. resize() retires a table
+    // while holding all of its bucket locks, so a table found retired
+    // once the lock is held has lost its items: retry on the new one.
+    template<typename Lock>
+    Bucket& lockBucket(const Key& key, Lock& lock) const {
+        size_t hash = hasher(key);
+        while (true) {
+            Table* current = table.load();
+            Bucket& bucket = *current->buckets[hash % current->buckets.size()];
+            
+            lock = Lock(bucket.mutex, std::try_to_lock);
+            if (!lock.owns_lock()) {
+                bucket.contended.fetch_add(1, std::memory_order_relaxed);
+                TraceSpan span("map.lock_wait");
+                lock.lock();
+            }
+            if (!current->retired) {
+                bucket.acquisitions.fetch_add(1, std::memory_order_relaxed);
+                return bucket;
+            }
+            lock.unlock();
+        }
+    }
+    
+    void addWeight(size_t weight) {
+        total_weight.fetch_add(weight, std::memory_order_relaxed);
+    }
+    
+    void subtractWeight(size_t weight) {
+        total_weight.fetch_sub(weight, std::memory_order_relaxed);
     }
     
 public:
     ConcurrentHashMap(size_t num_buckets = 64) {
-        buckets.reserve(num_buckets);
-        for (size_t i = 0; i < num_buckets; ++i) {
-            buckets.push_back(std::make_unique<Bucket>());
-        }
+        tables.push_back(std::make_unique<Table>(std::max<size_t>(num_buckets, 1)));
+        table.store(tables.back().get());
     }
     
     ~ConcurrentHashMap() = default;
@@ -62,37 +188,47 @@ public:
     ConcurrentHashMap& operator=(ConcurrentHashMap&&) = default;
     
     bool insert(const Key& key, Value value) {
-        auto& bucket = getBucket(key);
-        std::unique_lock lock(bucket.mutex);
+        TraceSpan span("map.insert");
+        Pin pin(*this);
+        std::unique_lock<std::shared_mutex> lock;
+        auto& bucket = lockBucket(key, lock);
         
         auto it = bucket.find(key);
         if (it != bucket.items.end()) {
+            subtractWeight(weigher(it->first, it->second));
             it->second = std::move(value);
+            addWeight(weigher(it->first, it->second));
             return false; // Key already existed, updated
         }
         
         bucket.items.emplace_back(key, std::move(value));
         item_count.fetch_add(1, std::memory_order_relaxed);
+        addWeight(weigher(bucket.items.back().first, bucket.items.back().second));
         return true; // New key inserted
     }
     
     bool erase(const Key& key) {
-        auto& bucket = getBucket(key);
-        std::unique_lock lock(bucket.mutex);
+        TraceSpan span("map.erase");
+        Pin pin(*this);
+        std::unique_lock<std::shared_mutex> lock;
+        auto& bucket = lockBucket(key, lock);
         
         auto it = bucket.find(key);
         if (it == bucket.items.end()) {
             return false;
         }
         
+        subtractWeight(weigher(it->first, it->second));
         bucket.items.erase(it);
         item_count.fetch_sub(1, std::memory_order_relaxed);
         return true;
     }
     
     bool find(const Key& key, Value& value) const {
-        const auto& bucket = getBucket(key);
-        std::shared_lock lock(bucket.mutex);
+        TraceSpan span("map.find");
+        Pin pin(*this);
+        std::shared_lock<std::shared_mutex> lock;
+        const auto& bucket = lockBucket(key, lock);
         
         auto it = bucket.find(key);
         if (it == bucket.items.end()) {
@@ -103,9 +239,74 @@ public:
         return true;
     }
     
+    // Atomically read-modify-write the entry for key under the bucket's
+    // exclusive lock (cf. Java's ConcurrentHashMap::compute). fn receives
+    // the current value, or an empty optional if the key is absent, and
+    // may modify, fill or reset it; an empty optional afterwards removes
+    // the key. Returns whatever fn returns.
+    template<typename Fn>
+    auto compute(const Key& key, Fn fn) {
+        TraceSpan span("map.compute");
+        Pin pin(*this);
+        std::unique_lock<std::shared_mutex> lock;
+        auto& bucket = lockBucket(key, lock);
+        
+        auto it = bucket.find(key);
+        bool existed = it != bucket.items.end();
+        
+        std::optional<Value> slot;
+        if (existed) {
+            subtractWeight(weigher(it->first, it->second));
+            slot.emplace(std::move(it->second));
+        }
+        
+        auto store_back = [&]() {
+            if (slot) {
+                addWeight(weigher(key, *slot));
+                if (existed) {
+                    it->second = std::move(*slot);
+                } else {
+                    bucket.items.emplace_back(key, std::move(*slot));
+                    item_count.fetch_add(1, std::memory_order_relaxed);
+                }
+            } else if (existed) {
+                bucket.items.erase(it);
+                item_count.fetch_sub(1, std::memory_order_relaxed);
+            }
+        };
+        
+        // Write back even if fn throws, so the entry is never lost
+        struct StoreBack {
+            decltype(store_back)& apply;
+            ~StoreBack() { apply(); }
+        } guard{store_back};
+        
+        return fn(slot);
+    }
+    
+    // Run fn on the stored value under the bucket's shared lock instead
+    // of copying it out (e.g. to read a slice of a large value).
+    // Returns false if the key is absent.
+    template<typename Fn>
+    bool visit(const Key& key, Fn fn) const {
+        TraceSpan span("map.visit");
+        Pin pin(*this);
+        std::shared_lock<std::shared_mutex> lock;
+        const auto& bucket = lockBucket(key, lock);
+        
+        auto it = bucket.find(key);
+        if (it == bucket.items.end()) {
+            return false;
+        }
+        
+        fn(static_cast<const Value&>(it->second));
+        return true;
+    }
+    
     bool exists(const Key& key) const {
-        const auto& bucket = getBucket(key);
-        std::shared_lock lock(bucket.mutex);
+        Pin pin(*this);
+        std::shared_lock<std::shared_mutex> lock;
+        const auto& bucket = lockBucket(key, lock);
         return bucket.find(key) != bucket.items.end();
     }
     
@@ -117,10 +318,58 @@ public:
         return size() == 0;
     }
     
+    size_t bucketCount() const {
+        Pin pin(*this);
+        return table.load()->buckets.size();
+    }
+    
+    // Rehash into num_buckets buckets. Concurrent operations wait for the
+    // move and then continue on the new table; list nodes are spliced,
+    // not copied. Returns false if the count is unchanged.
+    bool resize(size_t num_buckets) {
+        std::lock_guard resize_lock(resize_mutex);
+        Table* old_table = table.load(std::memory_order_acquire);
+        if (num_buckets == 0 || num_buckets == old_table->buckets.size()) {
+            return false;
+        }
+        
+        auto new_table = std::make_unique<Table>(num_buckets);
+        
+        // In index order; other operations hold at most one bucket lock
+        std::vector<std::unique_lock<std::shared_mutex>> locks;
+        locks.reserve(old_table->buckets.size());
+        for (auto& bucket : old_table->buckets) {
+            locks.emplace_back(bucket->mutex);
+        }
+        
+        for (auto& bucket : old_table->buckets) {
+            auto& items = bucket->items;
+            while (!items.empty()) {
+                auto& target = *new_table->buckets[hasher(items.front().first) % num_buckets];
+                target.items.splice(target.items.end(), items, items.begin());
+            }
+            retired_acquisitions += bucket->acquisitions.load(std::memory_order_relaxed);
+            retired_contended += bucket->contended.load(std::memory_order_relaxed);
+        }
+        
+        old_table->retired = true;
+        std::lock_guard tables_lock(tables_mutex);
+        table.store(new_table.get());
+        tables.push_back(std::move(new_table));
+        retired_tables.fetch_add(1, std::memory_order_relaxed);
+        
+        // The old table's locks go before the table itself can
+        locks.clear();
+        reclaimRetired();
+        resizes.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    
     // Thread-safe iteration with a visitor pattern
     template<typename Visitor>
     void for_each(Visitor visitor) const {
-        for (const auto& bucket : buckets) {
+        std::lock_guard resize_lock(resize_mutex);
+        for (const auto& bucket : table.load(std::memory_order_acquire)->buckets) {
             std::shared_lock lock(bucket->mutex);
             for (const auto& item : bucket->items) {
                 visitor(item.first, item.second);
@@ -128,13 +377,68 @@ public:
         }
     }
     
-    // Clear all items
+    // Clear all items. Each bucket's share of the totals is subtracted
+    // under its lock, so writes to buckets already cleared still count.
     void clear() {
-        for (auto& bucket : buckets) {
+        std::lock_guard resize_lock(resize_mutex);
+        for (auto& bucket : table.load(std::memory_order_acquire)->buckets) {
             std::unique_lock lock(bucket->mutex);
+            for (const auto& item : bucket->items) {
+                subtractWeight(weigher(item.first, item.second));
+            }
+            item_count.fetch_sub(bucket->items.size(), std::memory_order_relaxed);
             bucket->items.clear();
         }
-        item_count.store(0, std::memory_order_relaxed);
+    }
+    
+    // Total weight of the items (see Weigher)
+    size_t weight() const {
+        return total_weight.load(std::memory_order_relaxed);
+    }
+    
+    // Some key, chosen from seed: the first non-empty bucket from bucket
+    // seed mod the bucket count, then an item of it by the seed's high
+    // bits. Keys sharing a bucket are picked less often than a lone key,
+    // which is fine for sampling (e.g. eviction). False if the map is
+    // empty.
+    bool sampleKey(uint64_t seed, Key& key) const {
+        Pin pin(*this);
+        while (true) {
+            Table* current = table.load();
+            size_t count = current->buckets.size();
+            bool retired = false;
+            for (size_t i = 0; i < count && !retired; ++i) {
+                const Bucket& bucket = *current->buckets[(seed + i) % count];
+                std::shared_lock lock(bucket.mutex);
+                retired = current->retired;
+                if (!retired && !bucket.items.empty()) {
+                    auto it = bucket.items.begin();
+                    std::advance(it, (seed >> 32) % bucket.items.size());
+                    key = it->first;
+                    return true;
+                }
+            }
+            if (!retired) {
+                return false;
+            }
+        }
+    }
+    
+    // Bucket lock acquisitions since construction, and how many found the
+    // lock held (a reader waiting on a writer or the other way round)
+    struct LockStatistics {
+        uint64_t acquisitions;
+        uint64_t contended;
+    };
+    
+    LockStatistics getLockStatistics() const {
+        std::lock_guard resize_lock(resize_mutex);
+        LockStatistics stats{retired_acquisitions, retired_contended};
+        for (const auto& bucket : table.load(std::memory_order_acquire)->buckets) {
+            stats.acquisitions += bucket->acquisitions.load(std::memory_order_relaxed);
+            stats.contended += bucket->contended.load(std::memory_order_relaxed);
+        }
+        return stats;
     }
     
     // Get statistics
@@ -144,13 +448,20 @@ public:
         std::vector<size_t> bucket_sizes;
         double load_factor;
         double utilization;
+        uint64_t resizes;
+        size_t retired_tables;  // Replaced by resize() but not yet freed
     };
     
     Statistics getStatistics() const {
+        std::lock_guard resize_lock(resize_mutex);
+        const auto& buckets = table.load(std::memory_order_acquire)->buckets;
+        
         Statistics stats;
         stats.item_count = size();
         stats.bucket_count = buckets.size();
         stats.bucket_sizes.reserve(buckets.size());
+        stats.resizes = resizes.load(std::memory_order_relaxed);
+        stats.retired_tables = retired_tables.load(std::memory_order_relaxed);
         
         size_t used_buckets = 0;
         for (const auto& bucket : buckets) {
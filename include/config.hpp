@@ -4,6 +4,8 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <charconv>
+#include <stdexcept>
 #include "types.hpp"
 
 namespace kvstore {
@@ -32,24 +34,15 @@ public:
                 trim(key);
                 trim(value);
                 
-                if (key == "num_segments") {
-                    config.num_segments = std::stoul(value);
-                } else if (key == "initial_bucket_size") {
-                    config.initial_bucket_size = std::stoul(value);
-                } else if (key == "wal_file") {
-                    config.wal_file = value;
-                } else if (key == "wal_buffer_size") {
-                    config.wal_buffer_size = std::stoul(value);
-                } else if (key == "sync_wal") {
-                    config.sync_wal = (value == "true" || value == "1");
-                } else if (key == "server_port") {
-                    config.server_port = static_cast<uint16_t>(std::stoi(value));
-                } else if (key == "max_key_size") {
-                    config.max_key_size = std::stoul(value);
-                } else if (key == "max_value_size") {
-                    config.max_value_size = std::stoul(value);
-                } else if (key == "max_connections") {
-                    config.max_connections = std::stoul(value);
+                size_t index;
+                std::string setting;
+                if (databaseSetting(key, index, setting)) {
+                    // Check the value now rather than when the namespace opens
+                    Config scratch;
+                    apply(scratch, setting, value);
+                    config.database_settings[index].emplace_back(setting, value);
+                } else {
+                    apply(config, key, value);
                 }
             }
         }
@@ -57,6 +50,128 @@ public:
         return config;
     }
     
+    // Set one setting from its config file text; unknown keys are ignored,
+    // malformed values throw (std::invalid_argument or std::out_of_range)
+    static void apply(Config& config, const std::string& key, const std::string& value) {
+        if (key == "num_segments") {
+            config.num_segments = std::stoul(value);
+        } else if (key == "initial_bucket_size") {
+            config.initial_bucket_size = std::stoul(value);
+        } else if (key == "wal_file") {
+            config.wal_file = value;
+        } else if (key == "wal_buffer_size") {
+            config.wal_buffer_size = std::stoul(value);
+        } else if (key == "sync_wal") {
+            config.sync_wal = (value == "true" || value == "1");
+        } else if (key == "fsync_writes") {
+            config.fsync_writes = (value == "true" || value == "1");
+        } else if (key == "server_port") {
+            config.server_port = static_cast<uint16_t>(std::stoi(value));
+        } else if (key == "max_key_size") {
+            config.max_key_size = std::stoul(value);
+        } else if (key == "max_value_size") {
+            config.max_value_size = std::stoul(value);
+        } else if (key == "max_stream_value_size") {
+            config.max_stream_value_size = std::stoul(value);
+        } else if (key == "max_stream_uploads") {
+            config.max_stream_uploads = std::stoul(value);
+        } else if (key == "max_connections") {
+            config.max_connections = std::stoul(value);
+        } else if (key == "checkpoint_wal_size") {
+            config.checkpoint_wal_size = std::stoul(value);
+        } else if (key == "expiry_sweep_interval_ms") {
+            config.expiry_sweep_interval_ms = std::stoull(value);
+        } else if (key == "num_workers") {
+            config.num_workers = std::stoul(value);
+        } else if (key == "auto_tune") {
+            config.auto_tune = (value == "true" || value == "1");
+        } else if (key == "expected_keys") {
+            config.expected_keys = std::stoul(value);
+        } else if (key == "min_segments") {
+            config.min_segments = std::stoul(value);
+        } else if (key == "max_segments") {
+            config.max_segments = std::stoul(value);
+        } else if (key == "min_workers") {
+            config.min_workers = std::stoul(value);
+        } else if (key == "max_workers") {
+            config.max_workers = std::stoul(value);
+        } else if (key == "tune_interval_ms") {
+            config.tune_interval_ms = std::stoull(value);
+        } else if (key == "trace_file") {
+            config.trace_file = value;
+        } else if (key == "trace_sample_every") {
+            config.trace_sample_every = static_cast<uint32_t>(std::stoul(value));
+        } else if (key == "hash_max_listpack_entries") {
+            config.hash_max_listpack_entries = std::stoul(value);
+        } else if (key == "hash_max_listpack_value") {
+            config.hash_max_listpack_value = std::stoul(value);
+        } else if (key == "list_max_listpack_size") {
+            config.list_max_listpack_size = std::stoul(value);
+        } else if (key == "set_max_intset_entries") {
+            config.set_max_intset_entries = std::stoul(value);
+        } else if (key == "hll_sparse_max_registers") {
+            config.hll_sparse_max_registers = std::stoul(value);
+        } else if (key == "bf_error_rate") {
+            config.bf_error_rate = std::stod(value);
+        } else if (key == "bf_initial_capacity") {
+            config.bf_initial_capacity = std::stoull(value);
+        } else if (key == "bf_expansion") {
+            config.bf_expansion = static_cast<uint32_t>(std::stoul(value));
+        } else if (key == "databases") {
+            config.databases = std::stoul(value);
+        } else if (key == "max_memory") {
+            config.max_memory = std::stoull(value);
+        } else if (key == "eviction_policy") {
+            if (!parseEvictionPolicy(value, config.eviction_policy)) {
+                throw std::invalid_argument("unknown eviction_policy: " + value);
+            }
+        } else if (key == "eviction_samples") {
+            config.eviction_samples = std::stoul(value);
+        }
+    }
+    
+    // The configuration of namespace index: base plus its "db<index>."
+    // overrides. Namespace 0 keeps wal_file, so a store that had one
+    // namespace recovers the same data; namespace n defaults to
+    // "<wal_file>.db<n>".
+    static Config databaseConfig(const Config& base, size_t index) {
+        Config config = base;
+        config.database_settings.clear();
+        if (index > 0) {
+            config.wal_file = base.wal_file + ".db" + std::to_string(index);
+        }
+        
+        auto it = base.database_settings.find(index);
+        if (it != base.database_settings.end()) {
+            for (const auto& [key, value] : it->second) {
+                apply(config, key, value);
+            }
+        }
+        return config;
+    }
+    
+    static const char* evictionPolicyName(EvictionPolicy policy) {
+        switch (policy) {
+            case EvictionPolicy::ALLKEYS_RANDOM:
+                return "allkeys-random";
+            case EvictionPolicy::VOLATILE_TTL:
+                return "volatile-ttl";
+            default:
+                return "noeviction";
+        }
+    }
+    
+    static bool parseEvictionPolicy(const std::string& name, EvictionPolicy& policy) {
+        for (auto candidate : {EvictionPolicy::NOEVICTION, EvictionPolicy::ALLKEYS_RANDOM,
+                               EvictionPolicy::VOLATILE_TTL}) {
+            if (name == evictionPolicyName(candidate)) {
+                policy = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+    
     static void saveToFile(const Config& config, 
                           const std::string& filename = "kv_config.conf") {
         std::ofstream file(filename);
@@ -69,15 +184,62 @@ public:
         file << "wal_file=" << config.wal_file << "\n";
         file << "wal_buffer_size=" << config.wal_buffer_size << "\n";
         file << "sync_wal=" << (config.sync_wal ? "true" : "false") << "\n";
+        file << "fsync_writes=" << (config.fsync_writes ? "true" : "false") << "\n";
         file << "server_port=" << config.server_port << "\n";
         file << "max_key_size=" << config.max_key_size << "\n";
         file << "max_value_size=" << config.max_value_size << "\n";
+        file << "max_stream_value_size=" << config.max_stream_value_size << "\n";
+        file << "max_stream_uploads=" << config.max_stream_uploads << "\n";
         file << "max_connections=" << config.max_connections << "\n";
+        file << "checkpoint_wal_size=" << config.checkpoint_wal_size << "\n";
+        file << "expiry_sweep_interval_ms=" << config.expiry_sweep_interval_ms << "\n";
+        file << "num_workers=" << config.num_workers << "\n";
+        file << "auto_tune=" << (config.auto_tune ? "true" : "false") << "\n";
+        file << "expected_keys=" << config.expected_keys << "\n";
+        file << "min_segments=" << config.min_segments << "\n";
+        file << "max_segments=" << config.max_segments << "\n";
+        file << "min_workers=" << config.min_workers << "\n";
+        file << "max_workers=" << config.max_workers << "\n";
+        file << "tune_interval_ms=" << config.tune_interval_ms << "\n";
+        file << "trace_file=" << config.trace_file << "\n";
+        file << "trace_sample_every=" << config.trace_sample_every << "\n";
+        file << "hash_max_listpack_entries=" << config.hash_max_listpack_entries << "\n";
+        file << "hash_max_listpack_value=" << config.hash_max_listpack_value << "\n";
+        file << "list_max_listpack_size=" << config.list_max_listpack_size << "\n";
+        file << "set_max_intset_entries=" << config.set_max_intset_entries << "\n";
+        file << "hll_sparse_max_registers=" << config.hll_sparse_max_registers << "\n";
+        file << "bf_error_rate=" << config.bf_error_rate << "\n";
+        file << "bf_initial_capacity=" << config.bf_initial_capacity << "\n";
+        file << "bf_expansion=" << config.bf_expansion << "\n";
+        file << "databases=" << config.databases << "\n";
+        file << "max_memory=" << config.max_memory << "\n";
+        file << "eviction_policy=" << evictionPolicyName(config.eviction_policy) << "\n";
+        file << "eviction_samples=" << config.eviction_samples << "\n";
+        for (const auto& [index, settings] : config.database_settings) {
+            for (const auto& [key, value] : settings) {
+                file << "db" << index << "." << key << "=" << value << "\n";
+            }
+        }
         
         file.close();
     }
     
 private:
+    // "db<index>.<setting>", a setting of one namespace
+    static bool databaseSetting(const std::string& key, size_t& index, std::string& setting) {
+        size_t dot = key.find('.');
+        if (key.compare(0, 2, "db") != 0 || dot == std::string::npos || dot == 2) {
+            return false;
+        }
+        const char* end = key.data() + dot;
+        auto [ptr, ec] = std::from_chars(key.data() + 2, end, index);
+        if (ec != std::errc() || ptr != end) {
+            return false;
+        }
+        setting = key.substr(dot + 1);
+        return true;
+    }
+    
     static void trim(std::string& str) {
         str.erase(0, str.find_first_not_of(" \t\n\r\f\v"));
         str.erase(str.find_last_not_of(" \t\n\r\f\v") + 1);
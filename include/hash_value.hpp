@@ -0,0 +1,175 @@
+#ifndef KV_STORE_HASH_VALUE_HPP
+#define KV_STORE_HASH_VALUE_HPP
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <memory>
+#include "listpack.hpp"
+#include "types.hpp"
+
+namespace kvstore {
+
+// Field map stored at a key (HSET/HGET). A small hash is one Listpack of
+// field, value pairs, scanned linearly: for a few dozen short fields
+// that beats hashing, and a hash costs two allocations instead of one
+// per field. Once it exceeds max_entries pairs or a field or value
+// longer than max_value, it converts to an unordered_map for good; it
+// never converts back, since a hash that grew once tends to grow again.
+class HashValue : public Collection {
+private:
+    Listpack packed;        // field, value, field, value, ... while compact
+    std::unique_ptr<std::unordered_map<std::string, std::string>> table;
+    size_t table_bytes = 0;     // Field and value bytes in table
+    size_t max_entries;
+    size_t max_value;
+
+    // Per table pair beyond its bytes: the node with its two strings, and
+    // the bucket slot
+    static constexpr size_t kPairOverhead = 2 * sizeof(std::string) + 3 * sizeof(void*);
+
+    // Position of the field in packed, or npos
+    size_t findPacked(std::string_view field) const {
+        std::string_view element;
+        for (size_t pos = 0; pos < packed.end(); ) {
+            size_t value_pos = packed.next(pos, element);
+            if (element == field) {
+                return pos;
+            }
+            pos = packed.next(value_pos, element);
+        }
+        return std::string::npos;
+    }
+
+    void convert() {
+        auto converted = std::make_unique<std::unordered_map<std::string, std::string>>();
+        converted->reserve(size() + 1);
+        forEach([&](std::string_view field, std::string_view value) {
+            converted->emplace(field, value);
+            table_bytes += field.size() + value.size();
+        });
+        table = std::move(converted);
+        packed.clear();
+    }
+
+public:
+    HashValue(size_t max_entries, size_t max_value)
+        : max_entries(max_entries), max_value(max_value) {}
+
+    ValueType type() const override {
+        return ValueType::HASH;
+    }
+
+    size_t memoryUsage() const override {
+        return table ? table_bytes + table->size() * kPairOverhead : packed.bytes();
+    }
+
+    size_t size() const {
+        return table ? table->size() : packed.size() / 2;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // True while in the Listpack encoding
+    bool compact() const {
+        return !table;
+    }
+
+    // Set field to value; true if the field is new
+    bool set(std::string_view field, std::string_view value) {
+        if (!table) {
+            size_t pos = findPacked(field);
+            bool added = pos == std::string::npos;
+            if (field.size() <= max_value && value.size() <= max_value &&
+                (!added || size() < max_entries)) {
+                if (added) {
+                    packed.push_back(field);
+                    packed.push_back(value);
+                } else {
+                    std::string_view current;
+                    packed.replace(packed.next(pos, current), value);
+                }
+                return added;
+            }
+            convert();
+        }
+
+        auto [it, added] = table->try_emplace(std::string(field), value);
+        if (added) {
+            table_bytes += field.size() + value.size();
+        } else {
+            table_bytes += value.size() - it->second.size();
+            it->second.assign(value.data(), value.size());
+        }
+        return added;
+    }
+
+    bool get(std::string_view field, std::string& value) const {
+        if (table) {
+            auto it = table->find(std::string(field));
+            if (it == table->end()) {
+                return false;
+            }
+            value = it->second;
+            return true;
+        }
+
+        size_t pos = findPacked(field);
+        if (pos == std::string::npos) {
+            return false;
+        }
+        std::string_view element;
+        packed.next(packed.next(pos, element), element);
+        value.assign(element.data(), element.size());
+        return true;
+    }
+
+    bool contains(std::string_view field) const {
+        return table ? table->count(std::string(field)) > 0
+                     : findPacked(field) != std::string::npos;
+    }
+
+    // Remove field; true if it was present
+    bool erase(std::string_view field) {
+        if (table) {
+            auto it = table->find(std::string(field));
+            if (it == table->end()) {
+                return false;
+            }
+            table_bytes -= it->first.size() + it->second.size();
+            table->erase(it);
+            return true;
+        }
+
+        size_t pos = findPacked(field);
+        if (pos == std::string::npos) {
+            return false;
+        }
+        packed.erase(pos);      // Field; the value moves up to pos
+        packed.erase(pos);
+        return true;
+    }
+
+    // fn(field, value) for every pair, in insertion order while compact
+    template<typename Fn>
+    void forEach(Fn fn) const {
+        if (table) {
+            for (const auto& [field, value] : *table) {
+                fn(std::string_view(field), std::string_view(value));
+            }
+            return;
+        }
+
+        std::string_view field, value;
+        for (size_t pos = 0; pos < packed.end(); ) {
+            pos = packed.next(packed.next(pos, field), value);
+            fn(field, value);
+        }
+    }
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_HASH_VALUE_HPP
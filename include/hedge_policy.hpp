@@ -0,0 +1,124 @@
+#ifndef KV_STORE_HEDGE_POLICY_HPP
+#define KV_STORE_HEDGE_POLICY_HPP
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+namespace kvstore {
+
+// Hedged read configuration
+struct HedgeOptions {
+    double percentile = 0.95;                        // Hedge once a read is slower than this
+    std::chrono::microseconds initial_delay{2000};   // Used until enough samples exist
+    std::chrono::microseconds min_delay{200};
+    std::chrono::microseconds max_delay{100000};
+    size_t window_size = 1024;                       // Recent reads considered
+    size_t min_samples = 64;
+    double max_hedge_ratio = 0.1;                    // Hedges allowed per read, long run
+    double hedge_burst = 10.0;                       // Hedges allowed back to back
+};
+
+// Decides how long a read may run before a duplicate is sent to a
+// replica: the configured percentile of recently observed read latency,
+// clamped to [min_delay, max_delay]. At p95 this costs roughly 5% extra
+// reads while cutting the tail down to the faster server. When the
+// primary slows down for good, every read would pass the delay, so a
+// budget caps hedges at max_hedge_ratio of reads: each read earns that
+// fraction of a token, up to hedge_burst, and each hedge spends one.
+class HedgePolicy {
+private:
+    HedgeOptions options;
+    std::vector<uint32_t> window;       // Ring buffer of latencies (us)
+    size_t next = 0;
+    size_t samples_since_update = 0;
+    std::chrono::microseconds current_delay;
+    int64_t hedge_credit;               // Thousandths of a hedge
+
+    uint64_t reads = 0;
+    uint64_t hedges = 0;
+    uint64_t replica_wins = 0;
+    uint64_t throttled = 0;
+
+    static constexpr int64_t kCreditPerHedge = 1000;
+
+    int64_t burstCredit() const {
+        return static_cast<int64_t>(options.hedge_burst * kCreditPerHedge);
+    }
+
+    void updateDelay() {
+        std::vector<uint32_t> sorted(window);
+        size_t rank = static_cast<size_t>(options.percentile * (sorted.size() - 1));
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+
+        current_delay = std::clamp(std::chrono::microseconds(sorted[rank]),
+                                   options.min_delay, options.max_delay);
+    }
+
+public:
+    explicit HedgePolicy(const HedgeOptions& options = HedgeOptions())
+        : options(options), current_delay(options.initial_delay),
+          hedge_credit(burstCredit()) {
+        window.reserve(options.window_size);
+    }
+
+    std::chrono::microseconds delay() const {
+        return current_delay;
+    }
+
+    // Take a hedge from the budget once a read has outlived delay();
+    // false if the budget is spent and the read should just wait
+    bool tryHedge() {
+        if (hedge_credit < kCreditPerHedge) {
+            throttled++;
+            return false;
+        }
+        hedge_credit -= kCreditPerHedge;
+        return true;
+    }
+
+    // Record the latency of a completed read and whether it was hedged
+    void record(std::chrono::microseconds latency, bool hedged, bool replica_won) {
+        auto us = static_cast<uint32_t>(std::min<int64_t>(latency.count(), UINT32_MAX));
+        if (window.size() < options.window_size) {
+            window.push_back(us);
+        } else {
+            window[next] = us;
+            next = (next + 1) % options.window_size;
+        }
+
+        reads++;
+        hedges += hedged ? 1 : 0;
+        replica_wins += replica_won ? 1 : 0;
+
+        auto earned = static_cast<int64_t>(std::llround(options.max_hedge_ratio * kCreditPerHedge));
+        hedge_credit = std::min(hedge_credit + earned, burstCredit());
+
+        // Re-derive the percentile periodically rather than per read,
+        // first as soon as min_samples reads have been seen
+        if (++samples_since_update >= options.min_samples &&
+            window.size() >= options.min_samples) {
+            samples_since_update = 0;
+            updateDelay();
+        }
+    }
+
+    // Get statistics
+    struct Statistics {
+        uint64_t reads;
+        uint64_t hedges;
+        uint64_t replica_wins;
+        uint64_t throttled;             // Hedges skipped for lack of budget
+        std::chrono::microseconds delay;
+    };
+
+    Statistics getStatistics() const {
+        return Statistics{reads, hedges, replica_wins, throttled, current_delay};
+    }
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_HEDGE_POLICY_HPP
@@ -2,20 +2,566 @@
 #define KV_STORE_CLIENT_HPP
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <optional>
+#include <charconv>
+#include <cstdlib>
 #include <asio.hpp>
 #include <iostream>
 #include <sstream>
+#include "near_cache.hpp"
+#include "hedge_policy.hpp"
+#include "latency_histogram.hpp"
 
 namespace kvstore {
 
 using asio::ip::tcp;
 
+// Client-side performance counters (latencies in nanoseconds)
+struct ClientStatistics {
+    struct OperationStatistics {
+        LatencyHistogram::Summary latency;      // Round trip seen by the client
+        LatencyHistogram::Summary server_time;  // Reported by the server (TIMING ON)
+        uint64_t errors;
+    };
+    
+    std::map<std::string, OperationStatistics> operations;  // By command word
+    int64_t in_flight;
+    uint64_t reconnects;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+};
+
 class KVClient {
 private:
     asio::io_context io_context;
     tcp::socket socket;
     std::string host;
     uint16_t port;
+    asio::streambuf read_buffer;    // Kept across calls: may hold pushes
+    size_t stale_responses = 0;     // Replies owed to abandoned hedged reads
+    bool value_reply = false;       // Last reply read was stored data ("$<length>")
+    
+    // Near cache, off unless enableNearCache() is called
+    std::unique_ptr<NearCache<std::string, std::string>> near_cache;
+    std::string pending_get_key;
+    bool get_pending = false;
+    bool pending_get_invalidated = false;
+    
+    // Read replicas for hedged GETs, off unless setReplicas() is called
+    struct Replica {
+        std::string host;
+        uint16_t port;
+        std::unique_ptr<tcp::socket> socket;
+        asio::streambuf read_buffer;
+        size_t stale_responses = 0;
+    };
+    
+    std::vector<std::unique_ptr<Replica>> replicas;
+    size_t next_replica = 0;
+    std::unique_ptr<HedgePolicy> hedge_policy;
+    
+    // Instrumentation; histograms are created per command word on first use
+    struct OperationMetrics {
+        LatencyHistogram latency;
+        LatencyHistogram server_time;
+        std::atomic<uint64_t> errors{0};
+    };
+    
+    std::map<std::string, std::unique_ptr<OperationMetrics>> op_metrics;
+    mutable std::mutex metrics_mutex;
+    std::atomic<int64_t> in_flight{0};
+    std::atomic<uint64_t> reconnects{0};
+    bool connected_once = false;
+    std::atomic<uint64_t> bytes_sent{0};
+    std::atomic<uint64_t> bytes_received{0};
+    bool server_timing = false;
+    int64_t last_server_time = -1;  // From the ">TIME" line ahead of a reply
+    size_t database = 0;            // Re-selected on every (re)connect
+    
+    OperationMetrics& metricsFor(const std::string& command) {
+        std::string op = command.substr(0, command.find(' '));
+        std::lock_guard lock(metrics_mutex);
+        
+        auto& metrics = op_metrics[op];
+        if (!metrics) {
+            metrics = std::make_unique<OperationMetrics>();
+        }
+        return *metrics;
+    }
+    
+    void recordCompletion(OperationMetrics& metrics,
+                          std::chrono::steady_clock::time_point start,
+                          const std::string& response) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        metrics.latency.record(static_cast<uint64_t>(elapsed));
+        
+        if (!value_reply && response.compare(0, 5, "ERROR") == 0) {
+            metrics.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (last_server_time >= 0) {
+            metrics.server_time.record(static_cast<uint64_t>(last_server_time));
+            last_server_time = -1;
+        }
+    }
+    
+    static constexpr const char* invalidate_prefix = ">INVALIDATE ";
+    static constexpr size_t invalidate_prefix_len = 12;
+    static constexpr const char* time_prefix = ">TIME ";
+    static constexpr size_t time_prefix_len = 6;
+    
+    // Stored data always comes as a "$<length>" value and no other reply
+    // line starts with '>', so a line that does is a push whatever follows
+    static bool isPush(const std::string& line) {
+        return !line.empty() && line[0] == '>';
+    }
+    
+    // Apply a server push (">INVALIDATE key", ">FLUSH" or ">TIME ns")
+    void handlePush(const std::string& line) {
+        if (line.compare(0, time_prefix_len, time_prefix) == 0) {
+            last_server_time = std::strtoll(line.c_str() + time_prefix_len, nullptr, 10);
+        } else if (line.compare(0, invalidate_prefix_len, invalidate_prefix) == 0) {
+            std::string key = line.substr(invalidate_prefix_len);
+            if (near_cache) {
+                near_cache->erase(key);
+            }
+            // The GET in flight may carry the value this push invalidates
+            if (get_pending && key == pending_get_key) {
+                pending_get_invalidated = true;
+            }
+        } else if (line == ">FLUSH") {
+            if (near_cache) {
+                near_cache->clear();
+            }
+            pending_get_invalidated = true;
+        }
+    }
+    
+    std::string readLine() {
+        size_t n = asio::read_until(socket, read_buffer, '\n');
+        
+        std::string line(
+            asio::buffers_begin(read_buffer.data()),
+            asio::buffers_begin(read_buffer.data()) + n - 1); // Remove newline
+        
+        read_buffer.consume(n);
+        bytes_received.fetch_add(n, std::memory_order_relaxed);
+        return line;
+    }
+    
+    // Length of the stored data announced by a "$<length>" line; the
+    // data and a newline follow it
+    static bool valueLength(const std::string& line, size_t& length) {
+        if (line.size() < 2 || line[0] != '$') {
+            return false;
+        }
+        const char* end = line.data() + line.size();
+        auto [ptr, ec] = std::from_chars(line.data() + 1, end, length);
+        return ec == std::errc() && ptr == end;
+    }
+    
+    // The data after a "$<length>" line, read in full
+    std::string readValue(size_t length) {
+        if (read_buffer.size() < length + 1) {
+            asio::read(socket, read_buffer,
+                       asio::transfer_exactly(length + 1 - read_buffer.size()));
+        }
+        
+        std::string data(asio::buffers_begin(read_buffer.data()),
+                         asio::buffers_begin(read_buffer.data()) + length);
+        read_buffer.consume(length + 1);
+        bytes_received.fetch_add(length + 1, std::memory_order_relaxed);
+        return data;
+    }
+    
+    // True if line is not the reply being waited for: either a push, or
+    // the late reply to a hedged read whose replica answered first
+    bool absorbLine(const std::string& line) {
+        if (isPush(line)) {
+            handlePush(line);
+            return true;
+        }
+        if (stale_responses > 0) {
+            stale_responses--;
+            last_server_time = -1;  // Belonged to the abandoned read
+            return true;
+        }
+        return false;
+    }
+    
+    // Read the next response (or array element), applying any pushes
+    // queued ahead of it. Stored data comes back without its framing;
+    // value_reply tells it apart from a line such as NOT_FOUND.
+    std::string readResponse() {
+        while (true) {
+            std::string line = readLine();
+            size_t length = 0;
+            value_reply = valueLength(line, length);
+            std::string response = value_reply ? readValue(length) : line;
+            if (!absorbLine(line)) {
+                return response;
+            }
+        }
+    }
+    
+    // Apply pushes that have already arrived, without blocking
+    void drainPushes() {
+        asio::error_code ec;
+        size_t available = socket.available(ec);
+        if (!ec && available > 0) {
+            size_t n = socket.read_some(read_buffer.prepare(available), ec);
+            read_buffer.commit(n);
+            bytes_received.fetch_add(n, std::memory_order_relaxed);
+        }
+        
+        while (true) {
+            auto begin = asio::buffers_begin(read_buffer.data());
+            auto end = asio::buffers_end(read_buffer.data());
+            auto newline = std::find(begin, end, '\n');
+            if (newline == end) {
+                break;
+            }
+            
+            // A stale reply carrying data is skipped once all of it is here
+            std::string line(begin, newline);
+            size_t consumed = line.size() + 1;
+            size_t length = 0;
+            if (valueLength(line, length)) {
+                if (read_buffer.size() < consumed + length + 1) {
+                    break;
+                }
+                consumed += length + 1;
+            }
+            read_buffer.consume(consumed);
+            absorbLine(line);
+        }
+    }
+    
+    void connectReplica(Replica& replica) {
+        tcp::resolver resolver(io_context);
+        auto endpoints = resolver.resolve(replica.host, std::to_string(replica.port));
+        if (replica.socket) {
+            reconnects.fetch_add(1, std::memory_order_relaxed);
+        }
+        replica.socket = std::make_unique<tcp::socket>(io_context);
+        asio::connect(*replica.socket, endpoints);
+        replica.socket->set_option(tcp::no_delay(true));
+        replica.read_buffer.consume(replica.read_buffer.size());
+        replica.stale_responses = 0;
+        
+        // The reply comes ahead of the first hedged read's, so skip it
+        if (database != 0) {
+            std::string select = "SELECT " + std::to_string(database) + "\n";
+            asio::write(*replica.socket, asio::buffer(select));
+            replica.stale_responses = 1;
+        }
+    }
+    
+    using ReplyHandler = std::function<void(const asio::error_code&, const std::string&,
+                                            std::string)>;
+    
+    // Read one reply from sock asynchronously and pass on_reply its first
+    // line and the reply (the data, for a "$<length>" line). Nothing is
+    // consumed until the whole reply has arrived, and nothing at all once
+    // done is set, so an abandoned read leaves its reply intact for the
+    // stale reply skipping.
+    void asyncReadReply(tcp::socket& sock, asio::streambuf& buffer, const bool& done,
+                        ReplyHandler on_reply) {
+        asio::async_read_until(sock, buffer, '\n',
+            [this, &sock, &buffer, &done, on_reply](const asio::error_code& ec, size_t n) {
+                if (done) {
+                    return;
+                }
+                if (ec) {
+                    on_reply(ec, "", "");
+                    return;
+                }
+                
+                std::string line(asio::buffers_begin(buffer.data()),
+                                 asio::buffers_begin(buffer.data()) + n - 1);
+                size_t length = 0;
+                if (!valueLength(line, length)) {
+                    buffer.consume(n);
+                    bytes_received.fetch_add(n, std::memory_order_relaxed);
+                    on_reply(ec, line, line);
+                    return;
+                }
+                
+                size_t size = n + length + 1;
+                size_t missing = buffer.size() < size ? size - buffer.size() : 0;
+                asio::async_read(sock, buffer, asio::transfer_exactly(missing),
+                    [this, &buffer, &done, on_reply, line, n, length](const asio::error_code& ec,
+                                                                     size_t) {
+                        if (done) {
+                            return;
+                        }
+                        if (ec) {
+                            on_reply(ec, line, "");
+                            return;
+                        }
+                        std::string data(asio::buffers_begin(buffer.data()) + n,
+                                         asio::buffers_begin(buffer.data()) + n + length);
+                        buffer.consume(n + length + 1);
+                        bytes_received.fetch_add(n + length + 1, std::memory_order_relaxed);
+                        on_reply(ec, line, std::move(data));
+                    });
+            });
+    }
+    
+    // Send a read to the primary and, if it has not answered within the
+    // hedge delay, the same read to the next replica. The first reply
+    // wins; the loser's read is cancelled and its reply skipped when it
+    // eventually arrives, so neither connection has to be torn down.
+    std::string sendHedgedCommand(const std::string& command, bool& replica_won) {
+        if (!socket.is_open()) {
+            connect();
+        }
+        
+        OperationMetrics& metrics = metricsFor(command);
+        auto start = std::chrono::steady_clock::now();
+        
+        std::string full_command = command + "\n";
+        asio::write(socket, asio::buffer(full_command));
+        bytes_sent.fetch_add(full_command.size(), std::memory_order_relaxed);
+        in_flight.fetch_add(1, std::memory_order_relaxed);
+        
+        std::string result;
+        bool done = false;
+        asio::error_code primary_error;
+        Replica* replica = nullptr;
+        bool replica_failed = false;
+        replica_won = false;
+        
+        io_context.restart();
+        
+        std::function<void()> read_primary = [&]() {
+            asyncReadReply(socket, read_buffer, done,
+                [&](const asio::error_code& ec, const std::string& line, std::string reply) {
+                    if (ec) {
+                        primary_error = ec;
+                        done = (replica == nullptr || replica_failed);
+                        return;
+                    }
+                    
+                    if (absorbLine(line)) {
+                        read_primary();
+                        return;
+                    }
+                    size_t length = 0;
+                    value_reply = valueLength(line, length);
+                    result = std::move(reply);
+                    done = true;
+                });
+        };
+        
+        std::function<void()> read_replica = [&]() {
+            asyncReadReply(*replica->socket, replica->read_buffer, done,
+                [&](const asio::error_code& ec, const std::string& line, std::string reply) {
+                    if (ec) {
+                        replica_failed = true;
+                        done = static_cast<bool>(primary_error);
+                        return;
+                    }
+                    
+                    if (replica->stale_responses > 0) {
+                        replica->stale_responses--;
+                        read_replica();
+                        return;
+                    }
+                    size_t length = 0;
+                    value_reply = valueLength(line, length);
+                    result = std::move(reply);
+                    replica_won = true;
+                    done = true;
+                });
+        };
+        
+        asio::steady_timer hedge_timer(io_context, hedge_policy->delay());
+        hedge_timer.async_wait([&](const asio::error_code& ec) {
+            if (ec || done || replicas.empty() || !hedge_policy->tryHedge()) {
+                return;
+            }
+            
+            replica = replicas[next_replica++ % replicas.size()].get();
+            try {
+                if (!replica->socket || !replica->socket->is_open()) {
+                    connectReplica(*replica);
+                }
+                asio::write(*replica->socket, asio::buffer(full_command));
+                bytes_sent.fetch_add(full_command.size(), std::memory_order_relaxed);
+                in_flight.fetch_add(1, std::memory_order_relaxed);
+            } catch (const std::exception&) {
+                replica_failed = true;
+                done = static_cast<bool>(primary_error);
+                return;
+            }
+            read_replica();
+        });
+        
+        read_primary();
+        while (!done) {
+            if (io_context.run_one() == 0) {
+                break;
+            }
+        }
+        
+        // Cancel the loser and let every handler run before the state
+        // they reference goes out of scope
+        hedge_timer.cancel();
+        bool hedged = replica != nullptr && !replica_failed;
+        if (replica_won) {
+            std::error_code ec;
+            socket.cancel(ec);
+            stale_responses++;
+        } else if (hedged) {
+            std::error_code ec;
+            replica->socket->cancel(ec);
+            replica->stale_responses++;
+        }
+        io_context.run();
+        in_flight.fetch_sub(hedged ? 2 : 1, std::memory_order_relaxed);
+        
+        if (primary_error) {
+            disconnect();
+        }
+        if (replica && replica_failed && replica->socket) {
+            std::error_code ec;
+            replica->socket->close(ec);
+        }
+        if (!replica_won && primary_error) {
+            metrics.errors.fetch_add(1, std::memory_order_relaxed);
+            throw asio::system_error(primary_error);
+        }
+        
+        if (replica_won) {
+            last_server_time = -1;
+        }
+        recordCompletion(metrics, start, result);
+        hedge_policy->record(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start),
+            hedged, replica_won);
+        return result;
+    }
+    
+    // Length or count reply of a write to key (APPEND, SETRANGE, HSET,
+    // HDEL, LPUSH, RPUSH, ZADD, ZREM, SADD, SREM, PFADD, SETBIT, BITOP)
+    std::optional<size_t> lengthReply(const std::string& key, const std::string& response) {
+        if (near_cache) {
+            near_cache->erase(key);
+        }
+        
+        size_t length;
+        const char* end = response.data() + response.size();
+        auto [ptr, ec] = std::from_chars(response.data(), end, length);
+        if (response.empty() || ec != std::errc() || ptr != end) {
+            return std::nullopt;
+        }
+        return length;
+    }
+    
+    // Lines of an array reply; none on an error reply
+    std::vector<std::string> membersReply(const std::string& command) {
+        std::string header = sendCommand(command);
+        std::vector<std::string> members;
+        if (header.empty() || header[0] != '*') {
+            return members;
+        }
+        size_t count = std::stoul(header.substr(1));
+        members.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            members.push_back(readResponse());
+        }
+        return members;
+    }
+    
+    static std::vector<bool> flagsReply(const std::vector<std::string>& lines) {
+        std::vector<bool> flags;
+        flags.reserve(lines.size());
+        for (const auto& line : lines) {
+            flags.push_back(line == "1");
+        }
+        return flags;
+    }
+    
+    static std::string listCommand(const std::string& op, const std::string& key,
+                                   const std::vector<std::string>& elements) {
+        std::ostringstream oss;
+        oss << op << " \"" << key << "\"";
+        for (const auto& element : elements) {
+            oss << " \"" << element << "\"";
+        }
+        return oss.str();
+    }
+    
+    // Element reply of a pop from key (LPOP, RPOP)
+    std::optional<std::string> popReply(const std::string& key, std::string response) {
+        if (near_cache) {
+            near_cache->erase(key);
+        }
+        if (!value_reply) {
+            return std::nullopt;    // NOT_FOUND or ERROR
+        }
+        return response;
+    }
+    
+    static std::string formatScore(double score) {
+        char buffer[32];
+        auto [ptr, ec] = std::to_chars(buffer, buffer + sizeof(buffer), score);
+        return ec == std::errc() ? std::string(buffer, ptr) : std::to_string(score);
+    }
+    
+    static std::optional<double> parseScore(const std::string& text) {
+        char* end = nullptr;
+        double score = std::strtod(text.c_str(), &end);
+        if (text.empty() || end != text.c_str() + text.size()) {
+            return std::nullopt;
+        }
+        return score;
+    }
+    
+    // Member, score pairs of a WITHSCORES array reply
+    std::vector<std::pair<std::string, double>> scoredReply(const std::string& command) {
+        auto lines = sendArrayCommand(command);
+        std::vector<std::pair<std::string, double>> members;
+        if (lines.size() % 2 != 0) {
+            return members;     // Error reply
+        }
+        for (size_t i = 0; i < lines.size(); i += 2) {
+            members.emplace_back(std::move(lines[i]), parseScore(lines[i + 1]).value_or(0.0));
+        }
+        return members;
+    }
+    
+    std::optional<std::pair<std::string, std::string>> blockingPop(
+            const std::string& op, const std::vector<std::string>& keys,
+            std::chrono::milliseconds timeout) {
+        std::ostringstream oss;
+        oss << op;
+        for (const auto& key : keys) {
+            oss << " \"" << key << "\"";
+        }
+        oss << " " << timeout.count();
+        
+        std::string header = sendCommand(oss.str());
+        if (header != "*2") {
+            return std::nullopt;    // Timed out or error
+        }
+        std::string key = readResponse();
+        std::string element = readResponse();
+        if (near_cache) {
+            near_cache->erase(key);
+        }
+        return std::make_pair(std::move(key), std::move(element));
+    }
     
 public:
     KVClient(const std::string& host = "127.0.0.1", uint16_t port = 6379)
@@ -31,6 +577,25 @@ public:
         tcp::resolver resolver(io_context);
         auto endpoints = resolver.resolve(host, std::to_string(port));
         asio::connect(socket, endpoints);
+        socket.set_option(tcp::no_delay(true));
+        if (connected_once) {
+            reconnects.fetch_add(1, std::memory_order_relaxed);
+        }
+        connected_once = true;
+        read_buffer.consume(read_buffer.size());
+        stale_responses = 0;
+        
+        // Invalidations were lost while disconnected
+        if (near_cache) {
+            near_cache->clear();
+            sendCommand("TRACKING ON");
+        }
+        if (server_timing) {
+            sendCommand("TIMING ON");
+        }
+        if (database != 0) {
+            sendCommand("SELECT " + std::to_string(database));
+        }
     }
     
     void disconnect() {
@@ -46,41 +611,702 @@ public:
             connect();
         }
         
+        OperationMetrics& metrics = metricsFor(command);
+        auto start = std::chrono::steady_clock::now();
         std::string full_command = command + "\n";
         
-        asio::write(socket, asio::buffer(full_command));
-        
-        asio::streambuf response;
-        asio::read_until(socket, response, '\n');
+        in_flight.fetch_add(1, std::memory_order_relaxed);
+        try {
+            asio::write(socket, asio::buffer(full_command));
+            bytes_sent.fetch_add(full_command.size(), std::memory_order_relaxed);
+            
+            std::string response = readResponse();
+            in_flight.fetch_sub(1, std::memory_order_relaxed);
+            recordCompletion(metrics, start, response);
+            return response;
+        } catch (...) {
+            in_flight.fetch_sub(1, std::memory_order_relaxed);
+            metrics.errors.fetch_add(1, std::memory_order_relaxed);
+            throw;
+        }
+    }
+    
+    // Enable the client-side near cache. The server then pushes an
+    // invalidation whenever a key this connection has read is written,
+    // so repeat GETs are served locally without going stale.
+    bool enableNearCache(const NearCacheOptions& options = NearCacheOptions()) {
+        near_cache = std::make_unique<NearCache<std::string, std::string>>(options);
+        if (sendCommand("TRACKING ON") != "OK") {
+            near_cache.reset();
+            return false;
+        }
+        return true;
+    }
+    
+    void disableNearCache() {
+        if (near_cache) {
+            near_cache.reset();
+            sendCommand("TRACKING OFF");
+        }
+    }
+    
+    bool nearCacheEnabled() const {
+        return near_cache != nullptr;
+    }
+    
+    NearCache<std::string, std::string>::Statistics nearCacheStats() const {
+        if (!near_cache) {
+            return {};
+        }
+        return near_cache->getStatistics();
+    }
+    
+    // Hedge GETs across read replicas: when the primary has not answered
+    // within the observed p95 read latency, the same GET goes to the next
+    // replica and whichever replies first wins. Replicas must serve the
+    // same data set; a value read from a replica is never near-cached,
+    // since replica lag would escape the primary's invalidations.
+    void setReplicas(const std::vector<std::pair<std::string, uint16_t>>& endpoints,
+                     const HedgeOptions& options = HedgeOptions()) {
+        replicas.clear();
+        for (const auto& endpoint : endpoints) {
+            auto replica = std::make_unique<Replica>();
+            replica->host = endpoint.first;
+            replica->port = endpoint.second;
+            replicas.push_back(std::move(replica));
+        }
         
-        std::string response_str(
-            asio::buffers_begin(response.data()),
-            asio::buffers_begin(response.data()) + response.size() - 1); // Remove newline
+        hedge_policy = replicas.empty() ? nullptr : std::make_unique<HedgePolicy>(options);
+    }
+    
+    // Ask the server to report its processing time ahead of every reply,
+    // recorded per command in clientStats().server_time
+    bool enableServerTiming() {
+        server_timing = true;
+        if (sendCommand("TIMING ON") != "OK") {
+            server_timing = false;
+            return false;
+        }
+        return true;
+    }
+    
+    void disableServerTiming() {
+        if (server_timing) {
+            sendCommand("TIMING OFF");
+            server_timing = false;
+        }
+    }
+    
+    // Client-side latency, traffic and connection counters. GETs served
+    // by the near cache are not timed here; see nearCacheStats().
+    ClientStatistics clientStats() const {
+        ClientStatistics stats;
+        {
+            std::lock_guard lock(metrics_mutex);
+            for (const auto& entry : op_metrics) {
+                auto& op = stats.operations[entry.first];
+                op.latency = entry.second->latency.summarize();
+                op.server_time = entry.second->server_time.summarize();
+                op.errors = entry.second->errors.load(std::memory_order_relaxed);
+            }
+        }
         
-        response.consume(response.size());
-        return response_str;
+        stats.in_flight = in_flight.load(std::memory_order_relaxed);
+        stats.reconnects = reconnects.load(std::memory_order_relaxed);
+        stats.bytes_sent = bytes_sent.load(std::memory_order_relaxed);
+        stats.bytes_received = bytes_received.load(std::memory_order_relaxed);
+        return stats;
+    }
+    
+    void resetClientStats() {
+        std::lock_guard lock(metrics_mutex);
+        op_metrics.clear();
+        bytes_sent.store(0, std::memory_order_relaxed);
+        bytes_received.store(0, std::memory_order_relaxed);
+    }
+    
+    HedgePolicy::Statistics hedgeStats() const {
+        if (!hedge_policy) {
+            return {};
+        }
+        return hedge_policy->getStatistics();
     }
     
     bool put(const std::string& key, const std::string& value) {
         std::ostringstream oss;
         oss << "PUT \"" << key << "\" \"" << value << "\"";
         std::string response = sendCommand(oss.str());
+        if (near_cache) {
+            near_cache->erase(key);
+        }
         return response == "OK";
     }
     
     std::string get(const std::string& key) {
+        if (near_cache) {
+            drainPushes();
+            
+            std::string cached;
+            if (near_cache->find(key, cached)) {
+                return cached;
+            }
+            
+            pending_get_key = key;
+            pending_get_invalidated = false;
+            get_pending = true;
+        }
+        
         std::ostringstream oss;
         oss << "GET \"" << key << "\"";
-        return sendCommand(oss.str());
+        
+        bool replica_won = false;
+        std::string response = hedge_policy ? sendHedgedCommand(oss.str(), replica_won)
+                                            : sendCommand(oss.str());
+        
+        if (near_cache) {
+            get_pending = false;
+            if (!pending_get_invalidated && !replica_won && value_reply) {
+                near_cache->insert(key, response);
+            }
+        }
+        return response;
+    }
+    
+    // Streaming upload for values larger than max_value_size. next_chunk
+    // fills in the next chunk and returns false once there is no more data;
+    // the value becomes visible atomically when the upload completes.
+    bool putStream(const std::string& key,
+                   const std::function<bool(std::string&)>& next_chunk) {
+        std::string quoted_key = "\"" + key + "\"";
+        if (sendCommand("PUT.BEGIN " + quoted_key) != "OK") {
+            return false;
+        }
+        
+        std::string chunk;
+        while (next_chunk(chunk)) {
+            if (chunk.empty()) {
+                continue;
+            }
+            if (sendCommand("PUT.CHUNK " + quoted_key + " \"" + chunk + "\"") != "OK") {
+                sendCommand("PUT.ABORT " + quoted_key);
+                return false;
+            }
+            chunk.clear();
+        }
+        
+        bool stored = sendCommand("PUT.END " + quoted_key) == "OK";
+        if (near_cache) {
+            near_cache->erase(key);
+        }
+        return stored;
+    }
+    
+    // Upload a value given as a range of string chunks
+    template<typename Iterator>
+    bool putStream(const std::string& key, Iterator begin, Iterator end) {
+        return putStream(key, [&begin, end](std::string& chunk) {
+            if (begin == end) {
+                return false;
+            }
+            chunk = *begin++;
+            return true;
+        });
+    }
+    
+    // Streaming download: on_chunk receives the value in order, at most
+    // chunk_size bytes at a time. Returns false if the key is missing or
+    // its size changes mid-download (chunks are separate reads).
+    bool getStream(const std::string& key,
+                   const std::function<void(const std::string&)>& on_chunk,
+                   size_t chunk_size = 65536) {
+        std::string quoted_key = "\"" + key + "\"";
+        size_t offset = 0;
+        size_t total = 0;
+        
+        do {
+            // [total_size, bytes]; anything else is NOT_FOUND or ERROR
+            auto reply = sendArrayCommand("GET.CHUNK " + quoted_key + " " +
+                                          std::to_string(offset) + " " +
+                                          std::to_string(chunk_size));
+            size_t size = 0;
+            if (reply.size() != 2) {
+                return false;
+            }
+            const char* digits_end = reply[0].data() + reply[0].size();
+            auto [ptr, ec] = std::from_chars(reply[0].data(), digits_end, size);
+            if (reply[0].empty() || ec != std::errc() || ptr != digits_end) {
+                return false;
+            }
+            if (offset > 0 && size != total) {
+                return false;
+            }
+            total = size;
+            
+            if (!reply[1].empty()) {
+                on_chunk(reply[1]);
+                offset += reply[1].size();
+            } else if (offset < total) {
+                return false; // Shrunk underneath us
+            }
+        } while (offset < total);
+        
+        return true;
     }
     
     bool del(const std::string& key) {
         std::ostringstream oss;
         oss << "DELETE \"" << key << "\"";
         std::string response = sendCommand(oss.str());
+        if (near_cache) {
+            near_cache->erase(key);
+        }
         return response == "OK";
     }
     
+    // Atomically add delta to the integer at key on the server (a missing
+    // key counts as 0); empty if the value is not an integer or would
+    // overflow
+    std::optional<int64_t> incrBy(const std::string& key, int64_t delta) {
+        std::ostringstream oss;
+        oss << "INCRBY \"" << key << "\" " << delta;
+        std::string response = sendCommand(oss.str());
+        if (near_cache) {
+            near_cache->erase(key);
+        }
+        
+        int64_t result;
+        const char* end = response.data() + response.size();
+        auto [ptr, ec] = std::from_chars(response.data(), end, result);
+        if (response.empty() || ec != std::errc() || ptr != end) {
+            return std::nullopt;
+        }
+        return result;
+    }
+    
+    std::optional<int64_t> incr(const std::string& key) {
+        return incrBy(key, 1);
+    }
+    
+    std::optional<int64_t> decr(const std::string& key) {
+        return incrBy(key, -1);
+    }
+    
+    // Append data on the server; returns the new length, or empty on error
+    std::optional<size_t> append(const std::string& key, const std::string& data) {
+        std::ostringstream oss;
+        oss << "APPEND \"" << key << "\" \"" << data << "\"";
+        return lengthReply(key, sendCommand(oss.str()));
+    }
+    
+    // Overwrite bytes from offset on (zero-padding a shorter value);
+    // returns the new length, or empty on error
+    std::optional<size_t> setRange(const std::string& key, size_t offset,
+                                   const std::string& data) {
+        std::ostringstream oss;
+        oss << "SETRANGE \"" << key << "\" " << offset << " \"" << data << "\"";
+        return lengthReply(key, sendCommand(oss.str()));
+    }
+    
+    // Bytes start..end inclusive; negative offsets count from the end
+    std::string getRange(const std::string& key, int64_t start, int64_t end) {
+        std::ostringstream oss;
+        oss << "GETRANGE \"" << key << "\" " << start << " " << end;
+        return sendCommand(oss.str());
+    }
+    
+    size_t strlen(const std::string& key) {
+        std::ostringstream oss;
+        oss << "STRLEN \"" << key << "\"";
+        std::string response = sendCommand(oss.str());
+        try {
+            return std::stoul(response);
+        } catch (...) {
+            return 0;
+        }
+    }
+    
+    // Set fields of the hash at key; returns the number of new fields,
+    // or empty on error (e.g. key holds a string)
+    std::optional<size_t> hset(const std::string& key,
+                               const std::vector<std::pair<std::string, std::string>>& fields) {
+        std::ostringstream oss;
+        oss << "HSET \"" << key << "\"";
+        for (const auto& [field, value] : fields) {
+            oss << " \"" << field << "\" \"" << value << "\"";
+        }
+        return lengthReply(key, sendCommand(oss.str()));
+    }
+    
+    std::optional<std::string> hget(const std::string& key, const std::string& field) {
+        std::ostringstream oss;
+        oss << "HGET \"" << key << "\" \"" << field << "\"";
+        std::string response = sendCommand(oss.str());
+        if (!value_reply) {
+            return std::nullopt;    // NOT_FOUND or ERROR
+        }
+        return response;
+    }
+    
+    // One value per field, empty for missing fields
+    std::vector<std::optional<std::string>> hmget(const std::string& key,
+                                                  const std::vector<std::string>& fields) {
+        std::ostringstream oss;
+        oss << "HMGET \"" << key << "\"";
+        for (const auto& field : fields) {
+            oss << " \"" << field << "\"";
+        }
+        
+        std::vector<std::optional<std::string>> values;
+        std::string header = sendCommand(oss.str());
+        if (header.empty() || header[0] != '*') {
+            values.resize(fields.size());   // Error reply
+            return values;
+        }
+        size_t count = std::stoul(header.substr(1));
+        for (size_t i = 0; i < count; ++i) {
+            std::string value = readResponse();
+            values.push_back(value_reply ? std::optional<std::string>(std::move(value))
+                                         : std::nullopt);
+        }
+        return values;
+    }
+    
+    std::vector<std::pair<std::string, std::string>> hgetAll(const std::string& key) {
+        auto lines = sendArrayCommand("HGETALL \"" + key + "\"");
+        std::vector<std::pair<std::string, std::string>> pairs;
+        if (lines.size() % 2 != 0) {
+            return pairs;       // Error reply
+        }
+        for (size_t i = 0; i < lines.size(); i += 2) {
+            pairs.emplace_back(std::move(lines[i]), std::move(lines[i + 1]));
+        }
+        return pairs;
+    }
+    
+    // Remove fields; returns the number removed, or empty on error
+    std::optional<size_t> hdel(const std::string& key, const std::vector<std::string>& fields) {
+        std::ostringstream oss;
+        oss << "HDEL \"" << key << "\"";
+        for (const auto& field : fields) {
+            oss << " \"" << field << "\"";
+        }
+        return lengthReply(key, sendCommand(oss.str()));
+    }
+    
+    // Atomically add delta to the integer in a hash field (missing counts
+    // as 0); empty if it is not an integer or would overflow
+    std::optional<int64_t> hincrBy(const std::string& key, const std::string& field,
+                                   int64_t delta) {
+        std::ostringstream oss;
+        oss << "HINCRBY \"" << key << "\" \"" << field << "\" " << delta;
+        std::string response = sendCommand(oss.str());
+        if (near_cache) {
+            near_cache->erase(key);
+        }
+        
+        int64_t result;
+        const char* end = response.data() + response.size();
+        auto [ptr, ec] = std::from_chars(response.data(), end, result);
+        if (response.empty() || ec != std::errc() || ptr != end) {
+            return std::nullopt;
+        }
+        return result;
+    }
+    
+    // Push elements onto the head (LPUSH) or tail (RPUSH) of a list;
+    // returns the new length, or empty on error
+    std::optional<size_t> lpush(const std::string& key, const std::vector<std::string>& elements) {
+        return lengthReply(key, sendCommand(listCommand("LPUSH", key, elements)));
+    }
+    
+    std::optional<size_t> rpush(const std::string& key, const std::vector<std::string>& elements) {
+        return lengthReply(key, sendCommand(listCommand("RPUSH", key, elements)));
+    }
+    
+    // Pop from the head or tail; empty if the list is empty or missing
+    std::optional<std::string> lpop(const std::string& key) {
+        return popReply(key, sendCommand("LPOP \"" + key + "\""));
+    }
+    
+    std::optional<std::string> rpop(const std::string& key) {
+        return popReply(key, sendCommand("RPOP \"" + key + "\""));
+    }
+    
+    // Pop from the first non-empty list of keys, waiting up to timeout
+    // (0 = indefinitely) for an element; returns the key and element, or
+    // empty on timeout. The server parks the connection while it waits,
+    // so consumers need no polling loop.
+    std::optional<std::pair<std::string, std::string>> blpop(
+            const std::vector<std::string>& keys, std::chrono::milliseconds timeout) {
+        return blockingPop("BLPOP", keys, timeout);
+    }
+    
+    std::optional<std::pair<std::string, std::string>> brpop(
+            const std::vector<std::string>& keys, std::chrono::milliseconds timeout) {
+        return blockingPop("BRPOP", keys, timeout);
+    }
+    
+    // Elements start..stop inclusive; negative indexes count from the end
+    std::vector<std::string> lrange(const std::string& key, int64_t start, int64_t stop) {
+        std::ostringstream oss;
+        oss << "LRANGE \"" << key << "\" " << start << " " << stop;
+        std::string header = sendCommand(oss.str());
+        std::vector<std::string> elements;
+        if (header.empty() || header[0] != '*') {
+            return elements;    // Error reply
+        }
+        size_t count = std::stoul(header.substr(1));
+        elements.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            elements.push_back(readResponse());
+        }
+        return elements;
+    }
+    
+    size_t llen(const std::string& key) {
+        std::string response = sendCommand("LLEN \"" + key + "\"");
+        try {
+            return std::stoul(response);
+        } catch (...) {
+            return 0;
+        }
+    }
+    
+    // Add members with scores to a sorted set (or move them); returns the
+    // number of new members, or empty on error
+    std::optional<size_t> zadd(const std::string& key,
+                               const std::vector<std::pair<std::string, double>>& members) {
+        std::ostringstream oss;
+        oss << "ZADD \"" << key << "\"";
+        for (const auto& [member, score] : members) {
+            oss << " " << formatScore(score) << " \"" << member << "\"";
+        }
+        return lengthReply(key, sendCommand(oss.str()));
+    }
+    
+    // Add delta to a member's score (missing counts as 0); returns the
+    // new score
+    std::optional<double> zincrBy(const std::string& key, const std::string& member,
+                                  double delta) {
+        std::ostringstream oss;
+        oss << "ZINCRBY \"" << key << "\" " << formatScore(delta) << " \"" << member << "\"";
+        std::string response = sendCommand(oss.str());
+        if (near_cache) {
+            near_cache->erase(key);
+        }
+        return parseScore(response);
+    }
+    
+    // Members ranked start..stop in score order, with their scores;
+    // negative ranks count from the end
+    std::vector<std::pair<std::string, double>> zrange(const std::string& key,
+                                                       int64_t start, int64_t stop) {
+        std::ostringstream oss;
+        oss << "ZRANGE \"" << key << "\" " << start << " " << stop << " WITHSCORES";
+        return scoredReply(oss.str());
+    }
+    
+    // Members with min <= score <= max (bounds as in ZRANGEBYSCORE, e.g.
+    // "(10" or "+inf"), at most limit of them after skipping offset
+    std::vector<std::pair<std::string, double>> zrangeByScore(
+            const std::string& key, const std::string& min, const std::string& max,
+            size_t offset = 0, int64_t limit = -1) {
+        std::ostringstream oss;
+        oss << "ZRANGEBYSCORE \"" << key << "\" " << min << " " << max
+            << " WITHSCORES LIMIT " << offset << " " << limit;
+        return scoredReply(oss.str());
+    }
+    
+    std::optional<size_t> zrank(const std::string& key, const std::string& member) {
+        std::string response = sendCommand("ZRANK \"" + key + "\" \"" + member + "\"");
+        size_t rank;
+        const char* end = response.data() + response.size();
+        auto [ptr, ec] = std::from_chars(response.data(), end, rank);
+        if (response.empty() || ec != std::errc() || ptr != end) {
+            return std::nullopt;
+        }
+        return rank;
+    }
+    
+    std::optional<double> zscore(const std::string& key, const std::string& member) {
+        return parseScore(sendCommand("ZSCORE \"" + key + "\" \"" + member + "\""));
+    }
+    
+    // Remove members; returns the number removed, or empty on error
+    std::optional<size_t> zrem(const std::string& key, const std::vector<std::string>& members) {
+        return lengthReply(key, sendCommand(listCommand("ZREM", key, members)));
+    }
+    
+    size_t zcard(const std::string& key) {
+        std::string response = sendCommand("ZCARD \"" + key + "\"");
+        try {
+            return std::stoul(response);
+        } catch (...) {
+            return 0;
+        }
+    }
+    
+    // Add members to a set; returns the number that were new, or empty
+    // on error
+    std::optional<size_t> sadd(const std::string& key, const std::vector<std::string>& members) {
+        return lengthReply(key, sendCommand(listCommand("SADD", key, members)));
+    }
+    
+    std::optional<size_t> srem(const std::string& key, const std::vector<std::string>& members) {
+        return lengthReply(key, sendCommand(listCommand("SREM", key, members)));
+    }
+    
+    bool sismember(const std::string& key, const std::string& member) {
+        return sendCommand("SISMEMBER \"" + key + "\" \"" + member + "\"") == "1";
+    }
+    
+    std::vector<std::string> smembers(const std::string& key) {
+        return membersReply("SMEMBERS \"" + key + "\"");
+    }
+    
+    size_t scard(const std::string& key) {
+        std::string response = sendCommand("SCARD \"" + key + "\"");
+        try {
+            return std::stoul(response);
+        } catch (...) {
+            return 0;
+        }
+    }
+    
+    // Intersection or union of the sets at keys, computed by the server
+    std::vector<std::string> sinter(const std::vector<std::string>& keys) {
+        return keys.empty() ? std::vector<std::string>()
+                            : membersReply(listCommand("SINTER", keys[0],
+                                                       {keys.begin() + 1, keys.end()}));
+    }
+    
+    std::vector<std::string> sunion(const std::vector<std::string>& keys) {
+        return keys.empty() ? std::vector<std::string>()
+                            : membersReply(listCommand("SUNION", keys[0],
+                                                       {keys.begin() + 1, keys.end()}));
+    }
+    
+    // Add elements to a HyperLogLog; true if its estimate may have
+    // changed, empty on error
+    std::optional<bool> pfadd(const std::string& key, const std::vector<std::string>& elements) {
+        auto changed = lengthReply(key, sendCommand(listCommand("PFADD", key, elements)));
+        if (!changed) {
+            return std::nullopt;
+        }
+        return *changed == 1;
+    }
+    
+    // Estimated distinct elements across the HyperLogLogs at keys
+    std::optional<uint64_t> pfcount(const std::vector<std::string>& keys) {
+        if (keys.empty()) {
+            return std::nullopt;
+        }
+        std::string response = sendCommand(listCommand("PFCOUNT", keys[0],
+                                                       {keys.begin() + 1, keys.end()}));
+        uint64_t count;
+        const char* end = response.data() + response.size();
+        auto [ptr, ec] = std::from_chars(response.data(), end, count);
+        if (response.empty() || ec != std::errc() || ptr != end) {
+            return std::nullopt;
+        }
+        return count;
+    }
+    
+    bool pfmerge(const std::string& dest, const std::vector<std::string>& sources) {
+        if (near_cache) {
+            near_cache->erase(dest);
+        }
+        return sendCommand(listCommand("PFMERGE", dest, sources)) == "OK";
+    }
+    
+    // Create a Bloom filter for capacity items at error_rate; false if the
+    // key exists or the parameters are out of range
+    bool bfReserve(const std::string& key, double error_rate, uint64_t capacity,
+                   uint32_t expansion = 2) {
+        std::ostringstream oss;
+        oss << "BF.RESERVE \"" << key << "\" " << formatScore(error_rate) << " " << capacity
+            << " EXPANSION " << expansion;
+        return sendCommand(oss.str()) == "OK";
+    }
+    
+    // Add an item to a Bloom filter (created with the server's defaults
+    // if missing); false if it may have been present already
+    bool bfAdd(const std::string& key, const std::string& item) {
+        return sendCommand(listCommand("BF.ADD", key, {item})) == "1";
+    }
+    
+    // One round trip for many items; one result per item, none on error
+    std::vector<bool> bfMadd(const std::string& key, const std::vector<std::string>& items) {
+        return flagsReply(membersReply(listCommand("BF.MADD", key, items)));
+    }
+    
+    // False if the item is definitely not in the filter
+    bool bfExists(const std::string& key, const std::string& item) {
+        return sendCommand(listCommand("BF.EXISTS", key, {item})) == "1";
+    }
+    
+    std::vector<bool> bfMexists(const std::string& key, const std::vector<std::string>& items) {
+        return flagsReply(membersReply(listCommand("BF.MEXISTS", key, items)));
+    }
+    
+    // Set or clear one bit of the string at key; returns the previous
+    // bit, or empty on error
+    std::optional<bool> setBit(const std::string& key, uint64_t offset, bool bit) {
+        std::ostringstream oss;
+        oss << "SETBIT \"" << key << "\" " << offset << " " << (bit ? 1 : 0);
+        auto previous = lengthReply(key, sendCommand(oss.str()));
+        if (!previous) {
+            return std::nullopt;
+        }
+        return *previous == 1;
+    }
+    
+    bool getBit(const std::string& key, uint64_t offset) {
+        std::ostringstream oss;
+        oss << "GETBIT \"" << key << "\" " << offset;
+        return sendCommand(oss.str()) == "1";
+    }
+    
+    // Set bits in bytes start..end inclusive (negative offsets count from
+    // the end), by default the whole value
+    std::optional<uint64_t> bitCount(const std::string& key, int64_t start = 0,
+                                     int64_t end = -1) {
+        std::ostringstream oss;
+        oss << "BITCOUNT \"" << key << "\" " << start << " " << end;
+        std::string response = sendCommand(oss.str());
+        uint64_t count;
+        const char* last = response.data() + response.size();
+        auto [ptr, ec] = std::from_chars(response.data(), last, count);
+        if (response.empty() || ec != std::errc() || ptr != last) {
+            return std::nullopt;
+        }
+        return count;
+    }
+    
+    // Index of the first bit equal to bit from byte start on, -1 if there
+    // is none; empty on error
+    std::optional<int64_t> bitPos(const std::string& key, bool bit, int64_t start = 0) {
+        std::ostringstream oss;
+        oss << "BITPOS \"" << key << "\" " << (bit ? 1 : 0) << " " << start;
+        std::string response = sendCommand(oss.str());
+        int64_t position;
+        const char* last = response.data() + response.size();
+        auto [ptr, ec] = std::from_chars(response.data(), last, position);
+        if (response.empty() || ec != std::errc() || ptr != last) {
+            return std::nullopt;
+        }
+        return position;
+    }
+    
+    // Store op ("AND", "OR", "XOR" or "NOT") of the strings at sources in
+    // dest; returns the length of dest, or empty on error
+    std::optional<size_t> bitOp(const std::string& op, const std::string& dest,
+                                const std::vector<std::string>& sources) {
+        std::vector<std::string> keys = {dest};
+        keys.insert(keys.end(), sources.begin(), sources.end());
+        return lengthReply(dest, sendCommand(listCommand("BITOP", op, keys)));
+    }
+    
     bool exists(const std::string& key) {
         std::ostringstream oss;
         oss << "EXISTS \"" << key << "\"";
@@ -101,12 +1327,68 @@ public:
         return sendCommand("PING") == "PONG";
     }
     
+    // Switch this client (and its replica connections) to namespace
+    // database; false if the server has no such namespace
+    bool select(size_t database) {
+        if (sendCommand("SELECT " + std::to_string(database)) != "OK") {
+            return false;
+        }
+        this->database = database;
+        
+        // Cached values belong to the previous namespace
+        if (near_cache) {
+            near_cache->clear();
+        }
+        for (auto& replica : replicas) {
+            replica->socket.reset();
+        }
+        return true;
+    }
+    
+    // Remove every key of the selected namespace
     bool flush() {
+        if (near_cache) {
+            near_cache->clear();
+        }
         return sendCommand("FLUSH") == "OK";
     }
     
+    // Remove every key of every namespace
+    bool flushAll() {
+        if (near_cache) {
+            near_cache->clear();
+        }
+        return sendCommand("FLUSHALL") == "OK";
+    }
+    
+    // Send a command whose reply is a "*<count>" framed list of lines
+    // or values
+    std::vector<std::string> sendArrayCommand(const std::string& command) {
+        std::string header = sendCommand(command);
+        std::vector<std::string> lines;
+        
+        if (header.empty() || header[0] != '*') {
+            lines.push_back(header); // Error or single-line reply
+            return lines;
+        }
+        
+        size_t count = std::stoul(header.substr(1));
+        lines.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            lines.push_back(readResponse());
+        }
+        return lines;
+    }
+    
     std::string stats() {
-        return sendCommand("STATS");
+        std::string result;
+        for (const auto& line : sendArrayCommand("STATS")) {
+            if (!result.empty()) {
+                result += "\n";
+            }
+            result += line;
+        }
+        return result;
     }
     
     // Batch operations
@@ -0,0 +1,2860 @@
+#ifndef KV_STORE_ENGINE_HPP
+#define KV_STORE_ENGINE_HPP
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <functional>
+#include <filesystem>
+#include <chrono>
+#include <charconv>
+#include <cstring>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <cmath>
+#include <algorithm>
+#include <unordered_set>
+#include <random>
+#include "concurrent_hash_map.hpp"
+#include "hash_value.hpp"
+#include "list_value.hpp"
+#include "zset_value.hpp"
+#include "set_value.hpp"
+#include "hll_value.hpp"
+#include "bloom_value.hpp"
+#include "bitmap.hpp"
+#include "auto_tuner.hpp"
+#include "write_ahead_log.hpp"
+#include "types.hpp"
+
+namespace kvstore {
+
+// Result of an engine operation
+enum class Status {
+    OK,
+    NOT_FOUND,
+    WAL_ERROR,
+    NOT_INTEGER,        // INCR on a value that is not a 64-bit integer
+    OUT_OF_RANGE,       // INCR result would overflow int64
+    WRONG_TYPE,         // Operation on a key holding another value type
+    KEY_EXISTS,         // Create of a key that already exists (BF.RESERVE)
+    OUT_OF_MEMORY       // Write refused: over max_memory with nothing to evict
+};
+
+// Embeddable storage engine: the concurrent hash map, write-ahead log,
+// checkpoints and key expiry, with no networking. KVServer is a TCP
+// front end over it, and libkvstore exposes it to C through kvstore.h.
+//
+// Every write is logged and applied under the key's bucket lock, so the
+// WAL order of writes to one key always matches the in-memory order.
+// A checkpoint writes the live data set to "<wal_file>.snapshot" and then
+// truncates the WAL; recovery loads the snapshot and replays the rest.
+//
+// With config.sync_wal a write returns once its entries reach the OS, so
+// it survives a process crash but not a power loss. config.fsync_writes
+// also fsyncs the WAL (group commit) before the write is applied.
+//
+// With config.auto_tune the segment count is chosen by AutoTuner at
+// construction and both maps are resized online as they grow (also during
+// recovery, which would otherwise replay into overlong bucket chains).
+//
+// One engine is one namespace: the server runs one per SELECT index, each
+// with its own map, WAL, memory quota and statistics. With
+// config.max_memory set, writes that may grow the data first evict keys
+// per config.eviction_policy, or fail with OUT_OF_MEMORY.
+class KVEngine {
+private:
+    // A value in canonical decimal integer form (what INCR produces and
+    // what GET must return byte for byte) is stored as its int64 in the
+    // string's inline buffer: counters never allocate, and INCR adds
+    // without parsing. text() gives the decimal form back.
+    //
+    // Other value types (hashes, lists, sorted sets) live in collection,
+    // and value is unused.
+    struct Entry {
+        std::string value;
+        std::unique_ptr<Collection> collection;
+        uint64_t expires_at : 63;   // ms since epoch, 0 = no expiry
+        uint64_t is_integer : 1;
+
+        explicit Entry(const std::string& text = "", uint64_t expires_at = 0)
+            : expires_at(expires_at), is_integer(0) {
+            int64_t number;
+            if (parseCanonical(text, number)) {
+                setInteger(number);
+            } else {
+                value = text;
+            }
+        }
+
+        static Entry integer(int64_t number, uint64_t expires_at) {
+            Entry entry;
+            entry.expires_at = expires_at;
+            entry.setInteger(number);
+            return entry;
+        }
+
+        void setInteger(int64_t number) {
+            value.assign(reinterpret_cast<const char*>(&number), sizeof(number));
+            is_integer = 1;
+        }
+
+        bool isString() const {
+            return !collection;
+        }
+
+        ValueType type() const {
+            return collection ? collection->type() : ValueType::STRING;
+        }
+
+        std::string text() const {
+            if (!is_integer) {
+                return value;
+            }
+            int64_t number;
+            toInteger(number);
+            return std::to_string(number);
+        }
+
+        // Integer value, also of text that parses as one (e.g. "007")
+        bool toInteger(int64_t& number) const {
+            if (is_integer) {
+                std::memcpy(&number, value.data(), sizeof(number));
+                return true;
+            }
+            const char* end = value.data() + value.size();
+            auto [ptr, ec] = std::from_chars(value.data(), end, number);
+            return ec == std::errc() && ptr == end && !value.empty();
+        }
+
+        // Switch to the text form before modifying the bytes in place
+        std::string& mutableText() {
+            if (is_integer) {
+                value = text();
+                is_integer = 0;
+            }
+            return value;
+        }
+
+        // Re-encode after an in-place change, if the text is an integer now
+        void normalize() {
+            int64_t number;
+            if (!is_integer && value.size() <= 20 && parseCanonical(value, number)) {
+                setInteger(number);
+            }
+        }
+
+        // True if text is exactly std::to_string of an int64
+        static bool parseCanonical(const std::string& text, int64_t& number) {
+            if (text.empty() || text.size() > 20 ||
+                (text[0] != '-' && (text[0] < '0' || text[0] > '9'))) {
+                return false;
+            }
+            const char* end = text.data() + text.size();
+            auto [ptr, ec] = std::from_chars(text.data(), end, number);
+            if (ec != std::errc() || ptr != end) {
+                return false;
+            }
+            // No leading zeros or "-0"
+            size_t digits = text[0] == '-' ? 1 : 0;
+            return text[digits] != '0' || (text.size() == 1);
+        }
+    };
+
+    // Approximate bytes of an entry: its map node, key and value bytes
+    // and any collection. The store keeps the total (used_memory).
+    struct EntryWeigher {
+        static constexpr size_t kNodeOverhead =
+            sizeof(std::pair<std::string, Entry>) + 2 * sizeof(void*);
+
+        size_t operator()(const std::string& key, const Entry& entry) const {
+            return kNodeOverhead + key.size() + entry.value.size() +
+                   (entry.collection ? entry.collection->memoryUsage() : 0);
+        }
+    };
+
+    static std::string encodeDelta(int64_t delta) {
+        return std::string(reinterpret_cast<const char*>(&delta), sizeof(delta));
+    }
+
+    static std::string encodeOffset(uint64_t offset, const std::string& data) {
+        std::string record(reinterpret_cast<const char*>(&offset), sizeof(offset));
+        return record + data;
+    }
+
+    // Overwrite text at offset, zero-padding any gap (SETRANGE)
+    static void writeAt(std::string& text, size_t offset, const std::string& data) {
+        if (text.size() < offset + data.size()) {
+            text.resize(offset + data.size(), '\0');
+        }
+        text.replace(offset, data.size(), data);
+    }
+
+    // The bytes of a string entry, formatting an integer into scratch
+    static const std::string& bytesOf(const Entry& entry, std::string& scratch) {
+        if (!entry.is_integer) {
+            return entry.value;
+        }
+        scratch = entry.text();
+        return scratch;
+    }
+
+    // Bytes first..last of a size-byte value for start..end inclusive,
+    // negative offsets counting from the end (GETRANGE, BITCOUNT); false
+    // if the range is empty
+    static bool byteRange(int64_t size, int64_t start, int64_t end,
+                          int64_t& first, int64_t& last) {
+        first = start < 0 ? std::max<int64_t>(size + start, 0) : start;
+        last = end < 0 ? size + end : std::min(end, size - 1);
+        return first <= last && first < size;
+    }
+
+    static bool addWouldOverflow(int64_t base, int64_t delta) {
+        return (delta > 0 && base > INT64_MAX - delta) ||
+               (delta < 0 && base < INT64_MIN - delta);
+    }
+
+    // Listpack elements per record when a checkpoint writes out a
+    // collection (1024 hash fields with their values)
+    static constexpr size_t kSnapshotElementsPerRecord = 2048;
+
+    // How often a blocked pop checks whether it was cancelled
+    static constexpr auto kBlockedPopCheckInterval = std::chrono::milliseconds(100);
+
+    Entry newHash() const {
+        Entry entry;
+        entry.collection = std::make_unique<HashValue>(config.hash_max_listpack_entries,
+                                                       config.hash_max_listpack_value);
+        return entry;
+    }
+
+    static bool isHash(const Entry& entry) {
+        return entry.type() == ValueType::HASH;
+    }
+
+    static HashValue& hashOf(Entry& entry) {
+        return static_cast<HashValue&>(*entry.collection);
+    }
+
+    static const HashValue& hashOf(const Entry& entry) {
+        return static_cast<const HashValue&>(*entry.collection);
+    }
+
+    Entry newList() const {
+        Entry entry;
+        entry.collection = std::make_unique<ListValue>(config.list_max_listpack_size);
+        return entry;
+    }
+
+    static bool isList(const Entry& entry) {
+        return entry.type() == ValueType::LIST;
+    }
+
+    static ListValue& listOf(Entry& entry) {
+        return static_cast<ListValue&>(*entry.collection);
+    }
+
+    static const ListValue& listOf(const Entry& entry) {
+        return static_cast<const ListValue&>(*entry.collection);
+    }
+
+    static Entry newZSet() {
+        Entry entry;
+        entry.collection = std::make_unique<ZSetValue>();
+        return entry;
+    }
+
+    static bool isZSet(const Entry& entry) {
+        return entry.type() == ValueType::ZSET;
+    }
+
+    static ZSetValue& zsetOf(Entry& entry) {
+        return static_cast<ZSetValue&>(*entry.collection);
+    }
+
+    static const ZSetValue& zsetOf(const Entry& entry) {
+        return static_cast<const ZSetValue&>(*entry.collection);
+    }
+
+    Entry newSet() const {
+        Entry entry;
+        entry.collection = std::make_unique<SetValue>(config.set_max_intset_entries);
+        return entry;
+    }
+
+    static bool isSet(const Entry& entry) {
+        return entry.type() == ValueType::SET;
+    }
+
+    static SetValue& setOf(Entry& entry) {
+        return static_cast<SetValue&>(*entry.collection);
+    }
+
+    static const SetValue& setOf(const Entry& entry) {
+        return static_cast<const SetValue&>(*entry.collection);
+    }
+
+    Entry newHll() const {
+        Entry entry;
+        entry.collection = std::make_unique<HyperLogLog>(config.hll_sparse_max_registers);
+        return entry;
+    }
+
+    static bool isHll(const Entry& entry) {
+        return entry.type() == ValueType::HLL;
+    }
+
+    static HyperLogLog& hllOf(Entry& entry) {
+        return static_cast<HyperLogLog&>(*entry.collection);
+    }
+
+    static const HyperLogLog& hllOf(const Entry& entry) {
+        return static_cast<const HyperLogLog&>(*entry.collection);
+    }
+
+    Entry newBloom() const {
+        return newBloom(config.bf_error_rate, config.bf_initial_capacity, config.bf_expansion);
+    }
+
+    static Entry newBloom(double error_rate, uint64_t capacity, uint32_t expansion) {
+        Entry entry;
+        entry.collection = std::make_unique<BloomFilter>(error_rate, capacity, expansion);
+        return entry;
+    }
+
+    static bool isBloom(const Entry& entry) {
+        return entry.type() == ValueType::BLOOM;
+    }
+
+    static BloomFilter& bloomOf(Entry& entry) {
+        return static_cast<BloomFilter&>(*entry.collection);
+    }
+
+    static const BloomFilter& bloomOf(const Entry& entry) {
+        return static_cast<const BloomFilter&>(*entry.collection);
+    }
+
+    static std::vector<BloomFilter::Hash> hashItems(const std::vector<std::string>& items) {
+        std::vector<BloomFilter::Hash> hashes;
+        hashes.reserve(items.size());
+        for (const auto& item : items) {
+            hashes.push_back(BloomFilter::hash(item));
+        }
+        return hashes;
+    }
+
+    static std::string encodeScore(double score) {
+        return std::string(reinterpret_cast<const char*>(&score), sizeof(score));
+    }
+
+    static bool decodeScore(std::string_view bytes, double& score) {
+        if (bytes.size() != sizeof(score)) {
+            return false;
+        }
+        std::memcpy(&score, bytes.data(), sizeof(score));
+        return true;
+    }
+
+    Config config;
+    ConcurrentHashMap<std::string, Entry, StringHasher, EntryWeigher> store;
+    ConcurrentHashMap<std::string, uint64_t> expiry_index;  // Sweep candidates
+    WriteAheadLog wal;
+    std::string snapshot_file;
+
+    // Writers hold this shared; checkpoint and flush hold it exclusively
+    // so the snapshot and the WAL cut-over see no write in between
+    std::shared_mutex checkpoint_mutex;
+    std::atomic<uint64_t> checkpoints{0};
+    std::atomic<uint64_t> checkpoint_fsyncs{0};
+    std::atomic<uint64_t> evictions{0};
+
+    std::mutex tune_mutex;
+    AutoTuner store_tuner;
+    AutoTuner expiry_tuner;
+
+    // Blocked pops sleep on pop_cv until a push bumps pushes. Pushes
+    // skip the notification while no pop is blocked.
+    std::mutex pop_mutex;
+    std::condition_variable pop_cv;
+    uint64_t pushes = 0;
+    std::atomic<size_t> blocked_pops{0};
+
+public:
+    // What recovery did at construction
+    struct RecoveryStatistics {
+        uint64_t snapshot_records = 0;
+        uint64_t wal_records = 0;       // Replayed; excludes entries the snapshot covered
+        double snapshot_ms = 0.0;
+        double wal_ms = 0.0;
+    };
+
+private:
+    RecoveryStatistics recovery_stats;
+
+    std::mutex listener_mutex;
+    std::function<void(const std::string&)> expiry_listener;
+
+    std::thread maintenance_thread;
+    std::mutex maintenance_mutex;
+    std::condition_variable maintenance_cv;
+    bool stopping = false;
+
+    static uint64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static bool expired(const Entry& entry, uint64_t now) {
+        return entry.expires_at != 0 && entry.expires_at <= now;
+    }
+
+    // Apply a logged operation during recovery (no WAL writes)
+    void apply(const WALEntry& entry) {
+        switch (entry.op) {
+            case Operation::PUT:
+                store.insert(entry.key, Entry(entry.value));
+                break;
+            case Operation::DELETE:
+                store.erase(entry.key);
+                break;
+            case Operation::EXPIRE: {
+                uint64_t deadline = std::stoull(entry.value);
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    if (current) {
+                        current->expires_at = deadline;
+                        expiry_index.insert(entry.key, deadline);
+                    }
+                });
+                break;
+            }
+            case Operation::INCR: {
+                if (entry.value.size() != sizeof(int64_t)) {
+                    break;
+                }
+                int64_t delta;
+                std::memcpy(&delta, entry.value.data(), sizeof(delta));
+                // Logged only against a live integer, so this cannot fail
+                // or overflow unless the log is from a different history
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    int64_t base = 0;
+                    if (current && !current->toInteger(base)) {
+                        return;
+                    }
+                    uint64_t expires_at = current ? current->expires_at : 0;
+                    current = Entry::integer(
+                        static_cast<int64_t>(static_cast<uint64_t>(base) + delta), expires_at);
+                });
+                break;
+            }
+            case Operation::APPEND:
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    if (!current) {
+                        current.emplace();
+                    }
+                    current->mutableText() += entry.value;
+                    current->normalize();
+                });
+                break;
+            case Operation::SETRANGE: {
+                if (entry.value.size() < sizeof(uint64_t)) {
+                    break;
+                }
+                uint64_t offset;
+                std::memcpy(&offset, entry.value.data(), sizeof(offset));
+                std::string data = entry.value.substr(sizeof(offset));
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    if (!current) {
+                        current.emplace();
+                    }
+                    writeAt(current->mutableText(), offset, data);
+                    current->normalize();
+                });
+                break;
+            }
+            case Operation::HSET: {
+                Listpack pairs;
+                if (!Listpack::fromBytes(entry.value, pairs)) {
+                    break;
+                }
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    if (!current || !isHash(*current)) {
+                        current = newHash();
+                    }
+                    auto& hash = hashOf(*current);
+                    std::string_view field, value;
+                    for (size_t pos = 0; pos < pairs.end(); ) {
+                        pos = pairs.next(pairs.next(pos, field), value);
+                        hash.set(field, value);
+                    }
+                });
+                break;
+            }
+            case Operation::HDEL: {
+                Listpack fields;
+                if (!Listpack::fromBytes(entry.value, fields)) {
+                    break;
+                }
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    if (!current || !isHash(*current)) {
+                        return;
+                    }
+                    auto& hash = hashOf(*current);
+                    fields.forEach([&](std::string_view field) {
+                        hash.erase(field);
+                    });
+                    if (hash.empty()) {
+                        current.reset();
+                    }
+                });
+                break;
+            }
+            case Operation::LPUSH:
+            case Operation::RPUSH: {
+                Listpack elements;
+                if (!Listpack::fromBytes(entry.value, elements)) {
+                    break;
+                }
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    if (!current || !isList(*current)) {
+                        current = newList();
+                    }
+                    auto& list = listOf(*current);
+                    elements.forEach([&](std::string_view element) {
+                        if (entry.op == Operation::LPUSH) {
+                            list.pushFront(element);
+                        } else {
+                            list.pushBack(element);
+                        }
+                    });
+                });
+                break;
+            }
+            case Operation::LPOP:
+            case Operation::RPOP:
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    if (!current || !isList(*current)) {
+                        return;
+                    }
+                    auto& list = listOf(*current);
+                    std::string element;
+                    if (entry.op == Operation::LPOP) {
+                        list.popFront(element);
+                    } else {
+                        list.popBack(element);
+                    }
+                    if (list.empty()) {
+                        current.reset();
+                    }
+                });
+                break;
+            case Operation::ZADD: {
+                Listpack pairs;
+                if (!Listpack::fromBytes(entry.value, pairs)) {
+                    break;
+                }
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    if (!current || !isZSet(*current)) {
+                        current = newZSet();
+                    }
+                    auto& zset = zsetOf(*current);
+                    std::string_view score_bytes, member;
+                    double score;
+                    for (size_t pos = 0; pos < pairs.end(); ) {
+                        pos = pairs.next(pairs.next(pos, score_bytes), member);
+                        if (decodeScore(score_bytes, score)) {
+                            zset.add(member, score);
+                        }
+                    }
+                });
+                break;
+            }
+            case Operation::ZREM: {
+                Listpack members;
+                if (!Listpack::fromBytes(entry.value, members)) {
+                    break;
+                }
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    if (!current || !isZSet(*current)) {
+                        return;
+                    }
+                    auto& zset = zsetOf(*current);
+                    members.forEach([&](std::string_view member) {
+                        zset.erase(member);
+                    });
+                    if (zset.empty()) {
+                        current.reset();
+                    }
+                });
+                break;
+            }
+            case Operation::SADD: {
+                Listpack members;
+                if (!Listpack::fromBytes(entry.value, members)) {
+                    break;
+                }
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    if (!current || !isSet(*current)) {
+                        current = newSet();
+                    }
+                    auto& set = setOf(*current);
+                    members.forEach([&](std::string_view member) {
+                        set.add(member);
+                    });
+                });
+                break;
+            }
+            case Operation::SREM: {
+                Listpack members;
+                if (!Listpack::fromBytes(entry.value, members)) {
+                    break;
+                }
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    if (!current || !isSet(*current)) {
+                        return;
+                    }
+                    auto& set = setOf(*current);
+                    members.forEach([&](std::string_view member) {
+                        set.erase(member);
+                    });
+                    if (set.empty()) {
+                        current.reset();
+                    }
+                });
+                break;
+            }
+            case Operation::PFADD:
+            case Operation::PFMERGE:
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    if (!current || !isHll(*current)) {
+                        current = newHll();
+                    }
+                    if (entry.op == Operation::PFADD) {
+                        hllOf(*current).applyUpdates(entry.value);
+                    } else {
+                        hllOf(*current).mergeSerialized(entry.value);
+                    }
+                });
+                break;
+            case Operation::BFRESERVE: {
+                double error_rate;
+                uint64_t capacity;
+                uint32_t expansion;
+                if (BloomFilter::decodeParameters(entry.value, error_rate, capacity, expansion)) {
+                    store.insert(entry.key, newBloom(error_rate, capacity, expansion));
+                }
+                break;
+            }
+            case Operation::BFADD: {
+                std::vector<BloomFilter::Hash> hashes;
+                if (!BloomFilter::decodeHashes(entry.value, hashes)) {
+                    break;
+                }
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    if (!current || !isBloom(*current)) {
+                        current = newBloom();
+                    }
+                    auto& filter = bloomOf(*current);
+                    for (const auto& hash : hashes) {
+                        filter.add(hash);
+                    }
+                });
+                break;
+            }
+            case Operation::BFLOAD:
+                store.compute(entry.key, [&](std::optional<Entry>& current) {
+                    if (current && isBloom(*current)) {
+                        bloomOf(*current).loadLayer(entry.value);
+                    }
+                });
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Write a collection to a snapshot as the records that rebuild it,
+    // each a Listpack of at most kSnapshotElementsPerRecord elements
+    static bool writeCollection(WriteAheadLog& snapshot, const std::string& key,
+                                const Entry& entry) {
+        if (isHll(entry)) {
+            return snapshot.writeEntry(Operation::PFMERGE, key, hllOf(entry).serialize());
+        }
+        if (isBloom(entry)) {
+            const auto& filter = bloomOf(entry);
+            bool ok = snapshot.writeEntry(Operation::BFRESERVE, key, filter.encodeParameters());
+            for (size_t i = 0; ok && i < filter.layerCount(); ++i) {
+                ok = snapshot.writeEntry(Operation::BFLOAD, key, filter.encodeLayer(i));
+            }
+            return ok;
+        }
+
+        Listpack batch;
+        bool ok = true;
+        Operation op = isHash(entry) ? Operation::HSET
+                     : isList(entry) ? Operation::RPUSH
+                     : isZSet(entry) ? Operation::ZADD : Operation::SADD;
+        auto flush = [&]() {
+            ok = ok && snapshot.writeEntry(op, key, batch.raw());
+            batch.clear();
+        };
+
+        if (isHash(entry)) {
+            hashOf(entry).forEach([&](std::string_view field, std::string_view value) {
+                batch.push_back(field);
+                batch.push_back(value);
+                if (batch.size() >= kSnapshotElementsPerRecord) {
+                    flush();
+                }
+            });
+        } else if (isList(entry)) {
+            listOf(entry).forEach([&](std::string_view element) {
+                batch.push_back(element);
+                if (batch.size() >= kSnapshotElementsPerRecord) {
+                    flush();
+                }
+            });
+        } else if (isZSet(entry)) {
+            zsetOf(entry).forEach([&](std::string_view member, double score) {
+                batch.push_back(encodeScore(score));
+                batch.push_back(member);
+                if (batch.size() >= kSnapshotElementsPerRecord) {
+                    flush();
+                }
+            });
+        } else if (isSet(entry)) {
+            setOf(entry).forEach([&](std::string_view member) {
+                batch.push_back(member);
+                if (batch.size() >= kSnapshotElementsPerRecord) {
+                    flush();
+                }
+            });
+        }
+        if (!batch.empty()) {
+            flush();
+        }
+        return ok;
+    }
+
+    Status push(const std::string& key, const std::vector<std::string>& elements,
+                bool front, size_t& length) {
+        Status status;
+        {
+            std::shared_lock checkpoint_lock(checkpoint_mutex);
+            uint64_t now = nowMs();
+            length = 0;
+
+            Status room = makeRoom();
+            if (room != Status::OK) {
+                return room;
+            }
+            status = store.compute(key, [&](std::optional<Entry>& current) {
+                bool live = current && !expired(*current, now);
+                if (live && !isList(*current)) {
+                    return Status::WRONG_TYPE;
+                }
+                if (elements.empty()) {
+                    length = live ? listOf(*current).size() : 0;
+                    return Status::OK;
+                }
+
+                Listpack record;
+                for (const auto& element : elements) {
+                    record.push_back(element);
+                }
+                if (!logRecreate(key, current, live) ||
+                    !wal.writeEntry(front ? Operation::LPUSH : Operation::RPUSH, key,
+                                    record.raw())) {
+                    return Status::WAL_ERROR;
+                }
+
+                if (!live) {
+                    current = newList();
+                }
+                auto& list = listOf(*current);
+                for (const auto& element : elements) {
+                    if (front) {
+                        list.pushFront(element);
+                    } else {
+                        list.pushBack(element);
+                    }
+                }
+                length = list.size();
+                return Status::OK;
+            });
+        }
+
+        if (status == Status::OK && !elements.empty() &&
+            blocked_pops.load(std::memory_order_seq_cst) > 0) {
+            {
+                std::lock_guard lock(pop_mutex);
+                pushes++;
+            }
+            pop_cv.notify_all();
+        }
+        return status;
+    }
+
+    Status pop(const std::string& key, bool front, std::string& element) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            if (!current || expired(*current, now)) {
+                return Status::NOT_FOUND;
+            }
+            if (!isList(*current)) {
+                return Status::WRONG_TYPE;
+            }
+            if (!wal.writeEntry(front ? Operation::LPOP : Operation::RPOP, key)) {
+                return Status::WAL_ERROR;
+            }
+
+            auto& list = listOf(*current);
+            if (front) {
+                list.popFront(element);
+            } else {
+                list.popBack(element);
+            }
+            if (list.empty()) {
+                current.reset();
+            }
+            return Status::OK;
+        });
+    }
+
+    Status blockingPop(const std::vector<std::string>& keys, bool front, uint64_t timeout_ms,
+                       std::string& key, std::string& element,
+                       const std::function<bool()>& cancelled) {
+        using Clock = std::chrono::steady_clock;
+        auto deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+
+        // Registered before the first attempt, so a push that the attempt
+        // misses is sure to see the count and notify
+        blocked_pops.fetch_add(1, std::memory_order_seq_cst);
+        std::unique_lock lock(pop_mutex);
+        Status status = Status::NOT_FOUND;
+
+        while (true) {
+            uint64_t seen = pushes;
+            lock.unlock();
+            // Checked before every attempt: a cancelled waiter must not
+            // take the element that woke it
+            bool stop = cancelled && cancelled();
+            for (size_t i = 0; !stop && i < keys.size(); ++i) {
+                status = pop(keys[i], front, element);
+                if (status != Status::NOT_FOUND) {
+                    key = keys[i];
+                    stop = true;
+                }
+            }
+            lock.lock();
+
+            if (stop) {
+                break;
+            }
+            auto now = Clock::now();
+            if (timeout_ms > 0 && now >= deadline) {
+                break;
+            }
+            auto wake = now + kBlockedPopCheckInterval;
+            if (timeout_ms > 0) {
+                wake = std::min(wake, deadline);
+            }
+            pop_cv.wait_until(lock, wake, [&] { return pushes != seen; });
+        }
+
+        lock.unlock();
+        blocked_pops.fetch_sub(1, std::memory_order_relaxed);
+        return status;
+    }
+
+    // Log the records that turn current into a new, empty hash, if it is
+    // expired (not live). Its fields are gone and must not come back on
+    // replay, so the key is deleted first.
+    bool logRecreate(const std::string& key, const std::optional<Entry>& current, bool live) {
+        return live || !current || wal.writeEntry(Operation::DELETE, key);
+    }
+
+    // Called before a write that may grow the data, holding
+    // checkpoint_mutex shared and no bucket lock: while the store is over
+    // max_memory, evict a key per the eviction policy. A single write may
+    // still overshoot the quota, as the check comes first. OUT_OF_MEMORY
+    // under NOEVICTION or once nothing is left to evict.
+    Status makeRoom() {
+        while (config.max_memory > 0 && store.weight() > config.max_memory) {
+            std::string victim;
+            if (config.eviction_policy == EvictionPolicy::NOEVICTION || !pickVictim(victim)) {
+                return Status::OUT_OF_MEMORY;
+            }
+            Status status = evict(victim);
+            if (status == Status::WAL_ERROR) {
+                return status;
+            }
+        }
+        return Status::OK;
+    }
+
+    // A key to evict: any key for ALLKEYS_RANDOM; for VOLATILE_TTL the
+    // nearest deadline among eviction_samples keys with a TTL
+    bool pickVictim(std::string& victim) const {
+        thread_local std::mt19937_64 random{std::random_device{}()};
+        if (config.eviction_policy == EvictionPolicy::ALLKEYS_RANDOM) {
+            return store.sampleKey(random(), victim);
+        }
+
+        uint64_t nearest = UINT64_MAX;
+        for (size_t i = 0; i < std::max<size_t>(config.eviction_samples, 1); ++i) {
+            std::string key;
+            uint64_t deadline = 0;
+            if (!expiry_index.sampleKey(random(), key)) {
+                break;
+            }
+            if (expiry_index.find(key, deadline) && deadline < nearest) {
+                nearest = deadline;
+                victim = std::move(key);
+            }
+        }
+        return nearest != UINT64_MAX;
+    }
+
+    // Delete key to make room, logged like DEL so replay agrees.
+    // NOT_FOUND if it is gone, or under VOLATILE_TTL no longer has a TTL
+    // (a stale expiry index entry, dropped here).
+    Status evict(const std::string& key) {
+        bool volatile_only = config.eviction_policy == EvictionPolicy::VOLATILE_TTL;
+        Status status = store.compute(key, [&](std::optional<Entry>& current) {
+            if (!current || (volatile_only && current->expires_at == 0)) {
+                return Status::NOT_FOUND;
+            }
+            if (!wal.writeEntry(Operation::DELETE, key)) {
+                return Status::WAL_ERROR;
+            }
+            current.reset();
+            return Status::OK;
+        });
+        if (status == Status::WAL_ERROR) {
+            return status;
+        }
+
+        expiry_index.erase(key);
+        if (status == Status::OK) {
+            evictions.fetch_add(1, std::memory_order_relaxed);
+            std::function<void(const std::string&)> listener;
+            {
+                std::lock_guard lock(listener_mutex);
+                listener = expiry_listener;
+            }
+            if (listener) {
+                listener(key);
+            }
+        }
+        return status;
+    }
+
+    // Raise registers (kRegisters bytes) to the union of the HyperLogLogs
+    // at keys, reading each key on its own
+    Status unionRegisters(const std::vector<std::string>& keys, uint8_t* registers,
+                          uint64_t now) const {
+        Status status = Status::OK;
+        for (const auto& key : keys) {
+            store.visit(key, [&](const Entry& entry) {
+                if (expired(entry, now)) {
+                    return;
+                }
+                if (!isHll(entry)) {
+                    status = Status::WRONG_TYPE;
+                } else {
+                    hllOf(entry).maxInto(registers);
+                }
+            });
+            if (status != Status::OK) {
+                return status;
+            }
+        }
+        return status;
+    }
+
+    void recover() {
+        // Keep the segment count up with the replayed key count
+        static constexpr uint64_t kTuneEvery = 65536;
+        uint64_t applied = 0;
+        auto replay = [&](const WALEntry& entry) {
+            apply(entry);
+            if (config.auto_tune && ++applied % kTuneEvery == 0) {
+                tune();
+            }
+        };
+
+        using Clock = std::chrono::steady_clock;
+        auto millisSince = [](Clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        };
+        uint64_t covered = 0;
+
+        auto started = Clock::now();
+        if (std::filesystem::exists(snapshot_file)) {
+            WriteAheadLog snapshot(snapshot_file, false, config.wal_buffer_size);
+            snapshot.replayEntries([&](const WALEntry& entry) {
+                if (entry.op == Operation::CHECKPOINT) {
+                    covered = std::stoull(entry.value);
+                } else {
+                    replay(entry);
+                    recovery_stats.snapshot_records++;
+                }
+            });
+        }
+        recovery_stats.snapshot_ms = millisSince(started);
+
+        // Entries below the snapshot's cut were already folded into it
+        // (the process may have died between writing it and clearing the WAL)
+        // New writes continue past both the snapshot's cut and every entry
+        // actually found in the WAL
+        started = Clock::now();
+        uint64_t next_sequence = covered;
+        wal.replayEntries([&](const WALEntry& entry) {
+            next_sequence = std::max(next_sequence, entry.sequence_number + 1);
+            if (entry.sequence_number >= covered) {
+                replay(entry);
+                recovery_stats.wal_records++;
+            }
+        });
+        recovery_stats.wal_ms = millisSince(started);
+
+        wal.setNextSequence(next_sequence);
+        if (config.auto_tune) {
+            tune();
+        }
+    }
+
+    bool tuning() const {
+        return config.auto_tune && config.tune_interval_ms > 0;
+    }
+
+    void maintenanceLoop() {
+        using Clock = std::chrono::steady_clock;
+        std::unique_lock lock(maintenance_mutex);
+        auto sweep_interval = std::chrono::milliseconds(
+            config.expiry_sweep_interval_ms > 0 ? config.expiry_sweep_interval_ms : 1000);
+        auto tune_interval = std::chrono::milliseconds(config.tune_interval_ms);
+        auto interval = tuning() ? std::min(sweep_interval, tune_interval) : sweep_interval;
+        auto next_sweep = Clock::now() + sweep_interval;
+        auto next_tune = Clock::now() + tune_interval;
+
+        while (!maintenance_cv.wait_for(lock, interval, [this] { return stopping; })) {
+            lock.unlock();
+            auto now = Clock::now();
+
+            if (config.expiry_sweep_interval_ms > 0 && now >= next_sweep) {
+                purgeExpired();
+                next_sweep = now + sweep_interval;
+            }
+            if (tuning() && now >= next_tune) {
+                tune();
+                next_tune = now + tune_interval;
+            }
+            if (config.checkpoint_wal_size > 0 && wal.size() >= config.checkpoint_wal_size) {
+                checkpoint();
+            }
+
+            lock.lock();
+        }
+    }
+
+    // fsync the directory holding path so a rename into it is durable
+    bool syncDirectory(const std::string& path) {
+        std::string dir = std::filesystem::path(path).parent_path().string();
+        int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = ::fsync(fd) == 0;
+        ::close(fd);
+        if (ok) {
+            checkpoint_fsyncs.fetch_add(1, std::memory_order_relaxed);
+        }
+        return ok;
+    }
+
+public:
+    explicit KVEngine(const Config& config)
+        : config(AutoTuner::startupConfig(config)),
+          store(this->config.num_segments),
+          expiry_index(this->config.num_segments),
+          wal(config.wal_file, config.sync_wal, config.wal_buffer_size, config.fsync_writes),
+          snapshot_file(config.wal_file + ".snapshot"),
+          store_tuner(this->config, this->config.num_segments),
+          expiry_tuner(this->config, this->config.num_segments) {
+        recover();
+
+        if (config.expiry_sweep_interval_ms > 0 || config.checkpoint_wal_size > 0 || tuning()) {
+            maintenance_thread = std::thread(&KVEngine::maintenanceLoop, this);
+        }
+    }
+
+    ~KVEngine() {
+        {
+            std::lock_guard lock(maintenance_mutex);
+            stopping = true;
+        }
+        maintenance_cv.notify_all();
+
+        if (maintenance_thread.joinable()) {
+            maintenance_thread.join();
+        }
+    }
+
+    KVEngine(const KVEngine&) = delete;
+    KVEngine& operator=(const KVEngine&) = delete;
+
+    // Store value; a non-zero ttl_ms makes the key expire, otherwise any
+    // previous expiry is cleared
+    Status put(const std::string& key, const std::string& value, uint64_t ttl_ms = 0) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t deadline = ttl_ms > 0 ? nowMs() + ttl_ms : 0;
+
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            if (!wal.writeEntry(Operation::PUT, key, value)) {
+                return Status::WAL_ERROR;
+            }
+            if (deadline != 0 &&
+                !wal.writeEntry(Operation::EXPIRE, key, std::to_string(deadline))) {
+                return Status::WAL_ERROR;
+            }
+
+            current = Entry(value, deadline);
+            if (deadline != 0) {
+                expiry_index.insert(key, deadline);
+            }
+            return Status::OK;
+        });
+    }
+
+    bool get(const std::string& key, std::string& value) const {
+        uint64_t now = nowMs();
+        bool live = false;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (!expired(entry, now) && entry.isString()) {
+                value = entry.text();
+                live = true;
+            }
+        });
+        return live;
+    }
+
+    // Copy at most length bytes starting at offset; total receives the
+    // full value size
+    bool getRange(const std::string& key, size_t offset, size_t length,
+                  std::string& chunk, size_t& total) const {
+        uint64_t now = nowMs();
+        bool live = false;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (!expired(entry, now) && entry.isString()) {
+                std::string integer_text;
+                const std::string* text = &entry.value;
+                if (entry.is_integer) {
+                    integer_text = entry.text();
+                    text = &integer_text;
+                }
+                total = text->size();
+                chunk = offset < total ? text->substr(offset, length) : std::string();
+                live = true;
+            }
+        });
+        return live;
+    }
+
+    // Redis GETRANGE: bytes start..end inclusive, negative offsets
+    // counting from the end; an empty slice if the range is empty
+    bool getSlice(const std::string& key, int64_t start, int64_t end,
+                  std::string& slice) const {
+        uint64_t now = nowMs();
+        bool live = false;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now) || !entry.isString()) {
+                return;
+            }
+            live = true;
+
+            std::string integer_text;
+            const std::string* text = &entry.value;
+            if (entry.is_integer) {
+                integer_text = entry.text();
+                text = &integer_text;
+            }
+
+            int64_t first, last;
+            slice = byteRange(static_cast<int64_t>(text->size()), start, end, first, last)
+                ? text->substr(static_cast<size_t>(first), static_cast<size_t>(last - first + 1))
+                : std::string();
+        });
+        return live;
+    }
+
+    // Length of the value in bytes, 0 if the key does not exist or does
+    // not hold a string
+    size_t valueLength(const std::string& key) const {
+        uint64_t now = nowMs();
+        size_t length = 0;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (!expired(entry, now) && entry.isString()) {
+                length = entry.is_integer ? entry.text().size() : entry.value.size();
+            }
+        });
+        return length;
+    }
+
+    // Append data to the value at key (a missing key starts empty) and
+    // return the new length. Only the appended bytes are logged, so a
+    // small append to a large value costs O(data), not O(value).
+    Status append(const std::string& key, const std::string& data, size_t& length) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            bool live = current && !expired(*current, now);
+            if (live && !current->isString()) {
+                return Status::WRONG_TYPE;
+            }
+            size_t base = live ? (current->is_integer ? current->text().size()
+                                                      : current->value.size()) : 0;
+            if (base + data.size() > config.max_stream_value_size) {
+                return Status::OUT_OF_RANGE;
+            }
+
+            // As with INCR, only a change to a live value may be a delta
+            bool logged = live ? wal.writeEntry(Operation::APPEND, key, data)
+                               : wal.writeEntry(Operation::PUT, key, data);
+            if (!logged) {
+                return Status::WAL_ERROR;
+            }
+
+            if (live) {
+                current->mutableText() += data;
+                current->normalize();
+            } else {
+                current = Entry(data);
+            }
+            length = base + data.size();
+            return Status::OK;
+        });
+    }
+
+    // Overwrite the value at key from offset on, zero-padding it if it is
+    // shorter, and return the new length. Only the written range is
+    // logged. A missing key is created unless data is empty.
+    Status setRange(const std::string& key, size_t offset, const std::string& data,
+                    size_t& length) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+
+        if (offset > config.max_stream_value_size ||
+            data.size() > config.max_stream_value_size - offset) {
+            return Status::OUT_OF_RANGE;
+        }
+
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            bool live = current && !expired(*current, now);
+            if (live && !current->isString()) {
+                return Status::WRONG_TYPE;
+            }
+            size_t base = live ? (current->is_integer ? current->text().size()
+                                                      : current->value.size()) : 0;
+            if (data.empty()) {
+                length = base;
+                return Status::OK;
+            }
+
+            bool logged;
+            if (live) {
+                logged = wal.writeEntry(Operation::SETRANGE, key, encodeOffset(offset, data));
+            } else {
+                std::string text;
+                writeAt(text, offset, data);
+                logged = wal.writeEntry(Operation::PUT, key, text);
+            }
+            if (!logged) {
+                return Status::WAL_ERROR;
+            }
+
+            if (!live) {
+                current = Entry();
+            }
+            writeAt(current->mutableText(), offset, data);
+            current->normalize();
+            length = std::max(base, offset + data.size());
+            return Status::OK;
+        });
+    }
+
+    // Set or clear the bit at offset (bit 0 is the high bit of byte 0) of
+    // the string at key, zero-padding it as SETRANGE does, and return the
+    // previous bit. The changed byte is logged as a one-byte SETRANGE; an
+    // unchanged bit within the value is not logged at all.
+    Status setBit(const std::string& key, uint64_t offset, bool bit, bool& previous) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+        uint64_t byte = offset / 8;
+
+        if (byte >= config.max_stream_value_size) {
+            return Status::OUT_OF_RANGE;
+        }
+
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            bool live = current && !expired(*current, now);
+            if (live && !current->isString()) {
+                return Status::WRONG_TYPE;
+            }
+            std::string scratch;
+            const std::string& text = live ? bytesOf(*current, scratch) : scratch;
+            previous = Bitmap::get(text, offset);
+            if (live && byte < text.size() && previous == bit) {
+                return Status::OK;
+            }
+
+            std::string updated(1, byte < text.size() ? text[byte] : '\0');
+            Bitmap::set(updated, offset % 8, bit);
+            bool logged;
+            if (live) {
+                logged = wal.writeEntry(Operation::SETRANGE, key, encodeOffset(byte, updated));
+            } else {
+                std::string padded;
+                writeAt(padded, byte, updated);
+                logged = wal.writeEntry(Operation::PUT, key, padded);
+            }
+            if (!logged) {
+                return Status::WAL_ERROR;
+            }
+
+            if (!live) {
+                current = Entry();
+            }
+            writeAt(current->mutableText(), byte, updated);
+            current->normalize();
+            return Status::OK;
+        });
+    }
+
+    // The bit at offset; bits past the end of the value, or of a missing
+    // key, are 0
+    Status getBit(const std::string& key, uint64_t offset, bool& bit) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        bit = false;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!entry.isString()) {
+                status = Status::WRONG_TYPE;
+            } else {
+                std::string scratch;
+                bit = Bitmap::get(bytesOf(entry, scratch), offset);
+            }
+        });
+        return status;
+    }
+
+    // Set bits in bytes start..end inclusive of the string at key,
+    // negative offsets counting from the end as in GETRANGE
+    Status bitCount(const std::string& key, int64_t start, int64_t end,
+                    uint64_t& count) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        count = 0;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!entry.isString()) {
+                status = Status::WRONG_TYPE;
+                return;
+            }
+            std::string scratch;
+            const std::string& text = bytesOf(entry, scratch);
+            int64_t first, last;
+            if (byteRange(static_cast<int64_t>(text.size()), start, end, first, last)) {
+                count = Bitmap::count(
+                    reinterpret_cast<const unsigned char*>(text.data()) + first,
+                    static_cast<size_t>(last - first + 1));
+            }
+        });
+        return status;
+    }
+
+    // Index of the first bit equal to bit within bytes start..end of the
+    // string at key, or -1 (Redis BITPOS). Without an end, a value of all
+    // ones has its first clear bit just past its last byte, so searching
+    // for 0 then never returns -1, and a missing key answers 0.
+    Status bitPos(const std::string& key, bool bit, int64_t start,
+                  std::optional<int64_t> end, int64_t& position) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        position = bit ? -1 : 0;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!entry.isString()) {
+                status = Status::WRONG_TYPE;
+                return;
+            }
+            std::string scratch;
+            const std::string& text = bytesOf(entry, scratch);
+            int64_t first, last;
+            if (!byteRange(static_cast<int64_t>(text.size()), start, end.value_or(-1),
+                           first, last)) {
+                position = -1;
+                return;
+            }
+            position = Bitmap::position(
+                reinterpret_cast<const unsigned char*>(text.data()) + first,
+                static_cast<size_t>(last - first + 1), bit);
+            if (position >= 0) {
+                position += first * 8;
+            } else if (!bit && !end) {
+                position = (last + 1) * 8;
+            }
+        });
+        return status;
+    }
+
+    // Store the bitwise AND, OR or XOR of the strings at sources (or NOT
+    // of the one source) at dest, replacing whatever dest held, and
+    // return its length. Shorter sources count as zero-padded; a missing
+    // key is empty, and an empty result deletes dest. The sources are
+    // read one at a time, so this is not a snapshot across keys written
+    // concurrently. dest is logged as a plain PUT.
+    Status bitOp(BitOp op, const std::string& dest, const std::vector<std::string>& sources,
+                 size_t& length) {
+        if (sources.empty() || (op == BitOp::NOT && sources.size() != 1)) {
+            return Status::OUT_OF_RANGE;
+        }
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        std::vector<std::string> operands(sources.size());
+
+        for (size_t i = 0; i < sources.size() && status == Status::OK; ++i) {
+            store.visit(sources[i], [&](const Entry& entry) {
+                if (expired(entry, now)) {
+                    return;
+                }
+                if (!entry.isString()) {
+                    status = Status::WRONG_TYPE;
+                } else {
+                    operands[i] = entry.text();
+                }
+            });
+        }
+        if (status != Status::OK) {
+            return status;
+        }
+
+        length = 0;
+        for (const auto& operand : operands) {
+            length = std::max(length, operand.size());
+        }
+        std::string result = std::move(operands[0]);
+        result.resize(length, '\0');
+        auto* target = reinterpret_cast<unsigned char*>(result.data());
+        if (op == BitOp::NOT) {
+            Bitmap::combine(op, target, nullptr, length);
+        }
+        for (size_t i = 1; i < operands.size(); ++i) {
+            const std::string& operand = operands[i];
+            Bitmap::combine(op, target,
+                            reinterpret_cast<const unsigned char*>(operand.data()),
+                            operand.size());
+            if (op == BitOp::AND) {
+                std::fill(result.begin() + static_cast<std::ptrdiff_t>(operand.size()),
+                          result.end(), '\0');
+            }
+        }
+
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(dest, [&](std::optional<Entry>& current) {
+            bool logged = length == 0 ? wal.writeEntry(Operation::DELETE, dest)
+                                      : wal.writeEntry(Operation::PUT, dest, result);
+            if (!logged) {
+                return Status::WAL_ERROR;
+            }
+            if (length == 0) {
+                current.reset();
+            } else {
+                current = Entry(result);
+            }
+            return Status::OK;
+        });
+    }
+
+    Status erase(const std::string& key) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            if (!wal.writeEntry(Operation::DELETE, key)) {
+                return Status::WAL_ERROR;
+            }
+            bool live = current && !expired(*current, now);
+            current.reset();
+            return live ? Status::OK : Status::NOT_FOUND;
+        });
+    }
+
+    // Add delta to the integer at key, counting a missing or expired key
+    // as 0, and return the new value in result. The expiry is kept. A
+    // live counter is logged as a compact delta record; a new one as a
+    // PUT, since a delta only replays onto the value it was applied to.
+    Status incrBy(const std::string& key, int64_t delta, int64_t& result) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            bool live = current && !expired(*current, now);
+            if (live && !current->isString()) {
+                return Status::WRONG_TYPE;
+            }
+            int64_t base = 0;
+            if (live && !current->toInteger(base)) {
+                return Status::NOT_INTEGER;
+            }
+            if (addWouldOverflow(base, delta)) {
+                return Status::OUT_OF_RANGE;
+            }
+
+            int64_t sum = base + delta;
+            bool logged = live ? wal.writeEntry(Operation::INCR, key, encodeDelta(delta))
+                               : wal.writeEntry(Operation::PUT, key, std::to_string(sum));
+            if (!logged) {
+                return Status::WAL_ERROR;
+            }
+
+            current = Entry::integer(sum, live ? current->expires_at : 0);
+            result = sum;
+            return Status::OK;
+        });
+    }
+
+    using FieldValues = std::vector<std::pair<std::string, std::string>>;
+
+    // Set fields of the hash at key, creating it if missing; added
+    // receives the number of fields that were new. All pairs go into one
+    // HSET record, so a crash never leaves the command half applied.
+    Status hset(const std::string& key, const FieldValues& fields, size_t& added) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+        added = 0;
+
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            bool live = current && !expired(*current, now);
+            if (live && !isHash(*current)) {
+                return Status::WRONG_TYPE;
+            }
+            if (fields.empty()) {
+                return Status::OK;
+            }
+
+            Listpack record;
+            for (const auto& [field, value] : fields) {
+                record.push_back(field);
+                record.push_back(value);
+            }
+            if (!logRecreate(key, current, live) ||
+                !wal.writeEntry(Operation::HSET, key, record.raw())) {
+                return Status::WAL_ERROR;
+            }
+
+            if (!live) {
+                current = newHash();
+            }
+            auto& hash = hashOf(*current);
+            for (const auto& [field, value] : fields) {
+                added += hash.set(field, value) ? 1 : 0;
+            }
+            return Status::OK;
+        });
+    }
+
+    Status hget(const std::string& key, const std::string& field, std::string& value) const {
+        uint64_t now = nowMs();
+        Status status = Status::NOT_FOUND;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isHash(entry)) {
+                status = Status::WRONG_TYPE;
+            } else if (hashOf(entry).get(field, value)) {
+                status = Status::OK;
+            }
+        });
+        return status;
+    }
+
+    // Values of fields, nullopt for each missing one (all of them if the
+    // key does not exist)
+    Status hmget(const std::string& key, const std::vector<std::string>& fields,
+                 std::vector<std::optional<std::string>>& values) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        values.assign(fields.size(), std::nullopt);
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isHash(entry)) {
+                status = Status::WRONG_TYPE;
+                return;
+            }
+            std::string value;
+            for (size_t i = 0; i < fields.size(); ++i) {
+                if (hashOf(entry).get(fields[i], value)) {
+                    values[i] = value;
+                }
+            }
+        });
+        return status;
+    }
+
+    // All field, value pairs; none if the key does not exist
+    Status hgetAll(const std::string& key, FieldValues& pairs) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        pairs.clear();
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isHash(entry)) {
+                status = Status::WRONG_TYPE;
+                return;
+            }
+            pairs.reserve(hashOf(entry).size());
+            hashOf(entry).forEach([&](std::string_view field, std::string_view value) {
+                pairs.emplace_back(field, value);
+            });
+        });
+        return status;
+    }
+
+    // Number of fields, 0 if the key does not exist
+    Status hlen(const std::string& key, size_t& length) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        length = 0;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isHash(entry)) {
+                status = Status::WRONG_TYPE;
+            } else {
+                length = hashOf(entry).size();
+            }
+        });
+        return status;
+    }
+
+    // Remove fields from the hash at key; removed receives the number
+    // that existed. Removing the last field removes the key.
+    Status hdel(const std::string& key, const std::vector<std::string>& fields,
+                size_t& removed) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+        removed = 0;
+
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            if (!current || expired(*current, now)) {
+                return Status::OK;
+            }
+            if (!isHash(*current)) {
+                return Status::WRONG_TYPE;
+            }
+
+            auto& hash = hashOf(*current);
+            Listpack record;
+            for (const auto& field : fields) {
+                if (hash.contains(field)) {
+                    record.push_back(field);
+                }
+            }
+            if (record.empty()) {
+                return Status::OK;
+            }
+            if (!wal.writeEntry(Operation::HDEL, key, record.raw())) {
+                return Status::WAL_ERROR;
+            }
+
+            record.forEach([&](std::string_view field) {
+                removed += hash.erase(field) ? 1 : 0;
+            });
+            if (hash.empty()) {
+                current.reset();
+            }
+            return Status::OK;
+        });
+    }
+
+    // Add delta to the integer in field of the hash at key, counting a
+    // missing field (or key) as 0. The result is logged as an HSET of the
+    // field, which replays the same whatever the field held before.
+    Status hincrBy(const std::string& key, const std::string& field, int64_t delta,
+                   int64_t& result) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            bool live = current && !expired(*current, now);
+            if (live && !isHash(*current)) {
+                return Status::WRONG_TYPE;
+            }
+
+            int64_t base = 0;
+            std::string text;
+            if (live && hashOf(*current).get(field, text)) {
+                const char* end = text.data() + text.size();
+                auto [ptr, ec] = std::from_chars(text.data(), end, base);
+                if (text.empty() || ec != std::errc() || ptr != end) {
+                    return Status::NOT_INTEGER;
+                }
+            }
+            if (addWouldOverflow(base, delta)) {
+                return Status::OUT_OF_RANGE;
+            }
+
+            int64_t sum = base + delta;
+            Listpack record;
+            record.push_back(field);
+            record.push_back(std::to_string(sum));
+            if (!logRecreate(key, current, live) ||
+                !wal.writeEntry(Operation::HSET, key, record.raw())) {
+                return Status::WAL_ERROR;
+            }
+
+            if (!live) {
+                current = newHash();
+            }
+            hashOf(*current).set(field, std::to_string(sum));
+            result = sum;
+            return Status::OK;
+        });
+    }
+
+    // Push elements onto the head of the list at key, creating it if
+    // missing, so the last element ends up first; length receives the
+    // new length. Wakes pops blocked on the key.
+    Status lpush(const std::string& key, const std::vector<std::string>& elements,
+                 size_t& length) {
+        return push(key, elements, true, length);
+    }
+
+    // Push elements onto the tail of the list at key
+    Status rpush(const std::string& key, const std::vector<std::string>& elements,
+                 size_t& length) {
+        return push(key, elements, false, length);
+    }
+
+    // Remove and return the first element; popping the last element
+    // removes the key
+    Status lpop(const std::string& key, std::string& element) {
+        return pop(key, true, element);
+    }
+
+    Status rpop(const std::string& key, std::string& element) {
+        return pop(key, false, element);
+    }
+
+    // Pop from the first of keys holding a non-empty list, waiting up to
+    // timeout_ms (0 = indefinitely) for a push if all are empty. The
+    // caller's thread sleeps until a push wakes it, checking cancelled
+    // (e.g. "has the client disconnected") every 100ms. NOT_FOUND on
+    // timeout or cancellation.
+    Status blpop(const std::vector<std::string>& keys, uint64_t timeout_ms,
+                 std::string& key, std::string& element,
+                 const std::function<bool()>& cancelled = {}) {
+        return blockingPop(keys, true, timeout_ms, key, element, cancelled);
+    }
+
+    Status brpop(const std::vector<std::string>& keys, uint64_t timeout_ms,
+                 std::string& key, std::string& element,
+                 const std::function<bool()>& cancelled = {}) {
+        return blockingPop(keys, false, timeout_ms, key, element, cancelled);
+    }
+
+    // Elements start..stop inclusive; negative indexes count from the end
+    Status lrange(const std::string& key, int64_t start, int64_t stop,
+                  std::vector<std::string>& elements) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        elements.clear();
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isList(entry)) {
+                status = Status::WRONG_TYPE;
+                return;
+            }
+
+            const auto& list = listOf(entry);
+            auto size = static_cast<int64_t>(list.size());
+            int64_t first = start < 0 ? std::max<int64_t>(size + start, 0) : start;
+            int64_t last = stop < 0 ? size + stop : std::min(stop, size - 1);
+            if (first <= last && first < size) {
+                list.range(static_cast<size_t>(first), static_cast<size_t>(last), elements);
+            }
+        });
+        return status;
+    }
+
+    // Number of elements, 0 if the key does not exist
+    Status llen(const std::string& key, size_t& length) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        length = 0;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isList(entry)) {
+                status = Status::WRONG_TYPE;
+            } else {
+                length = listOf(entry).size();
+            }
+        });
+        return status;
+    }
+
+    using ScoredMembers = std::vector<std::pair<std::string, double>>;
+
+    // Add members to the sorted set at key with their scores, or move
+    // existing members to them; added receives the number of new
+    // members. OUT_OF_RANGE if a score is NaN.
+    Status zadd(const std::string& key, const ScoredMembers& members, size_t& added) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+        added = 0;
+
+        for (const auto& member : members) {
+            if (std::isnan(member.second)) {
+                return Status::OUT_OF_RANGE;
+            }
+        }
+
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            bool live = current && !expired(*current, now);
+            if (live && !isZSet(*current)) {
+                return Status::WRONG_TYPE;
+            }
+            if (members.empty()) {
+                return Status::OK;
+            }
+
+            Listpack record;
+            for (const auto& [member, score] : members) {
+                record.push_back(encodeScore(score));
+                record.push_back(member);
+            }
+            if (!logRecreate(key, current, live) ||
+                !wal.writeEntry(Operation::ZADD, key, record.raw())) {
+                return Status::WAL_ERROR;
+            }
+
+            if (!live) {
+                current = newZSet();
+            }
+            auto& zset = zsetOf(*current);
+            for (const auto& [member, score] : members) {
+                added += zset.add(member, score) ? 1 : 0;
+            }
+            return Status::OK;
+        });
+    }
+
+    // Add delta to the score of member (a missing member starts at 0) and
+    // return the new score. Logged as a ZADD of the result.
+    Status zincrBy(const std::string& key, const std::string& member, double delta,
+                   double& score) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            bool live = current && !expired(*current, now);
+            if (live && !isZSet(*current)) {
+                return Status::WRONG_TYPE;
+            }
+
+            double base = 0.0;
+            if (live) {
+                zsetOf(*current).score(member, base);
+            }
+            double result = base + delta;
+            if (std::isnan(result)) {
+                return Status::OUT_OF_RANGE;
+            }
+
+            Listpack record;
+            record.push_back(encodeScore(result));
+            record.push_back(member);
+            if (!logRecreate(key, current, live) ||
+                !wal.writeEntry(Operation::ZADD, key, record.raw())) {
+                return Status::WAL_ERROR;
+            }
+
+            if (!live) {
+                current = newZSet();
+            }
+            zsetOf(*current).add(member, result);
+            score = result;
+            return Status::OK;
+        });
+    }
+
+    // Remove members; removed receives the number that existed. Removing
+    // the last member removes the key.
+    Status zrem(const std::string& key, const std::vector<std::string>& members,
+                size_t& removed) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+        removed = 0;
+
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            if (!current || expired(*current, now)) {
+                return Status::OK;
+            }
+            if (!isZSet(*current)) {
+                return Status::WRONG_TYPE;
+            }
+
+            auto& zset = zsetOf(*current);
+            Listpack record;
+            double score;
+            for (const auto& member : members) {
+                if (zset.score(member, score)) {
+                    record.push_back(member);
+                }
+            }
+            if (record.empty()) {
+                return Status::OK;
+            }
+            if (!wal.writeEntry(Operation::ZREM, key, record.raw())) {
+                return Status::WAL_ERROR;
+            }
+
+            record.forEach([&](std::string_view member) {
+                removed += zset.erase(member) ? 1 : 0;
+            });
+            if (zset.empty()) {
+                current.reset();
+            }
+            return Status::OK;
+        });
+    }
+
+    // Members ranked start..stop inclusive in score order, with their
+    // scores; negative ranks count from the end
+    Status zrange(const std::string& key, int64_t start, int64_t stop,
+                  ScoredMembers& members) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        members.clear();
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isZSet(entry)) {
+                status = Status::WRONG_TYPE;
+                return;
+            }
+
+            const auto& zset = zsetOf(entry);
+            auto size = static_cast<int64_t>(zset.size());
+            int64_t first = start < 0 ? std::max<int64_t>(size + start, 0) : start;
+            int64_t last = stop < 0 ? size + stop : std::min(stop, size - 1);
+            if (first <= last && first < size) {
+                zset.forEachInRank(static_cast<size_t>(first), static_cast<size_t>(last),
+                                   [&](std::string_view member, double score) {
+                    members.emplace_back(member, score);
+                });
+            }
+        });
+        return status;
+    }
+
+    // Members with scores within [min, max] in score order, skipping the
+    // first offset and returning at most limit
+    Status zrangeByScore(const std::string& key, const ScoreBound& min, const ScoreBound& max,
+                         ScoredMembers& members, size_t offset = 0,
+                         size_t limit = SIZE_MAX) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        members.clear();
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isZSet(entry)) {
+                status = Status::WRONG_TYPE;
+                return;
+            }
+            zsetOf(entry).forEachInScore(min, max, offset, limit,
+                                         [&](std::string_view member, double score) {
+                members.emplace_back(member, score);
+            });
+        });
+        return status;
+    }
+
+    // 0-based rank of member in score order
+    Status zrank(const std::string& key, const std::string& member, size_t& rank) const {
+        uint64_t now = nowMs();
+        Status status = Status::NOT_FOUND;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isZSet(entry)) {
+                status = Status::WRONG_TYPE;
+            } else if (zsetOf(entry).rank(member, rank)) {
+                status = Status::OK;
+            }
+        });
+        return status;
+    }
+
+    Status zscore(const std::string& key, const std::string& member, double& score) const {
+        uint64_t now = nowMs();
+        Status status = Status::NOT_FOUND;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isZSet(entry)) {
+                status = Status::WRONG_TYPE;
+            } else if (zsetOf(entry).score(member, score)) {
+                status = Status::OK;
+            }
+        });
+        return status;
+    }
+
+    // Number of members, 0 if the key does not exist
+    Status zcard(const std::string& key, size_t& count) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        count = 0;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isZSet(entry)) {
+                status = Status::WRONG_TYPE;
+            } else {
+                count = zsetOf(entry).size();
+            }
+        });
+        return status;
+    }
+
+    // Add members to the set at key, creating it if missing; added
+    // receives the number that were new. Only the new members are logged.
+    Status sadd(const std::string& key, const std::vector<std::string>& members,
+                size_t& added) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+        added = 0;
+
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            bool live = current && !expired(*current, now);
+            if (live && !isSet(*current)) {
+                return Status::WRONG_TYPE;
+            }
+
+            Listpack record;
+            for (const auto& member : members) {
+                if (!live || !setOf(*current).contains(member)) {
+                    record.push_back(member);
+                }
+            }
+            if (record.empty()) {
+                return Status::OK;
+            }
+            if (!logRecreate(key, current, live) ||
+                !wal.writeEntry(Operation::SADD, key, record.raw())) {
+                return Status::WAL_ERROR;
+            }
+
+            if (!live) {
+                current = newSet();
+            }
+            auto& set = setOf(*current);
+            record.forEach([&](std::string_view member) {
+                added += set.add(member) ? 1 : 0;
+            });
+            return Status::OK;
+        });
+    }
+
+    // Remove members; removed receives the number that existed. Removing
+    // the last member removes the key.
+    Status srem(const std::string& key, const std::vector<std::string>& members,
+                size_t& removed) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+        removed = 0;
+
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            if (!current || expired(*current, now)) {
+                return Status::OK;
+            }
+            if (!isSet(*current)) {
+                return Status::WRONG_TYPE;
+            }
+
+            auto& set = setOf(*current);
+            Listpack record;
+            for (const auto& member : members) {
+                if (set.contains(member)) {
+                    record.push_back(member);
+                }
+            }
+            if (record.empty()) {
+                return Status::OK;
+            }
+            if (!wal.writeEntry(Operation::SREM, key, record.raw())) {
+                return Status::WAL_ERROR;
+            }
+
+            record.forEach([&](std::string_view member) {
+                removed += set.erase(member) ? 1 : 0;
+            });
+            if (set.empty()) {
+                current.reset();
+            }
+            return Status::OK;
+        });
+    }
+
+    Status sismember(const std::string& key, const std::string& member, bool& found) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        found = false;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isSet(entry)) {
+                status = Status::WRONG_TYPE;
+            } else {
+                found = setOf(entry).contains(member);
+            }
+        });
+        return status;
+    }
+
+    // All members; integer sets come out ascending, others in no order
+    Status smembers(const std::string& key, std::vector<std::string>& members) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        members.clear();
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isSet(entry)) {
+                status = Status::WRONG_TYPE;
+                return;
+            }
+            members.reserve(setOf(entry).size());
+            setOf(entry).forEach([&](std::string_view member) {
+                members.emplace_back(member);
+            });
+        });
+        return status;
+    }
+
+    // Number of members, 0 if the key does not exist
+    Status scard(const std::string& key, size_t& count) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        count = 0;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isSet(entry)) {
+                status = Status::WRONG_TYPE;
+            } else {
+                count = setOf(entry).size();
+            }
+        });
+        return status;
+    }
+
+    // Members of every set at keys; a missing key is an empty set. The
+    // smallest set is copied and each other set filters it in place, so
+    // the work is bounded by the smallest set. Two intsets intersect with
+    // a vectorized merge. Each key is read on its own: the result is not
+    // a snapshot across keys written concurrently.
+    Status sinter(const std::vector<std::string>& keys,
+                  std::vector<std::string>& members) const {
+        uint64_t now = nowMs();
+        members.clear();
+
+        std::vector<std::pair<size_t, const std::string*>> order;
+        for (const auto& key : keys) {
+            size_t count = 0;
+            Status status = scard(key, count);
+            if (status != Status::OK || count == 0) {
+                return status;
+            }
+            order.emplace_back(count, &key);
+        }
+        std::sort(order.begin(), order.end());
+
+        Status status = Status::OK;
+        bool integers = true;
+        std::vector<int64_t> ints;
+        std::vector<std::string> strings;
+        for (size_t i = 0; i < order.size(); ++i) {
+            bool found = false;
+            store.visit(*order[i].second, [&](const Entry& entry) {
+                if (expired(entry, now)) {
+                    return;
+                }
+                if (!isSet(entry)) {
+                    status = Status::WRONG_TYPE;
+                    return;
+                }
+                found = true;
+                const auto& set = setOf(entry);
+                if (i == 0) {
+                    integers = set.compact();
+                    if (integers) {
+                        ints = set.integers();
+                    } else {
+                        set.forEach([&](std::string_view member) {
+                            strings.emplace_back(member);
+                        });
+                    }
+                } else if (integers && set.compact()) {
+                    ints = SetValue::intersect(ints, set.integers());
+                } else if (integers) {
+                    ints.erase(std::remove_if(ints.begin(), ints.end(), [&](int64_t member) {
+                        return !set.contains(std::to_string(member));
+                    }), ints.end());
+                } else {
+                    strings.erase(std::remove_if(strings.begin(), strings.end(),
+                                                 [&](const std::string& member) {
+                        return !set.contains(member);
+                    }), strings.end());
+                }
+            });
+            if (status != Status::OK || !found) {
+                return status;
+            }
+        }
+
+        if (integers) {
+            members.reserve(ints.size());
+            for (int64_t member : ints) {
+                members.push_back(std::to_string(member));
+            }
+        } else {
+            members = std::move(strings);
+        }
+        return Status::OK;
+    }
+
+    // Members of any set at keys. Intsets merge into a sorted array until
+    // a set in the other encoding turns the result into a hash set.
+    Status sunion(const std::vector<std::string>& keys,
+                  std::vector<std::string>& members) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        members.clear();
+
+        bool integers = true;
+        std::vector<int64_t> ints;
+        std::unordered_set<std::string> strings;
+        for (const auto& key : keys) {
+            store.visit(key, [&](const Entry& entry) {
+                if (expired(entry, now)) {
+                    return;
+                }
+                if (!isSet(entry)) {
+                    status = Status::WRONG_TYPE;
+                    return;
+                }
+                const auto& set = setOf(entry);
+                if (integers && set.compact()) {
+                    ints = SetValue::unite(ints, set.integers());
+                    return;
+                }
+                if (integers) {
+                    for (int64_t member : ints) {
+                        strings.insert(std::to_string(member));
+                    }
+                    ints.clear();
+                    integers = false;
+                }
+                set.forEach([&](std::string_view member) {
+                    strings.emplace(member);
+                });
+            });
+            if (status != Status::OK) {
+                return status;
+            }
+        }
+
+        if (integers) {
+            members.reserve(ints.size());
+            for (int64_t member : ints) {
+                members.push_back(std::to_string(member));
+            }
+        } else {
+            members.assign(strings.begin(), strings.end());
+        }
+        return Status::OK;
+    }
+
+    // Add elements to the HyperLogLog at key, creating it if missing;
+    // changed is true if the estimate may have moved (the key was created
+    // or a register grew). Only the grown registers are logged.
+    Status pfadd(const std::string& key, const std::vector<std::string>& elements,
+                 bool& changed) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+        changed = false;
+
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            bool live = current && !expired(*current, now);
+            if (live && !isHll(*current)) {
+                return Status::WRONG_TYPE;
+            }
+
+            std::string record;
+            for (const auto& element : elements) {
+                uint16_t index;
+                uint8_t rank;
+                HyperLogLog::position(element, index, rank);
+                if (!live || rank > hllOf(*current).get(index)) {
+                    HyperLogLog::appendUpdate(record, index, rank);
+                }
+            }
+            if (live && record.empty()) {
+                return Status::OK;
+            }
+            if (!logRecreate(key, current, live) ||
+                !wal.writeEntry(Operation::PFADD, key, record)) {
+                return Status::WAL_ERROR;
+            }
+
+            if (!live) {
+                current = newHll();
+            }
+            hllOf(*current).applyUpdates(record);
+            changed = true;
+            return Status::OK;
+        });
+    }
+
+    // Estimated number of distinct elements added to the HyperLogLogs at
+    // keys, counted as their union; missing keys count as empty
+    Status pfcount(const std::vector<std::string>& keys, uint64_t& count) const {
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        count = 0;
+
+        if (keys.size() == 1) {
+            store.visit(keys[0], [&](const Entry& entry) {
+                if (expired(entry, now)) {
+                    return;
+                }
+                if (!isHll(entry)) {
+                    status = Status::WRONG_TYPE;
+                } else {
+                    count = hllOf(entry).count();
+                }
+            });
+            return status;
+        }
+
+        std::vector<uint8_t> registers(HyperLogLog::kRegisters, 0);
+        status = unionRegisters(keys, registers.data(), now);
+        if (status == Status::OK) {
+            count = HyperLogLog::count(registers.data());
+        }
+        return status;
+    }
+
+    // Merge the HyperLogLogs at sources into the one at dest, creating it
+    // if missing. The union of the sources is logged as one PFMERGE
+    // record, which replays the same onto whatever dest then holds.
+    Status pfmerge(const std::string& dest, const std::vector<std::string>& sources) {
+        uint64_t now = nowMs();
+        std::vector<uint8_t> registers(HyperLogLog::kRegisters, 0);
+        Status status = unionRegisters(sources, registers.data(), now);
+        if (status != Status::OK) {
+            return status;
+        }
+
+        HyperLogLog merged(config.hll_sparse_max_registers);
+        merged.merge(registers.data());
+        std::string record = merged.serialize();
+
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(dest, [&](std::optional<Entry>& current) {
+            bool live = current && !expired(*current, now);
+            if (live && !isHll(*current)) {
+                return Status::WRONG_TYPE;
+            }
+            if (!logRecreate(dest, current, live) ||
+                !wal.writeEntry(Operation::PFMERGE, dest, record)) {
+                return Status::WAL_ERROR;
+            }
+
+            if (!live) {
+                current = newHll();
+            }
+            hllOf(*current).merge(registers.data());
+            return Status::OK;
+        });
+    }
+
+    // Create an empty Bloom filter at key sized for capacity items at
+    // error_rate, growing expansion times per added layer beyond that.
+    // OUT_OF_RANGE if BloomFilter::validParameters rejects them,
+    // KEY_EXISTS if the key holds any value.
+    Status bfReserve(const std::string& key, double error_rate, uint64_t capacity,
+                     uint32_t expansion) {
+        if (!BloomFilter::validParameters(error_rate, capacity, expansion)) {
+            return Status::OUT_OF_RANGE;
+        }
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            bool live = current && !expired(*current, now);
+            if (live) {
+                return Status::KEY_EXISTS;
+            }
+            Entry created = newBloom(error_rate, capacity, expansion);
+            if (!logRecreate(key, current, live) ||
+                !wal.writeEntry(Operation::BFRESERVE, key,
+                                bloomOf(created).encodeParameters())) {
+                return Status::WAL_ERROR;
+            }
+            current = std::move(created);
+            return Status::OK;
+        });
+    }
+
+    // Add items to the Bloom filter at key, creating it with the
+    // configured defaults if missing. added[i] is false if item i may
+    // have been present already. The items are hashed before the key is
+    // locked, once each for every layer, and only the hashes of items
+    // not already present are logged.
+    Status bfAdd(const std::string& key, const std::vector<std::string>& items,
+                 std::vector<bool>& added) {
+        std::vector<BloomFilter::Hash> hashes = hashItems(items);
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+        added.assign(items.size(), false);
+
+        Status room = makeRoom();
+        if (room != Status::OK) {
+            return room;
+        }
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            bool live = current && !expired(*current, now);
+            if (live && !isBloom(*current)) {
+                return Status::WRONG_TYPE;
+            }
+
+            std::string record;
+            std::vector<size_t> candidates;
+            for (size_t i = 0; i < hashes.size(); ++i) {
+                if (!live || !bloomOf(*current).contains(hashes[i])) {
+                    BloomFilter::appendHash(record, hashes[i]);
+                    candidates.push_back(i);
+                }
+            }
+            if (live && candidates.empty()) {
+                return Status::OK;
+            }
+
+            Entry created = live ? Entry() : newBloom();
+            if (!logRecreate(key, current, live) ||
+                (!live && !wal.writeEntry(Operation::BFRESERVE, key,
+                                          bloomOf(created).encodeParameters())) ||
+                (!candidates.empty() && !wal.writeEntry(Operation::BFADD, key, record))) {
+                return Status::WAL_ERROR;
+            }
+
+            if (!live) {
+                current = std::move(created);
+            }
+            // Replay adds the same hashes in the same order, so an item a
+            // batch-mate's bits now cover is skipped there too
+            auto& filter = bloomOf(*current);
+            for (size_t i : candidates) {
+                added[i] = filter.add(hashes[i]);
+            }
+            return Status::OK;
+        });
+    }
+
+    // found[i] is true if item i may be in the Bloom filter at key, false
+    // if it definitely is not (or the key does not exist)
+    Status bfExists(const std::string& key, const std::vector<std::string>& items,
+                    std::vector<bool>& found) const {
+        std::vector<BloomFilter::Hash> hashes = hashItems(items);
+        uint64_t now = nowMs();
+        Status status = Status::OK;
+        found.assign(items.size(), false);
+
+        store.visit(key, [&](const Entry& entry) {
+            if (expired(entry, now)) {
+                return;
+            }
+            if (!isBloom(entry)) {
+                status = Status::WRONG_TYPE;
+                return;
+            }
+            const auto& filter = bloomOf(entry);
+            for (size_t i = 0; i < hashes.size(); ++i) {
+                found[i] = filter.contains(hashes[i]);
+            }
+        });
+        return status;
+    }
+
+    // Type of the value at key, NONE if it does not exist
+    ValueType type(const std::string& key) const {
+        uint64_t now = nowMs();
+        ValueType result = ValueType::NONE;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (!expired(entry, now)) {
+                result = entry.type();
+            }
+        });
+        return result;
+    }
+
+    bool exists(const std::string& key) const {
+        uint64_t now = nowMs();
+        bool live = false;
+
+        store.visit(key, [&](const Entry& entry) {
+            live = !expired(entry, now);
+        });
+        return live;
+    }
+
+    // Set a key to expire ttl_ms from now
+    Status expire(const std::string& key, uint64_t ttl_ms) {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+        uint64_t deadline = now + ttl_ms;
+
+        return store.compute(key, [&](std::optional<Entry>& current) {
+            if (!current || expired(*current, now)) {
+                return Status::NOT_FOUND;
+            }
+            if (!wal.writeEntry(Operation::EXPIRE, key, std::to_string(deadline))) {
+                return Status::WAL_ERROR;
+            }
+
+            current->expires_at = deadline;
+            expiry_index.insert(key, deadline);
+            return Status::OK;
+        });
+    }
+
+    // Remaining time to live in ms; -1 if the key does not expire,
+    // -2 if it does not exist
+    int64_t ttl(const std::string& key) const {
+        uint64_t now = nowMs();
+        int64_t remaining = -2;
+
+        store.visit(key, [&](const Entry& entry) {
+            if (entry.expires_at == 0) {
+                remaining = -1;
+            } else if (entry.expires_at > now) {
+                remaining = static_cast<int64_t>(entry.expires_at - now);
+            }
+        });
+        return remaining;
+    }
+
+    // Number of stored keys, including expired keys not yet purged
+    size_t size() const {
+        return store.size();
+    }
+
+    // Drop expired keys from memory. Reads already hide them; this only
+    // reclaims space. Deadlines are absolute and logged, so nothing needs
+    // to be written: replay re-expires them.
+    size_t purgeExpired() {
+        std::shared_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t now = nowMs();
+
+        std::vector<std::string> candidates;
+        expiry_index.for_each([&](const std::string& key, uint64_t deadline) {
+            if (deadline <= now) {
+                candidates.push_back(key);
+            }
+        });
+
+        std::function<void(const std::string&)> listener;
+        {
+            std::lock_guard lock(listener_mutex);
+            listener = expiry_listener;
+        }
+        
+        size_t purged = 0;
+        for (const auto& key : candidates) {
+            bool removed = store.compute(key, [&](std::optional<Entry>& current) {
+                if (current && expired(*current, now)) {
+                    current.reset();
+                    return true;
+                }
+                return false;
+            });
+
+            expiry_index.erase(key);
+            if (removed) {
+                purged++;
+                if (listener) {
+                    listener(key);
+                }
+            }
+        }
+        return purged;
+    }
+
+    // Called with each key the background sweep purges or makeRoom()
+    // evicts (e.g. so the server can invalidate client caches)
+    void setExpiryListener(std::function<void(const std::string&)> listener) {
+        std::lock_guard lock(listener_mutex);
+        expiry_listener = std::move(listener);
+    }
+
+    // Write the live data set to the snapshot file and truncate the WAL.
+    // The snapshot and its directory are fsynced first, so a power loss
+    // cannot lose data the cleared WAL used to hold.
+    bool checkpoint() {
+        std::unique_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t covered = wal.nextSequence();
+        uint64_t now = nowMs();
+        std::string temp_file = snapshot_file + ".tmp";
+
+        std::remove(temp_file.c_str());
+        {
+            WriteAheadLog snapshot(temp_file, false, config.wal_buffer_size);
+            bool ok = snapshot.writeEntry(Operation::CHECKPOINT, "", std::to_string(covered));
+
+            store.for_each([&](const std::string& key, const Entry& entry) {
+                if (!ok || expired(entry, now)) {
+                    return;
+                }
+                ok = entry.isString()
+                    ? snapshot.writeEntry(Operation::PUT, key, entry.text())
+                    : writeCollection(snapshot, key, entry);
+                if (ok && entry.expires_at != 0) {
+                    ok = snapshot.writeEntry(Operation::EXPIRE, key,
+                                             std::to_string(entry.expires_at));
+                }
+            });
+
+            // The snapshot must be on disk before it replaces the old one
+            if (!ok || !snapshot.sync()) {
+                return false;
+            }
+            checkpoint_fsyncs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (std::rename(temp_file.c_str(), snapshot_file.c_str()) != 0) {
+            return false;
+        }
+        // ...and the rename must be on disk before the WAL is dropped
+        if (!syncDirectory(snapshot_file)) {
+            return false;
+        }
+
+        wal.clear();
+        wal.setNextSequence(covered);
+        checkpoints.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Let the tuner resize the maps to the current load and lock
+    // contention (done periodically with config.auto_tune). Returns the
+    // number of maps resized.
+    size_t tune() {
+        std::lock_guard lock(tune_mutex);
+        size_t resized = 0;
+
+        auto tuneMap = [&](auto& map, AutoTuner& tuner) {
+            auto locks = map.getLockStatistics();
+            size_t segments = map.bucketCount();
+            size_t target = tuner.targetSegments(map.size(), segments,
+                                                 locks.acquisitions, locks.contended);
+            if (target != segments && map.resize(target)) {
+                resized++;
+            }
+        };
+
+        tuneMap(store, store_tuner);
+        tuneMap(expiry_index, expiry_tuner);
+        return resized;
+    }
+
+    // Remove every key, including the persisted snapshot and WAL
+    void clear() {
+        std::unique_lock checkpoint_lock(checkpoint_mutex);
+        uint64_t next = wal.nextSequence();
+
+        store.clear();
+        expiry_index.clear();
+        std::remove(snapshot_file.c_str());
+        wal.clear();
+        wal.setNextSequence(next);
+    }
+
+    // Get statistics
+    struct Statistics {
+        size_t item_count;
+        size_t bucket_count;
+        double load_factor;
+        double utilization;
+        size_t expiring_keys;
+        size_t wal_size;
+        uint64_t checkpoints;
+        uint64_t fsyncs;            // WAL, snapshot and directory fsyncs
+        uint64_t resizes;
+        double lock_contention;     // Share of bucket lock acquisitions that waited
+        size_t used_memory;         // Approximate bytes of keys and values
+        uint64_t max_memory;
+        uint64_t evictions;
+    };
+
+    Statistics getStatistics() {
+        auto map_stats = store.getStatistics();
+
+        Statistics stats;
+        stats.item_count = map_stats.item_count;
+        stats.bucket_count = map_stats.bucket_count;
+        stats.load_factor = map_stats.load_factor;
+        stats.utilization = map_stats.utilization;
+        stats.expiring_keys = expiry_index.size();
+        stats.wal_size = wal.size();
+        stats.checkpoints = checkpoints.load(std::memory_order_relaxed);
+        stats.fsyncs = wal.getStatistics().fsyncs
+            + checkpoint_fsyncs.load(std::memory_order_relaxed);
+        stats.resizes = map_stats.resizes;
+        stats.used_memory = store.weight();
+        stats.max_memory = config.max_memory;
+        stats.evictions = evictions.load(std::memory_order_relaxed);
+
+        auto locks = store.getLockStatistics();
+        stats.lock_contention = locks.acquisitions > 0
+            ? static_cast<double>(locks.contended) / locks.acquisitions : 0.0;
+        return stats;
+    }
+
+    const RecoveryStatistics& getRecoveryStatistics() const {
+        return recovery_stats;
+    }
+
+    const Config& getConfig() const {
+        return config;
+    }
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_ENGINE_HPP
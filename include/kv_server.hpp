@@ -2,14 +2,28 @@
 #define KV_STORE_SERVER_HPP
 
 #include <string>
+#include <iostream>
+#include <sstream>
 #include <memory>
 #include <thread>
 #include <vector>
 #include <atomic>
 #include <functional>
+#include <array>
+#include <mutex>
+#include <unordered_map>
+#include <fstream>
+#include <charconv>
+#include <optional>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <sys/socket.h>
 #include <asio.hpp>
-#include "concurrent_hash_map.hpp"
-#include "write_ahead_log.hpp"
+#include "kv_engine.hpp"
+#include "config.hpp"
+#include "client_tracker.hpp"
+#include "tracer.hpp"
 #include "types.hpp"
 
 namespace kvstore {
@@ -18,18 +32,41 @@ using asio::ip::tcp;
 
 class KVServer {
 private:
+    // Per-connection state shared between the connection's own thread
+    // and writers pushing near-cache invalidations to it
+    struct Connection {
+        uint64_t id;
+        std::shared_ptr<tcp::socket> socket;
+        std::mutex write_mutex;
+        std::string pending_push;       // Pushes the socket has not accepted yet
+        std::atomic<bool> tracking{false};
+        std::atomic<bool> timing{false};    // Report processing time per reply
+        size_t database = 0;            // SELECT index (this connection's thread only)
+        
+        // Chunked PUTs in progress, by key (touched only by this
+        // connection's thread), at most max_stream_uploads of them
+        std::unordered_map<std::string, std::string> uploads;
+    };
+    
     asio::io_context io_context;
     tcp::acceptor acceptor;
     std::unique_ptr<std::thread> io_thread;
     std::atomic<bool> running{false};
     
-    ConcurrentHashMap<std::string, std::string> store;
-    WriteAheadLog wal;
     Config config;
     
     std::vector<std::thread> worker_threads;
     std::atomic<size_t> current_connections{0};
     
+    std::atomic<uint64_t> next_connection_id{1};
+    std::mutex connections_mutex;
+    std::unordered_map<uint64_t, std::weak_ptr<Connection>> connections;
+    ClientTracker tracker;
+    
+    // One engine per namespace (SELECT index). Declared last: their
+    // expiry sweeps call back into the members above.
+    std::vector<std::unique_ptr<KVEngine>> engines;
+    
     void startAccept() {
         auto socket = std::make_shared<tcp::socket>(io_context);
         
@@ -38,7 +75,16 @@ private:
                 if (!error) {
                     if (current_connections < config.max_connections) {
                         current_connections++;
-                        std::thread(&KVServer::handleConnection, this, socket).detach();
+                        
+                        // Pushes are small unsolicited writes; Nagle would
+                        // hold them back behind the client's delayed ACK
+                        std::error_code ec;
+                        socket->set_option(tcp::no_delay(true), ec);
+                        
+                        auto conn = std::make_shared<Connection>();
+                        conn->id = next_connection_id.fetch_add(1);
+                        conn->socket = socket;
+                        std::thread(&KVServer::handleConnection, this, conn).detach();
                     } else {
                         // Connection limit reached
                         std::error_code ec;
@@ -52,14 +98,24 @@ private:
             });
     }
     
-    void handleConnection(std::shared_ptr<tcp::socket> socket) {
+    void handleConnection(std::shared_ptr<Connection> conn) {
+        auto& socket = conn->socket;
+        {
+            std::lock_guard lock(connections_mutex);
+            connections[conn->id] = conn;
+        }
+        
         try {
             asio::streambuf buffer;
             asio::error_code error;
             
             while (running) {
-                // Read command
+                TraceRequest request;
+                
+                // Read command (the span includes waiting for the client)
+                TraceSpan read_span("socket.read");
                 size_t n = asio::read_until(*socket, buffer, '\n', error);
+                read_span.end();
                 
                 if (error == asio::error::eof || error == asio::error::connection_reset) {
                     break; // Connection closed
@@ -74,11 +130,29 @@ private:
                 buffer.consume(n);
                 
                 // Process command
-                std::string response = processCommand(command);
+                auto started = std::chrono::steady_clock::now();
+                TraceSpan command_span("command");
+                std::string response = processCommand(*conn, command);
+                command_span.end();
+                
+                // Server-side processing time, so clients can separate it
+                // from network and queueing delay
+                if (conn->timing) {
+                    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - started).count();
+                    response = ">TIME " + std::to_string(elapsed) + "\n" + response;
+                }
                 response += "\n";
                 
-                // Send response
-                asio::write(*socket, asio::buffer(response), error);
+                // Send response, preceded by any invalidations still queued
+                {
+                    TraceSpan write_span("socket.write");
+                    std::lock_guard lock(conn->write_mutex);
+                    std::array<asio::const_buffer, 2> buffers = {
+                        asio::buffer(conn->pending_push), asio::buffer(response)};
+                    asio::write(*socket, buffers, error);
+                    conn->pending_push.clear();
+                }
                 
                 if (error) {
                     break;
@@ -88,20 +162,220 @@ private:
             // Log error
         }
         
+        {
+            std::lock_guard lock(connections_mutex);
+            connections.erase(conn->id);
+        }
+        
         current_connections--;
         std::error_code ec;
         socket->close(ec);
     }
     
-    std::string processCommand(const std::string& command) {
+    // Queue a push message for a connection and hand as much of it to the
+    // socket as it accepts without blocking; the remainder goes out ahead
+    // of that connection's next response or push. Writers never block on
+    // a slow reader, and the queue stays bounded because each push answers
+    // an earlier GET from the same connection. Pushes start with '>',
+    // which no reply line does (stored data goes through formatValue).
+    void pushToConnection(uint64_t connection_id, const std::string& message) {
+        std::shared_ptr<Connection> conn;
+        {
+            std::lock_guard lock(connections_mutex);
+            auto it = connections.find(connection_id);
+            if (it != connections.end()) {
+                conn = it->second.lock();
+            }
+        }
+        
+        if (!conn || !conn->tracking) {
+            return;
+        }
+        
+        std::lock_guard lock(conn->write_mutex);
+        conn->pending_push += message;
+        
+        ssize_t sent = ::send(conn->socket->native_handle(),
+                              conn->pending_push.data(), conn->pending_push.size(),
+                              MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn->pending_push.erase(0, static_cast<size_t>(sent));
+        }
+    }
+    
+    // Tell every connection that may have cached key to drop it
+    void invalidate(const std::string& key) {
+        for (uint64_t id : tracker.take(key)) {
+            pushToConnection(id, ">INVALIDATE " + key + "\n");
+        }
+    }
+    
+    // Tell every tracking connection to drop its whole cache
+    void invalidateAll() {
+        tracker.clear();
+        
+        std::vector<uint64_t> ids;
+        {
+            std::lock_guard lock(connections_mutex);
+            for (const auto& entry : connections) {
+                ids.push_back(entry.first);
+            }
+        }
+        
+        for (uint64_t id : ids) {
+            pushToConnection(id, ">FLUSH\n");
+        }
+    }
+    
+    // Multi-line responses are framed as "*<count>" followed by that many
+    // lines (or values, see formatValue), so clients know where the
+    // response ends
+    static std::string formatArray(const std::vector<std::string>& lines) {
+        std::string result = "*" + std::to_string(lines.size());
+        for (const auto& line : lines) {
+            result += "\n";
+            result += line;
+        }
+        return result;
+    }
+    
+    // Stored data (values, fields, elements, members) is framed as
+    // "$<length>" and then exactly that many bytes: SETBIT, BITOP and
+    // SETRANGE can put any byte in a value, newlines included, so it
+    // cannot be sent as a line
+    static std::string formatValue(const std::string& data) {
+        std::string result = "$" + std::to_string(data.size()) + "\n";
+        result += data;
+        return result;
+    }
+    
+    static std::string formatValues(const std::vector<std::string>& values) {
+        std::vector<std::string> framed;
+        framed.reserve(values.size());
+        for (const auto& value : values) {
+            framed.push_back(formatValue(value));
+        }
+        return formatArray(framed);
+    }
+    
+    static constexpr const char* kWrongType =
+        "ERROR WRONGTYPE Operation against a key holding the wrong kind of value";
+    static constexpr const char* kOutOfMemory =
+        "ERROR OOM Namespace is over max_memory and nothing can be evicted";
+    
+    // Split the arguments of a multi-argument command (HSET, HMGET, ...)
+    // at whitespace; an argument may be quoted to contain spaces
+    static std::vector<std::string> splitArguments(const std::string& text) {
+        std::vector<std::string> arguments;
+        size_t pos = 0;
+        while (true) {
+            pos = text.find_first_not_of(" \t\r", pos);
+            if (pos == std::string::npos) {
+                break;
+            }
+            char quote = text[pos];
+            if (quote == '"' || quote == '\'') {
+                size_t close = text.find(quote, pos + 1);
+                if (close != std::string::npos) {
+                    arguments.push_back(text.substr(pos + 1, close - pos - 1));
+                    pos = close + 1;
+                    continue;
+                }
+            }
+            size_t end = text.find_first_of(" \t\r", pos);
+            arguments.push_back(text.substr(pos, end == std::string::npos ? end : end - pos));
+            pos = end;
+        }
+        return arguments;
+    }
+    
+    static const char* typeName(ValueType type) {
+        switch (type) {
+            case ValueType::STRING:
+                return "string";
+            case ValueType::HASH:
+                return "hash";
+            case ValueType::LIST:
+                return "list";
+            case ValueType::ZSET:
+                return "zset";
+            case ValueType::SET:
+                return "set";
+            case ValueType::HLL:
+                return "hyperloglog";
+            case ValueType::BLOOM:
+                return "bloom";
+            default:
+                return "none";
+        }
+    }
+    
+    // Whole text as an integer
+    template<typename T>
+    static bool parseNumber(const std::string& text, T& number) {
+        const char* end = text.data() + text.size();
+        auto [ptr, ec] = std::from_chars(text.data(), end, number);
+        return !text.empty() && ec == std::errc() && ptr == end;
+    }
+    
+    // Sorted set score: a decimal, "inf", "+inf" or "-inf"; never NaN
+    static bool parseScore(const std::string& text, double& score) {
+        if (text.empty()) {
+            return false;
+        }
+        char* end = nullptr;
+        score = std::strtod(text.c_str(), &end);
+        return end == text.c_str() + text.size() && !std::isnan(score);
+    }
+    
+    // ZRANGEBYSCORE bound: a score, exclusive if prefixed with "("
+    static bool parseBound(const std::string& text, ScoreBound& bound) {
+        bound.exclusive = !text.empty() && text[0] == '(';
+        return parseScore(bound.exclusive ? text.substr(1) : text, bound.value);
+    }
+    
+    // Shortest text that parses back to the same double
+    static std::string formatScore(double score) {
+        char buffer[32];
+        auto [ptr, ec] = std::to_chars(buffer, buffer + sizeof(buffer), score);
+        return ec == std::errc() ? std::string(buffer, ptr) : std::to_string(score);
+    }
+    
+    static std::string formatScoredMembers(const KVEngine::ScoredMembers& members,
+                                           bool with_scores) {
+        std::vector<std::string> lines;
+        lines.reserve(members.size() * (with_scores ? 2 : 1));
+        for (const auto& [member, score] : members) {
+            lines.push_back(formatValue(member));
+            if (with_scores) {
+                lines.push_back(formatScore(score));
+            }
+        }
+        return formatArray(lines);
+    }
+    
+    // True once the peer has closed the connection (a blocked pop must
+    // not take an element nobody will receive)
+    static bool peerClosed(Connection& conn) {
+        char byte;
+        ssize_t n = ::recv(conn.socket->native_handle(), &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+        return n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+    }
+    
+    std::string processCommand(Connection& conn, const std::string& command) {
+        TraceSpan parse_span("parse");
         std::istringstream iss(command);
         std::string op_str, key;
         std::string value;
         
-        if (!(iss >> op_str >> std::ws)) {
+        if (!(iss >> op_str)) {
             return "ERROR Invalid command format";
         }
         
+        // Commands without arguments (PING, SIZE, FLUSH, STATS) hit EOF here,
+        // which must not be treated as a parse failure
+        iss >> std::ws;
+        
         // Read key (may contain spaces if quoted)
         char first_char = iss.peek();
         if (first_char == '"' || first_char == '\'') {
@@ -114,6 +388,7 @@ private:
         
         // Read value (rest of the line, may be empty)
         std::getline(iss >> std::ws, value);
+        std::string arguments = value;      // Before trimming, for splitArguments()
         
         // Trim quotes from value if present
         if (!value.empty() && (value[0] == '"' || value[0] == '\'')) {
@@ -123,6 +398,9 @@ private:
             }
         }
         
+        parse_span.end();
+        KVEngine& engine = *engines[conn.database];
+        
         // Validate sizes
         if (key.size() > config.max_key_size) {
             return "ERROR Key too large";
@@ -134,50 +412,980 @@ private:
         
         // Process operation
         if (op_str == "PUT") {
-            if (wal.writeEntry(Operation::PUT, key, value)) {
-                store.insert(key, value);
-                return "OK";
+            switch (engine.put(key, value)) {
+                case Status::OK:
+                    invalidate(key);
+                    return "OK";
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
             }
-            return "ERROR WAL write failed";
         }
         else if (op_str == "GET") {
+            // Register before reading so a concurrent write is guaranteed
+            // to push an invalidation for whatever value we return
+            if (conn.tracking) {
+                tracker.track(key, conn.id);
+            }
+            
             std::string result;
-            if (store.find(key, result)) {
-                return result;
+            if (engine.get(key, result)) {
+                return formatValue(result);
             }
-            return "NOT_FOUND";
+            return engine.type(key) == ValueType::NONE ? "NOT_FOUND" : kWrongType;
         }
         else if (op_str == "DELETE") {
-            if (wal.writeEntry(Operation::DELETE, key)) {
-                if (store.erase(key)) {
+            switch (engine.erase(key)) {
+                case Status::OK:
+                    invalidate(key);
                     return "OK";
-                }
-                return "NOT_FOUND";
+                case Status::NOT_FOUND:
+                    return "NOT_FOUND";
+                default:
+                    return "ERROR WAL write failed";
             }
-            return "ERROR WAL write failed";
+        }
+        else if (op_str == "PUT.BEGIN") {
+            // Chunked upload: values larger than max_value_size are staged
+            // per connection and stored in one step by PUT.END, so readers
+            // never see a partial value. Each upload may stage up to
+            // max_stream_value_size, so their number is capped too.
+            auto it = conn.uploads.find(key);
+            if (it != conn.uploads.end()) {
+                it->second.clear();
+                return "OK";
+            }
+            if (conn.uploads.size() >= config.max_stream_uploads) {
+                return "ERROR Too many uploads in progress";
+            }
+            conn.uploads[key];
+            return "OK";
+        }
+        else if (op_str == "PUT.CHUNK") {
+            auto it = conn.uploads.find(key);
+            if (it == conn.uploads.end()) {
+                return "ERROR No upload in progress";
+            }
+            if (it->second.size() + value.size() > config.max_stream_value_size) {
+                conn.uploads.erase(it);
+                return "ERROR Value too large";
+            }
+            it->second += value;
+            return "OK";
+        }
+        else if (op_str == "PUT.END") {
+            auto it = conn.uploads.find(key);
+            if (it == conn.uploads.end()) {
+                return "ERROR No upload in progress";
+            }
+            
+            std::string assembled = std::move(it->second);
+            conn.uploads.erase(it);
+            
+            switch (engine.put(key, assembled)) {
+                case Status::OK:
+                    invalidate(key);
+                    return "OK";
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "PUT.ABORT") {
+            conn.uploads.erase(key);
+            return "OK";
+        }
+        else if (op_str == "GET.CHUNK") {
+            // Chunked download: "GET.CHUNK key offset length" replies
+            // with the array [total_size, bytes], copying only the
+            // requested slice
+            std::istringstream args(value);
+            size_t offset = 0, length = 0;
+            if (!(args >> offset >> length)) {
+                return "ERROR GET.CHUNK expects offset and length";
+            }
+            length = std::min(length, config.max_value_size);
+            
+            std::string chunk;
+            size_t total = 0;
+            if (engine.getRange(key, offset, length, chunk, total)) {
+                return formatArray({std::to_string(total), formatValue(chunk)});
+            }
+            return engine.type(key) == ValueType::NONE ? "NOT_FOUND" : kWrongType;
+        }
+        else if (op_str == "APPEND") {
+            size_t length = 0;
+            switch (engine.append(key, value, length)) {
+                case Status::OK:
+                    invalidate(key);
+                    return std::to_string(length);
+                case Status::OUT_OF_RANGE:
+                    return "ERROR Value too large";
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "SETRANGE") {
+            // "SETRANGE key offset data": data is the rest of the line
+            size_t space = value.find(' ');
+            size_t offset = 0;
+            const char* end = value.data() + (space == std::string::npos ? value.size() : space);
+            auto [ptr, ec] = std::from_chars(value.data(), end, offset);
+            if (value.empty() || ec != std::errc() || ptr != end) {
+                return "ERROR SETRANGE expects an offset and a value";
+            }
+            
+            std::string data = space == std::string::npos ? "" : value.substr(space + 1);
+            if (data.size() >= 2 && (data[0] == '"' || data[0] == '\'') && data.back() == data[0]) {
+                data = data.substr(1, data.size() - 2);
+            }
+            
+            size_t length = 0;
+            switch (engine.setRange(key, offset, data, length)) {
+                case Status::OK:
+                    if (!data.empty()) {
+                        invalidate(key);
+                    }
+                    return std::to_string(length);
+                case Status::OUT_OF_RANGE:
+                    return "ERROR Value too large";
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "GETRANGE") {
+            std::istringstream args(value);
+            int64_t start = 0, end = 0;
+            if (!(args >> start >> end)) {
+                return "ERROR GETRANGE expects start and end";
+            }
+            
+            std::string slice;
+            if (engine.getSlice(key, start, end, slice)) {
+                return formatValue(slice);
+            }
+            return formatValue("");
+        }
+        else if (op_str == "STRLEN") {
+            return std::to_string(engine.valueLength(key));
         }
         else if (op_str == "EXISTS") {
-            return store.exists(key) ? "true" : "false";
+            return engine.exists(key) ? "true" : "false";
+        }
+        else if (op_str == "EXPIRE") {
+            // EXPIRE key milliseconds
+            uint64_t ttl_ms = 0;
+            try {
+                ttl_ms = std::stoull(value);
+            } catch (const std::exception&) {
+                return "ERROR EXPIRE expects a time in milliseconds";
+            }
+            
+            switch (engine.expire(key, ttl_ms)) {
+                case Status::OK:
+                    invalidate(key);
+                    return "OK";
+                case Status::NOT_FOUND:
+                    return "NOT_FOUND";
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "TTL") {
+            return std::to_string(engine.ttl(key));
+        }
+        else if (op_str == "INCR" || op_str == "DECR" ||
+                 op_str == "INCRBY" || op_str == "DECRBY") {
+            int64_t delta = 1;
+            if (op_str == "INCRBY" || op_str == "DECRBY") {
+                const char* end = value.data() + value.size();
+                auto [ptr, ec] = std::from_chars(value.data(), end, delta);
+                if (value.empty() || ec != std::errc() || ptr != end) {
+                    return "ERROR Increment is not an integer";
+                }
+            }
+            if (op_str[0] == 'D') {
+                if (delta == INT64_MIN) {
+                    return "ERROR Increment or decrement would overflow";
+                }
+                delta = -delta;
+            }
+            
+            int64_t result = 0;
+            switch (engine.incrBy(key, delta, result)) {
+                case Status::OK:
+                    invalidate(key);
+                    return std::to_string(result);
+                case Status::NOT_INTEGER:
+                    return "ERROR Value is not an integer";
+                case Status::OUT_OF_RANGE:
+                    return "ERROR Increment or decrement would overflow";
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "HSET") {
+            // HSET key field value [field value ...]
+            auto args = splitArguments(arguments);
+            if (args.empty() || args.size() % 2 != 0) {
+                return "ERROR HSET expects field value pairs";
+            }
+            KVEngine::FieldValues fields;
+            for (size_t i = 0; i < args.size(); i += 2) {
+                fields.emplace_back(std::move(args[i]), std::move(args[i + 1]));
+            }
+            
+            size_t added = 0;
+            switch (engine.hset(key, fields, added)) {
+                case Status::OK:
+                    invalidate(key);
+                    return std::to_string(added);
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "HGET") {
+            std::string result;
+            switch (engine.hget(key, value, result)) {
+                case Status::OK:
+                    return formatValue(result);
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                default:
+                    return "NOT_FOUND";
+            }
+        }
+        else if (op_str == "HMGET") {
+            auto fields = splitArguments(arguments);
+            if (fields.empty()) {
+                return "ERROR HMGET expects at least one field";
+            }
+            std::vector<std::optional<std::string>> values;
+            if (engine.hmget(key, fields, values) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            std::vector<std::string> lines;
+            for (auto& result : values) {
+                lines.push_back(result ? formatValue(*result) : "NOT_FOUND");
+            }
+            return formatArray(lines);
+        }
+        else if (op_str == "HGETALL") {
+            // Alternating field and value lines
+            KVEngine::FieldValues pairs;
+            if (engine.hgetAll(key, pairs) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            std::vector<std::string> lines;
+            lines.reserve(pairs.size() * 2);
+            for (auto& [field, result] : pairs) {
+                lines.push_back(formatValue(field));
+                lines.push_back(formatValue(result));
+            }
+            return formatArray(lines);
+        }
+        else if (op_str == "HLEN") {
+            size_t length = 0;
+            if (engine.hlen(key, length) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            return std::to_string(length);
+        }
+        else if (op_str == "HDEL") {
+            auto fields = splitArguments(arguments);
+            if (fields.empty()) {
+                return "ERROR HDEL expects at least one field";
+            }
+            size_t removed = 0;
+            switch (engine.hdel(key, fields, removed)) {
+                case Status::OK:
+                    if (removed > 0) {
+                        invalidate(key);
+                    }
+                    return std::to_string(removed);
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "HINCRBY") {
+            // HINCRBY key field increment
+            auto args = splitArguments(arguments);
+            int64_t delta = 0;
+            if (args.size() != 2) {
+                return "ERROR HINCRBY expects a field and an increment";
+            }
+            const char* end = args[1].data() + args[1].size();
+            auto [ptr, ec] = std::from_chars(args[1].data(), end, delta);
+            if (args[1].empty() || ec != std::errc() || ptr != end) {
+                return "ERROR Increment is not an integer";
+            }
+            
+            int64_t result = 0;
+            switch (engine.hincrBy(key, args[0], delta, result)) {
+                case Status::OK:
+                    invalidate(key);
+                    return std::to_string(result);
+                case Status::NOT_INTEGER:
+                    return "ERROR Hash value is not an integer";
+                case Status::OUT_OF_RANGE:
+                    return "ERROR Increment or decrement would overflow";
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "LPUSH" || op_str == "RPUSH") {
+            // LPUSH key element [element ...]
+            auto elements = splitArguments(arguments);
+            if (elements.empty()) {
+                return "ERROR " + op_str + " expects at least one element";
+            }
+            
+            size_t length = 0;
+            Status status = op_str == "LPUSH" ? engine.lpush(key, elements, length)
+                                              : engine.rpush(key, elements, length);
+            switch (status) {
+                case Status::OK:
+                    invalidate(key);
+                    return std::to_string(length);
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "LPOP" || op_str == "RPOP") {
+            std::string element;
+            Status status = op_str == "LPOP" ? engine.lpop(key, element)
+                                             : engine.rpop(key, element);
+            switch (status) {
+                case Status::OK:
+                    invalidate(key);
+                    return formatValue(element);
+                case Status::NOT_FOUND:
+                    return "NOT_FOUND";
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "BLPOP" || op_str == "BRPOP") {
+            // BLPOP key [key ...] timeout_ms: the connection's thread sleeps
+            // until an element arrives, so waiting consumers cost no polling
+            auto args = splitArguments(arguments);
+            uint64_t timeout_ms = 0;
+            if (args.empty()) {
+                return "ERROR " + op_str + " expects keys and a timeout";
+            }
+            const char* end = args.back().data() + args.back().size();
+            auto [ptr, ec] = std::from_chars(args.back().data(), end, timeout_ms);
+            if (ec != std::errc() || ptr != end) {
+                return "ERROR Timeout is not a number of milliseconds";
+            }
+            std::vector<std::string> keys = {key};
+            keys.insert(keys.end(), args.begin(), args.end() - 1);
+            
+            std::string popped_key, element;
+            auto cancelled = [&]() { return !running || peerClosed(conn); };
+            Status status = op_str == "BLPOP"
+                ? engine.blpop(keys, timeout_ms, popped_key, element, cancelled)
+                : engine.brpop(keys, timeout_ms, popped_key, element, cancelled);
+            switch (status) {
+                case Status::OK:
+                    invalidate(popped_key);
+                    return formatValues({popped_key, element});
+                case Status::NOT_FOUND:
+                    return "NOT_FOUND";
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "LRANGE") {
+            std::istringstream range(value);
+            int64_t start = 0, stop = 0;
+            if (!(range >> start >> stop)) {
+                return "ERROR LRANGE expects start and stop";
+            }
+            
+            std::vector<std::string> elements;
+            if (engine.lrange(key, start, stop, elements) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            return formatValues(elements);
+        }
+        else if (op_str == "LLEN") {
+            size_t length = 0;
+            if (engine.llen(key, length) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            return std::to_string(length);
+        }
+        else if (op_str == "ZADD") {
+            // ZADD key score member [score member ...]
+            auto args = splitArguments(arguments);
+            if (args.empty() || args.size() % 2 != 0) {
+                return "ERROR ZADD expects score member pairs";
+            }
+            KVEngine::ScoredMembers members;
+            for (size_t i = 0; i < args.size(); i += 2) {
+                double score;
+                if (!parseScore(args[i], score)) {
+                    return "ERROR Score is not a valid number";
+                }
+                members.emplace_back(std::move(args[i + 1]), score);
+            }
+            
+            size_t added = 0;
+            switch (engine.zadd(key, members, added)) {
+                case Status::OK:
+                    invalidate(key);
+                    return std::to_string(added);
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "ZINCRBY") {
+            // ZINCRBY key delta member
+            auto args = splitArguments(arguments);
+            double delta;
+            if (args.size() != 2 || !parseScore(args[0], delta)) {
+                return "ERROR ZINCRBY expects an increment and a member";
+            }
+            
+            double score = 0.0;
+            switch (engine.zincrBy(key, args[1], delta, score)) {
+                case Status::OK:
+                    invalidate(key);
+                    return formatScore(score);
+                case Status::OUT_OF_RANGE:
+                    return "ERROR Resulting score is not a number";
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "ZRANGE") {
+            // ZRANGE key start stop [WITHSCORES]
+            auto args = splitArguments(arguments);
+            int64_t start = 0, stop = 0;
+            bool with_scores = args.size() == 3 && args[2] == "WITHSCORES";
+            if ((args.size() != 2 && !with_scores) ||
+                !parseNumber(args[0], start) || !parseNumber(args[1], stop)) {
+                return "ERROR ZRANGE expects start stop [WITHSCORES]";
+            }
+            
+            KVEngine::ScoredMembers members;
+            if (engine.zrange(key, start, stop, members) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            return formatScoredMembers(members, with_scores);
+        }
+        else if (op_str == "ZRANGEBYSCORE") {
+            // ZRANGEBYSCORE key min max [WITHSCORES] [LIMIT offset count]
+            auto args = splitArguments(arguments);
+            ScoreBound min, max;
+            if (args.size() < 2 || !parseBound(args[0], min) || !parseBound(args[1], max)) {
+                return "ERROR ZRANGEBYSCORE expects min max [WITHSCORES] [LIMIT offset count]";
+            }
+            
+            bool with_scores = false;
+            size_t offset = 0, limit = SIZE_MAX;
+            for (size_t i = 2; i < args.size(); ++i) {
+                if (args[i] == "WITHSCORES") {
+                    with_scores = true;
+                } else if (args[i] == "LIMIT" && i + 2 < args.size()) {
+                    // A negative count means no limit
+                    int64_t count = 0;
+                    if (!parseNumber(args[i + 1], offset) || !parseNumber(args[i + 2], count)) {
+                        return "ERROR LIMIT expects offset and count";
+                    }
+                    limit = count < 0 ? SIZE_MAX : static_cast<size_t>(count);
+                    i += 2;
+                } else {
+                    return "ERROR ZRANGEBYSCORE expects min max [WITHSCORES] [LIMIT offset count]";
+                }
+            }
+            
+            KVEngine::ScoredMembers members;
+            if (engine.zrangeByScore(key, min, max, members, offset, limit) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            return formatScoredMembers(members, with_scores);
+        }
+        else if (op_str == "ZRANK") {
+            size_t rank = 0;
+            switch (engine.zrank(key, value, rank)) {
+                case Status::OK:
+                    return std::to_string(rank);
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                default:
+                    return "NOT_FOUND";
+            }
+        }
+        else if (op_str == "ZSCORE") {
+            double score = 0.0;
+            switch (engine.zscore(key, value, score)) {
+                case Status::OK:
+                    return formatScore(score);
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                default:
+                    return "NOT_FOUND";
+            }
+        }
+        else if (op_str == "ZREM") {
+            auto members = splitArguments(arguments);
+            if (members.empty()) {
+                return "ERROR ZREM expects at least one member";
+            }
+            size_t removed = 0;
+            switch (engine.zrem(key, members, removed)) {
+                case Status::OK:
+                    if (removed > 0) {
+                        invalidate(key);
+                    }
+                    return std::to_string(removed);
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "ZCARD") {
+            size_t count = 0;
+            if (engine.zcard(key, count) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            return std::to_string(count);
+        }
+        else if (op_str == "SADD" || op_str == "SREM") {
+            auto members = splitArguments(arguments);
+            if (members.empty()) {
+                return "ERROR " + op_str + " expects at least one member";
+            }
+            size_t count = 0;
+            Status status = op_str == "SADD" ? engine.sadd(key, members, count)
+                                             : engine.srem(key, members, count);
+            switch (status) {
+                case Status::OK:
+                    if (count > 0) {
+                        invalidate(key);
+                    }
+                    return std::to_string(count);
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "SISMEMBER") {
+            bool found = false;
+            if (engine.sismember(key, value, found) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            return found ? "1" : "0";
+        }
+        else if (op_str == "SMEMBERS") {
+            std::vector<std::string> members;
+            if (engine.smembers(key, members) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            return formatValues(members);
+        }
+        else if (op_str == "SCARD") {
+            size_t count = 0;
+            if (engine.scard(key, count) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            return std::to_string(count);
+        }
+        else if (op_str == "SINTER" || op_str == "SUNION") {
+            // SINTER key [key ...]
+            std::vector<std::string> keys = {key};
+            auto more = splitArguments(arguments);
+            keys.insert(keys.end(), more.begin(), more.end());
+            
+            std::vector<std::string> members;
+            Status status = op_str == "SINTER" ? engine.sinter(keys, members)
+                                               : engine.sunion(keys, members);
+            if (status == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            return formatValues(members);
+        }
+        else if (op_str == "PFADD") {
+            // PFADD key [element ...]: 1 if the estimate may have changed
+            bool changed = false;
+            switch (engine.pfadd(key, splitArguments(arguments), changed)) {
+                case Status::OK:
+                    if (changed) {
+                        invalidate(key);
+                    }
+                    return changed ? "1" : "0";
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "PFCOUNT") {
+            // PFCOUNT key [key ...]: cardinality of the union
+            std::vector<std::string> keys = {key};
+            auto more = splitArguments(arguments);
+            keys.insert(keys.end(), more.begin(), more.end());
+            
+            uint64_t count = 0;
+            if (engine.pfcount(keys, count) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            return std::to_string(count);
+        }
+        else if (op_str == "PFMERGE") {
+            // PFMERGE dest [source ...]
+            switch (engine.pfmerge(key, splitArguments(arguments))) {
+                case Status::OK:
+                    invalidate(key);
+                    return "OK";
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "BF.RESERVE") {
+            // BF.RESERVE key error_rate capacity [EXPANSION n]
+            auto args = splitArguments(arguments);
+            double error_rate = 0.0;
+            uint64_t capacity = 0;
+            uint32_t expansion = engine.getConfig().bf_expansion;
+            bool with_expansion = args.size() == 4 && args[2] == "EXPANSION";
+            if ((args.size() != 2 && !with_expansion) || !parseScore(args[0], error_rate) ||
+                !parseNumber(args[1], capacity) ||
+                (with_expansion && !parseNumber(args[3], expansion))) {
+                return "ERROR BF.RESERVE expects error_rate capacity [EXPANSION n]";
+            }
+            
+            switch (engine.bfReserve(key, error_rate, capacity, expansion)) {
+                case Status::OK:
+                    invalidate(key);
+                    return "OK";
+                case Status::OUT_OF_RANGE:
+                    return "ERROR Error rate must be in (0, 1), capacity positive, expansion "
+                           "1-1024, and the first layer at most 512MB";
+                case Status::KEY_EXISTS:
+                    return "ERROR Key already exists";
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "BF.ADD" || op_str == "BF.MADD") {
+            // BF.ADD key item; BF.MADD key item [item ...] replies one
+            // line per item: 1 if added, 0 if it may have been present
+            auto items = splitArguments(arguments);
+            if (items.empty() || (op_str == "BF.ADD" && items.size() != 1)) {
+                return "ERROR " + op_str + (op_str == "BF.ADD" ? " expects one item"
+                                                               : " expects at least one item");
+            }
+            std::vector<bool> added;
+            switch (engine.bfAdd(key, items, added)) {
+                case Status::OK:
+                    invalidate(key);
+                    break;
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+            if (op_str == "BF.ADD") {
+                return added[0] ? "1" : "0";
+            }
+            std::vector<std::string> lines;
+            for (bool item_added : added) {
+                lines.push_back(item_added ? "1" : "0");
+            }
+            return formatArray(lines);
+        }
+        else if (op_str == "BF.EXISTS" || op_str == "BF.MEXISTS") {
+            auto items = splitArguments(arguments);
+            if (items.empty() || (op_str == "BF.EXISTS" && items.size() != 1)) {
+                return "ERROR " + op_str + (op_str == "BF.EXISTS" ? " expects one item"
+                                                                  : " expects at least one item");
+            }
+            std::vector<bool> found;
+            if (engine.bfExists(key, items, found) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            if (op_str == "BF.EXISTS") {
+                return found[0] ? "1" : "0";
+            }
+            std::vector<std::string> lines;
+            for (bool item_found : found) {
+                lines.push_back(item_found ? "1" : "0");
+            }
+            return formatArray(lines);
+        }
+        else if (op_str == "SETBIT") {
+            // SETBIT key offset 0|1: replies the previous bit
+            auto args = splitArguments(arguments);
+            uint64_t offset = 0;
+            if (args.size() != 2 || !parseNumber(args[0], offset) ||
+                (args[1] != "0" && args[1] != "1")) {
+                return "ERROR SETBIT expects an offset and a bit (0 or 1)";
+            }
+            
+            bool previous = false;
+            switch (engine.setBit(key, offset, args[1] == "1", previous)) {
+                case Status::OK:
+                    invalidate(key);
+                    return previous ? "1" : "0";
+                case Status::OUT_OF_RANGE:
+                    return "ERROR Value too large";
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "GETBIT") {
+            uint64_t offset = 0;
+            if (!parseNumber(value, offset)) {
+                return "ERROR GETBIT expects an offset";
+            }
+            bool bit = false;
+            if (engine.getBit(key, offset, bit) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            return bit ? "1" : "0";
+        }
+        else if (op_str == "BITCOUNT") {
+            // BITCOUNT key [start end]: a byte range, as in GETRANGE
+            auto args = splitArguments(arguments);
+            int64_t start = 0, end = -1;
+            if ((args.size() != 0 && args.size() != 2) ||
+                (args.size() == 2 && (!parseNumber(args[0], start) || !parseNumber(args[1], end)))) {
+                return "ERROR BITCOUNT expects an optional start and end";
+            }
+            uint64_t count = 0;
+            if (engine.bitCount(key, start, end, count) == Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            return std::to_string(count);
+        }
+        else if (op_str == "BITPOS") {
+            // BITPOS key 0|1 [start [end]]
+            auto args = splitArguments(arguments);
+            int64_t start = 0, end = -1;
+            if (args.empty() || args.size() > 3 || (args[0] != "0" && args[0] != "1") ||
+                (args.size() > 1 && !parseNumber(args[1], start)) ||
+                (args.size() > 2 && !parseNumber(args[2], end))) {
+                return "ERROR BITPOS expects a bit (0 or 1) and an optional start and end";
+            }
+            int64_t position = -1;
+            std::optional<int64_t> range_end;
+            if (args.size() > 2) {
+                range_end = end;
+            }
+            if (engine.bitPos(key, args[0] == "1", start, range_end, position) ==
+                Status::WRONG_TYPE) {
+                return kWrongType;
+            }
+            return std::to_string(position);
+        }
+        else if (op_str == "BITOP") {
+            // BITOP AND|OR|XOR|NOT dest source [source ...]: the operation
+            // parses as the key; replies the length of dest
+            auto args = splitArguments(arguments);
+            BitOp op;
+            if (key == "AND") {
+                op = BitOp::AND;
+            } else if (key == "OR") {
+                op = BitOp::OR;
+            } else if (key == "XOR") {
+                op = BitOp::XOR;
+            } else if (key == "NOT") {
+                op = BitOp::NOT;
+            } else {
+                return "ERROR BITOP expects AND, OR, XOR or NOT";
+            }
+            if (args.size() < 2 || (op == BitOp::NOT && args.size() != 2)) {
+                return op == BitOp::NOT ? "ERROR BITOP NOT expects dest and one source"
+                                        : "ERROR BITOP expects dest and at least one source";
+            }
+            if (args[0].size() > config.max_key_size) {
+                return "ERROR Key too large";
+            }
+            
+            std::vector<std::string> sources(args.begin() + 1, args.end());
+            size_t length = 0;
+            switch (engine.bitOp(op, args[0], sources, length)) {
+                case Status::OK:
+                    invalidate(args[0]);
+                    return std::to_string(length);
+                case Status::WRONG_TYPE:
+                    return kWrongType;
+                case Status::OUT_OF_MEMORY:
+                    return kOutOfMemory;
+                default:
+                    return "ERROR WAL write failed";
+            }
+        }
+        else if (op_str == "TYPE") {
+            return typeName(engine.type(key));
         }
         else if (op_str == "SIZE") {
-            return std::to_string(store.size());
+            return std::to_string(engine.size());
         }
         else if (op_str == "PING") {
             return "PONG";
         }
+        else if (op_str == "SELECT") {
+            // Namespace for this connection's later commands
+            size_t database = 0;
+            if (!parseNumber(key, database) || database >= engines.size()) {
+                return "ERROR SELECT expects a namespace from 0 to " +
+                       std::to_string(engines.size() - 1);
+            }
+            conn.database = database;
+            return "OK";
+        }
         else if (op_str == "FLUSH") {
-            store.clear();
-            wal.clear();
+            // The selected namespace only. Near caches key by name alone,
+            // so every tracking connection drops its whole cache.
+            engine.clear();
+            invalidateAll();
+            return "OK";
+        }
+        else if (op_str == "FLUSHALL") {
+            for (auto& database : engines) {
+                database->clear();
+            }
+            invalidateAll();
             return "OK";
         }
+        else if (op_str == "CHECKPOINT") {
+            return engine.checkpoint() ? "OK" : "ERROR Checkpoint failed";
+        }
+        else if (op_str == "TRACKING") {
+            // Near-cache invalidation channel for this connection
+            if (key == "ON") {
+                conn.tracking = true;
+                return "OK";
+            } else if (key == "OFF") {
+                conn.tracking = false;
+                return "OK";
+            }
+            return "ERROR TRACKING expects ON or OFF";
+        }
+        else if (op_str == "TIMING") {
+            if (key == "ON") {
+                conn.timing = true;
+                return "OK";
+            } else if (key == "OFF") {
+                conn.timing = false;
+                return "OK";
+            }
+            return "ERROR TIMING expects ON or OFF";
+        }
+        else if (op_str == "TRACE") {
+            auto& tracer = Tracer::instance();
+            if (key == "START") {
+                uint32_t every = config.trace_sample_every;
+                if (!value.empty()) {
+                    try {
+                        every = static_cast<uint32_t>(std::stoul(value));
+                    } catch (const std::exception&) {
+                        return "ERROR Invalid sample rate";
+                    }
+                }
+                tracer.start(every);
+                return "OK";
+            } else if (key == "STOP") {
+                if (!tracer.isEnabled()) {
+                    return "ERROR Tracing not started";
+                }
+                tracer.stop();
+                
+                std::ofstream out(config.trace_file);
+                size_t events = tracer.writeChromeTrace(out);
+                if (!out) {
+                    return "ERROR Cannot write " + config.trace_file;
+                }
+                return "OK " + std::to_string(events) + " " + config.trace_file;
+            }
+            return "ERROR TRACE expects START or STOP";
+        }
         else if (op_str == "STATS") {
-            auto stats = store.getStatistics();
-            std::ostringstream oss;
-            oss << "items: " << stats.item_count << "\n"
-                << "buckets: " << stats.bucket_count << "\n"
-                << "load_factor: " << stats.load_factor << "\n"
-                << "utilization: " << stats.utilization;
-            return oss.str();
+            auto stats = engine.getStatistics();
+            std::ostringstream load_factor, utilization, lock_contention;
+            load_factor << stats.load_factor;
+            utilization << stats.utilization;
+            lock_contention << stats.lock_contention;
+            
+            return formatArray({
+                "namespace: " + std::to_string(conn.database),
+                "items: " + std::to_string(stats.item_count),
+                "buckets: " + std::to_string(stats.bucket_count),
+                "load_factor: " + load_factor.str(),
+                "utilization: " + utilization.str(),
+                "expiring_keys: " + std::to_string(stats.expiring_keys),
+                "wal_size: " + std::to_string(stats.wal_size),
+                "checkpoints: " + std::to_string(stats.checkpoints),
+                "fsyncs: " + std::to_string(stats.fsyncs),
+                "resizes: " + std::to_string(stats.resizes),
+                "lock_contention: " + lock_contention.str(),
+                "used_memory: " + std::to_string(stats.used_memory),
+                "max_memory: " + std::to_string(stats.max_memory),
+                "evictions: " + std::to_string(stats.evictions),
+                "tracked_keys: " + std::to_string(tracker.size())
+            });
         }
         else {
             return "ERROR Unknown command";
@@ -187,23 +1395,44 @@ private:
 public:
     KVServer(const Config& config)
         : acceptor(io_context, tcp::endpoint(tcp::v4(), config.server_port)),
-          store(config.num_segments),
-          wal(config.wal_file, config.sync_wal, config.wal_buffer_size),
-          config(config) {
+          config(AutoTuner::startupConfig(config)) {
+        for (size_t i = 0; i < std::max<size_t>(config.databases, 1); ++i) {
+            engines.push_back(std::make_unique<KVEngine>(ConfigManager::databaseConfig(config, i)));
+        }
+        
+        std::cout << "Recovery complete. " << getItemCount() << " items loaded";
+        if (engines.size() > 1) {
+            std::cout << " into " << engines.size() << " namespaces";
+        }
+        std::cout << "." << std::endl;
         
-        // Recover from WAL
-        recoverFromWAL();
+        // Keys purged by the expiry sweep or evicted may still sit in near
+        // caches
+        for (auto& engine : engines) {
+            engine->setExpiryListener([this](const std::string& key) {
+                invalidate(key);
+            });
+        }
     }
     
     ~KVServer() {
         stop();
     }
     
-    void start(size_t num_workers = 4) {
+    // num_workers = 0 uses config.num_workers
+    void start(size_t num_workers = 0) {
         if (running) return;
         
+        if (num_workers == 0) {
+            num_workers = config.num_workers;
+        }
+
         running = true;
         
+        // Queue the first accept before any thread calls run(), otherwise
+        // run() can find no work and return immediately
+        startAccept();
+        
         // Start IO context in separate thread
         io_thread = std::make_unique<std::thread>([this]() {
             io_context.run();
@@ -216,10 +1445,10 @@ public:
             });
         }
         
-        startAccept();
-        
         std::cout << "KV Server started on port " << config.server_port << std::endl;
-        std::cout << "Segments: " << config.num_segments << std::endl;
+        std::cout << "Segments: " << config.num_segments
+                  << (config.auto_tune ? " (auto-tuned)" : "") << std::endl;
+        std::cout << "Workers: " << num_workers << std::endl;
         std::cout << "WAL: " << config.wal_file << std::endl;
     }
     
@@ -244,28 +1473,17 @@ public:
         std::cout << "KV Server stopped" << std::endl;
     }
     
-    void recoverFromWAL() {
-        std::cout << "Recovering from WAL..." << std::endl;
-        
-        auto insert_func = [this](const std::string& key, const std::string& value) {
-            store.insert(key, value);
-        };
-        
-        auto delete_func = [this](const std::string& key) {
-            store.erase(key);
-        };
-        
-        wal.replay(insert_func, delete_func);
-        
-        std::cout << "Recovery complete. " << store.size() << " items loaded." << std::endl;
-    }
-    
     size_t getConnectionCount() const {
         return current_connections.load();
     }
     
+    // Keys across all namespaces
     size_t getItemCount() const {
-        return store.size();
+        size_t items = 0;
+        for (const auto& engine : engines) {
+            items += engine->size();
+        }
+        return items;
     }
     
     Config getConfig() const {
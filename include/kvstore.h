@@ -0,0 +1,102 @@
+#ifndef KV_STORE_C_API_H
+#define KV_STORE_C_API_H
+
+/*
+ * C interface to the embeddable engine (libkvstore): the same store,
+ * WAL, checkpoints and expiry as kv_server, called in-process with no
+ * networking. Every function is thread-safe. No C++ exception crosses
+ * this boundary; failures are reported through kvstore_status.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct kvstore_engine kvstore_engine;
+
+typedef enum {
+    KVSTORE_OK = 0,
+    KVSTORE_NOT_FOUND = 1,
+    KVSTORE_WAL_ERROR = 2,          /* Write could not be logged; not applied */
+    KVSTORE_INVALID_ARGUMENT = 3,
+    KVSTORE_ERROR = 4,              /* Unexpected failure (e.g. out of memory) */
+    KVSTORE_NOT_INTEGER = 5,        /* Increment of a value that is not an integer */
+    KVSTORE_OUT_OF_RANGE = 6,       /* Increment would overflow int64 */
+    KVSTORE_WRONG_TYPE = 7,         /* Key holds another value type (e.g. a hash) */
+    KVSTORE_KEY_EXISTS = 8,         /* Create of a key that already exists */
+    KVSTORE_OUT_OF_MEMORY = 9       /* Over max_memory with nothing to evict */
+} kvstore_status;
+
+/* Open (and recover) the store logged to wal_file. Returns NULL on failure.
+ * sync_wal 0 buffers WAL writes; 1 flushes each write to the OS before
+ * returning, so it survives a process crash but not a power loss; 2 also
+ * fsyncs it (fsync_writes), so it survives a power loss. */
+kvstore_engine* kvstore_open(const char* wal_file, size_t num_segments, int sync_wal);
+
+/* Open with settings from a kv_server style configuration file */
+kvstore_engine* kvstore_open_config(const char* config_file);
+
+void kvstore_close(kvstore_engine* engine);
+
+/* Store a value; ttl_ms > 0 makes the key expire */
+kvstore_status kvstore_put(kvstore_engine* engine,
+                           const char* key, size_t key_len,
+                           const char* value, size_t value_len,
+                           uint64_t ttl_ms);
+
+/* On KVSTORE_OK, *value receives a malloc'd copy (release with
+ * kvstore_free) and *value_len its length */
+kvstore_status kvstore_get(kvstore_engine* engine,
+                           const char* key, size_t key_len,
+                           char** value, size_t* value_len);
+
+kvstore_status kvstore_delete(kvstore_engine* engine, const char* key, size_t key_len);
+
+/* Returns 1 if the key exists, 0 otherwise */
+int kvstore_exists(kvstore_engine* engine, const char* key, size_t key_len);
+
+size_t kvstore_size(kvstore_engine* engine);
+
+kvstore_status kvstore_expire(kvstore_engine* engine,
+                              const char* key, size_t key_len, uint64_t ttl_ms);
+
+/* Add delta to the integer at key (a missing key counts as 0); on
+ * KVSTORE_OK *result receives the new value */
+kvstore_status kvstore_incrby(kvstore_engine* engine,
+                              const char* key, size_t key_len,
+                              int64_t delta, int64_t* result);
+
+/* Append to the value at key (a missing key starts empty); on
+ * KVSTORE_OK *length receives the new length */
+kvstore_status kvstore_append(kvstore_engine* engine,
+                              const char* key, size_t key_len,
+                              const char* data, size_t data_len, size_t* length);
+
+/* Overwrite the value from offset on, zero-padding a shorter value */
+kvstore_status kvstore_setrange(kvstore_engine* engine,
+                                const char* key, size_t key_len, size_t offset,
+                                const char* data, size_t data_len, size_t* length);
+
+/* Value length in bytes, 0 if the key does not exist */
+size_t kvstore_strlen(kvstore_engine* engine, const char* key, size_t key_len);
+
+/* Remaining time to live in ms; -1 if the key does not expire,
+ * -2 if it does not exist */
+int64_t kvstore_ttl(kvstore_engine* engine, const char* key, size_t key_len);
+
+/* Snapshot the data set and truncate the WAL */
+kvstore_status kvstore_checkpoint(kvstore_engine* engine);
+
+/* Remove every key, including persisted data */
+kvstore_status kvstore_flush(kvstore_engine* engine);
+
+void kvstore_free(void* ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KV_STORE_C_API_H */
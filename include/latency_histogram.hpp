@@ -0,0 +1,170 @@
+#ifndef KV_STORE_LATENCY_HISTOGRAM_HPP
+#define KV_STORE_LATENCY_HISTOGRAM_HPP
+
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+namespace kvstore {
+
+// Log-linear (HDR-style) latency histogram.
+// Values are bucketed with 32 linear sub-buckets per power of two, which
+// keeps every recorded value within ~3% of its true magnitude over the
+// whole range (1ns .. ~4.9h when recording nanoseconds). Recording is a
+// single relaxed atomic increment, so one histogram may be shared by
+// several threads; snapshots are not atomic across buckets.
+class LatencyHistogram {
+public:
+    static constexpr int sub_bucket_bits = 5;
+    static constexpr uint64_t sub_bucket_half = 1ULL << sub_bucket_bits;   // 32
+    static constexpr uint64_t linear_limit = sub_bucket_half * 2;          // 64
+    static constexpr int max_magnitude = 44;                               // Values < 2^44
+    static constexpr size_t bucket_count =
+        linear_limit + (max_magnitude - sub_bucket_bits - 2) * sub_bucket_half + sub_bucket_half;
+
+private:
+    std::array<std::atomic<uint64_t>, bucket_count> counts{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> min_value{UINT64_MAX};
+    std::atomic<uint64_t> max_value{0};
+
+    static size_t indexFor(uint64_t value) {
+        if (value < linear_limit) {
+            return static_cast<size_t>(value);
+        }
+
+        value = std::min<uint64_t>(value, (1ULL << max_magnitude) - 1);
+        int msb = 63 - __builtin_clzll(value);
+        int shift = msb - sub_bucket_bits;
+        uint64_t sub = value >> shift;  // In [32, 64)
+        return linear_limit + (shift - 1) * sub_bucket_half + (sub - sub_bucket_half);
+    }
+
+    // Highest value that maps to the same bucket as index
+    static uint64_t upperBoundFor(size_t index) {
+        if (index < linear_limit) {
+            return index;
+        }
+
+        size_t offset = index - linear_limit;
+        int shift = static_cast<int>(offset / sub_bucket_half) + 1;
+        uint64_t sub = offset % sub_bucket_half + sub_bucket_half;
+        return ((sub + 1) << shift) - 1;
+    }
+
+public:
+    LatencyHistogram() = default;
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(uint64_t value) {
+        counts[indexFor(value)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t current = min_value.load(std::memory_order_relaxed);
+        while (value < current &&
+               !min_value.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+        current = max_value.load(std::memory_order_relaxed);
+        while (value > current &&
+               !max_value.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Fold another histogram into this one (e.g. per-thread results)
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < bucket_count; ++i) {
+            uint64_t n = other.counts[i].load(std::memory_order_relaxed);
+            if (n > 0) {
+                counts[i].fetch_add(n, std::memory_order_relaxed);
+            }
+        }
+        total.fetch_add(other.total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        sum.fetch_add(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+        uint64_t other_min = other.min_value.load(std::memory_order_relaxed);
+        uint64_t current = min_value.load(std::memory_order_relaxed);
+        while (other_min < current &&
+               !min_value.compare_exchange_weak(current, other_min, std::memory_order_relaxed)) {
+        }
+        uint64_t other_max = other.max_value.load(std::memory_order_relaxed);
+        current = max_value.load(std::memory_order_relaxed);
+        while (other_max > current &&
+               !max_value.compare_exchange_weak(current, other_max, std::memory_order_relaxed)) {
+        }
+    }
+
+    void reset() {
+        for (auto& count : counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        total.store(0, std::memory_order_relaxed);
+        sum.store(0, std::memory_order_relaxed);
+        min_value.store(UINT64_MAX, std::memory_order_relaxed);
+        max_value.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    uint64_t min() const {
+        return count() > 0 ? min_value.load(std::memory_order_relaxed) : 0;
+    }
+
+    uint64_t max() const {
+        return max_value.load(std::memory_order_relaxed);
+    }
+
+    double mean() const {
+        uint64_t n = count();
+        return n > 0 ? static_cast<double>(sum.load(std::memory_order_relaxed)) / n : 0.0;
+    }
+
+    // Value at the given percentile (0-100), reported as the upper bound
+    // of its bucket and never above the largest recorded value
+    uint64_t percentile(double p) const {
+        uint64_t n = count();
+        if (n == 0) {
+            return 0;
+        }
+
+        auto target = static_cast<uint64_t>(p / 100.0 * n + 0.5);
+        target = std::clamp<uint64_t>(target, 1, n);
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < bucket_count; ++i) {
+            seen += counts[i].load(std::memory_order_relaxed);
+            if (seen >= target) {
+                return std::min(upperBoundFor(i), max());
+            }
+        }
+        return max();
+    }
+
+    // Point-in-time summary
+    struct Summary {
+        uint64_t count;
+        uint64_t min;
+        uint64_t max;
+        double mean;
+        uint64_t p50;
+        uint64_t p90;
+        uint64_t p99;
+        uint64_t p999;
+    };
+
+    Summary summarize() const {
+        return Summary{count(), min(), max(), mean(),
+                       percentile(50.0), percentile(90.0),
+                       percentile(99.0), percentile(99.9)};
+    }
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_LATENCY_HISTOGRAM_HPP
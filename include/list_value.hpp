@@ -0,0 +1,137 @@
+#ifndef KV_STORE_LIST_VALUE_HPP
+#define KV_STORE_LIST_VALUE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include "listpack.hpp"
+#include "types.hpp"
+
+namespace kvstore {
+
+// List stored at a key (LPUSH/RPOP...), as a deque of Listpack chunks of
+// up to chunk_size elements each. Pushes and pops at either end touch
+// only the end chunk, so they cost O(chunk) regardless of the list
+// length, and a queue of short items costs a few bytes per element
+// rather than a node allocation each.
+class ListValue : public Collection {
+private:
+    std::deque<Listpack> chunks;
+    size_t count = 0;
+    size_t packed_bytes = 0;    // Sum of the chunks' bytes()
+    size_t chunk_size;
+
+public:
+    explicit ListValue(size_t chunk_size) : chunk_size(chunk_size > 0 ? chunk_size : 1) {}
+
+    ValueType type() const override {
+        return ValueType::LIST;
+    }
+
+    size_t memoryUsage() const override {
+        return packed_bytes + chunks.size() * sizeof(Listpack);
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    size_t chunkCount() const {
+        return chunks.size();
+    }
+
+    void pushFront(std::string_view element) {
+        if (chunks.empty() || chunks.front().size() >= chunk_size) {
+            chunks.emplace_front();
+        }
+        size_t before = chunks.front().bytes();
+        chunks.front().insert(0, element);
+        packed_bytes += chunks.front().bytes() - before;
+        count++;
+    }
+
+    void pushBack(std::string_view element) {
+        if (chunks.empty() || chunks.back().size() >= chunk_size) {
+            chunks.emplace_back();
+        }
+        size_t before = chunks.back().bytes();
+        chunks.back().push_back(element);
+        packed_bytes += chunks.back().bytes() - before;
+        count++;
+    }
+
+    bool popFront(std::string& element) {
+        if (chunks.empty()) {
+            return false;
+        }
+        auto& chunk = chunks.front();
+        std::string_view first;
+        chunk.next(0, first);
+        element.assign(first.data(), first.size());
+        size_t before = chunk.bytes();
+        chunk.erase(0);
+        packed_bytes -= before - chunk.bytes();
+        if (chunk.empty()) {
+            chunks.pop_front();
+        }
+        count--;
+        return true;
+    }
+
+    bool popBack(std::string& element) {
+        if (chunks.empty()) {
+            return false;
+        }
+        auto& chunk = chunks.back();
+        size_t pos = chunk.back();
+        std::string_view last;
+        chunk.next(pos, last);
+        element.assign(last.data(), last.size());
+        size_t before = chunk.bytes();
+        chunk.erase(pos);
+        packed_bytes -= before - chunk.bytes();
+        if (chunk.empty()) {
+            chunks.pop_back();
+        }
+        count--;
+        return true;
+    }
+
+    // Append elements first..last (inclusive, both < size()) to out,
+    // skipping whole chunks up to first
+    void range(size_t first, size_t last, std::vector<std::string>& out) const {
+        size_t index = 0;
+        for (const auto& chunk : chunks) {
+            if (index > last) {
+                break;
+            }
+            if (index + chunk.size() <= first) {
+                index += chunk.size();
+                continue;
+            }
+            chunk.forEach([&](std::string_view element) {
+                if (index >= first && index <= last) {
+                    out.emplace_back(element);
+                }
+                index++;
+            });
+        }
+    }
+
+    // fn(element) front to back
+    template<typename Fn>
+    void forEach(Fn fn) const {
+        for (const auto& chunk : chunks) {
+            chunk.forEach(fn);
+        }
+    }
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_LIST_VALUE_HPP
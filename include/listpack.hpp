@@ -0,0 +1,149 @@
+#ifndef KV_STORE_LISTPACK_HPP
+#define KV_STORE_LISTPACK_HPP
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace kvstore {
+
+// A sequence of strings in one contiguous buffer, each stored as its
+// length (LEB128 varint) followed by its bytes. Small collections use it
+// instead of node-based containers: an element costs a byte or two of
+// overhead rather than a heap node, and a scan touches one allocation.
+// Positions are byte offsets into the buffer; begin() is 0 and end() is
+// bytes().
+class Listpack {
+private:
+    std::string data;
+    size_t count = 0;
+
+    static void appendVarint(std::string& out, size_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    static std::string encode(std::string_view element) {
+        std::string encoded;
+        appendVarint(encoded, element.size());
+        encoded.append(element.data(), element.size());
+        return encoded;
+    }
+
+public:
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    size_t bytes() const {
+        return data.size();
+    }
+
+    size_t end() const {
+        return data.size();
+    }
+
+    // The raw buffer, e.g. for a WAL record; fromBytes() reverses it
+    const std::string& raw() const {
+        return data;
+    }
+
+    // Decode a buffer written by raw(); false if it is malformed
+    static bool fromBytes(std::string bytes, Listpack& result) {
+        Listpack decoded;
+        decoded.data = std::move(bytes);
+        std::string_view element;
+        for (size_t pos = 0; pos < decoded.data.size(); ) {
+            pos = decoded.next(pos, element);
+            if (pos == std::string::npos) {
+                return false;
+            }
+            decoded.count++;
+        }
+        result = std::move(decoded);
+        return true;
+    }
+
+    // Read the element at pos; returns the position after it, or npos if
+    // pos is at the end or the buffer is truncated
+    size_t next(size_t pos, std::string_view& element) const {
+        size_t length = 0;
+        for (unsigned shift = 0; ; shift += 7) {
+            if (pos >= data.size() || shift > 63) {
+                return std::string::npos;
+            }
+            auto byte = static_cast<uint8_t>(data[pos++]);
+            length |= static_cast<size_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+        if (length > data.size() - pos) {
+            return std::string::npos;
+        }
+        element = std::string_view(data).substr(pos, length);
+        return pos + length;
+    }
+
+    // Position of the last element, or npos if empty (a forward scan:
+    // the encoding has no back links)
+    size_t back() const {
+        std::string_view element;
+        size_t last = std::string::npos;
+        for (size_t pos = 0; pos < data.size(); pos = next(pos, element)) {
+            last = pos;
+        }
+        return last;
+    }
+
+    void push_back(std::string_view element) {
+        appendVarint(data, element.size());
+        data.append(element.data(), element.size());
+        count++;
+    }
+
+    void insert(size_t pos, std::string_view element) {
+        data.insert(pos, encode(element));
+        count++;
+    }
+
+    // Remove the element at pos
+    void erase(size_t pos) {
+        std::string_view element;
+        size_t after = next(pos, element);
+        data.erase(pos, after - pos);
+        count--;
+    }
+
+    // Overwrite the element at pos
+    void replace(size_t pos, std::string_view element) {
+        std::string_view current;
+        size_t after = next(pos, current);
+        data.replace(pos, after - pos, encode(element));
+    }
+
+    void clear() {
+        data.clear();
+        count = 0;
+    }
+
+    template<typename Fn>
+    void forEach(Fn fn) const {
+        std::string_view element;
+        for (size_t pos = 0; pos < data.size(); ) {
+            pos = next(pos, element);
+            fn(element);
+        }
+    }
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_LISTPACK_HPP
@@ -0,0 +1,179 @@
+#ifndef KV_STORE_NEAR_CACHE_HPP
+#define KV_STORE_NEAR_CACHE_HPP
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include "types.hpp"
+
+namespace kvstore {
+
+// Near cache configuration
+struct NearCacheOptions {
+    size_t capacity = 10000;                      // Max cached entries (all shards)
+    std::chrono::milliseconds ttl{60000};         // Upper bound on staleness
+    size_t num_shards = 16;                       // Independent LRU shards
+};
+
+// Bounded client-side cache: sharded LRU with per-entry TTL.
+// Coherence is the caller's job (KVClient erases entries when the
+// server pushes invalidations); the TTL only bounds staleness if a
+// push is ever lost.
+template<typename Key, typename Value, typename Hash = StringHasher>
+class NearCache {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        Key key;
+        Value value;
+        Clock::time_point expires_at;
+    };
+
+    struct Shard {
+        std::list<Entry> lru;   // Most recently used at the front
+        std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index;
+        std::mutex mutex;
+        size_t capacity = 0;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::chrono::milliseconds ttl;
+    Hash hasher;
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> evictions{0};
+    std::atomic<uint64_t> invalidations{0};
+
+    Shard& getShard(const Key& key) {
+        return *shards[hasher(key) % shards.size()];
+    }
+
+public:
+    explicit NearCache(const NearCacheOptions& options = NearCacheOptions())
+        : ttl(options.ttl) {
+        size_t num_shards = options.num_shards > 0 ? options.num_shards : 1;
+        size_t per_shard = (options.capacity + num_shards - 1) / num_shards;
+
+        shards.reserve(num_shards);
+        for (size_t i = 0; i < num_shards; ++i) {
+            shards.push_back(std::make_unique<Shard>());
+            shards.back()->capacity = per_shard > 0 ? per_shard : 1;
+        }
+    }
+
+    NearCache(const NearCache&) = delete;
+    NearCache& operator=(const NearCache&) = delete;
+
+    bool find(const Key& key, Value& value) {
+        auto& shard = getShard(key);
+        std::lock_guard lock(shard.mutex);
+
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (Clock::now() >= it->second->expires_at) {
+            shard.lru.erase(it->second);
+            shard.index.erase(it);
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // Move to front (most recently used)
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        value = it->second->value;
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void insert(const Key& key, Value value) {
+        auto& shard = getShard(key);
+        std::lock_guard lock(shard.mutex);
+        auto expires_at = Clock::now() + ttl;
+
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            it->second->value = std::move(value);
+            it->second->expires_at = expires_at;
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            return;
+        }
+
+        if (shard.lru.size() >= shard.capacity) {
+            shard.index.erase(shard.lru.back().key);
+            shard.lru.pop_back();
+            evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        shard.lru.push_front(Entry{key, std::move(value), expires_at});
+        shard.index.emplace(key, shard.lru.begin());
+    }
+
+    // Drop a single key (server-pushed invalidation or local write)
+    bool erase(const Key& key) {
+        auto& shard = getShard(key);
+        std::lock_guard lock(shard.mutex);
+
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            return false;
+        }
+
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        invalidations.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void clear() {
+        for (auto& shard : shards) {
+            std::lock_guard lock(shard->mutex);
+            shard->lru.clear();
+            shard->index.clear();
+        }
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& shard : shards) {
+            std::lock_guard lock(shard->mutex);
+            total += shard->lru.size();
+        }
+        return total;
+    }
+
+    // Get statistics
+    struct Statistics {
+        size_t size;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t invalidations;
+        double hit_ratio;
+    };
+
+    Statistics getStatistics() const {
+        Statistics stats;
+        stats.size = size();
+        stats.hits = hits.load(std::memory_order_relaxed);
+        stats.misses = misses.load(std::memory_order_relaxed);
+        stats.evictions = evictions.load(std::memory_order_relaxed);
+        stats.invalidations = invalidations.load(std::memory_order_relaxed);
+
+        uint64_t lookups = stats.hits + stats.misses;
+        stats.hit_ratio = lookups > 0 ? static_cast<double>(stats.hits) / lookups : 0.0;
+        return stats;
+    }
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_NEAR_CACHE_HPP
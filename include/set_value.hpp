@@ -0,0 +1,223 @@
+#ifndef KV_STORE_SET_VALUE_HPP
+#define KV_STORE_SET_VALUE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_set>
+#include <memory>
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include "types.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace kvstore {
+
+// Unordered set of members stored at a key (SADD/SISMEMBER...). A small
+// set whose members are all integers is an intset: a sorted int64 array,
+// 8 bytes a member with binary-search lookups, and intersections and
+// unions of intsets are linear merges. A set that gains a non-integer
+// member or more than max_intset_entries members converts to an
+// unordered_set for good.
+class SetValue : public Collection {
+private:
+    std::vector<int64_t> ints;      // Sorted, while an intset
+    std::unique_ptr<std::unordered_set<std::string>> table;
+    size_t table_bytes = 0;     // Member bytes in table
+    size_t max_intset_entries;
+
+    // Per table member beyond its bytes: the node with its string, and
+    // the bucket slot
+    static constexpr size_t kMemberOverhead = sizeof(std::string) + 3 * sizeof(void*);
+
+    void convert() {
+        auto converted = std::make_unique<std::unordered_set<std::string>>();
+        converted->reserve(ints.size() + 1);
+        for (int64_t member : ints) {
+            table_bytes += converted->insert(std::to_string(member)).first->size();
+        }
+        table = std::move(converted);
+        ints.clear();
+        ints.shrink_to_fit();
+    }
+
+public:
+    explicit SetValue(size_t max_intset_entries) : max_intset_entries(max_intset_entries) {}
+
+    ValueType type() const override {
+        return ValueType::SET;
+    }
+
+    size_t memoryUsage() const override {
+        return table ? table_bytes + table->size() * kMemberOverhead
+                     : ints.size() * sizeof(int64_t);
+    }
+
+    // member as an integer, if it is the canonical text of one ("12",
+    // not "012" or "+12"), so it formats back to the same member
+    static bool toInteger(std::string_view member, int64_t& value) {
+        if (member.empty() || member.size() > 20 || member[0] == '+' ||
+            (member[0] == '0' && member.size() > 1) ||
+            (member[0] == '-' && member.size() > 1 && member[1] == '0')) {
+            return false;
+        }
+        const char* end = member.data() + member.size();
+        auto [ptr, ec] = std::from_chars(member.data(), end, value);
+        return ec == std::errc() && ptr == end;
+    }
+
+    size_t size() const {
+        return table ? table->size() : ints.size();
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // True while in the intset encoding
+    bool compact() const {
+        return !table;
+    }
+
+    // The sorted members of an intset
+    const std::vector<int64_t>& integers() const {
+        return ints;
+    }
+
+    // Add member; true if it is new
+    bool add(std::string_view member) {
+        if (!table) {
+            int64_t value;
+            if (toInteger(member, value)) {
+                auto it = std::lower_bound(ints.begin(), ints.end(), value);
+                if (it != ints.end() && *it == value) {
+                    return false;
+                }
+                if (ints.size() < max_intset_entries) {
+                    ints.insert(it, value);
+                    return true;
+                }
+            }
+            convert();
+        }
+        bool added = table->emplace(member).second;
+        if (added) {
+            table_bytes += member.size();
+        }
+        return added;
+    }
+
+    bool contains(std::string_view member) const {
+        if (table) {
+            return table->count(std::string(member)) > 0;
+        }
+        int64_t value;
+        return toInteger(member, value) && std::binary_search(ints.begin(), ints.end(), value);
+    }
+
+    // Remove member; true if it was present
+    bool erase(std::string_view member) {
+        if (table) {
+            if (table->erase(std::string(member)) == 0) {
+                return false;
+            }
+            table_bytes -= member.size();
+            return true;
+        }
+        int64_t value;
+        if (!toInteger(member, value)) {
+            return false;
+        }
+        auto it = std::lower_bound(ints.begin(), ints.end(), value);
+        if (it == ints.end() || *it != value) {
+            return false;
+        }
+        ints.erase(it);
+        return true;
+    }
+
+    // fn(member) for every member, ascending while an intset
+    template<typename Fn>
+    void forEach(Fn fn) const {
+        if (table) {
+            for (const auto& member : *table) {
+                fn(std::string_view(member));
+            }
+            return;
+        }
+
+        char buffer[24];
+        for (int64_t member : ints) {
+            auto [ptr, ec] = std::to_chars(buffer, buffer + sizeof(buffer), member);
+            fn(std::string_view(buffer, ptr - buffer));
+        }
+    }
+
+    // Members of both sorted, duplicate-free arrays, ascending. With AVX2
+    // this compares four members of a against four of b per step (each
+    // rotation of b's block against a's), then advances whichever block
+    // ends lower; the remainder, or the whole merge without AVX2, steps
+    // both cursors by comparison results rather than by branches.
+    static std::vector<int64_t> intersect(const std::vector<int64_t>& a,
+                                          const std::vector<int64_t>& b) {
+        // Every lane stores before the count says whether to keep it, so
+        // the last block may write up to 3 past the final match
+        std::vector<int64_t> out(std::min(a.size(), b.size()) + 3);
+        size_t i = 0, j = 0, k = 0;
+
+#if defined(__AVX2__)
+        while (i + 4 <= a.size() && j + 4 <= b.size()) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.data() + i));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b.data() + j));
+            __m256i match = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi64(va, vb),
+                                _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0x39))),
+                _mm256_or_si256(_mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0x4e)),
+                                _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0x93))));
+            int mask = _mm256_movemask_pd(_mm256_castsi256_pd(match));
+            for (int lane = 0; lane < 4; ++lane) {
+                out[k] = a[i + lane];
+                k += (mask >> lane) & 1;
+            }
+            int64_t a_last = a[i + 3], b_last = b[j + 3];
+            i += a_last <= b_last ? 4 : 0;
+            j += b_last <= a_last ? 4 : 0;
+        }
+#endif
+
+        while (i < a.size() && j < b.size()) {
+            int64_t x = a[i], y = b[j];
+            out[k] = x;
+            k += x == y;
+            i += x <= y;
+            j += y <= x;
+        }
+        out.resize(k);
+        return out;
+    }
+
+    // Members of either sorted, duplicate-free array, ascending
+    static std::vector<int64_t> unite(const std::vector<int64_t>& a,
+                                      const std::vector<int64_t>& b) {
+        std::vector<int64_t> out(a.size() + b.size());
+        size_t i = 0, j = 0, k = 0;
+        while (i < a.size() && j < b.size()) {
+            int64_t x = a[i], y = b[j];
+            out[k++] = x < y ? x : y;
+            i += x <= y;
+            j += y <= x;
+        }
+        k = std::copy(a.begin() + i, a.end(), out.begin() + k) - out.begin();
+        k = std::copy(b.begin() + j, b.end(), out.begin() + k) - out.begin();
+        out.resize(k);
+        return out;
+    }
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_SET_VALUE_HPP
@@ -0,0 +1,265 @@
+#ifndef KV_STORE_TRACER_HPP
+#define KV_STORE_TRACER_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <ostream>
+#include <cstdint>
+#include <cstdio>
+
+namespace kvstore {
+
+// Sampled span tracing of request lifecycles, dumped as Chrome trace
+// JSON (chrome://tracing, ui.perfetto.dev).
+//
+// A thread that starts a request asks the tracer whether to sample it;
+// with tracing on, every Nth request per thread is. Spans are recorded
+// only while the current thread is inside a sampled request, so code on
+// the request path (map, WAL) can open spans unconditionally: outside a
+// sampled request a span costs one thread-local load, and with tracing
+// off a request costs one relaxed atomic load.
+//
+// Each thread appends to its own ring buffer, keeping the most recent
+// events when it wraps. The buffer's mutex is only ever contended by a
+// dump.
+class Tracer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t kDefaultCapacity = 16384;   // Events per thread
+
+    struct Event {
+        const char* name;       // Static string
+        uint64_t start_ns;      // Since the tracer was created
+        uint64_t duration_ns;
+        uint64_t request;
+    };
+
+private:
+    struct ThreadBuffer {
+        std::mutex mutex;
+        std::vector<Event> events;
+        size_t next = 0;            // Overwrite position once full
+        uint64_t tid = 0;
+    };
+
+    // Buffers stay registered after their thread exits, until start()
+    struct ThreadState {
+        std::shared_ptr<ThreadBuffer> buffer;
+        uint64_t generation = 0;    // Tracer generation the buffer belongs to
+        uint32_t countdown = 0;     // Requests until the next sample
+        std::minstd_rand random{static_cast<uint32_t>(
+            std::hash<std::thread::id>()(std::this_thread::get_id()))};
+    };
+
+    std::atomic<bool> enabled{false};
+    std::atomic<uint32_t> sample_every{1};
+    std::atomic<uint64_t> generation{0};        // Bumped by start()
+    std::atomic<uint64_t> next_request{1};
+    std::atomic<uint64_t> next_tid{1};
+    std::atomic<size_t> capacity{kDefaultCapacity};
+    Clock::time_point epoch = Clock::now();
+
+    std::mutex registry_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+    // Sampled request the current thread is in, 0 if none. Trivially
+    // initialised, so reading it needs no thread_local guard.
+    static inline thread_local uint64_t current_request = 0;
+
+    static ThreadState& threadState() {
+        thread_local ThreadState state;
+        return state;
+    }
+
+    Tracer() = default;
+
+    ThreadBuffer& threadBuffer() {
+        auto& state = threadState();
+        uint64_t current = generation.load(std::memory_order_acquire);
+        if (!state.buffer || state.generation != current) {
+            auto buffer = std::make_shared<ThreadBuffer>();
+            buffer->tid = next_tid.fetch_add(1, std::memory_order_relaxed);
+            {
+                std::lock_guard lock(registry_mutex);
+                buffers.push_back(buffer);
+            }
+            state.buffer = std::move(buffer);
+            state.generation = current;
+        }
+        return *state.buffer;
+    }
+
+public:
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Discard earlier events and sample every sample_every-th request
+    // per thread from now on
+    void start(uint32_t every = 1, size_t events_per_thread = kDefaultCapacity) {
+        std::lock_guard lock(registry_mutex);
+        enabled.store(false, std::memory_order_relaxed);
+        sample_every.store(every > 0 ? every : 1, std::memory_order_relaxed);
+        capacity.store(events_per_thread > 0 ? events_per_thread : 1, std::memory_order_relaxed);
+        buffers.clear();
+        generation.fetch_add(1, std::memory_order_acq_rel);
+        enabled.store(true, std::memory_order_release);
+    }
+
+    // Stop sampling new requests; recorded events stay until start()
+    void stop() {
+        enabled.store(false, std::memory_order_release);
+    }
+
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // Called at the start of a request on this thread; returns its id if
+    // sampled, else 0
+    uint64_t beginRequest() {
+        if (!enabled.load(std::memory_order_relaxed)) {
+            return current_request = 0;
+        }
+
+        // Start each thread at a random point in the cycle, so short-lived
+        // connections do not all sample their first request
+        auto& state = threadState();
+        uint32_t every = sample_every.load(std::memory_order_relaxed);
+        if (state.countdown == 0 || state.countdown > every) {
+            state.countdown = static_cast<uint32_t>(state.random() % every) + 1;
+        }
+        if (--state.countdown != 0) {
+            return current_request = 0;
+        }
+
+        state.countdown = every;
+        return current_request = next_request.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void endRequest() {
+        current_request = 0;
+    }
+
+    static bool sampling() {
+        return current_request != 0;
+    }
+
+    uint64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - epoch).count();
+    }
+
+    void record(const char* name, uint64_t start_ns, uint64_t end_ns) {
+        auto& buffer = threadBuffer();
+        Event event{name, start_ns, end_ns - start_ns, current_request};
+
+        std::lock_guard lock(buffer.mutex);
+        if (buffer.events.size() < capacity.load(std::memory_order_relaxed)) {
+            buffer.events.push_back(event);
+        } else {
+            buffer.events[buffer.next] = event;
+            buffer.next = (buffer.next + 1) % buffer.events.size();
+        }
+    }
+
+    // Recorded events with their thread ids, oldest first per thread
+    std::vector<std::pair<uint64_t, Event>> events() {
+        std::vector<std::shared_ptr<ThreadBuffer>> snapshot;
+        {
+            std::lock_guard lock(registry_mutex);
+            snapshot = buffers;
+        }
+
+        std::vector<std::pair<uint64_t, Event>> result;
+        for (const auto& buffer : snapshot) {
+            std::lock_guard lock(buffer->mutex);
+            size_t count = buffer->events.size();
+            for (size_t i = 0; i < count; ++i) {
+                result.emplace_back(buffer->tid, buffer->events[(buffer->next + i) % count]);
+            }
+        }
+        return result;
+    }
+
+    // Write the recorded events as Chrome trace JSON; returns the number
+    // of events written
+    size_t writeChromeTrace(std::ostream& out) {
+        auto recorded = events();
+
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        char line[96];
+        for (size_t i = 0; i < recorded.size(); ++i) {
+            const auto& [tid, event] = recorded[i];
+            // Complete ("X") events; timestamps in microseconds
+            out << (i == 0 ? "\n" : ",\n") << "{\"name\":\"" << event.name
+                << "\",\"cat\":\"kv\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid;
+            std::snprintf(line, sizeof(line), ",\"ts\":%.3f,\"dur\":%.3f",
+                          event.start_ns / 1000.0, event.duration_ns / 1000.0);
+            out << line << ",\"args\":{\"request\":" << event.request << "}}";
+        }
+        out << "\n]}\n";
+        return recorded.size();
+    }
+};
+
+// Marks the current thread's request for the lifetime of the object
+class TraceRequest {
+public:
+    TraceRequest() {
+        Tracer::instance().beginRequest();
+    }
+
+    ~TraceRequest() {
+        Tracer::instance().endRequest();
+    }
+
+    TraceRequest(const TraceRequest&) = delete;
+    TraceRequest& operator=(const TraceRequest&) = delete;
+};
+
+// Records a span from construction to end() or destruction, if the
+// current request is sampled. name must be a string literal.
+class TraceSpan {
+private:
+    const char* name;
+    uint64_t start_ns = 0;
+    bool active;
+
+public:
+    explicit TraceSpan(const char* name) : name(name), active(Tracer::sampling()) {
+        if (active) {
+            start_ns = Tracer::instance().now();
+        }
+    }
+
+    ~TraceSpan() {
+        end();
+    }
+
+    void end() {
+        if (active) {
+            auto& tracer = Tracer::instance();
+            tracer.record(name, start_ns, tracer.now());
+            active = false;
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_TRACER_HPP
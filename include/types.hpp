@@ -2,7 +2,9 @@
 #define KV_STORE_TYPES_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <map>
 #include <cstdint>
 #include <functional>
 
@@ -14,7 +16,49 @@ enum class Operation {
     GET,
     DELETE,
     EXISTS,
-    SIZE
+    SIZE,
+    EXPIRE,         // value: absolute deadline, ms since epoch
+    CHECKPOINT,     // value: first WAL sequence not covered by a snapshot
+    INCR,           // value: int64 delta, 8 bytes in host byte order
+    APPEND,         // value: bytes appended
+    SETRANGE,       // value: uint64 offset (8 bytes, host order), then the bytes written
+    HSET,           // value: Listpack of field, value pairs
+    HDEL,           // value: Listpack of fields
+    LPUSH,          // value: Listpack of elements, pushed in order
+    RPUSH,
+    LPOP,           // value: empty; removes one element
+    RPOP,
+    ZADD,           // value: Listpack of score (8-byte double, host order), member pairs
+    ZREM,           // value: Listpack of members
+    SADD,           // value: Listpack of members
+    SREM,           // value: Listpack of members
+    PFADD,          // value: HLL register updates, 2-byte index (host order) and rank each
+    PFMERGE,        // value: HyperLogLog::serialize() of the registers merged in
+    BFRESERVE,      // value: BloomFilter::encodeParameters(); creates an empty filter
+    BFADD,          // value: Bloom item hashes, 16 bytes each
+    BFLOAD          // value: BloomFilter::encodeLayer(); appends a layer (checkpoints)
+};
+
+// Type of the value stored at a key
+enum class ValueType {
+    NONE,           // No such key
+    STRING,
+    HASH,
+    LIST,
+    ZSET,
+    SET,
+    HLL,
+    BLOOM
+};
+
+// Base of the non-string value types the engine stores
+class Collection {
+public:
+    virtual ~Collection() = default;
+    virtual ValueType type() const = 0;
+
+    // Approximate heap bytes held, in O(1), for memory accounting
+    virtual size_t memoryUsage() const = 0;
 };
 
 // Operation result structure
@@ -58,6 +102,36 @@ struct StringHasher {
     }
 };
 
+// MurmurHash3 64-bit finalizer
+inline uint64_t mixHash(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// 64-bit hash whose every bit depends on every input byte, for the
+// probabilistic types that slice a hash into fields (HyperLogLog, Bloom
+// filters). FNV-1a alone leaves the high bits poorly mixed, so the
+// MurmurHash3 finalizer follows it.
+inline uint64_t mixedHash(std::string_view data) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ULL;
+    }
+    return mixHash(hash);
+}
+
+// What a namespace over max_memory does before a write that may grow it
+enum class EvictionPolicy {
+    NOEVICTION,         // Refuse the write (Status::OUT_OF_MEMORY)
+    ALLKEYS_RANDOM,     // Evict random keys
+    VOLATILE_TTL        // Evict keys with a TTL, nearest deadline among a sample first
+};
+
 // Configuration structure
 struct Config {
     size_t num_segments = 64;           // Number of hash map segments
@@ -65,10 +139,53 @@ struct Config {
     std::string wal_file = "kv_store.wal";
     size_t wal_buffer_size = 8192;      // 8KB buffer for WAL writes
     bool sync_wal = true;               // Synchronous WAL writes
+    bool fsync_writes = false;          // fsync the WAL before a write returns
     uint16_t server_port = 6379;        // Default port
     size_t max_key_size = 1024;         // 1KB max key size
     size_t max_value_size = 65536;      // 64KB max value size
+    size_t max_stream_value_size = 67108864; // 64MB max value assembled from chunks
+    size_t max_stream_uploads = 4;      // Chunked uploads in progress per connection
     size_t max_connections = 1000;      // Max concurrent connections
+    size_t checkpoint_wal_size = 0;     // Checkpoint once the WAL reaches this size (0 = never)
+    uint64_t expiry_sweep_interval_ms = 1000; // Purge expired keys this often (0 = never)
+    size_t num_workers = 4;             // Threads running the accept loop
+    
+    // Self-tuning (see AutoTuner): pick num_segments and num_workers from
+    // the hardware at startup and resize the segments at run time
+    bool auto_tune = false;
+    size_t expected_keys = 0;           // Size segments for this many keys at startup
+    size_t min_segments = 16;
+    size_t max_segments = 1048576;
+    size_t min_workers = 1;
+    size_t max_workers = 8;
+    uint64_t tune_interval_ms = 1000;   // Check metrics this often
+    
+    std::string trace_file = "kv_trace.json";   // Written by TRACE STOP
+    uint32_t trace_sample_every = 100;  // TRACE START default: trace 1 in N requests
+    
+    // Hashes stay in the compact Listpack encoding up to these limits
+    size_t hash_max_listpack_entries = 128;
+    size_t hash_max_listpack_value = 64;    // Bytes per field or value
+    size_t list_max_listpack_size = 128;    // Elements per list chunk
+    size_t set_max_intset_entries = 512;    // Integer sets stay sorted arrays up to this size
+    size_t hll_sparse_max_registers = 1000; // HyperLogLogs stay sparse up to this many registers
+
+    // Bloom filters created by BF.ADD without BF.RESERVE
+    double bf_error_rate = 0.01;
+    uint64_t bf_initial_capacity = 100;
+    uint32_t bf_expansion = 2;          // Each added layer holds this many times more
+
+    // Namespaces (SELECT 0..databases-1), each its own engine: map, WAL,
+    // quota and statistics. The settings above apply to every namespace
+    // unless overridden by "db<n>.<setting>=value" lines, kept here by
+    // index (see ConfigManager::databaseConfig).
+    size_t databases = 1;
+    std::map<size_t, std::vector<std::pair<std::string, std::string>>> database_settings;
+
+    // Per-namespace memory quota; 0 = unlimited
+    uint64_t max_memory = 0;
+    EvictionPolicy eviction_policy = EvictionPolicy::NOEVICTION;
+    size_t eviction_samples = 5;        // Expiring keys compared per VOLATILE_TTL eviction
 };
 
 } // namespace kvstore
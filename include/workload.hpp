@@ -0,0 +1,179 @@
+#ifndef KV_STORE_WORKLOAD_HPP
+#define KV_STORE_WORKLOAD_HPP
+
+#include <string>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <atomic>
+#include <algorithm>
+
+namespace kvstore {
+
+// Key-choice distributions shared by the benchmarks. Generators are
+// immutable after construction and draw from a caller-supplied engine,
+// so one generator can serve many threads, each with its own RNG.
+
+// Uniform over [0, n)
+class UniformGenerator {
+private:
+    uint64_t n;
+
+public:
+    explicit UniformGenerator(uint64_t n) : n(std::max<uint64_t>(n, 1)) {}
+
+    template<typename RNG>
+    uint64_t next(RNG& rng) const {
+        return std::uniform_int_distribution<uint64_t>(0, n - 1)(rng);
+    }
+
+    uint64_t items() const {
+        return n;
+    }
+};
+
+// Zipfian over [0, n): item 0 is the most popular. Uses the constant-time
+// sampling method of Gray et al., "Quickly Generating Billion-Record
+// Synthetic Databases" (SIGMOD '94), as YCSB does; theta 0.99 matches
+// YCSB's default skew. Construction is O(n) to compute zeta(n).
+class ZipfianGenerator {
+private:
+    uint64_t n;
+    double theta;
+    double alpha;
+    double zeta_n;
+    double eta;
+    double half_pow_theta;
+
+    static double zeta(uint64_t n, double theta) {
+        double sum = 0.0;
+        for (uint64_t i = 1; i <= n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        }
+        return sum;
+    }
+
+public:
+    static constexpr double default_theta = 0.99;
+
+    explicit ZipfianGenerator(uint64_t n, double theta = default_theta)
+        : n(std::max<uint64_t>(n, 1)), theta(theta) {
+        alpha = 1.0 / (1.0 - theta);
+        zeta_n = zeta(this->n, theta);
+        double zeta_2 = zeta(2, theta);
+        eta = (1.0 - std::pow(2.0 / this->n, 1.0 - theta)) / (1.0 - zeta_2 / zeta_n);
+        half_pow_theta = 1.0 + std::pow(0.5, theta);
+    }
+
+    template<typename RNG>
+    uint64_t next(RNG& rng) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zeta_n;
+
+        if (uz < 1.0) {
+            return 0;
+        }
+        if (uz < half_pow_theta) {
+            return std::min<uint64_t>(1, n - 1);
+        }
+
+        auto item = static_cast<uint64_t>(n * std::pow(eta * u - eta + 1.0, alpha));
+        return std::min(item, n - 1);
+    }
+
+    uint64_t items() const {
+        return n;
+    }
+};
+
+// Zipfian popularity with the popular items scattered over [0, n) rather
+// than clustered at the low indexes (YCSB's "zipfian" request distribution)
+class ScrambledZipfianGenerator {
+private:
+    ZipfianGenerator zipf;
+    uint64_t n;
+
+    static uint64_t fnv1a(uint64_t value) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (int i = 0; i < 8; ++i) {
+            hash ^= value & 0xff;
+            hash *= 1099511628211ULL;
+            value >>= 8;
+        }
+        return hash;
+    }
+
+public:
+    explicit ScrambledZipfianGenerator(uint64_t n, double theta = ZipfianGenerator::default_theta)
+        : zipf(n, theta), n(std::max<uint64_t>(n, 1)) {}
+
+    template<typename RNG>
+    uint64_t next(RNG& rng) const {
+        return fnv1a(zipf.next(rng)) % n;
+    }
+
+    uint64_t items() const {
+        return n;
+    }
+};
+
+// Skewed towards the most recently inserted items (YCSB's "latest"):
+// insert() grows the key space, and next() favours the newest keys
+class LatestGenerator {
+private:
+    ZipfianGenerator zipf;
+    std::atomic<uint64_t> count;
+
+public:
+    explicit LatestGenerator(uint64_t initial_items,
+                             double theta = ZipfianGenerator::default_theta)
+        : zipf(initial_items, theta), count(std::max<uint64_t>(initial_items, 1)) {}
+
+    // Claim the index of a new item
+    uint64_t insert() {
+        return count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    template<typename RNG>
+    uint64_t next(RNG& rng) const {
+        uint64_t newest = count.load(std::memory_order_relaxed) - 1;
+        uint64_t offset = zipf.next(rng);
+        return offset <= newest ? newest - offset : 0;
+    }
+
+    uint64_t items() const {
+        return count.load(std::memory_order_relaxed);
+    }
+};
+
+// Fixed-width key for item index, padded (or truncated) to size bytes:
+// "user000000000042" for index 42 and size 16
+inline std::string formatKey(uint64_t index, size_t size, const std::string& prefix = "user") {
+    std::string digits = std::to_string(index);
+    std::string key = prefix;
+
+    if (prefix.size() + digits.size() < size) {
+        key.append(size - prefix.size() - digits.size(), '0');
+    }
+    key += digits;
+
+    // Keep the distinguishing low digits if the prefix does not fit
+    if (key.size() > size && size >= digits.size()) {
+        key.erase(0, key.size() - size);
+    }
+    return key;
+}
+
+// Value of exactly size bytes; contents vary with seed so values are not
+// all identical
+inline std::string makeValue(size_t size, uint64_t seed = 0) {
+    std::string value(size, 'x');
+    for (size_t i = 0; i < size; ++i) {
+        value[i] = static_cast<char>('a' + (seed + i * 7) % 26);
+    }
+    return value;
+}
+
+} // namespace kvstore
+
+#endif // KV_STORE_WORKLOAD_HPP
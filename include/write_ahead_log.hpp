@@ -6,6 +6,12 @@
 #include <mutex>
 #include <vector>
 #include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include "tracer.hpp"
 #include "types.hpp"
 
 namespace kvstore {
@@ -17,9 +23,21 @@ private:
     std::mutex file_mutex;
     std::atomic<uint64_t> sequence_number{0};
     bool sync_mode;
+    bool durable_mode;
     size_t buffer_size;
     std::vector<char> write_buffer;
     
+    // Group commit state for sync(): entries below durable_sequence are
+    // on stable storage
+    std::mutex sync_mutex;
+    std::atomic<uint64_t> durable_sequence{0};
+    
+    std::atomic<uint64_t> records_written{0};
+    std::atomic<uint64_t> bytes_written{0};
+    std::atomic<uint64_t> flushes{0};
+    std::atomic<uint64_t> fsyncs{0};
+    std::atomic<uint64_t> truncated_bytes{0};
+    
     void ensureOpen() {
         if (!log_file.is_open()) {
             log_file.open(filename, std::ios::in | std::ios::out | std::ios::app);
@@ -33,29 +51,16 @@ private:
     
     void syncToDisk() {
         if (sync_mode && log_file.is_open()) {
+            TraceSpan span("wal.flush");
             log_file.flush();
-            // On systems that support it, we could use:
-            // std::ofstream::sync() or platform-specific sync
-        }
-    }
-    
-public:
-    WriteAheadLog(const std::string& filename, bool sync = true, size_t buffer_size = 8192)
-        : filename(filename), sync_mode(sync), buffer_size(buffer_size) {
-        write_buffer.reserve(buffer_size);
-        ensureOpen();
-        recoverSequenceNumber();
-    }
-    
-    ~WriteAheadLog() {
-        if (log_file.is_open()) {
-            log_file.close();
+            flushes.fetch_add(1, std::memory_order_relaxed);
+            // Hands the entry to the OS only; sync() makes it durable
         }
     }
     
-    // Write an entry to the WAL
-    bool writeEntry(Operation op, const std::string& key, 
-                   const std::string& value = "") {
+    // Encode one entry and write it to the log
+    bool append(Operation op, const std::string& key, const std::string& value) {
+        TraceSpan span("wal.append");
         std::lock_guard lock(file_mutex);
         ensureOpen();
         
@@ -99,65 +104,171 @@ public:
             return false;
         }
         
+        records_written.fetch_add(1, std::memory_order_relaxed);
+        bytes_written.fetch_add(write_buffer.size(), std::memory_order_relaxed);
         syncToDisk();
         return true;
     }
     
+public:
+    // sync flushes each entry to the OS (survives a process crash);
+    // durable also fsyncs it before writeEntry returns (survives power loss)
+    WriteAheadLog(const std::string& filename, bool sync = true, size_t buffer_size = 8192,
+                  bool durable = false)
+        : filename(filename), sync_mode(sync), durable_mode(durable), buffer_size(buffer_size) {
+        write_buffer.reserve(buffer_size);
+        ensureOpen();
+    }
+    
+    ~WriteAheadLog() {
+        if (log_file.is_open()) {
+            log_file.close();
+        }
+    }
+    
+    // Write an entry to the WAL
+    bool writeEntry(Operation op, const std::string& key, 
+                   const std::string& value = "") {
+        if (!append(op, key, value)) {
+            return false;
+        }
+        // Outside file_mutex, so concurrent writers share the fsync
+        return !durable_mode || sync();
+    }
+    
+    // Make every entry written so far durable (fsync). Concurrent callers
+    // share fsyncs: one that finds its entries already covered by another
+    // caller's fsync returns without issuing its own (group commit).
+    bool sync() {
+        TraceSpan span("wal.fsync");
+        uint64_t target;
+        {
+            std::lock_guard lock(file_mutex);
+            target = sequence_number.load();
+        }
+        
+        std::lock_guard sync_lock(sync_mutex);
+        if (durable_sequence.load() >= target) {
+            return true;
+        }
+        
+        // Cover everything written up to now, not just our own entries
+        uint64_t covered;
+        {
+            std::lock_guard lock(file_mutex);
+            log_file.flush();
+            covered = sequence_number.load();
+            if (!log_file) {
+                return false;
+            }
+        }
+        
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = ::fsync(fd) == 0;
+        ::close(fd);
+        
+        if (ok) {
+            durable_sequence.store(covered);
+            fsyncs.fetch_add(1, std::memory_order_relaxed);
+        }
+        return ok;
+    }
+    
     // Replay the WAL to rebuild state
     template<typename InsertFunc, typename DeleteFunc>
     void replay(InsertFunc insert_func, DeleteFunc delete_func) {
+        replayEntries([&](const WALEntry& entry) {
+            switch (entry.op) {
+                case Operation::PUT:
+                    insert_func(entry.key, entry.value);
+                    break;
+                case Operation::DELETE:
+                    delete_func(entry.key);
+                    break;
+                default:
+                    // Skip other operations during replay
+                    break;
+            }
+        });
+    }
+    
+    // Replay every entry in log order, for callers that understand more
+    // operations than PUT and DELETE. A torn final entry (the process died
+    // mid-write) is never applied: the log is truncated back to the last
+    // complete entry, so later appends follow valid data. Numbering then
+    // continues after the highest sequence read; an existing log must be
+    // replayed before it is appended to.
+    template<typename ApplyFunc>
+    void replayEntries(ApplyFunc apply_func) {
         std::lock_guard lock(file_mutex);
         ensureOpen();
         
+        log_file.seekg(0, std::ios::end);
+        const uint64_t file_size = static_cast<uint64_t>(log_file.tellg());
         log_file.seekg(0, std::ios::beg);
         
-        while (log_file.peek() != EOF) {
+        auto readField = [&](void* field, size_t size) {
+            log_file.read(reinterpret_cast<char*>(field), size);
+            return static_cast<size_t>(log_file.gcount()) == size;
+        };
+        auto remaining = [&]() {
+            return file_size - static_cast<uint64_t>(log_file.tellg());
+        };
+        
+        // Offset just past the last complete entry
+        uint64_t valid_end = 0;
+        
+        while (valid_end < file_size) {
             uint64_t seq;
             uint64_t timestamp;
             uint8_t op_val;
             size_t key_size, value_size;
             
-            // Read sequence number
-            log_file.read(reinterpret_cast<char*>(&seq), sizeof(seq));
-            if (log_file.eof()) break;
-            
-            // Read timestamp
-            log_file.read(reinterpret_cast<char*>(&timestamp), sizeof(timestamp));
-            
-            // Read operation
-            log_file.read(reinterpret_cast<char*>(&op_val), sizeof(op_val));
-            Operation op = static_cast<Operation>(op_val);
+            if (!readField(&seq, sizeof(seq)) ||
+                !readField(&timestamp, sizeof(timestamp)) ||
+                !readField(&op_val, sizeof(op_val)) ||
+                !readField(&key_size, sizeof(key_size)) ||
+                key_size > remaining()) {
+                break;
+            }
             
-            // Read key
-            log_file.read(reinterpret_cast<char*>(&key_size), sizeof(key_size));
             std::string key(key_size, '\0');
-            log_file.read(&key[0], key_size);
+            if (!readField(&key[0], key_size) ||
+                !readField(&value_size, sizeof(value_size)) ||
+                value_size > remaining()) {
+                break;
+            }
             
-            // Read value
-            log_file.read(reinterpret_cast<char*>(&value_size), sizeof(value_size));
             std::string value(value_size, '\0');
-            if (value_size > 0) {
-                log_file.read(&value[0], value_size);
+            if (value_size > 0 && !readField(&value[0], value_size)) {
+                break;
             }
+            valid_end = static_cast<uint64_t>(log_file.tellg());
             
             // Apply operation
-            switch (op) {
-                case Operation::PUT:
-                    insert_func(key, value);
-                    break;
-                case Operation::DELETE:
-                    delete_func(key);
-                    break;
-                default:
-                    // Skip other operations during replay
-                    break;
-            }
+            apply_func(WALEntry{static_cast<Operation>(op_val), std::move(key),
+                                std::move(value), timestamp, seq});
             
             // Update sequence number
             if (seq >= sequence_number.load()) {
                 sequence_number.store(seq + 1);
             }
         }
+        
+        // Reading to the end leaves eofbit set, which would make every
+        // later write fail silently
+        log_file.clear();
+        
+        if (valid_end < file_size) {
+            log_file.close();
+            if (::truncate(filename.c_str(), static_cast<off_t>(valid_end)) == 0) {
+                truncated_bytes.fetch_add(file_size - valid_end, std::memory_order_relaxed);
+            }
+            ensureOpen();
+        }
     }
     
     // Clear the WAL (start fresh)
@@ -175,6 +286,7 @@ public:
         
         // Reopen empty file
         sequence_number.store(0);
+        durable_sequence.store(0);
         ensureOpen();
         return true;
     }
@@ -193,50 +305,28 @@ public:
         return size() == 0;
     }
     
-private:
-    void recoverSequenceNumber() {
-        std::lock_guard lock(file_mutex);
-        ensureOpen();
-        
-        log_file.seekg(0, std::ios::end);
-        auto file_size = log_file.tellg();
-        
-        if (file_size == 0) {
-            sequence_number.store(0);
-            return;
-        }
-        
-        // Read the last entry to get sequence number
-        const size_t max_entry_size = sizeof(uint64_t) * 2 + 1 + 
-                                     sizeof(size_t) * 2 + 1024 + 65536; // Max sizes
-        
-        size_t read_size = std::min(static_cast<size_t>(file_size), max_entry_size);
-        log_file.seekg(-static_cast<int64_t>(read_size), std::ios::end);
-        
-        std::vector<char> buffer(read_size);
-        log_file.read(buffer.data(), read_size);
-        
-        // Try to find the last complete entry
-        // This is simplified - in production, you'd want more robust recovery
-        uint64_t last_seq = 0;
-        try {
-            // Scan backwards for a valid sequence number
-            // In a real implementation, you'd parse the WAL properly
-            for (int64_t i = buffer.size() - 8; i >= 0; --i) {
-                uint64_t potential_seq;
-                std::memcpy(&potential_seq, &buffer[i], sizeof(potential_seq));
-                
-                // Basic validation (sequence should increase over time)
-                if (potential_seq >= last_seq) {
-                    last_seq = potential_seq;
-                }
-            }
-        } catch (...) {
-            // If recovery fails, start from 0
-            last_seq = 0;
-        }
-        
-        sequence_number.store(last_seq + 1);
+    // Get statistics (cumulative since construction)
+    struct Statistics {
+        uint64_t records;       // Entries written
+        uint64_t bytes;         // Encoded bytes written
+        uint64_t flushes;       // Stream flushes to the OS (sync mode)
+        uint64_t fsyncs;        // fsyncs issued by sync()
+        uint64_t truncated;     // Torn-tail bytes discarded by replay
+    };
+    
+    Statistics getStatistics() const {
+        return Statistics{records_written.load(), bytes_written.load(),
+                          flushes.load(), fsyncs.load(), truncated_bytes.load()};
+    }
+    
+    // Sequence number the next entry will be written with
+    uint64_t nextSequence() const {
+        return sequence_number.load();
+    }
+    
+    // Continue numbering from seq, e.g. after a checkpoint cleared the log
+    void setNextSequence(uint64_t seq) {
+        sequence_number.store(seq);
     }
 };
 
@@ -0,0 +1,312 @@
+#ifndef KV_STORE_ZSET_VALUE_HPP
+#define KV_STORE_ZSET_VALUE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <random>
+#include <cstdint>
+#include "types.hpp"
+
+namespace kvstore {
+
+// Bound of a score range (ZRANGEBYSCORE); exclusive for "(1.5"
+struct ScoreBound {
+    double value;
+    bool exclusive = false;
+};
+
+// Sorted set stored at a key (ZADD/ZRANGE...): members ordered by
+// (score, member) in a skiplist, with a member index for O(1) score
+// lookups. Each forward link records how many elements it skips (its
+// span), so rank queries and rank ranges are O(log n) too. The index
+// keys view the member strings owned by the nodes, so a member is
+// stored once.
+class ZSetValue : public Collection {
+public:
+    static constexpr int kMaxLevel = 32;
+    static constexpr uint32_t kLevelProbability = 4;    // 1 in 4 nodes goes up a level
+
+private:
+    struct Node;
+
+    struct Level {
+        Node* forward = nullptr;
+        size_t span = 0;        // Elements between this node and forward
+    };
+
+    struct Node {
+        std::string member;
+        double score;
+        Node* backward = nullptr;
+        std::unique_ptr<Level[]> levels;
+
+        Node(std::string_view member, double score, int height)
+            : member(member), score(score), levels(new Level[height]) {}
+    };
+
+    Node head{"", 0.0, kMaxLevel};
+    Node* tail = nullptr;
+    int level = 1;
+    size_t count = 0;
+    size_t member_bytes = 0;
+    std::unordered_map<std::string_view, Node*> index;
+
+    // Per member beyond its bytes: the node, its expected 4/3 levels
+    // rounded up, and the index entry with its bucket slot
+    static constexpr size_t kMemberOverhead =
+        sizeof(Node) + 2 * sizeof(Level) + sizeof(std::string_view) + 4 * sizeof(void*);
+
+    static int randomLevel() {
+        thread_local std::minstd_rand random{std::random_device{}()};
+        int height = 1;
+        while (height < kMaxLevel && random() % kLevelProbability == 0) {
+            height++;
+        }
+        return height;
+    }
+
+    // True if node sorts before (score, member)
+    static bool before(const Node* node, double score, std::string_view member) {
+        return node->score < score || (node->score == score && node->member < member);
+    }
+
+    static bool aboveMin(double score, const ScoreBound& min) {
+        return min.exclusive ? score > min.value : score >= min.value;
+    }
+
+    static bool belowMax(double score, const ScoreBound& max) {
+        return max.exclusive ? score < max.value : score <= max.value;
+    }
+
+    void insertNode(std::string_view member, double score) {
+        Node* update[kMaxLevel];
+        size_t rank[kMaxLevel];
+
+        Node* x = &head;
+        for (int i = level - 1; i >= 0; --i) {
+            rank[i] = i == level - 1 ? 0 : rank[i + 1];
+            while (x->levels[i].forward && before(x->levels[i].forward, score, member)) {
+                rank[i] += x->levels[i].span;
+                x = x->levels[i].forward;
+            }
+            update[i] = x;
+        }
+
+        int height = randomLevel();
+        if (height > level) {
+            for (int i = level; i < height; ++i) {
+                rank[i] = 0;
+                update[i] = &head;
+                update[i]->levels[i].span = count;
+            }
+            level = height;
+        }
+
+        Node* node = new Node(member, score, height);
+        for (int i = 0; i < height; ++i) {
+            node->levels[i].forward = update[i]->levels[i].forward;
+            update[i]->levels[i].forward = node;
+            node->levels[i].span = update[i]->levels[i].span - (rank[0] - rank[i]);
+            update[i]->levels[i].span = (rank[0] - rank[i]) + 1;
+        }
+        for (int i = height; i < level; ++i) {
+            update[i]->levels[i].span++;
+        }
+
+        node->backward = update[0] == &head ? nullptr : update[0];
+        if (node->levels[0].forward) {
+            node->levels[0].forward->backward = node;
+        } else {
+            tail = node;
+        }
+        count++;
+        member_bytes += member.size();
+        index.emplace(node->member, node);
+    }
+
+    void eraseNode(Node* node) {
+        Node* update[kMaxLevel];
+        Node* x = &head;
+        for (int i = level - 1; i >= 0; --i) {
+            while (x->levels[i].forward && before(x->levels[i].forward, node->score, node->member)) {
+                x = x->levels[i].forward;
+            }
+            update[i] = x;
+        }
+
+        for (int i = 0; i < level; ++i) {
+            if (update[i]->levels[i].forward == node) {
+                update[i]->levels[i].span += node->levels[i].span - 1;
+                update[i]->levels[i].forward = node->levels[i].forward;
+            } else {
+                update[i]->levels[i].span--;
+            }
+        }
+        if (node->levels[0].forward) {
+            node->levels[0].forward->backward = node->backward;
+        } else {
+            tail = node->backward;
+        }
+        while (level > 1 && !head.levels[level - 1].forward) {
+            level--;
+        }
+        count--;
+        member_bytes -= node->member.size();
+        index.erase(node->member);
+        delete node;
+    }
+
+    // Node at 0-based rank, which must be < size()
+    const Node* nodeAt(size_t rank) const {
+        const Node* x = &head;
+        size_t traversed = 0;
+        for (int i = level - 1; i >= 0; --i) {
+            while (x->levels[i].forward && traversed + x->levels[i].span <= rank + 1) {
+                traversed += x->levels[i].span;
+                x = x->levels[i].forward;
+            }
+            if (traversed == rank + 1) {
+                return x;
+            }
+        }
+        return nullptr;
+    }
+
+    // First node with a score within min, or nullptr
+    const Node* firstFrom(const ScoreBound& min) const {
+        const Node* x = &head;
+        for (int i = level - 1; i >= 0; --i) {
+            while (x->levels[i].forward && !aboveMin(x->levels[i].forward->score, min)) {
+                x = x->levels[i].forward;
+            }
+        }
+        return x->levels[0].forward;
+    }
+
+public:
+    ZSetValue() = default;
+
+    ~ZSetValue() override {
+        Node* node = head.levels[0].forward;
+        while (node) {
+            Node* next = node->levels[0].forward;
+            delete node;
+            node = next;
+        }
+    }
+
+    ZSetValue(const ZSetValue&) = delete;
+    ZSetValue& operator=(const ZSetValue&) = delete;
+
+    ValueType type() const override {
+        return ValueType::ZSET;
+    }
+
+    size_t memoryUsage() const override {
+        return member_bytes + count * kMemberOverhead;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    // Add member or move it to score; true if it is new
+    bool add(std::string_view member, double score) {
+        auto it = index.find(member);
+        if (it == index.end()) {
+            insertNode(member, score);
+            return true;
+        }
+        if (it->second->score != score) {
+            eraseNode(it->second);
+            insertNode(member, score);
+        }
+        return false;
+    }
+
+    bool erase(std::string_view member) {
+        auto it = index.find(member);
+        if (it == index.end()) {
+            return false;
+        }
+        eraseNode(it->second);
+        return true;
+    }
+
+    bool score(std::string_view member, double& result) const {
+        auto it = index.find(member);
+        if (it == index.end()) {
+            return false;
+        }
+        result = it->second->score;
+        return true;
+    }
+
+    // 0-based position of member in score order
+    bool rank(std::string_view member, size_t& result) const {
+        auto it = index.find(member);
+        if (it == index.end()) {
+            return false;
+        }
+
+        const Node* target = it->second;
+        const Node* x = &head;
+        size_t traversed = 0;
+        for (int i = level - 1; i >= 0; --i) {
+            while (x->levels[i].forward &&
+                   !before(target, x->levels[i].forward->score, x->levels[i].forward->member)) {
+                traversed += x->levels[i].span;
+                x = x->levels[i].forward;
+            }
+            if (x == target) {
+                result = traversed - 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // fn(member, score) for ranks first..last inclusive (both < size())
+    template<typename Fn>
+    void forEachInRank(size_t first, size_t last, Fn fn) const {
+        const Node* node = nodeAt(first);
+        for (size_t rank = first; node && rank <= last; ++rank) {
+            fn(std::string_view(node->member), node->score);
+            node = node->levels[0].forward;
+        }
+    }
+
+    // fn(member, score) for scores within [min, max], skipping the first
+    // offset matches and stopping after limit
+    template<typename Fn>
+    void forEachInScore(const ScoreBound& min, const ScoreBound& max, size_t offset,
+                        size_t limit, Fn fn) const {
+        const Node* node = firstFrom(min);
+        for (; node && offset > 0 && belowMax(node->score, max); --offset) {
+            node = node->levels[0].forward;
+        }
+        for (; node && limit > 0 && belowMax(node->score, max); --limit) {
+            fn(std::string_view(node->member), node->score);
+            node = node->levels[0].forward;
+        }
+    }
+
+    // fn(member, score) in score order
+    template<typename Fn>
+    void forEach(Fn fn) const {
+        for (const Node* node = head.levels[0].forward; node; node = node->levels[0].forward) {
+            fn(std::string_view(node->member), node->score);
+        }
+    }
+};
+
+} // namespace kvstore
+
+#endif // KV_STORE_ZSET_VALUE_HPP
@@ -0,0 +1,60 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "kv_client.hpp"
+
+// Minimal command-line client:
+//   kv_client [-h host] [-p port] [-n namespace] COMMAND [key] [value...]
+// e.g. kv_client PUT user:1 alice, kv_client -n 2 STATS
+int main(int argc, char* argv[]) {
+    std::string host = "127.0.0.1";
+    uint16_t port = 6379;
+    size_t database = 0;
+
+    int arg = 1;
+    while (arg + 1 < argc && argv[arg][0] == '-') {
+        std::string flag = argv[arg];
+        if (flag == "-h") {
+            host = argv[arg + 1];
+        } else if (flag == "-p") {
+            port = static_cast<uint16_t>(std::atoi(argv[arg + 1]));
+        } else if (flag == "-n") {
+            database = static_cast<size_t>(std::strtoul(argv[arg + 1], nullptr, 10));
+        } else {
+            break;
+        }
+        arg += 2;
+    }
+
+    if (arg >= argc) {
+        std::cerr << "Usage: " << argv[0] << " [-h host] [-p port] [-n namespace] COMMAND [key] [value...]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::string command = argv[arg++];
+    for (; arg < argc; ++arg) {
+        command += " ";
+        command += argv[arg];
+    }
+
+    try {
+        kvstore::KVClient client(host, port);
+        client.connect();
+        if (database != 0 && !client.select(database)) {
+            std::cerr << "Error: no namespace " << database << std::endl;
+            return 1;
+        }
+
+        if (command == "STATS") {
+            std::cout << client.stats() << std::endl;
+        } else {
+            std::cout << client.sendCommand(command) << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
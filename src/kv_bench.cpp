@@ -0,0 +1,948 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <array>
+#include <cctype>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <asio.hpp>
+#include "latency_histogram.hpp"
+#include "workload.hpp"
+#include "benchmark_baseline.hpp"
+
+// YCSB-style load generator for kv_server.
+//
+//   kv_bench --load --records 100000              # populate the key space
+//   kv_bench --workload B --connections 8 --pipeline 16 --duration 30
+//
+// Each connection runs on its own thread and keeps up to --pipeline
+// operations outstanding: it writes a batch of requests, then reads all
+// their replies. An operation's latency runs from the moment its batch is
+// written to the moment its reply is read. Operations issued during
+// --warmup are executed but not recorded.
+//
+// Closed-loop latency hides server stalls: while one request is stuck,
+// the requests that would have followed it are simply not sent, so the
+// stall is recorded once instead of once per delayed request
+// ("coordinated omission"). With --rate the tool runs open loop instead:
+//
+//   kv_bench --workload A --rate 50000 --duration 30
+//   kv_bench --workload B --sweep 10000:100000:10000 --slo-p99 2
+//
+// Each connection sends on a fixed schedule from one thread and reads
+// replies on another, never waiting for replies before sending. Latency
+// is measured from each request's scheduled send time, so time spent
+// queued behind a stall counts. A sweep repeats the run at increasing
+// rates and reports the highest rate whose p99 stays within the SLO.
+
+using asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+enum class OpType {
+    READ,
+    UPDATE,
+    INSERT,
+    SCAN,
+    READ_MODIFY_WRITE,
+    COUNT
+};
+
+constexpr size_t op_count = static_cast<size_t>(OpType::COUNT);
+
+const char* opName(OpType op) {
+    switch (op) {
+        case OpType::READ: return "READ";
+        case OpType::UPDATE: return "UPDATE";
+        case OpType::INSERT: return "INSERT";
+        case OpType::SCAN: return "SCAN";
+        case OpType::READ_MODIFY_WRITE: return "RMW";
+        default: return "?";
+    }
+}
+
+enum class KeyDistribution {
+    UNIFORM,
+    ZIPFIAN,
+    LATEST
+};
+
+const char* distributionName(KeyDistribution dist) {
+    switch (dist) {
+        case KeyDistribution::UNIFORM: return "uniform";
+        case KeyDistribution::ZIPFIAN: return "zipfian";
+        case KeyDistribution::LATEST: return "latest";
+    }
+    return "?";
+}
+
+// Operation mix of a YCSB core workload (proportions sum to 1)
+struct WorkloadSpec {
+    char name;
+    double proportions[op_count];
+    KeyDistribution distribution;
+    const char* description;
+};
+
+//                       read  update insert scan  rmw
+const WorkloadSpec workloads[] = {
+    {'A', {0.50, 0.50, 0.00, 0.00, 0.00}, KeyDistribution::ZIPFIAN, "update heavy"},
+    {'B', {0.95, 0.05, 0.00, 0.00, 0.00}, KeyDistribution::ZIPFIAN, "read mostly"},
+    {'C', {1.00, 0.00, 0.00, 0.00, 0.00}, KeyDistribution::ZIPFIAN, "read only"},
+    {'D', {0.95, 0.00, 0.05, 0.00, 0.00}, KeyDistribution::LATEST, "read latest"},
+    {'E', {0.00, 0.00, 0.05, 0.95, 0.00}, KeyDistribution::ZIPFIAN, "short ranges"},
+    {'F', {0.50, 0.00, 0.00, 0.00, 0.50}, KeyDistribution::ZIPFIAN, "read-modify-write"},
+};
+
+struct Options {
+    std::string host = "127.0.0.1";
+    uint16_t port = 6379;
+    char workload = 'A';
+    uint64_t records = 100000;
+    uint64_t operations = 0;            // Stop after this many measured ops (0 = use duration)
+    double duration = 10.0;             // Measured seconds
+    double warmup = 2.0;                // Unmeasured seconds before that
+    size_t connections = 4;
+    size_t pipeline = 1;
+    size_t key_size = 16;
+    size_t field_size = 100;
+    size_t max_scan_length = 100;
+    bool load = false;
+    bool distribution_set = false;
+    KeyDistribution distribution = KeyDistribution::ZIPFIAN;
+    std::string json_file;
+    double rate = 0.0;                  // Open-loop ops/sec over all connections (0 = closed loop)
+    std::vector<double> sweep_rates;    // Open-loop rates to step through
+    double slo_p99_ms = 0.0;            // p99 objective for sweeps (0 = none)
+    unsigned trials = 1;                // Measured runs (closed loop or --rate)
+    std::string save_baseline;
+    std::string compare_baseline;
+    double threshold = 0.05;            // Smallest relative change --compare flags
+};
+
+void usage(const char* program) {
+    std::cerr
+        << "Usage: " << program << " [options]\n"
+        << "  -h, --host HOST          Server host (127.0.0.1)\n"
+        << "  -p, --port PORT          Server port (6379)\n"
+        << "  -w, --workload A-F       YCSB core workload (A)\n"
+        << "  -r, --records N          Key space size (100000)\n"
+        << "  -n, --operations N       Measured operations (default: run for --duration)\n"
+        << "  -d, --duration SECONDS   Measured run time (10)\n"
+        << "      --warmup SECONDS     Unmeasured warmup (2)\n"
+        << "  -c, --connections N      Concurrent connections (4)\n"
+        << "  -P, --pipeline N         Outstanding operations per connection (1)\n"
+        << "      --distribution D     Override key choice: uniform|zipfian|latest\n"
+        << "      --key-size BYTES     Key length (16)\n"
+        << "      --field-size BYTES   Value length (100)\n"
+        << "      --max-scan N         Longest SCAN in workload E (100)\n"
+        << "      --load               Insert all records before the run\n"
+        << "      --json FILE          Also write the results as JSON\n"
+        << "      --rate OPS           Open loop: issue OPS requests/s on a fixed schedule\n"
+        << "      --sweep FROM:TO:STEP Open loop at each rate in turn (ops/sec)\n"
+        << "      --slo-p99 MS         With --sweep: report the highest rate with p99 <= MS\n"
+        << "      --trials N           Repeat the measured run N times (1); --json keeps the last\n"
+        << "      --save-baseline FILE Save per-trial throughput and latency as a baseline\n"
+        << "      --compare FILE       Flag significant regressions against a baseline\n"
+        << "      --threshold PCT      Smallest change --compare reports (5)\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("missing value for " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--host") {
+            options.host = next();
+        } else if (arg == "-p" || arg == "--port") {
+            options.port = static_cast<uint16_t>(std::stoi(next()));
+        } else if (arg == "-w" || arg == "--workload") {
+            options.workload = static_cast<char>(std::toupper(next()[0]));
+        } else if (arg == "-r" || arg == "--records") {
+            options.records = std::stoull(next());
+        } else if (arg == "-n" || arg == "--operations") {
+            options.operations = std::stoull(next());
+        } else if (arg == "-d" || arg == "--duration") {
+            options.duration = std::stod(next());
+        } else if (arg == "--warmup") {
+            options.warmup = std::stod(next());
+        } else if (arg == "-c" || arg == "--connections") {
+            options.connections = std::max<size_t>(std::stoul(next()), 1);
+        } else if (arg == "-P" || arg == "--pipeline") {
+            options.pipeline = std::max<size_t>(std::stoul(next()), 1);
+        } else if (arg == "--distribution") {
+            std::string dist = next();
+            options.distribution_set = true;
+            if (dist == "uniform") {
+                options.distribution = KeyDistribution::UNIFORM;
+            } else if (dist == "zipfian") {
+                options.distribution = KeyDistribution::ZIPFIAN;
+            } else if (dist == "latest") {
+                options.distribution = KeyDistribution::LATEST;
+            } else {
+                throw std::invalid_argument("unknown distribution " + dist);
+            }
+        } else if (arg == "--key-size") {
+            options.key_size = std::stoul(next());
+        } else if (arg == "--field-size") {
+            options.field_size = std::stoul(next());
+        } else if (arg == "--max-scan") {
+            options.max_scan_length = std::max<size_t>(std::stoul(next()), 1);
+        } else if (arg == "--load") {
+            options.load = true;
+        } else if (arg == "--json") {
+            options.json_file = next();
+        } else if (arg == "--trials") {
+            options.trials = static_cast<unsigned>(std::max(1UL, std::stoul(next())));
+        } else if (arg == "--save-baseline") {
+            options.save_baseline = next();
+        } else if (arg == "--compare") {
+            options.compare_baseline = next();
+        } else if (arg == "--threshold") {
+            options.threshold = std::stod(next()) / 100.0;
+        } else if (arg == "--rate") {
+            options.rate = std::stod(next());
+        } else if (arg == "--sweep") {
+            std::string range = next();
+            double from = 0, to = 0, step = 0;
+            char sep1 = 0, sep2 = 0;
+            std::istringstream iss(range);
+            if (!(iss >> from >> sep1 >> to >> sep2 >> step) || sep1 != ':' || sep2 != ':' ||
+                from <= 0 || step <= 0 || to < from) {
+                throw std::invalid_argument("--sweep expects FROM:TO:STEP");
+            }
+            for (double rate = from; rate <= to + step / 2; rate += step) {
+                options.sweep_rates.push_back(rate);
+            }
+        } else if (arg == "--slo-p99") {
+            options.slo_p99_ms = std::stod(next());
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Chooses the key for each operation. Inserts extend the key space past
+// the loaded records; "latest" favours those newest keys.
+class KeyChooser {
+private:
+    KeyDistribution distribution;
+    kvstore::UniformGenerator uniform;
+    kvstore::ScrambledZipfianGenerator zipfian;
+    kvstore::LatestGenerator latest;
+
+public:
+    KeyChooser(KeyDistribution distribution, uint64_t records)
+        : distribution(distribution), uniform(records), zipfian(records), latest(records) {}
+
+    template<typename RNG>
+    uint64_t next(RNG& rng) const {
+        switch (distribution) {
+            case KeyDistribution::UNIFORM:
+                return uniform.next(rng);
+            case KeyDistribution::LATEST:
+                return latest.next(rng);
+            default:
+                return zipfian.next(rng);
+        }
+    }
+
+    uint64_t insert() {
+        return latest.insert();
+    }
+};
+
+// Results shared by all connections. latency counts from when each
+// operation was due to be sent; service counts from when it was actually
+// written. The two differ only in open-loop mode, when the sender lags
+// behind its schedule.
+struct Results {
+    std::array<kvstore::LatencyHistogram, op_count> latency;
+    std::array<kvstore::LatencyHistogram, op_count> service;
+    std::array<std::atomic<uint64_t>, op_count> errors{};
+    std::atomic<uint64_t> not_found{0};
+    std::atomic<uint64_t> measured{0};
+    std::atomic<uint64_t> completed{0};     // Replies received inside the measured window
+    std::atomic<uint64_t> max_send_lag{0};  // ns behind schedule, open loop
+
+    // Latency of all operation types together
+    kvstore::LatencyHistogram::Summary overall() const {
+        kvstore::LatencyHistogram merged;
+        for (const auto& histogram : latency) {
+            merged.merge(histogram);
+        }
+        return merged.summarize();
+    }
+};
+
+// Blocking connection that writes requests in batches and reads the
+// single replies in order
+class BenchConnection {
+private:
+    asio::io_context io_context;
+    tcp::socket socket;
+    asio::streambuf buffer;
+
+public:
+    BenchConnection(const std::string& host, uint16_t port) : socket(io_context) {
+        tcp::resolver resolver(io_context);
+        asio::connect(socket, resolver.resolve(host, std::to_string(port)));
+        socket.set_option(tcp::no_delay(true));
+    }
+
+    void write(const std::string& requests) {
+        asio::write(socket, asio::buffer(requests));
+    }
+
+    std::string readLine() {
+        size_t n = asio::read_until(socket, buffer, '\n');
+        std::string line(asio::buffers_begin(buffer.data()),
+                         asio::buffers_begin(buffer.data()) + n - 1);
+        buffer.consume(n);
+        return line;
+    }
+
+    // A line, or for a "$<length>" line the stored data that follows it
+    std::string readReply() {
+        std::string line = readLine();
+        if (line.empty() || line[0] != '$') {
+            return line;
+        }
+        size_t length = std::stoul(line.substr(1));
+        if (buffer.size() < length + 1) {
+            asio::read(socket, buffer, asio::transfer_exactly(length + 1 - buffer.size()));
+        }
+        std::string data(asio::buffers_begin(buffer.data()),
+                         asio::buffers_begin(buffer.data()) + length);
+        buffer.consume(length + 1);
+        return data;
+    }
+
+    // Unblock a reader on another thread
+    void shutdown() {
+        asio::error_code ec;
+        socket.shutdown(tcp::socket::shutdown_both, ec);
+    }
+};
+
+// One operation in flight: how many replies it awaits, and when it was
+// due to be sent and actually sent
+struct PendingOp {
+    OpType type;
+    size_t replies;
+    Clock::time_point intended;
+    Clock::time_point sent;
+    bool measured;
+};
+
+class Worker {
+private:
+    const Options& options;
+    KeyChooser& keys;
+    Results& results;
+    const std::atomic<bool>& recording;
+    const std::atomic<bool>& stopping;
+    std::mt19937_64 rng;
+    std::discrete_distribution<size_t> choose_op;
+    std::string value;
+
+    void appendGet(std::string& batch, uint64_t index) {
+        batch += "GET ";
+        batch += kvstore::formatKey(index, options.key_size);
+        batch += '\n';
+    }
+
+    void appendPut(std::string& batch, uint64_t index) {
+        batch += "PUT ";
+        batch += kvstore::formatKey(index, options.key_size);
+        batch += ' ';
+        batch += value;
+        batch += '\n';
+    }
+
+    // Append the requests for one operation; returns how many replies it
+    // will produce
+    size_t appendOperation(std::string& batch, OpType type) {
+        switch (type) {
+            case OpType::READ:
+                appendGet(batch, keys.next(rng));
+                return 1;
+            case OpType::UPDATE:
+                appendPut(batch, keys.next(rng));
+                return 1;
+            case OpType::INSERT:
+                appendPut(batch, keys.insert());
+                return 1;
+            case OpType::SCAN: {
+                // The protocol has no range read: a scan is a run of GETs
+                // over consecutive record numbers, sent together
+                uint64_t start = keys.next(rng);
+                size_t length = std::uniform_int_distribution<size_t>(
+                    1, options.max_scan_length)(rng);
+                for (size_t i = 0; i < length; ++i) {
+                    appendGet(batch, start + i);
+                }
+                return length;
+            }
+            case OpType::READ_MODIFY_WRITE: {
+                // The server applies a connection's requests in order, so
+                // the PUT lands after the GET even though both are in flight
+                uint64_t index = keys.next(rng);
+                appendGet(batch, index);
+                appendPut(batch, index);
+                return 2;
+            }
+            default:
+                return 0;
+        }
+    }
+
+    // Read an operation's replies and record its latency
+    void complete(BenchConnection& connection, const PendingOp& op) {
+        bool failed = false;
+        for (size_t i = 0; i < op.replies; ++i) {
+            std::string reply = connection.readReply();
+            if (reply.compare(0, 5, "ERROR") == 0) {
+                failed = true;
+            } else if (op.measured && reply == "NOT_FOUND") {
+                results.not_found.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // Throughput counts completions inside the window; an overloaded
+        // open-loop run issues more than it completes
+        if (recording.load(std::memory_order_relaxed)) {
+            results.completed.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (!op.measured) {
+            return;
+        }
+
+        auto now = Clock::now();
+        auto index = static_cast<size_t>(op.type);
+        results.latency[index].record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - op.intended).count()));
+        results.service[index].record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - op.sent).count()));
+        if (failed) {
+            results.errors[index].fetch_add(1, std::memory_order_relaxed);
+        }
+        results.measured.fetch_add(1, std::memory_order_relaxed);
+    }
+
+public:
+    Worker(const Options& options, const WorkloadSpec& spec, KeyChooser& keys,
+           Results& results, const std::atomic<bool>& recording,
+           const std::atomic<bool>& stopping, uint64_t seed)
+        : options(options), keys(keys), results(results),
+          recording(recording), stopping(stopping), rng(seed),
+          choose_op(std::begin(spec.proportions), std::end(spec.proportions)),
+          value(kvstore::makeValue(options.field_size, seed)) {}
+
+    // Closed loop: send a batch of --pipeline operations, wait for all
+    // their replies, repeat
+    void run() {
+        BenchConnection connection(options.host, options.port);
+        std::string batch;
+        std::vector<PendingOp> pending;
+
+        while (!stopping.load(std::memory_order_relaxed)) {
+            batch.clear();
+            pending.clear();
+
+            bool measured = recording.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < options.pipeline; ++i) {
+                auto type = static_cast<OpType>(choose_op(rng));
+                pending.push_back({type, appendOperation(batch, type), {}, {}, measured});
+            }
+
+            auto sent = Clock::now();
+            connection.write(batch);
+
+            for (auto& op : pending) {
+                op.intended = op.sent = sent;
+                complete(connection, op);
+            }
+        }
+    }
+
+    // Open loop: send one operation every interval starting at first,
+    // whether or not earlier replies have arrived. A receiver thread
+    // matches replies to operations in order (the server answers a
+    // connection's requests in order).
+    void runOpenLoop(std::chrono::nanoseconds interval, Clock::time_point first) {
+        BenchConnection connection(options.host, options.port);
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<PendingOp> in_flight;
+        bool done = false;
+        std::exception_ptr receive_error;
+
+        std::thread receiver([&]() {
+            try {
+                while (true) {
+                    PendingOp op;
+                    {
+                        std::unique_lock lock(mutex);
+                        ready.wait(lock, [&] { return done || !in_flight.empty(); });
+                        if (in_flight.empty()) {
+                            return;
+                        }
+                        op = in_flight.front();
+                        in_flight.pop_front();
+                    }
+                    complete(connection, op);
+                }
+            } catch (...) {
+                receive_error = std::current_exception();
+            }
+        });
+
+        auto finish = [&]() {
+            {
+                std::lock_guard lock(mutex);
+                done = true;
+            }
+            ready.notify_one();
+        };
+
+        try {
+            std::string request;
+            auto intended = first;
+
+            while (!stopping.load(std::memory_order_relaxed)) {
+                std::this_thread::sleep_until(intended);
+
+                request.clear();
+                auto type = static_cast<OpType>(choose_op(rng));
+                PendingOp op{type, appendOperation(request, type), intended, Clock::now(),
+                             recording.load(std::memory_order_relaxed)};
+
+                // If the sender itself falls behind, latency still counts
+                // from the schedule; the lag shows the generator's limit
+                auto lag = static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(op.sent - intended).count());
+                uint64_t current = results.max_send_lag.load(std::memory_order_relaxed);
+                while (op.measured && lag > current &&
+                       !results.max_send_lag.compare_exchange_weak(current, lag)) {
+                }
+
+                {
+                    std::lock_guard lock(mutex);
+                    in_flight.push_back(op);
+                }
+                ready.notify_one();
+                connection.write(request);
+                intended += interval;
+            }
+        } catch (...) {
+            connection.shutdown();
+            finish();
+            receiver.join();
+            throw;
+        }
+
+        // Let the receiver drain the replies still outstanding
+        finish();
+        receiver.join();
+        if (receive_error) {
+            std::rethrow_exception(receive_error);
+        }
+    }
+};
+
+// Insert records [0, records) across the connections
+void loadRecords(const Options& options) {
+    std::cout << "Loading " << options.records << " records..." << std::endl;
+    auto started = Clock::now();
+
+    std::vector<std::thread> threads;
+    std::atomic<uint64_t> errors{0};
+    for (size_t c = 0; c < options.connections; ++c) {
+        threads.emplace_back([&, c]() {
+            BenchConnection connection(options.host, options.port);
+            std::string value = kvstore::makeValue(options.field_size, c);
+            std::string batch;
+
+            uint64_t index = c;
+            while (index < options.records) {
+                batch.clear();
+                size_t sent = 0;
+                for (; sent < options.pipeline && index < options.records; ++sent) {
+                    batch += "PUT " + kvstore::formatKey(index, options.key_size) + " " + value + "\n";
+                    index += options.connections;
+                }
+
+                connection.write(batch);
+                for (size_t i = 0; i < sent; ++i) {
+                    if (connection.readLine() != "OK") {
+                        errors++;
+                    }
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+    std::cout << "Loaded in " << std::fixed << std::setprecision(2) << seconds << "s ("
+              << std::setprecision(0) << options.records / seconds << " records/s, "
+              << errors.load() << " errors)" << std::endl;
+}
+
+double micros(uint64_t nanos) {
+    return nanos / 1000.0;
+}
+
+// Results of one timed run
+struct Phase {
+    std::unique_ptr<Results> results;
+    double seconds = 0.0;
+    double rate = 0.0;          // Target ops/sec, 0 for closed loop
+    bool failed = false;
+};
+
+// Run the workload once: warmup, then the measured window. rate > 0
+// runs open loop at that many ops/sec over all connections.
+Phase runPhase(const Options& options, const WorkloadSpec& spec, KeyChooser& keys, double rate) {
+    Phase phase;
+    phase.results = std::make_unique<Results>();
+    phase.rate = rate;
+
+    std::atomic<bool> recording{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> failed{0};
+
+    // Connections share the rate and are staggered across one interval
+    auto interval = std::chrono::nanoseconds(
+        rate > 0 ? static_cast<int64_t>(1e9 * options.connections / rate) : 0);
+    auto first = Clock::now() + std::chrono::milliseconds(50);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < options.connections; ++c) {
+        workers.push_back(std::make_unique<Worker>(
+            options, spec, keys, *phase.results, recording, stopping, 0x5eed + c));
+        threads.emplace_back([&, c]() {
+            try {
+                if (rate > 0) {
+                    workers[c]->runOpenLoop(interval, first + interval * c / options.connections);
+                } else {
+                    workers[c]->run();
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Connection " << c << ": " << e.what() << std::endl;
+                failed++;
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.warmup));
+    recording = true;
+    auto started = Clock::now();
+
+    if (options.operations > 0) {
+        while (phase.results->measured.load() < options.operations &&
+               failed.load() < options.connections) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    } else {
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.duration));
+    }
+
+    recording = false;
+    phase.seconds = std::chrono::duration<double>(Clock::now() - started).count();
+    stopping = true;
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    phase.failed = failed.load() > 0;
+    return phase;
+}
+
+void printTable(const std::array<kvstore::LatencyHistogram, op_count>& histograms,
+                const Results& results, double seconds) {
+    std::cout << "\n" << std::left << std::setw(8) << "Op" << std::right
+              << std::setw(10) << "Count" << std::setw(12) << "Ops/sec"
+              << std::setw(10) << "Avg(us)" << std::setw(10) << "p50"
+              << std::setw(10) << "p90" << std::setw(10) << "p99"
+              << std::setw(10) << "p99.9" << std::setw(10) << "Max"
+              << std::setw(8) << "Errors" << "\n";
+
+    for (size_t i = 0; i < op_count; ++i) {
+        auto summary = histograms[i].summarize();
+        if (summary.count == 0) {
+            continue;
+        }
+
+        std::cout << std::left << std::setw(8) << opName(static_cast<OpType>(i)) << std::right
+                  << std::setw(10) << summary.count
+                  << std::setw(12) << std::setprecision(0) << summary.count / seconds
+                  << std::setprecision(1)
+                  << std::setw(10) << micros(static_cast<uint64_t>(summary.mean))
+                  << std::setw(10) << micros(summary.p50)
+                  << std::setw(10) << micros(summary.p90)
+                  << std::setw(10) << micros(summary.p99)
+                  << std::setw(10) << micros(summary.p999)
+                  << std::setw(10) << micros(summary.max)
+                  << std::setw(8) << results.errors[i].load() << "\n";
+    }
+}
+
+void printHeader(const Options& options, const WorkloadSpec& spec, KeyDistribution distribution) {
+    std::cout << "\nWorkload " << spec.name << " (" << spec.description << ", "
+              << distributionName(distribution) << "), " << options.connections
+              << " connections";
+    if (options.rate > 0 || !options.sweep_rates.empty()) {
+        std::cout << ", open loop";
+    } else {
+        std::cout << " x pipeline " << options.pipeline;
+    }
+    std::cout << ", " << options.records << " records\n";
+}
+
+void printReport(const Options& options, const WorkloadSpec& spec,
+                 KeyDistribution distribution, const Phase& phase) {
+    const Results& results = *phase.results;
+    uint64_t total = results.completed.load();
+
+    printHeader(options, spec, distribution);
+    std::cout << "Throughput: " << std::fixed << std::setprecision(0) << total / phase.seconds
+              << " ops/sec (" << total << " ops in " << std::setprecision(2) << phase.seconds << "s";
+    if (phase.rate > 0) {
+        std::cout << ", target " << std::setprecision(0) << phase.rate;
+    }
+    std::cout << ")\n";
+    if (results.not_found > 0) {
+        std::cout << "NOT_FOUND replies: " << results.not_found << "\n";
+    }
+
+    if (phase.rate > 0) {
+        std::cout << "Max send lag: " << std::setprecision(1)
+                  << micros(results.max_send_lag.load()) << " us\n";
+        std::cout << "\nResponse time (from scheduled send):";
+        printTable(results.latency, results, phase.seconds);
+        std::cout << "\nService time (from actual send):";
+        printTable(results.service, results, phase.seconds);
+    } else {
+        printTable(results.latency, results, phase.seconds);
+    }
+}
+
+void writeOperations(std::ostream& out, const Phase& phase) {
+    const Results& results = *phase.results;
+    out << "{";
+
+    bool first = true;
+    for (size_t i = 0; i < op_count; ++i) {
+        auto summary = results.latency[i].summarize();
+        if (summary.count == 0) {
+            continue;
+        }
+
+        out << (first ? "\n" : ",\n") << "    \"" << opName(static_cast<OpType>(i)) << "\": {"
+            << "\"count\": " << summary.count
+            << ", \"throughput\": " << summary.count / phase.seconds
+            << ", \"errors\": " << results.errors[i].load()
+            << ", \"mean_us\": " << micros(static_cast<uint64_t>(summary.mean))
+            << ", \"p50_us\": " << micros(summary.p50)
+            << ", \"p90_us\": " << micros(summary.p90)
+            << ", \"p99_us\": " << micros(summary.p99)
+            << ", \"p999_us\": " << micros(summary.p999)
+            << ", \"max_us\": " << micros(summary.max)
+            << ", \"service_p99_us\": " << micros(results.service[i].percentile(99.0)) << "}";
+        first = false;
+    }
+    out << "\n  }";
+}
+
+void writeJsonHeader(std::ostream& out, const Options& options, const WorkloadSpec& spec,
+                     KeyDistribution distribution) {
+    out << std::fixed << std::setprecision(3);
+    out << "{\n"
+        << "  \"workload\": \"" << spec.name << "\",\n"
+        << "  \"distribution\": \"" << distributionName(distribution) << "\",\n"
+        << "  \"records\": " << options.records << ",\n"
+        << "  \"connections\": " << options.connections << ",\n"
+        << "  \"pipeline\": " << options.pipeline << ",\n";
+}
+
+void writeJson(const Options& options, const WorkloadSpec& spec,
+               KeyDistribution distribution, const Phase& phase) {
+    std::ofstream out(options.json_file);
+    writeJsonHeader(out, options, spec, distribution);
+    out << "  \"mode\": \"" << (phase.rate > 0 ? "open" : "closed") << "\",\n"
+        << "  \"target_rate\": " << phase.rate << ",\n"
+        << "  \"seconds\": " << phase.seconds << ",\n"
+        << "  \"throughput\": " << phase.results->completed.load() / phase.seconds << ",\n"
+        << "  \"operations\": ";
+    writeOperations(out, phase);
+    out << "\n}\n";
+}
+
+// Step through the sweep rates, stopping once the server can no longer
+// keep up; report the highest rate that met the p99 objective
+int runSweep(const Options& options, const WorkloadSpec& spec,
+             KeyDistribution distribution, KeyChooser& keys) {
+    printHeader(options, spec, distribution);
+    std::cout << "\n" << std::setw(12) << "Target" << std::setw(12) << "Achieved"
+              << std::setw(10) << "p50(us)" << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+              << std::setw(10) << "Max" << std::setw(8) << "SLO" << "\n";
+
+    std::vector<Phase> phases;
+    double best_rate = 0.0;
+    bool failed = false;
+    double slo_us = options.slo_p99_ms * 1000.0;
+
+    for (double rate : options.sweep_rates) {
+        phases.push_back(runPhase(options, spec, keys, rate));
+        const Phase& phase = phases.back();
+        auto summary = phase.results->overall();
+        double achieved = phase.results->completed.load() / phase.seconds;
+        bool within = slo_us <= 0 || micros(summary.p99) <= slo_us;
+
+        std::cout << std::fixed << std::setprecision(0)
+                  << std::setw(12) << rate << std::setw(12) << achieved << std::setprecision(1)
+                  << std::setw(10) << micros(summary.p50) << std::setw(10) << micros(summary.p99)
+                  << std::setw(10) << micros(summary.p999) << std::setw(10) << micros(summary.max)
+                  << std::setw(8) << (slo_us <= 0 ? "-" : within ? "ok" : "MISS") << std::endl;
+
+        if (phase.failed) {
+            failed = true;
+            break;
+        }
+        if (within && achieved >= rate * 0.95) {
+            best_rate = rate;
+        }
+        // Far past saturation every further step only grows the backlog
+        if (achieved < rate * 0.5) {
+            break;
+        }
+    }
+
+    if (slo_us > 0) {
+        std::cout << "\nHighest rate with p99 <= " << options.slo_p99_ms << " ms: ";
+        if (best_rate > 0) {
+            std::cout << std::setprecision(0) << best_rate << " ops/sec\n";
+        } else {
+            std::cout << "none\n";
+        }
+    }
+
+    if (!options.json_file.empty()) {
+        std::ofstream out(options.json_file);
+        writeJsonHeader(out, options, spec, distribution);
+        out << "  \"mode\": \"sweep\",\n"
+            << "  \"slo_p99_us\": " << slo_us << ",\n"
+            << "  \"max_rate_within_slo\": " << best_rate << ",\n"
+            << "  \"steps\": [";
+        for (size_t i = 0; i < phases.size(); ++i) {
+            auto summary = phases[i].results->overall();
+            out << (i == 0 ? "\n" : ",\n")
+                << "    {\"target_rate\": " << phases[i].rate
+                << ", \"throughput\": " << phases[i].results->completed.load() / phases[i].seconds
+                << ", \"p50_us\": " << micros(summary.p50)
+                << ", \"p99_us\": " << micros(summary.p99)
+                << ", \"p999_us\": " << micros(summary.p999)
+                << ", \"max_us\": " << micros(summary.max) << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    return failed ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        if (!parseOptions(argc, argv, options)) {
+            usage(argv[0]);
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        usage(argv[0]);
+        return 1;
+    }
+
+    const WorkloadSpec* spec = nullptr;
+    for (const auto& workload : workloads) {
+        if (workload.name == options.workload) {
+            spec = &workload;
+        }
+    }
+    if (!spec) {
+        std::cerr << "Unknown workload " << options.workload << " (expected A-F)" << std::endl;
+        return 1;
+    }
+
+    KeyDistribution distribution =
+        options.distribution_set ? options.distribution : spec->distribution;
+
+    try {
+        if (options.load) {
+            loadRecords(options);
+        }
+
+        KeyChooser keys(distribution, options.records);
+
+        if (!options.sweep_rates.empty()) {
+            return runSweep(options, *spec, distribution, keys);
+        }
+
+        kvstore::BenchmarkBaseline baseline;
+        std::string name = std::string("workload:") + spec->name + "/";
+        for (unsigned trial = 0; trial < options.trials; ++trial) {
+            Phase phase = runPhase(options, *spec, keys, options.rate);
+            printReport(options, *spec, distribution, phase);
+            if (!options.json_file.empty()) {
+                writeJson(options, *spec, distribution, phase);
+            }
+            if (phase.failed) {
+                return 1;
+            }
+
+            auto summary = phase.results->overall();
+            baseline.add(name + "throughput",
+                         phase.results->completed.load() / phase.seconds, true);
+            baseline.add(name + "p50_us", micros(summary.p50), false);
+            baseline.add(name + "p99_us", micros(summary.p99), false);
+            for (size_t i = 0; i < op_count; ++i) {
+                auto op = phase.results->latency[i].summarize();
+                if (op.count > 0) {
+                    baseline.add(name + opName(static_cast<OpType>(i)) + "/p99_us",
+                                 micros(op.p99), false);
+                }
+            }
+        }
+        return baseline.saveOrCompare(options.save_baseline, options.compare_baseline,
+                                      options.threshold);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
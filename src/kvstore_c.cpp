@@ -0,0 +1,270 @@
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include "kvstore.h"
+#include "kv_engine.hpp"
+#include "config.hpp"
+
+struct kvstore_engine {
+    std::unique_ptr<kvstore::KVEngine> engine;
+};
+
+namespace {
+
+kvstore_status toStatus(kvstore::Status status) {
+    switch (status) {
+        case kvstore::Status::OK:
+            return KVSTORE_OK;
+        case kvstore::Status::NOT_FOUND:
+            return KVSTORE_NOT_FOUND;
+        case kvstore::Status::WAL_ERROR:
+            return KVSTORE_WAL_ERROR;
+        case kvstore::Status::NOT_INTEGER:
+            return KVSTORE_NOT_INTEGER;
+        case kvstore::Status::OUT_OF_RANGE:
+            return KVSTORE_OUT_OF_RANGE;
+        case kvstore::Status::WRONG_TYPE:
+            return KVSTORE_WRONG_TYPE;
+        case kvstore::Status::KEY_EXISTS:
+            return KVSTORE_KEY_EXISTS;
+        case kvstore::Status::OUT_OF_MEMORY:
+            return KVSTORE_OUT_OF_MEMORY;
+    }
+    return KVSTORE_ERROR;
+}
+
+kvstore_engine* openEngine(const kvstore::Config& config) {
+    try {
+        auto handle = std::make_unique<kvstore_engine>();
+        handle->engine = std::make_unique<kvstore::KVEngine>(config);
+        return handle.release();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+bool validKey(kvstore_engine* engine, const char* key, size_t key_len) {
+    return engine && (key || key_len == 0);
+}
+
+} // namespace
+
+extern "C" {
+
+kvstore_engine* kvstore_open(const char* wal_file, size_t num_segments, int sync_wal) {
+    if (!wal_file) {
+        return nullptr;
+    }
+
+    kvstore::Config config;
+    config.wal_file = wal_file;
+    if (num_segments > 0) {
+        config.num_segments = num_segments;
+    }
+    config.sync_wal = sync_wal != 0;
+    config.fsync_writes = sync_wal > 1;
+    return openEngine(config);
+}
+
+kvstore_engine* kvstore_open_config(const char* config_file) {
+    if (!config_file) {
+        return nullptr;
+    }
+
+    try {
+        return openEngine(kvstore::ConfigManager::loadFromFile(config_file));
+    } catch (...) {
+        return nullptr;     // Malformed numeric setting
+    }
+}
+
+void kvstore_close(kvstore_engine* engine) {
+    delete engine;
+}
+
+kvstore_status kvstore_put(kvstore_engine* engine,
+                           const char* key, size_t key_len,
+                           const char* value, size_t value_len,
+                           uint64_t ttl_ms) {
+    if (!validKey(engine, key, key_len) || (!value && value_len > 0)) {
+        return KVSTORE_INVALID_ARGUMENT;
+    }
+
+    try {
+        return toStatus(engine->engine->put(std::string(key, key_len),
+                                            std::string(value, value_len), ttl_ms));
+    } catch (...) {
+        return KVSTORE_ERROR;
+    }
+}
+
+kvstore_status kvstore_get(kvstore_engine* engine,
+                           const char* key, size_t key_len,
+                           char** value, size_t* value_len) {
+    if (!validKey(engine, key, key_len) || !value || !value_len) {
+        return KVSTORE_INVALID_ARGUMENT;
+    }
+
+    try {
+        std::string result;
+        std::string name(key, key_len);
+        if (!engine->engine->get(name, result)) {
+            return engine->engine->type(name) == kvstore::ValueType::NONE
+                ? KVSTORE_NOT_FOUND : KVSTORE_WRONG_TYPE;
+        }
+
+        // Always allocate, so an empty value is still a valid pointer
+        auto* copy = static_cast<char*>(std::malloc(result.size() + 1));
+        if (!copy) {
+            return KVSTORE_ERROR;
+        }
+        std::memcpy(copy, result.data(), result.size());
+        copy[result.size()] = '\0';
+
+        *value = copy;
+        *value_len = result.size();
+        return KVSTORE_OK;
+    } catch (...) {
+        return KVSTORE_ERROR;
+    }
+}
+
+kvstore_status kvstore_delete(kvstore_engine* engine, const char* key, size_t key_len) {
+    if (!validKey(engine, key, key_len)) {
+        return KVSTORE_INVALID_ARGUMENT;
+    }
+
+    try {
+        return toStatus(engine->engine->erase(std::string(key, key_len)));
+    } catch (...) {
+        return KVSTORE_ERROR;
+    }
+}
+
+int kvstore_exists(kvstore_engine* engine, const char* key, size_t key_len) {
+    if (!validKey(engine, key, key_len)) {
+        return 0;
+    }
+
+    try {
+        return engine->engine->exists(std::string(key, key_len)) ? 1 : 0;
+    } catch (...) {
+        return 0;
+    }
+}
+
+size_t kvstore_size(kvstore_engine* engine) {
+    return engine ? engine->engine->size() : 0;
+}
+
+kvstore_status kvstore_expire(kvstore_engine* engine,
+                              const char* key, size_t key_len, uint64_t ttl_ms) {
+    if (!validKey(engine, key, key_len)) {
+        return KVSTORE_INVALID_ARGUMENT;
+    }
+
+    try {
+        return toStatus(engine->engine->expire(std::string(key, key_len), ttl_ms));
+    } catch (...) {
+        return KVSTORE_ERROR;
+    }
+}
+
+kvstore_status kvstore_incrby(kvstore_engine* engine,
+                              const char* key, size_t key_len,
+                              int64_t delta, int64_t* result) {
+    if (!validKey(engine, key, key_len) || !result) {
+        return KVSTORE_INVALID_ARGUMENT;
+    }
+
+    try {
+        return toStatus(engine->engine->incrBy(std::string(key, key_len), delta, *result));
+    } catch (...) {
+        return KVSTORE_ERROR;
+    }
+}
+
+kvstore_status kvstore_append(kvstore_engine* engine,
+                              const char* key, size_t key_len,
+                              const char* data, size_t data_len, size_t* length) {
+    if (!validKey(engine, key, key_len) || (!data && data_len > 0) || !length) {
+        return KVSTORE_INVALID_ARGUMENT;
+    }
+
+    try {
+        return toStatus(engine->engine->append(std::string(key, key_len),
+                                               std::string(data, data_len), *length));
+    } catch (...) {
+        return KVSTORE_ERROR;
+    }
+}
+
+kvstore_status kvstore_setrange(kvstore_engine* engine,
+                                const char* key, size_t key_len, size_t offset,
+                                const char* data, size_t data_len, size_t* length) {
+    if (!validKey(engine, key, key_len) || (!data && data_len > 0) || !length) {
+        return KVSTORE_INVALID_ARGUMENT;
+    }
+
+    try {
+        return toStatus(engine->engine->setRange(std::string(key, key_len), offset,
+                                                 std::string(data, data_len), *length));
+    } catch (...) {
+        return KVSTORE_ERROR;
+    }
+}
+
+size_t kvstore_strlen(kvstore_engine* engine, const char* key, size_t key_len) {
+    if (!validKey(engine, key, key_len)) {
+        return 0;
+    }
+
+    try {
+        return engine->engine->valueLength(std::string(key, key_len));
+    } catch (...) {
+        return 0;
+    }
+}
+
+int64_t kvstore_ttl(kvstore_engine* engine, const char* key, size_t key_len) {
+    if (!validKey(engine, key, key_len)) {
+        return -2;
+    }
+
+    try {
+        return engine->engine->ttl(std::string(key, key_len));
+    } catch (...) {
+        return -2;
+    }
+}
+
+kvstore_status kvstore_checkpoint(kvstore_engine* engine) {
+    if (!engine) {
+        return KVSTORE_INVALID_ARGUMENT;
+    }
+
+    try {
+        return engine->engine->checkpoint() ? KVSTORE_OK : KVSTORE_WAL_ERROR;
+    } catch (...) {
+        return KVSTORE_ERROR;
+    }
+}
+
+kvstore_status kvstore_flush(kvstore_engine* engine) {
+    if (!engine) {
+        return KVSTORE_INVALID_ARGUMENT;
+    }
+
+    try {
+        engine->engine->clear();
+        return KVSTORE_OK;
+    } catch (...) {
+        return KVSTORE_ERROR;
+    }
+}
+
+void kvstore_free(void* ptr) {
+    std::free(ptr);
+}
+
+} // extern "C"
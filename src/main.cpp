@@ -21,10 +21,15 @@ int main(int argc, char* argv[]) {
     
     // Load configuration
     kvstore::Config config;
-    if (argc > 1) {
-        config = kvstore::ConfigManager::loadFromFile(argv[1]);
-    } else {
-        config = kvstore::ConfigManager::loadFromFile();
+    try {
+        if (argc > 1) {
+            config = kvstore::ConfigManager::loadFromFile(argv[1]);
+        } else {
+            config = kvstore::ConfigManager::loadFromFile();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid configuration: " << e.what() << std::endl;
+        return 1;
     }
     
     // Create and start server
@@ -32,7 +37,7 @@ int main(int argc, char* argv[]) {
     
     std::cout << "=== Fault-Tolerant Concurrent KV Store ===" << std::endl;
     std::cout << "Port: " << config.server_port << std::endl;
-    std::cout << "Segments: " << config.num_segments << std::endl;
+    std::cout << "Segments: " << server->getConfig().num_segments << std::endl;
     std::cout << "WAL: " << config.wal_file << std::endl;
     std::cout << "Max connections: " << config.max_connections << std::endl;
     std::cout << "==========================================" << std::endl;
@@ -0,0 +1,543 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <filesystem>
+#include <algorithm>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "write_ahead_log.hpp"
+#include "config.hpp"
+
+// Crash-recovery torture test for kv_server. Each iteration:
+//
+//   1. --clients connections write and delete keys as fast as they can,
+//      each over its own key range, remembering every acknowledged write
+//   2. after a random delay the server is killed with SIGKILL
+//   3. with --torn, a random prefix of one more WAL entry is appended,
+//      as if the process had died in the middle of writing it
+//   4. the server is restarted on the same files; the time until it
+//      answers is the restart time
+//   5. every key is read back: it must hold its last acknowledged state,
+//      or the state of the one request that was in flight at the kill
+//
+// Acknowledged writes survive a process crash only with sync_wal=true
+// (entries are handed to the OS before the reply), which is what the
+// harness configures. --checkpoint-wal-size makes crashes land around
+// checkpoints too.
+//
+//   crash_test --server ./kv_server --iterations 50 --torn
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    std::string server;
+    std::string dir = ".";
+    uint16_t port = 6391;
+    unsigned iterations = 20;
+    size_t clients = 4;
+    size_t keys = 1000;             // Per client
+    size_t value_size = 100;
+    unsigned min_run_ms = 50;
+    unsigned max_run_ms = 500;
+    bool torn = false;
+    size_t checkpoint_wal_size = 0;
+    uint64_t seed = 1;
+    std::string json_file;
+};
+
+constexpr int64_t ABSENT = -1;
+constexpr int64_t NONE = -2;
+
+// What the server may hold for one key
+struct KeyState {
+    int64_t acked = ABSENT;         // Version of the last acknowledged write
+    int64_t pending = NONE;         // Version of an unacknowledged request
+};
+
+struct Iteration {
+    double run_ms = 0.0;
+    uint64_t acked = 0;
+    uint64_t wal_bytes = 0;
+    double restart_ms = 0.0;
+    uint64_t lost = 0;
+};
+
+void usage(const char* program) {
+    std::cerr
+        << "Usage: " << program << " --server PATH [options]\n"
+        << "  --server PATH           kv_server binary\n"
+        << "  --dir DIR               Directory for the WAL and config (.)\n"
+        << "  --port PORT             Server port (6391)\n"
+        << "  --iterations N          Crash/restart cycles (20)\n"
+        << "  --clients N             Concurrent writers (4)\n"
+        << "  --keys N                Keys per writer (1000)\n"
+        << "  --value-size BYTES      Value size (100)\n"
+        << "  --run-ms MIN:MAX        Load time before each kill (50:500)\n"
+        << "  --torn                  Leave a torn WAL entry after each kill\n"
+        << "  --checkpoint-wal-size N Server's checkpoint_wal_size (0)\n"
+        << "  --seed N                Random seed (1)\n"
+        << "  --json FILE             Also write per-iteration results as JSON\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--torn") {
+            options.torn = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--server") {
+            options.server = value;
+        } else if (arg == "--dir") {
+            options.dir = value;
+        } else if (arg == "--port") {
+            options.port = static_cast<uint16_t>(std::stoul(value));
+        } else if (arg == "--iterations") {
+            options.iterations = std::stoul(value);
+        } else if (arg == "--clients") {
+            options.clients = std::max<size_t>(std::stoul(value), 1);
+        } else if (arg == "--keys") {
+            options.keys = std::max<size_t>(std::stoul(value), 1);
+        } else if (arg == "--value-size") {
+            options.value_size = std::max<size_t>(std::stoul(value), 24);
+        } else if (arg == "--run-ms") {
+            size_t colon = value.find(':');
+            if (colon == std::string::npos) {
+                return false;
+            }
+            options.min_run_ms = std::stoul(value.substr(0, colon));
+            options.max_run_ms = std::stoul(value.substr(colon + 1));
+        } else if (arg == "--checkpoint-wal-size") {
+            options.checkpoint_wal_size = std::stoul(value);
+        } else if (arg == "--seed") {
+            options.seed = std::stoull(value);
+        } else if (arg == "--json") {
+            options.json_file = value;
+        } else {
+            return false;
+        }
+    }
+    return !options.server.empty() && options.min_run_ms <= options.max_run_ms;
+}
+
+// Blocking line-oriented connection
+class Connection {
+private:
+    int fd = -1;
+    std::string buffer;
+
+public:
+    explicit Connection(uint16_t port) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    ~Connection() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    bool connected() const {
+        return fd >= 0;
+    }
+
+    bool send(const std::string& data) {
+        return fd >= 0 && ::send(fd, data.data(), data.size(), MSG_NOSIGNAL) ==
+                          static_cast<ssize_t>(data.size());
+    }
+
+    // Append whatever has arrived; false once the connection is gone
+    bool receive() {
+        char chunk[4096];
+        ssize_t n = fd >= 0 ? recv(fd, chunk, sizeof(chunk), 0) : -1;
+        if (n <= 0) {
+            return false;
+        }
+        buffer.append(chunk, static_cast<size_t>(n));
+        return true;
+    }
+
+    bool readLine(std::string& line) {
+        while (true) {
+            size_t newline = buffer.find('\n');
+            if (newline != std::string::npos) {
+                line = buffer.substr(0, newline);
+                buffer.erase(0, newline + 1);
+                return true;
+            }
+            if (!receive()) {
+                return false;
+            }
+        }
+    }
+
+    // A line, or for a "$<length>" line the stored data that follows it
+    bool readReply(std::string& reply) {
+        if (!readLine(reply)) {
+            return false;
+        }
+        if (reply.empty() || reply[0] != '$') {
+            return true;
+        }
+        size_t length = std::stoul(reply.substr(1));
+        while (buffer.size() < length + 1) {
+            if (!receive()) {
+                return false;
+            }
+        }
+        reply = buffer.substr(0, length);
+        buffer.erase(0, length + 1);
+        return true;
+    }
+};
+
+std::string keyName(size_t client, size_t index) {
+    return "c" + std::to_string(client) + "_k" + std::to_string(index);
+}
+
+// "<version>:" padded to size, so the version can be read back
+std::string makeValue(int64_t version, size_t size) {
+    std::string value = std::to_string(version) + ":";
+    value.resize(std::max(size, value.size()), 'x');
+    return value;
+}
+
+int64_t parseVersion(const std::string& reply) {
+    if (reply == "NOT_FOUND") {
+        return ABSENT;
+    }
+    size_t colon = reply.find(':');
+    if (colon == std::string::npos || colon == 0) {
+        return NONE;
+    }
+    try {
+        return std::stoll(reply.substr(0, colon));
+    } catch (const std::exception&) {
+        return NONE;
+    }
+}
+
+// Write until the connection drops. Versions are unique across clients
+// and iterations: (next_version)++ per write, starting from base.
+void runClient(const Options& options, size_t client, std::vector<KeyState>& states,
+               int64_t& next_version, std::atomic<uint64_t>& acked, uint64_t seed) {
+    Connection connection(options.port);
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> pick(0, options.keys - 1);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::string reply;
+
+    while (connection.connected()) {
+        size_t index = pick(rng);
+        auto& state = states[index];
+        std::string key = keyName(client, index);
+
+        std::string request;
+        if (percent(rng) < 10) {
+            state.pending = ABSENT;
+            request = "DELETE " + key + "\n";
+        } else {
+            state.pending = next_version++;
+            request = "PUT " + key + " " + makeValue(state.pending, options.value_size) + "\n";
+        }
+
+        if (!connection.send(request) || !connection.readLine(reply)) {
+            return;     // Killed with the request in flight
+        }
+        if (reply == "OK" || (reply == "NOT_FOUND" && state.pending == ABSENT)) {
+            state.acked = state.pending;
+            state.pending = NONE;
+            acked.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            std::cerr << "Unexpected reply to " << key << ": " << reply << std::endl;
+            state.pending = NONE;
+        }
+    }
+}
+
+pid_t startServer(const Options& options, const std::string& config_file) {
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        execl(options.server.c_str(), options.server.c_str(), config_file.c_str(),
+              static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    return pid;
+}
+
+// Wait until the server answers a request; false if it exited first
+bool waitForServer(const Options& options, pid_t pid) {
+    std::string reply;
+    while (true) {
+        Connection connection(options.port);
+        if (connection.send("GET crash_test_probe\n") && connection.readReply(reply)) {
+            return true;
+        }
+
+        int status = 0;
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// Encoded bytes of a PUT as the WAL would hold it
+std::string encodeEntry(const Options& options, const std::string& key, const std::string& value) {
+    std::string file = (fs::path(options.dir) / "crash_test.entry").string();
+    fs::remove(file);
+    {
+        kvstore::WriteAheadLog wal(file);
+        wal.writeEntry(kvstore::Operation::PUT, key, value);
+    }
+
+    std::string bytes(fs::file_size(file), '\0');
+    std::ifstream(file, std::ios::binary).read(&bytes[0], bytes.size());
+    fs::remove(file);
+    return bytes;
+}
+
+// Read every key back and check it against the model; the observed
+// state becomes the new acknowledged state. Returns the violations.
+uint64_t verify(const Options& options, std::vector<std::vector<KeyState>>& states,
+                const std::string& torn_key) {
+    Connection connection(options.port);
+    uint64_t violations = 0;
+    std::string reply;
+
+    // Pipelined one client's key range at a time
+    for (size_t client = 0; client < options.clients; ++client) {
+        std::string requests;
+        for (size_t index = 0; index < options.keys; ++index) {
+            requests += "GET " + keyName(client, index) + "\n";
+        }
+        if (!connection.send(requests)) {
+            std::cerr << "Lost the connection while verifying" << std::endl;
+            return options.clients * options.keys;
+        }
+
+        for (size_t index = 0; index < options.keys; ++index) {
+            if (!connection.readReply(reply)) {
+                std::cerr << "Lost the connection while verifying" << std::endl;
+                return options.clients * options.keys;
+            }
+
+            auto& state = states[client][index];
+            int64_t observed = parseVersion(reply);
+            if (observed != state.acked && !(state.pending != NONE && observed == state.pending)) {
+                if (violations < 10) {
+                    std::cerr << "  " << keyName(client, index) << ": expected version "
+                              << state.acked;
+                    if (state.pending != NONE) {
+                        std::cerr << " or " << state.pending;
+                    }
+                    std::cerr << ", found " << (observed == ABSENT ? "none" : reply.substr(0, 20))
+                              << std::endl;
+                }
+                violations++;
+            }
+
+            state.acked = observed == NONE ? state.acked : observed;
+            state.pending = NONE;
+        }
+    }
+
+    if (!torn_key.empty()) {
+        if (!connection.send("GET " + torn_key + "\n") || !connection.readReply(reply) ||
+            reply != "NOT_FOUND") {
+            std::cerr << "  torn entry " << torn_key << " was applied" << std::endl;
+            violations++;
+        }
+    }
+    return violations;
+}
+
+void writeJson(const Options& options, const std::vector<Iteration>& iterations) {
+    std::ofstream out(options.json_file);
+    out << std::fixed << std::setprecision(3)
+        << "{\n  \"clients\": " << options.clients
+        << ",\n  \"keys\": " << options.clients * options.keys
+        << ",\n  \"torn\": " << (options.torn ? "true" : "false")
+        << ",\n  \"iterations\": [";
+    for (size_t i = 0; i < iterations.size(); ++i) {
+        const auto& it = iterations[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"run_ms\": " << it.run_ms
+            << ", \"acked_writes\": " << it.acked
+            << ", \"wal_bytes\": " << it.wal_bytes
+            << ", \"restart_ms\": " << it.restart_ms
+            << ", \"lost_writes\": " << it.lost << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        if (!parseOptions(argc, argv, options)) {
+            usage(argv[0]);
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        usage(argv[0]);
+        return 1;
+    }
+
+    kvstore::Config config;
+    config.wal_file = (fs::path(options.dir) / "crash_test.wal").string();
+    config.server_port = options.port;
+    config.sync_wal = true;
+    config.checkpoint_wal_size = options.checkpoint_wal_size;
+    std::string config_file = (fs::path(options.dir) / "crash_test.conf").string();
+    kvstore::ConfigManager::saveToFile(config, config_file);
+    fs::remove(config.wal_file);
+    fs::remove(config.wal_file + ".snapshot");
+
+    std::mt19937_64 rng(options.seed);
+    std::vector<std::vector<KeyState>> states(options.clients,
+                                              std::vector<KeyState>(options.keys));
+    std::vector<int64_t> next_version(options.clients);
+    for (size_t client = 0; client < options.clients; ++client) {
+        // Disjoint version ranges per client
+        next_version[client] = static_cast<int64_t>(client) << 40;
+    }
+
+    pid_t pid = startServer(options, config_file);
+    if (!waitForServer(options, pid)) {
+        std::cerr << "kv_server failed to start" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(6) << "Iter" << std::right
+              << std::setw(10) << "Run(ms)" << std::setw(10) << "Acked"
+              << std::setw(12) << "WAL(KB)" << std::setw(8) << "Torn"
+              << std::setw(13) << "Restart(ms)" << std::setw(8) << "Lost" << std::endl;
+
+    std::vector<Iteration> iterations;
+    uint64_t total_violations = 0;
+
+    for (unsigned iter = 1; iter <= options.iterations; ++iter) {
+        Iteration result;
+        std::atomic<uint64_t> acked{0};
+
+        std::vector<std::thread> clients;
+        for (size_t client = 0; client < options.clients; ++client) {
+            clients.emplace_back(runClient, std::cref(options), client, std::ref(states[client]),
+                                 std::ref(next_version[client]), std::ref(acked), rng());
+        }
+
+        unsigned run_ms = std::uniform_int_distribution<unsigned>(
+            options.min_run_ms, options.max_run_ms)(rng);
+        auto started = Clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(run_ms));
+
+        kill(pid, SIGKILL);
+        int status = 0;
+        waitpid(pid, &status, 0);
+        result.run_ms = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+
+        for (auto& thread : clients) {
+            thread.join();
+        }
+        result.acked = acked.load();
+
+        std::error_code ec;
+        result.wal_bytes = fs::file_size(config.wal_file, ec);
+
+        // A PUT that never completed: some prefix of it reached the log
+        std::string torn_key;
+        size_t torn_bytes = 0;
+        if (options.torn) {
+            torn_key = "torn_" + std::to_string(iter);
+            std::string entry = encodeEntry(options, torn_key, makeValue(0, options.value_size));
+            torn_bytes = std::uniform_int_distribution<size_t>(1, entry.size() - 1)(rng);
+            std::ofstream(config.wal_file, std::ios::binary | std::ios::app)
+                .write(entry.data(), static_cast<std::streamsize>(torn_bytes));
+        }
+
+        auto restarted = Clock::now();
+        pid = startServer(options, config_file);
+        if (!waitForServer(options, pid)) {
+            std::cerr << "kv_server failed to restart after iteration " << iter << std::endl;
+            return 1;
+        }
+        result.restart_ms = std::chrono::duration<double, std::milli>(
+            Clock::now() - restarted).count();
+
+        result.lost = verify(options, states, torn_key);
+        total_violations += result.lost;
+
+        std::cout << std::left << std::setw(6) << iter << std::right << std::fixed
+                  << std::setprecision(0) << std::setw(10) << result.run_ms
+                  << std::setw(10) << result.acked << std::setprecision(1)
+                  << std::setw(12) << result.wal_bytes / 1024.0
+                  << std::setw(8) << torn_bytes
+                  << std::setw(13) << result.restart_ms
+                  << std::setw(8) << result.lost << std::endl;
+        iterations.push_back(result);
+    }
+
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+
+    std::vector<double> restarts;
+    uint64_t total_acked = 0;
+    for (const auto& it : iterations) {
+        restarts.push_back(it.restart_ms);
+        total_acked += it.acked;
+    }
+    std::sort(restarts.begin(), restarts.end());
+    if (!restarts.empty()) {
+        std::cout << "\nRestart time: min " << std::setprecision(1) << restarts.front()
+                  << " ms, median " << restarts[restarts.size() / 2]
+                  << " ms, max " << restarts.back() << " ms" << std::endl;
+    }
+    std::cout << total_acked << " acknowledged writes, " << total_violations
+              << " lost or corrupted" << std::endl;
+
+    if (!options.json_file.empty()) {
+        writeJson(options, iterations);
+    }
+
+    fs::remove(config_file);
+    fs::remove(config.wal_file);
+    fs::remove(config.wal_file + ".snapshot");
+    return total_violations == 0 ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "concurrent_hash_map.hpp"
+#include "workload.hpp"
+#include "benchmark_baseline.hpp"
+
+// ConcurrentHashMap microbenchmarks. BM_MapMixed sweeps the full
+// parameter space; run a slice with --benchmark_filter, e.g.
+//   map_benchmark --benchmark_filter='segments:64/.*/dist:1'
+//       --benchmark_out=map.json --benchmark_out_format=json
+// Each run preloads key_space keys; reads pick a present key with
+// probability hit_pct and an absent one otherwise, writes overwrite
+// present keys, so the map size stays fixed during the run. The map does
+// not resize, so its load factor is key_space / segments.
+//
+// Besides Google Benchmark's own flags, --save-baseline FILE records
+// items_per_second of every repetition, and --compare FILE flags
+// significant changes against such a file (--threshold PCT, default 5):
+//   map_benchmark --benchmark_filter=BM_MapFind --benchmark_repetitions=10
+//       --save-baseline before.json
+
+namespace {
+
+constexpr uint64_t key_space = 10000;
+
+enum Distribution : int64_t {
+    UNIFORM = 0,
+    ZIPFIAN = 1
+};
+
+// Arguments, in ArgNames order
+enum Arg {
+    SEGMENTS,
+    KEY_SIZE,
+    VALUE_SIZE,
+    READ_PCT,
+    HIT_PCT,
+    DIST
+};
+
+struct Workload {
+    std::unique_ptr<kvstore::ConcurrentHashMap<std::string, std::string>> map;
+    std::vector<std::string> keys;
+    std::vector<std::string> missing_keys;
+    std::string value;
+    std::unique_ptr<kvstore::ZipfianGenerator> zipf;
+};
+
+// Built once per benchmark run, before its threads start
+Workload workload;
+
+void setupWorkload(const benchmark::State& state) {
+    auto key_size = static_cast<size_t>(state.range(KEY_SIZE));
+
+    workload.map = std::make_unique<kvstore::ConcurrentHashMap<std::string, std::string>>(
+        static_cast<size_t>(state.range(SEGMENTS)));
+    workload.value = kvstore::makeValue(static_cast<size_t>(state.range(VALUE_SIZE)));
+    workload.keys.clear();
+    workload.missing_keys.clear();
+
+    for (uint64_t i = 0; i < key_space; ++i) {
+        workload.keys.push_back(kvstore::formatKey(i, key_size));
+        workload.missing_keys.push_back(kvstore::formatKey(i, key_size, "miss"));
+        workload.map->insert(workload.keys.back(), workload.value);
+    }
+
+    if (state.range(DIST) == ZIPFIAN) {
+        workload.zipf = std::make_unique<kvstore::ZipfianGenerator>(key_space);
+    }
+}
+
+void teardownWorkload(const benchmark::State&) {
+    workload = Workload();
+}
+
+void BM_MapMixed(benchmark::State& state) {
+    const int64_t read_pct = state.range(READ_PCT);
+    const int64_t hit_pct = state.range(HIT_PCT);
+    const bool zipfian = state.range(DIST) == ZIPFIAN;
+
+    std::mt19937_64 rng(0x9e3779b97f4a7c15ULL + state.thread_index());
+    std::uniform_int_distribution<int64_t> percent(0, 99);
+    kvstore::UniformGenerator uniform(key_space);
+
+    auto& map = *workload.map;
+    std::string result;
+    int64_t reads = 0, hits = 0;
+
+    for (auto _ : state) {
+        uint64_t index = zipfian ? workload.zipf->next(rng) : uniform.next(rng);
+
+        if (percent(rng) < read_pct) {
+            const auto& key = percent(rng) < hit_pct ? workload.keys[index]
+                                                     : workload.missing_keys[index];
+            bool found = map.find(key, result);
+            benchmark::DoNotOptimize(found);
+            reads++;
+            hits += found ? 1 : 0;
+        } else {
+            map.insert(workload.keys[index], workload.value);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["reads"] = benchmark::Counter(static_cast<double>(reads),
+                                                 benchmark::Counter::kIsRate);
+    state.counters["hit_ratio"] = benchmark::Counter(
+        reads > 0 ? static_cast<double>(hits) / reads : 0.0, benchmark::Counter::kAvgThreads);
+}
+
+BENCHMARK(BM_MapMixed)
+    ->Setup(setupWorkload)
+    ->Teardown(teardownWorkload)
+    ->ArgNames({"segments", "key", "value", "read_pct", "hit_pct", "dist"})
+    ->ArgsProduct({
+        {16, 64, 256},      // Segments
+        {16, 128},          // Key size (bytes)
+        {64, 1024},         // Value size (bytes)
+        {50, 95, 100},      // Read percentage
+        {100, 50},          // Read hit percentage
+        {UNIFORM, ZIPFIAN}
+    })
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// Single-threaded baselines for the individual operations
+void BM_MapFind(benchmark::State& state) {
+    kvstore::ConcurrentHashMap<std::string, std::string> map(64);
+    std::vector<std::string> keys;
+    for (uint64_t i = 0; i < key_space; ++i) {
+        keys.push_back(kvstore::formatKey(i, 16));
+        map.insert(keys.back(), "value");
+    }
+
+    std::string result;
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(map.find(keys[i], result));
+        i = (i + 1) % keys.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MapFind);
+
+void BM_MapInsert(benchmark::State& state) {
+    kvstore::ConcurrentHashMap<std::string, std::string> map(64);
+    std::vector<std::string> keys;
+    for (uint64_t i = 0; i < key_space; ++i) {
+        keys.push_back(kvstore::formatKey(i, 16));
+    }
+
+    std::string value = kvstore::makeValue(static_cast<size_t>(state.range(0)));
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(map.insert(keys[i], value));
+        i = (i + 1) % keys.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MapInsert)->ArgName("value")->Arg(64)->Arg(1024)->Arg(16384);
+
+// Console output as usual, plus every repetition's throughput recorded
+// for the baseline
+class BaselineReporter : public benchmark::ConsoleReporter {
+private:
+    kvstore::BenchmarkBaseline& baseline;
+
+public:
+    explicit BaselineReporter(kvstore::BenchmarkBaseline& baseline) : baseline(baseline) {}
+
+    void ReportRuns(const std::vector<Run>& runs) override {
+        for (const auto& run : runs) {
+            auto it = run.counters.find("items_per_second");
+            if (run.run_type == Run::RT_Iteration && !run.error_occurred &&
+                it != run.counters.end()) {
+                baseline.add(run.benchmark_name() + "/items_per_second", it->second.value, true);
+            }
+        }
+        ConsoleReporter::ReportRuns(runs);
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+
+    // Take out our own flags; Google Benchmark has consumed its own
+    std::string save_file, compare_file;
+    double threshold = 0.05;
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "--save-baseline" || arg == "--compare" || arg == "--threshold") &&
+            i + 1 < argc) {
+            std::string value = argv[++i];
+            if (arg == "--save-baseline") {
+                save_file = value;
+            } else if (arg == "--compare") {
+                compare_file = value;
+            } else {
+                threshold = std::stod(value) / 100.0;
+            }
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    kvstore::BenchmarkBaseline baseline;
+    BaselineReporter reporter(baseline);
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+
+    return baseline.saveOrCompare(save_file, compare_file, threshold);
+}
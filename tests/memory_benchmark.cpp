@@ -0,0 +1,470 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <filesystem>
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "concurrent_hash_map.hpp"
+#include "kv_engine.hpp"
+#include "workload.hpp"
+#include "benchmark_baseline.hpp"
+
+// Memory-per-key benchmark. Loads --keys keys of each key and value size
+// into a fresh ConcurrentHashMap<string, string> ("map") or KVEngine
+// ("engine") and reports, per key:
+//
+//   rss       growth of the process's resident set
+//   heap      growth of live heap bytes as the allocator reports them
+//             (malloc_usable_size of every operator new block, so size
+//             class rounding is included)
+//   overhead  heap bytes per key beyond the raw key + value payload
+//
+// Each configuration loads in its own forked child, so freed memory from
+// one run never hides growth in the next. Run under LD_PRELOAD to compare
+// allocators, and vary --segments to compare bucket layouts:
+//
+//   LD_PRELOAD=libjemalloc.so.2 memory_benchmark --keys 1000000 --sizes 16:100,64:1024
+//
+// With --server HOST:PORT --pid PID the keys are PUT to a running
+// kv_server instead, and only its RSS growth is reported. --trials,
+// --save-baseline and --compare check for significant growth against an
+// earlier run.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::atomic<int64_t> heap_bytes{0};
+std::atomic<int64_t> heap_blocks{0};
+
+void* allocate(size_t size) {
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    heap_bytes.fetch_add(static_cast<int64_t>(malloc_usable_size(p)), std::memory_order_relaxed);
+    heap_blocks.fetch_add(1, std::memory_order_relaxed);
+    return p;
+}
+
+void deallocate(void* p) {
+    if (p != nullptr) {
+        heap_bytes.fetch_sub(static_cast<int64_t>(malloc_usable_size(p)), std::memory_order_relaxed);
+        heap_blocks.fetch_sub(1, std::memory_order_relaxed);
+        std::free(p);
+    }
+}
+
+} // namespace
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { deallocate(p); }
+
+namespace {
+
+struct Layout {
+    size_t key_size;
+    size_t value_size;
+};
+
+struct Options {
+    std::vector<std::string> targets = {"map", "engine"};
+    uint64_t keys = 1000000;
+    std::vector<Layout> sizes = {{16, 100}};
+    size_t segments = 0;            // 0 = one per 8 keys
+    std::string dir = ".";
+    std::string server;
+    pid_t server_pid = 0;
+    std::string json_file;
+    unsigned trials = 1;
+    std::string save_baseline;
+    std::string compare_baseline;
+    double threshold = 0.05;
+};
+
+// Sent from a loading child to the parent over a pipe
+struct MemoryReport {
+    bool ok = false;
+    int64_t rss_bytes = 0;
+    int64_t heap_bytes = 0;         // -1 when not measurable
+    int64_t heap_blocks = 0;
+    uint64_t items = 0;
+};
+
+struct Result {
+    std::string target;
+    Layout layout;
+    size_t segments;
+    MemoryReport report;
+};
+
+int64_t residentBytes(pid_t pid = 0) {
+    std::string path = pid == 0 ? "/proc/self/statm" : "/proc/" + std::to_string(pid) + "/statm";
+    std::ifstream statm(path);
+    int64_t size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+void usage(const char* program) {
+    std::cerr
+        << "Usage: " << program << " [options]\n"
+        << "  --targets LIST     map,engine (both)\n"
+        << "  --keys N           Keys to load (1000000)\n"
+        << "  --sizes LIST       KEY:VALUE byte sizes (16:100)\n"
+        << "  --segments N       Hash map segments (keys / 8)\n"
+        << "  --dir DIR          Directory for the engine's WAL (.)\n"
+        << "  --server HOST:PORT Load a running kv_server instead\n"
+        << "  --pid PID          The server's process id (with --server)\n"
+        << "  --json FILE        Also write the results as JSON\n"
+        << "  --trials N         Loads of each configuration (1)\n"
+        << "  --save-baseline F  Save the per-trial results as a baseline\n"
+        << "  --compare F        Flag significant regressions against a baseline\n"
+        << "  --threshold PCT    Smallest change --compare reports (5)\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        std::istringstream iss(value);
+        std::string item;
+
+        if (arg == "--targets") {
+            options.targets.clear();
+            while (std::getline(iss, item, ',')) {
+                if (item != "map" && item != "engine") {
+                    return false;
+                }
+                options.targets.push_back(item);
+            }
+        } else if (arg == "--keys") {
+            options.keys = std::stoull(value);
+        } else if (arg == "--sizes") {
+            options.sizes.clear();
+            while (std::getline(iss, item, ',')) {
+                size_t colon = item.find(':');
+                if (colon == std::string::npos) {
+                    return false;
+                }
+                options.sizes.push_back({std::stoul(item.substr(0, colon)),
+                                         std::stoul(item.substr(colon + 1))});
+            }
+        } else if (arg == "--segments") {
+            options.segments = std::stoul(value);
+        } else if (arg == "--dir") {
+            options.dir = value;
+        } else if (arg == "--server") {
+            options.server = value;
+        } else if (arg == "--pid") {
+            options.server_pid = static_cast<pid_t>(std::stol(value));
+        } else if (arg == "--json") {
+            options.json_file = value;
+        } else if (arg == "--trials") {
+            options.trials = std::max(1UL, std::stoul(value));
+        } else if (arg == "--save-baseline") {
+            options.save_baseline = value;
+        } else if (arg == "--compare") {
+            options.compare_baseline = value;
+        } else if (arg == "--threshold") {
+            options.threshold = std::stod(value) / 100.0;
+        } else {
+            return false;
+        }
+    }
+    if (!options.server.empty() && options.server_pid == 0) {
+        return false;
+    }
+    return options.keys > 0 && !options.sizes.empty();
+}
+
+size_t segmentCount(const Options& options) {
+    return options.segments > 0 ? options.segments
+                                : std::max<size_t>(options.keys / 8, 64);
+}
+
+// Load the keys in-process and measure the growth
+MemoryReport loadLocal(const Options& options, const std::string& target, const Layout& layout) {
+    // Built before the baseline so it is not counted
+    std::string value = kvstore::makeValue(layout.value_size);
+
+    std::unique_ptr<kvstore::ConcurrentHashMap<std::string, std::string>> map;
+    std::unique_ptr<kvstore::KVEngine> engine;
+
+    std::string wal_file = (fs::path(options.dir) / "memory_benchmark.wal").string();
+    fs::remove(wal_file);
+    fs::remove(wal_file + ".snapshot");
+
+    MemoryReport report;
+    int64_t rss_before = residentBytes();
+    int64_t heap_before = heap_bytes.load();
+    int64_t blocks_before = heap_blocks.load();
+
+    if (target == "map") {
+        map = std::make_unique<kvstore::ConcurrentHashMap<std::string, std::string>>(
+            segmentCount(options));
+        for (uint64_t i = 0; i < options.keys; ++i) {
+            map->insert(kvstore::formatKey(i, layout.key_size), value);
+        }
+        report.items = map->size();
+    } else {
+        kvstore::Config config;
+        config.wal_file = wal_file;
+        config.num_segments = segmentCount(options);
+        config.sync_wal = false;
+        config.expiry_sweep_interval_ms = 0;
+        engine = std::make_unique<kvstore::KVEngine>(config);
+        for (uint64_t i = 0; i < options.keys; ++i) {
+            engine->put(kvstore::formatKey(i, layout.key_size), value);
+        }
+        report.items = engine->size();
+    }
+
+    report.rss_bytes = residentBytes() - rss_before;
+    report.heap_bytes = heap_bytes.load() - heap_before;
+    report.heap_blocks = heap_blocks.load() - blocks_before;
+    report.ok = true;
+
+    fs::remove(wal_file);
+    return report;
+}
+
+int connectTo(const std::string& server) {
+    size_t colon = server.rfind(':');
+    std::string host = colon == std::string::npos ? server : server.substr(0, colon);
+    uint16_t port = colon == std::string::npos
+        ? 6379 : static_cast<uint16_t>(std::stoul(server.substr(colon + 1)));
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (fd < 0 || inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1 ||
+        connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+// PUT the keys to a running server in pipelined batches and measure the
+// growth of its RSS. Each trial writes its own key range.
+MemoryReport loadServer(const Options& options, const Layout& layout, unsigned trial) {
+    MemoryReport report;
+    report.heap_bytes = -1;
+
+    int fd = connectTo(options.server);
+    if (fd < 0) {
+        std::cerr << "Cannot connect to " << options.server << std::endl;
+        return report;
+    }
+
+    constexpr uint64_t batch = 1000;
+    std::string value = kvstore::makeValue(layout.value_size);
+    int64_t rss_before = residentBytes(options.server_pid);
+
+    bool ok = true;
+    for (uint64_t start = 0; ok && start < options.keys; start += batch) {
+        uint64_t end = std::min(options.keys, start + batch);
+        std::string requests;
+        for (uint64_t i = start; i < end; ++i) {
+            requests += "PUT " + kvstore::formatKey(i, layout.key_size, "mem" + std::to_string(trial) + "_") + " " + value + "\n";
+        }
+        ok = send(fd, requests.data(), requests.size(), MSG_NOSIGNAL) ==
+             static_cast<ssize_t>(requests.size());
+
+        // One reply line per PUT
+        uint64_t replies = 0;
+        char buffer[4096];
+        while (ok && replies < end - start) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            ok = n > 0;
+            for (ssize_t j = 0; j < n; ++j) {
+                if (buffer[j] == '\n') {
+                    replies++;
+                }
+            }
+        }
+        report.items = end;
+    }
+    close(fd);
+
+    report.rss_bytes = residentBytes(options.server_pid) - rss_before;
+    report.ok = ok;
+    return report;
+}
+
+MemoryReport runIsolated(const Options& options, const std::string& target, const Layout& layout) {
+    int fds[2];
+    MemoryReport report;
+    if (pipe(fds) != 0) {
+        return report;
+    }
+
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        return report;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        MemoryReport child = loadLocal(options, target, layout);
+        ssize_t written = write(fds[1], &child, sizeof(child));
+        // Skip tearing the map down
+        _exit(written == sizeof(child) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    if (read(fds[0], &report, sizeof(report)) != sizeof(report)) {
+        report.ok = false;
+    }
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    report.ok = report.ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    return report;
+}
+
+double perKey(int64_t bytes, uint64_t keys) {
+    return static_cast<double>(bytes) / static_cast<double>(keys);
+}
+
+void printHeader() {
+    std::cout << std::left << std::setw(8) << "Target" << std::right
+              << std::setw(6) << "Key" << std::setw(8) << "Value"
+              << std::setw(10) << "Segments" << std::setw(11) << "RSS(MB)"
+              << std::setw(11) << "RSS/key" << std::setw(11) << "Heap/key"
+              << std::setw(10) << "Payload" << std::setw(11) << "Overhead"
+              << std::setw(12) << "Blocks/key" << std::endl;
+}
+
+void printRow(const Result& result, uint64_t keys) {
+    const auto& report = result.report;
+    size_t payload = result.layout.key_size + result.layout.value_size;
+    double rss = perKey(report.rss_bytes, keys);
+
+    std::cout << std::left << std::setw(8) << result.target << std::right
+              << std::setw(6) << result.layout.key_size
+              << std::setw(8) << result.layout.value_size
+              << std::setw(10) << (result.segments > 0 ? std::to_string(result.segments) : "-")
+              << std::fixed << std::setprecision(1)
+              << std::setw(11) << report.rss_bytes / (1024.0 * 1024.0)
+              << std::setw(11) << rss;
+    if (report.heap_bytes >= 0) {
+        double heap = perKey(report.heap_bytes, keys);
+        std::cout << std::setw(11) << heap << std::setw(10) << payload
+                  << std::setw(11) << heap - payload
+                  << std::setw(12) << perKey(report.heap_blocks, keys);
+    } else {
+        // Only RSS is visible from outside the server
+        std::cout << std::setw(11) << "-" << std::setw(10) << payload
+                  << std::setw(11) << rss - payload << std::setw(12) << "-";
+    }
+    std::cout << std::endl;
+}
+
+void writeJson(const Options& options, const std::vector<Result>& results) {
+    std::ofstream out(options.json_file);
+    out << std::fixed << std::setprecision(3)
+        << "{\n  \"keys\": " << options.keys << ",\n  \"results\": [";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        const auto& report = result.report;
+        size_t payload = result.layout.key_size + result.layout.value_size;
+        double basis = report.heap_bytes >= 0 ? perKey(report.heap_bytes, options.keys)
+                                              : perKey(report.rss_bytes, options.keys);
+
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"target\": \"" << result.target << "\""
+            << ", \"key_size\": " << result.layout.key_size
+            << ", \"value_size\": " << result.layout.value_size
+            << ", \"segments\": " << result.segments
+            << ", \"rss_bytes\": " << report.rss_bytes
+            << ", \"rss_per_key\": " << perKey(report.rss_bytes, options.keys)
+            << ", \"heap_bytes\": " << report.heap_bytes
+            << ", \"heap_per_key\": "
+            << (report.heap_bytes >= 0 ? perKey(report.heap_bytes, options.keys) : -1.0)
+            << ", \"heap_blocks_per_key\": "
+            << (report.heap_bytes >= 0 ? perKey(report.heap_blocks, options.keys) : -1.0)
+            << ", \"payload_per_key\": " << payload
+            << ", \"overhead_per_key\": " << basis - payload << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        if (!parseOptions(argc, argv, options)) {
+            usage(argv[0]);
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::cout << "Memory per key, " << options.keys << " keys\n" << std::endl;
+    printHeader();
+
+    std::vector<Result> results;
+    std::vector<std::string> targets = options.server.empty()
+        ? options.targets : std::vector<std::string>{"server"};
+
+    kvstore::BenchmarkBaseline baseline;
+    for (const auto& target : targets) {
+        for (const auto& layout : options.sizes) {
+            std::string name = target + "/key:" + std::to_string(layout.key_size) +
+                               "/value:" + std::to_string(layout.value_size);
+
+            for (unsigned trial = 0; trial < options.trials; ++trial) {
+                Result result{target, layout, target == "server" ? 0 : segmentCount(options), {}};
+                result.report = target == "server" ? loadServer(options, layout, trial)
+                                                   : runIsolated(options, target, layout);
+                if (!result.report.ok || result.report.items != options.keys) {
+                    std::cerr << "Loading " << target << " failed" << std::endl;
+                    return 1;
+                }
+                printRow(result, options.keys);
+                results.push_back(result);
+
+                baseline.add(name + "/rss_per_key",
+                             perKey(result.report.rss_bytes, options.keys), false);
+                if (result.report.heap_bytes >= 0) {
+                    baseline.add(name + "/heap_per_key",
+                                 perKey(result.report.heap_bytes, options.keys), false);
+                }
+            }
+        }
+    }
+
+    if (!options.json_file.empty()) {
+        writeJson(options, results);
+    }
+    return baseline.saveOrCompare(options.save_baseline, options.compare_baseline,
+                                  options.threshold);
+}
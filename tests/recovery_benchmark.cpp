@@ -0,0 +1,469 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <filesystem>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "kv_engine.hpp"
+#include "config.hpp"
+#include "workload.hpp"
+#include "benchmark_baseline.hpp"
+
+// Recovery-time benchmark. Generates a data set of --keys distinct keys
+// through KVEngine, where --overwrite percent of all writes rewrite an
+// existing key and a checkpoint is taken after --snapshot percent of the
+// writes, then restarts on it --runs times and reports:
+//
+//   recovery   engine construction: snapshot load plus WAL replay
+//   first      until the first GET is answered
+//   peak RSS   high-water mark of the recovering process
+//
+// Generation and every recovery run in child processes, so each peak RSS
+// covers one recovery alone. With --server the recovering process is
+// kv_server itself, and "first" is measured over TCP from exec to the
+// first reply. Recovery blocks startup, so first request and full
+// recovery currently differ only by process and listener start-up.
+//
+//   recovery_benchmark --keys 10000000 --overwrite 80 --snapshot 50 --dir /mnt/data
+//
+// With --save-baseline and --compare the runs are checked for
+// significant regressions against an earlier invocation.
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    std::string dir = ".";
+    uint64_t keys = 1000000;
+    unsigned overwrite_pct = 50;
+    unsigned snapshot_pct = 50;
+    size_t key_size = 16;
+    size_t value_size = 100;
+    size_t segments = 0;            // 0 = one per 8 keys
+    unsigned runs = 3;
+    std::string server;
+    uint16_t port = 6390;
+    std::string json_file;
+    std::string save_baseline;
+    std::string compare_baseline;
+    double threshold = 0.05;
+};
+
+// Sent from a recovering child to the parent over a pipe
+struct RecoveryReport {
+    bool ok = false;
+    double recovery_ms = 0.0;
+    double first_ms = 0.0;
+    double snapshot_ms = 0.0;
+    double wal_ms = 0.0;
+    uint64_t snapshot_records = 0;
+    uint64_t wal_records = 0;
+    uint64_t items = 0;
+    uint64_t peak_rss_kb = 0;
+};
+
+double millisSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void usage(const char* program) {
+    std::cerr
+        << "Usage: " << program << " [options]\n"
+        << "  --dir DIR          Directory for the WAL and snapshot (.)\n"
+        << "  --keys N           Distinct keys (1000000)\n"
+        << "  --overwrite PCT    Writes that overwrite an existing key, 0-99 (50)\n"
+        << "  --snapshot PCT     Writes covered by the snapshot, 0-100 (50)\n"
+        << "  --key-size BYTES   Key size (16)\n"
+        << "  --value-size BYTES Value size (100)\n"
+        << "  --segments N       Hash map segments (keys / 8)\n"
+        << "  --runs N           Recoveries to time (3)\n"
+        << "  --server PATH      Recover in this kv_server binary instead\n"
+        << "  --port PORT        Port for --server (6390)\n"
+        << "  --json FILE        Also write the results as JSON\n"
+        << "  --save-baseline F  Save the per-run results as a baseline\n"
+        << "  --compare F        Flag significant regressions against a baseline\n"
+        << "  --threshold PCT    Smallest change --compare reports (5)\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--dir") {
+            options.dir = value;
+        } else if (arg == "--keys") {
+            options.keys = std::stoull(value);
+        } else if (arg == "--overwrite") {
+            options.overwrite_pct = std::stoul(value);
+        } else if (arg == "--snapshot") {
+            options.snapshot_pct = std::stoul(value);
+        } else if (arg == "--key-size") {
+            options.key_size = std::stoul(value);
+        } else if (arg == "--value-size") {
+            options.value_size = std::stoul(value);
+        } else if (arg == "--segments") {
+            options.segments = std::stoul(value);
+        } else if (arg == "--runs") {
+            options.runs = std::stoul(value);
+        } else if (arg == "--server") {
+            options.server = value;
+        } else if (arg == "--port") {
+            options.port = static_cast<uint16_t>(std::stoul(value));
+        } else if (arg == "--json") {
+            options.json_file = value;
+        } else if (arg == "--save-baseline") {
+            options.save_baseline = value;
+        } else if (arg == "--compare") {
+            options.compare_baseline = value;
+        } else if (arg == "--threshold") {
+            options.threshold = std::stod(value) / 100.0;
+        } else {
+            return false;
+        }
+    }
+    return options.keys > 0 && options.overwrite_pct < 100 && options.snapshot_pct <= 100;
+}
+
+kvstore::Config engineConfig(const Options& options) {
+    kvstore::Config config;
+    config.wal_file = (fs::path(options.dir) / "recovery_benchmark.wal").string();
+    config.num_segments = options.segments > 0 ? options.segments
+                                               : std::max<size_t>(options.keys / 8, 64);
+    config.server_port = options.port;
+    config.sync_wal = false;
+    config.checkpoint_wal_size = 0;
+    config.expiry_sweep_interval_ms = 0;
+    config.max_key_size = std::max(config.max_key_size, options.key_size);
+    config.max_value_size = std::max(config.max_value_size, options.value_size);
+    return config;
+}
+
+uint64_t totalWrites(const Options& options) {
+    return options.keys * 100 / (100 - options.overwrite_pct);
+}
+
+// Write the data set. New keys are spread evenly through the writes, and
+// each overwrite picks one of the keys written so far.
+void generate(const Options& options) {
+    kvstore::KVEngine engine(engineConfig(options));
+    std::mt19937_64 rng(42);
+
+    uint64_t writes = totalWrites(options);
+    uint64_t checkpoint_at = writes * options.snapshot_pct / 100;
+    uint64_t inserted = 0;
+
+    for (uint64_t w = 0; w < writes; ++w) {
+        if (w == checkpoint_at && w > 0) {
+            engine.checkpoint();
+        }
+
+        uint64_t index;
+        if (inserted < (w + 1) * options.keys / writes) {
+            index = inserted++;
+        } else {
+            index = kvstore::UniformGenerator(inserted).next(rng);
+        }
+        engine.put(kvstore::formatKey(index, options.key_size),
+                   kvstore::makeValue(options.value_size, w));
+    }
+
+    if (checkpoint_at == writes) {
+        engine.checkpoint();
+    }
+}
+
+// Fork, run fn in the child and return its exit status and resource usage
+template<typename Fn>
+bool runChild(Fn fn, struct rusage& usage) {
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        return false;
+    }
+    if (pid == 0) {
+        fn();
+        _exit(0);
+    }
+
+    int status = 0;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+RecoveryReport recoverInProcess(const Options& options) {
+    int fds[2];
+    RecoveryReport report;
+    if (pipe(fds) != 0) {
+        return report;
+    }
+
+    struct rusage usage {};
+    bool exited = runChild([&]() {
+        close(fds[0]);
+        RecoveryReport child;
+
+        auto started = Clock::now();
+        auto* engine = new kvstore::KVEngine(engineConfig(options));
+        child.recovery_ms = millisSince(started);
+
+        std::string value;
+        engine->get(kvstore::formatKey(0, options.key_size), value);
+        child.first_ms = millisSince(started);
+
+        const auto& stats = engine->getRecoveryStatistics();
+        child.snapshot_ms = stats.snapshot_ms;
+        child.wal_ms = stats.wal_ms;
+        child.snapshot_records = stats.snapshot_records;
+        child.wal_records = stats.wal_records;
+        child.items = engine->size();
+        child.ok = true;
+
+        // Report and exit without tearing the map down
+        ssize_t written = write(fds[1], &child, sizeof(child));
+        _exit(written == sizeof(child) ? 0 : 1);
+    }, usage);
+
+    close(fds[1]);
+    if (read(fds[0], &report, sizeof(report)) != sizeof(report)) {
+        report.ok = false;
+    }
+    close(fds[0]);
+
+    report.ok = report.ok && exited;
+    report.peak_rss_kb = static_cast<uint64_t>(usage.ru_maxrss);
+    return report;
+}
+
+// Send one GET; true once any reply line arrives
+bool tryRequest(uint16_t port, const std::string& key) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    bool replied = false;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+        std::string request = "GET " + key + "\n";
+        char c;
+        if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) ==
+                static_cast<ssize_t>(request.size())) {
+            while (recv(fd, &c, 1, 0) == 1) {
+                if (c == '\n') {
+                    replied = true;
+                    break;
+                }
+            }
+        }
+    }
+    close(fd);
+    return replied;
+}
+
+RecoveryReport recoverInServer(const Options& options) {
+    RecoveryReport report;
+    std::string config_file = (fs::path(options.dir) / "recovery_benchmark.conf").string();
+    kvstore::ConfigManager::saveToFile(engineConfig(options), config_file);
+
+    std::cout.flush();
+    auto started = Clock::now();
+    pid_t pid = fork();
+    if (pid < 0) {
+        return report;
+    }
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        execl(options.server.c_str(), options.server.c_str(), config_file.c_str(),
+              static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    std::string key = kvstore::formatKey(0, options.key_size);
+    int status = 0;
+    while (true) {
+        if (tryRequest(options.port, key)) {
+            report.first_ms = millisSince(started);
+            report.ok = true;
+            break;
+        }
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            std::cerr << "kv_server exited during recovery" << std::endl;
+            fs::remove(config_file);
+            return report;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // The server listens only once recovery is complete
+    report.recovery_ms = report.first_ms;
+
+    struct rusage usage {};
+    kill(pid, SIGTERM);
+    wait4(pid, &status, 0, &usage);
+    report.peak_rss_kb = static_cast<uint64_t>(usage.ru_maxrss);
+
+    fs::remove(config_file);
+    return report;
+}
+
+void printHeader() {
+    std::cout << std::left << std::setw(5) << "Run" << std::right
+              << std::setw(12) << "Snap recs" << std::setw(12) << "WAL recs"
+              << std::setw(12) << "Snap(ms)" << std::setw(12) << "WAL(ms)"
+              << std::setw(14) << "Recovery(ms)" << std::setw(12) << "First(ms)"
+              << std::setw(14) << "Peak RSS(MB)" << std::endl;
+}
+
+void printRow(unsigned run, const RecoveryReport& report, bool server) {
+    std::cout << std::left << std::setw(5) << run << std::right << std::fixed;
+    if (server) {
+        std::cout << std::setw(12) << "-" << std::setw(12) << "-"
+                  << std::setw(12) << "-" << std::setw(12) << "-";
+    } else {
+        std::cout << std::setw(12) << report.snapshot_records
+                  << std::setw(12) << report.wal_records << std::setprecision(1)
+                  << std::setw(12) << report.snapshot_ms << std::setw(12) << report.wal_ms;
+    }
+    std::cout << std::setprecision(1)
+              << std::setw(14) << report.recovery_ms << std::setw(12) << report.first_ms
+              << std::setw(14) << report.peak_rss_kb / 1024.0 << std::endl;
+}
+
+void writeJson(const Options& options, uint64_t wal_bytes, uint64_t snapshot_bytes,
+               double generate_seconds, const std::vector<RecoveryReport>& reports) {
+    std::ofstream out(options.json_file);
+    out << std::fixed << std::setprecision(3)
+        << "{\n  \"target\": \"" << (options.server.empty() ? "engine" : "server") << "\",\n"
+        << "  \"keys\": " << options.keys << ",\n"
+        << "  \"writes\": " << totalWrites(options) << ",\n"
+        << "  \"overwrite_pct\": " << options.overwrite_pct << ",\n"
+        << "  \"snapshot_pct\": " << options.snapshot_pct << ",\n"
+        << "  \"key_size\": " << options.key_size << ",\n"
+        << "  \"value_size\": " << options.value_size << ",\n"
+        << "  \"wal_bytes\": " << wal_bytes << ",\n"
+        << "  \"snapshot_bytes\": " << snapshot_bytes << ",\n"
+        << "  \"generate_seconds\": " << generate_seconds << ",\n"
+        << "  \"runs\": [";
+
+    for (size_t i = 0; i < reports.size(); ++i) {
+        const auto& report = reports[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"recovery_ms\": " << report.recovery_ms
+            << ", \"first_request_ms\": " << report.first_ms
+            << ", \"snapshot_ms\": " << report.snapshot_ms
+            << ", \"wal_ms\": " << report.wal_ms
+            << ", \"snapshot_records\": " << report.snapshot_records
+            << ", \"wal_records\": " << report.wal_records
+            << ", \"items\": " << report.items
+            << ", \"peak_rss_kb\": " << report.peak_rss_kb << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+uint64_t fileSize(const std::string& file) {
+    std::error_code ec;
+    auto size = fs::file_size(file, ec);
+    return ec ? 0 : size;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        if (!parseOptions(argc, argv, options)) {
+            usage(argv[0]);
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        usage(argv[0]);
+        return 1;
+    }
+
+    auto config = engineConfig(options);
+    std::string snapshot_file = config.wal_file + ".snapshot";
+    fs::remove(config.wal_file);
+    fs::remove(snapshot_file);
+
+    std::cout << "Generating " << options.keys << " keys, " << totalWrites(options)
+              << " writes (" << options.overwrite_pct << "% overwrites, "
+              << options.snapshot_pct << "% in the snapshot)..." << std::endl;
+
+    struct rusage usage {};
+    auto started = Clock::now();
+    if (!runChild([&]() { generate(options); }, usage)) {
+        std::cerr << "Generation failed" << std::endl;
+        return 1;
+    }
+    double generate_seconds = millisSince(started) / 1000.0;
+
+    uint64_t wal_bytes = fileSize(config.wal_file);
+    uint64_t snapshot_bytes = fileSize(snapshot_file);
+    std::cout << std::fixed << std::setprecision(1)
+              << "Generated in " << generate_seconds << "s: WAL "
+              << wal_bytes / (1024.0 * 1024.0) << " MB, snapshot "
+              << snapshot_bytes / (1024.0 * 1024.0) << " MB\n" << std::endl;
+
+    std::string scenario = std::string(options.server.empty() ? "engine" : "server") +
+        "/keys:" + std::to_string(options.keys) +
+        "/overwrite:" + std::to_string(options.overwrite_pct) +
+        "/snapshot:" + std::to_string(options.snapshot_pct) + "/";
+
+    printHeader();
+    std::vector<RecoveryReport> reports;
+    kvstore::BenchmarkBaseline baseline;
+    for (unsigned run = 1; run <= options.runs; ++run) {
+        auto report = options.server.empty() ? recoverInProcess(options)
+                                             : recoverInServer(options);
+        if (!report.ok) {
+            std::cerr << "Recovery run " << run << " failed" << std::endl;
+            return 1;
+        }
+        if (options.server.empty() && report.items != options.keys) {
+            std::cerr << "Recovered " << report.items << " keys, expected "
+                      << options.keys << std::endl;
+            return 1;
+        }
+        printRow(run, report, !options.server.empty());
+        reports.push_back(report);
+
+        baseline.add(scenario + "recovery_ms", report.recovery_ms, false);
+        baseline.add(scenario + "first_request_ms", report.first_ms, false);
+        baseline.add(scenario + "peak_rss_kb", static_cast<double>(report.peak_rss_kb), false);
+    }
+
+    if (!options.json_file.empty()) {
+        writeJson(options, wal_bytes, snapshot_bytes, generate_seconds, reports);
+    }
+
+    fs::remove(config.wal_file);
+    fs::remove(snapshot_file);
+    return baseline.saveOrCompare(options.save_baseline, options.compare_baseline,
+                                  options.threshold);
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "benchmark_baseline.hpp"
+
+using kvstore::BenchmarkBaseline;
+using kvstore::SampleSummary;
+
+TEST(BenchmarkBaselineTest, SummaryConfidenceInterval) {
+    auto summary = SampleSummary::of({10.0, 12.0, 14.0});
+
+    EXPECT_EQ(summary.count, 3);
+    EXPECT_DOUBLE_EQ(summary.mean, 12.0);
+    EXPECT_DOUBLE_EQ(summary.stddev, 2.0);
+    // t(0.975, 2) * 2 / sqrt(3)
+    EXPECT_NEAR(summary.ci95, 4.303 * 2.0 / std::sqrt(3.0), 1e-9);
+
+    auto single = SampleSummary::of({5.0});
+    EXPECT_DOUBLE_EQ(single.mean, 5.0);
+    EXPECT_DOUBLE_EQ(single.ci95, 0.0);
+}
+
+TEST(BenchmarkBaselineTest, NoiseIsNotARegression) {
+    BenchmarkBaseline before, after;
+    for (double value : {100.0, 80.0, 120.0, 95.0, 105.0}) {
+        before.add("ops", value, true);
+    }
+    for (double value : {90.0, 110.0, 75.0, 100.0, 98.0}) {
+        after.add("ops", value, true);
+    }
+
+    auto comparisons = after.compare(before, 0.05);
+    ASSERT_EQ(comparisons.size(), 1);
+    EXPECT_EQ(comparisons[0].verdict, BenchmarkBaseline::Verdict::UNCHANGED);
+}
+
+TEST(BenchmarkBaselineTest, DirectionDecidesVerdict) {
+    BenchmarkBaseline before, after;
+    for (double value : {100.0, 101.0, 99.0, 100.5, 99.5}) {
+        before.add("ops", value, true);
+        before.add("p99", value, false);
+    }
+    for (double value : {80.0, 81.0, 79.0, 80.5, 79.5}) {
+        after.add("ops", value, true);
+        after.add("p99", value, false);
+    }
+    after.add("new_metric", 1.0, true);
+
+    auto comparisons = after.compare(before, 0.05);
+    ASSERT_EQ(comparisons.size(), 3);
+    EXPECT_EQ(comparisons[0].name, "new_metric");
+    EXPECT_EQ(comparisons[0].verdict, BenchmarkBaseline::Verdict::NEW);
+    EXPECT_EQ(comparisons[1].verdict, BenchmarkBaseline::Verdict::REGRESSED);
+    EXPECT_NEAR(comparisons[1].change, -0.2, 1e-9);
+    EXPECT_EQ(comparisons[2].verdict, BenchmarkBaseline::Verdict::IMPROVED);
+
+    // Significant but below the threshold
+    EXPECT_EQ(after.compare(before, 0.5)[1].verdict, BenchmarkBaseline::Verdict::UNCHANGED);
+}
+
+TEST(BenchmarkBaselineTest, SaveAndLoad) {
+    const std::string file = "test_baseline.json";
+    BenchmarkBaseline saved;
+    saved.add("fsync/threads:4/records_per_sec", 12345.5, true);
+    saved.add("fsync/threads:4/records_per_sec", 12000.25, true);
+    saved.add("recovery_ms", 250.0, false);
+    ASSERT_TRUE(saved.save(file));
+
+    BenchmarkBaseline loaded;
+    ASSERT_TRUE(loaded.load(file));
+    std::remove(file.c_str());
+
+    const auto& metrics = loaded.getMetrics();
+    ASSERT_EQ(metrics.size(), 2);
+    const auto& throughput = metrics.at("fsync/threads:4/records_per_sec");
+    EXPECT_TRUE(throughput.higher_is_better);
+    EXPECT_EQ(throughput.samples, (std::vector<double>{12345.5, 12000.25}));
+    EXPECT_FALSE(metrics.at("recovery_ms").higher_is_better);
+
+    EXPECT_FALSE(loaded.load("missing_baseline.json"));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
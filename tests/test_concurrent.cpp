@@ -2,6 +2,7 @@
 #include <thread>
 #include <vector>
 #include <atomic>
+#include <optional>
 #include "concurrent_hash_map.hpp"
 
 class ConcurrentHashMapTest : public ::testing::Test {
@@ -124,6 +125,125 @@ TEST_F(ConcurrentHashMapTest, ForEachVisitor) {
     EXPECT_EQ(count, 3);
 }
 
+TEST_F(ConcurrentHashMapTest, Resize) {
+    for (int i = 0; i < 1000; ++i) {
+        map.insert("resize_key_" + std::to_string(i), std::to_string(i));
+    }
+    
+    EXPECT_TRUE(map.resize(1024));
+    EXPECT_FALSE(map.resize(1024));
+    EXPECT_EQ(map.bucketCount(), 1024);
+    EXPECT_EQ(map.size(), 1003);
+    EXPECT_EQ(map.getStatistics().resizes, 1);
+    
+    // With no operation in flight the old table is freed right away
+    EXPECT_EQ(map.getStatistics().retired_tables, 0);
+    
+    EXPECT_TRUE(map.resize(8));
+    EXPECT_EQ(map.getStatistics().retired_tables, 0);
+    std::string value;
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(map.find("resize_key_" + std::to_string(i), value));
+        EXPECT_EQ(value, std::to_string(i));
+    }
+    EXPECT_TRUE(map.find("key1", value));
+}
+
+TEST_F(ConcurrentHashMapTest, ResizeUnderConcurrentLoad) {
+    const int num_threads = 4;
+    const int num_operations = 20000;
+    
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    
+    // Each thread owns its keys, so it knows what it must read back
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < num_operations; ++i) {
+                std::string key = "t" + std::to_string(t) + "_" + std::to_string(i % 500);
+                map.compute(key, [&](std::optional<std::string>& current) {
+                    current = std::to_string(i);
+                });
+                
+                std::string value;
+                ASSERT_TRUE(map.find(key, value));
+                ASSERT_EQ(value, std::to_string(i));
+            }
+        });
+    }
+    
+    std::thread resizer([&]() {
+        size_t counts[] = {128, 2, 4096, 16};
+        for (int i = 0; !done; ++i) {
+            map.resize(counts[i % 4]);
+            std::this_thread::yield();
+        }
+    });
+    
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    done = true;
+    resizer.join();
+    
+    EXPECT_EQ(map.size(), 3 + num_threads * 500);
+    EXPECT_GT(map.getStatistics().resizes, 0);
+    
+    // Tables retired while operations were in flight go once they finish
+    std::string value;
+    EXPECT_TRUE(map.find("key1", value));
+    EXPECT_EQ(map.getStatistics().retired_tables, 0);
+    
+    auto locks = map.getLockStatistics();
+    EXPECT_GE(locks.acquisitions, static_cast<uint64_t>(num_threads * num_operations * 2));
+    EXPECT_LE(locks.contended, locks.acquisitions);
+}
+
+TEST_F(ConcurrentHashMapTest, WeightTracksEveryChange) {
+    struct ValueBytes {
+        size_t operator()(const std::string&, const std::string& value) const {
+            return value.size();
+        }
+    };
+    kvstore::ConcurrentHashMap<std::string, std::string, kvstore::StringHasher, ValueBytes>
+        weighed(4);
+    
+    weighed.insert("a", "12345");
+    weighed.insert("b", "123");
+    EXPECT_EQ(weighed.weight(), 8);
+    weighed.insert("a", "1");
+    EXPECT_EQ(weighed.weight(), 4);
+    weighed.compute("b", [](std::optional<std::string>& current) {
+        *current += "4567";
+    });
+    weighed.compute("c", [](std::optional<std::string>& current) {
+        current = "12";
+    });
+    EXPECT_EQ(weighed.weight(), 10);
+    weighed.compute("b", [](std::optional<std::string>& current) {
+        current.reset();
+    });
+    weighed.erase("a");
+    EXPECT_EQ(weighed.weight(), 2);
+    
+    weighed.resize(64);
+    EXPECT_EQ(weighed.weight(), 2);
+    weighed.clear();
+    EXPECT_EQ(weighed.weight(), 0);
+    EXPECT_EQ(map.weight(), 0);     // The default weighs nothing
+}
+
+TEST_F(ConcurrentHashMapTest, SampleKey) {
+    std::string key;
+    for (uint64_t seed = 0; seed < 100; ++seed) {
+        ASSERT_TRUE(map.sampleKey(seed * 0x9e3779b97f4a7c15ULL, key));
+        EXPECT_TRUE(map.exists(key));
+    }
+    
+    map.clear();
+    EXPECT_FALSE(map.sampleKey(42, key));
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,1656 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <set>
+#include <map>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+#include "kv_engine.hpp"
+#include "config.hpp"
+#include "kvstore.h"
+
+namespace fs = std::filesystem;
+
+class KVEngineTest : public ::testing::Test {
+protected:
+    kvstore::Config config;
+
+    void SetUp() override {
+        config.wal_file = "test_engine.wal";
+        config.num_segments = 16;
+        config.sync_wal = false;
+        config.expiry_sweep_interval_ms = 0;
+        removeFiles();
+    }
+
+    void TearDown() override {
+        removeFiles();
+    }
+
+    void removeFiles() {
+        for (const auto& file : {config.wal_file, config.wal_file + ".snapshot",
+                                 config.wal_file + ".snapshot.tmp"}) {
+            if (fs::exists(file)) {
+                fs::remove(file);
+            }
+        }
+    }
+};
+
+TEST_F(KVEngineTest, BasicOperations) {
+    kvstore::KVEngine engine(config);
+    std::string value;
+
+    EXPECT_EQ(engine.put("key1", "value1"), kvstore::Status::OK);
+    EXPECT_TRUE(engine.get("key1", value));
+    EXPECT_EQ(value, "value1");
+    EXPECT_TRUE(engine.exists("key1"));
+    EXPECT_EQ(engine.size(), 1);
+
+    EXPECT_EQ(engine.erase("key1"), kvstore::Status::OK);
+    EXPECT_EQ(engine.erase("key1"), kvstore::Status::NOT_FOUND);
+    EXPECT_FALSE(engine.get("key1", value));
+}
+
+TEST_F(KVEngineTest, GetRange) {
+    kvstore::KVEngine engine(config);
+    engine.put("key1", "0123456789");
+
+    std::string chunk;
+    size_t total = 0;
+    EXPECT_TRUE(engine.getRange("key1", 3, 4, chunk, total));
+    EXPECT_EQ(chunk, "3456");
+    EXPECT_EQ(total, 10);
+
+    EXPECT_TRUE(engine.getRange("key1", 20, 4, chunk, total));
+    EXPECT_TRUE(chunk.empty());
+}
+
+TEST_F(KVEngineTest, Expiry) {
+    kvstore::KVEngine engine(config);
+    std::string value;
+
+    engine.put("short", "value", 20);
+    engine.put("plain", "value");
+    EXPECT_GT(engine.ttl("short"), 0);
+    EXPECT_EQ(engine.ttl("plain"), -1);
+    EXPECT_EQ(engine.ttl("missing"), -2);
+    EXPECT_EQ(engine.expire("missing", 1000), kvstore::Status::NOT_FOUND);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    EXPECT_FALSE(engine.get("short", value));
+    EXPECT_FALSE(engine.exists("short"));
+    EXPECT_EQ(engine.ttl("short"), -2);
+
+    EXPECT_EQ(engine.purgeExpired(), 1);
+    EXPECT_EQ(engine.size(), 1);
+
+    // A plain PUT clears an earlier expiry
+    engine.put("plain", "value", 20);
+    engine.put("plain", "value");
+    EXPECT_EQ(engine.ttl("plain"), -1);
+}
+
+TEST_F(KVEngineTest, RecoversFromWAL) {
+    {
+        kvstore::KVEngine engine(config);
+        engine.put("key1", "value1");
+        engine.put("key2", "value2");
+        engine.erase("key1");
+        engine.put("key3", "value3", 60000);
+    }
+
+    kvstore::KVEngine engine(config);
+    std::string value;
+    EXPECT_FALSE(engine.get("key1", value));
+    EXPECT_TRUE(engine.get("key2", value));
+    EXPECT_EQ(value, "value2");
+    EXPECT_GT(engine.ttl("key3"), 0);
+    EXPECT_EQ(engine.size(), 2);
+}
+
+TEST_F(KVEngineTest, CheckpointTruncatesWAL) {
+    {
+        kvstore::KVEngine engine(config);
+        for (int i = 0; i < 100; ++i) {
+            engine.put("key" + std::to_string(i), "old");
+        }
+        for (int i = 0; i < 100; ++i) {
+            engine.put("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+
+        EXPECT_TRUE(engine.checkpoint());
+        EXPECT_EQ(engine.getStatistics().wal_size, 0);
+        EXPECT_EQ(engine.getStatistics().checkpoints, 1);
+
+        // Writes after the checkpoint land in the fresh WAL
+        engine.put("key0", "updated");
+        engine.erase("key1");
+    }
+
+    EXPECT_TRUE(fs::exists(config.wal_file + ".snapshot"));
+
+    kvstore::KVEngine engine(config);
+    EXPECT_EQ(engine.getRecoveryStatistics().snapshot_records, 100);
+    EXPECT_EQ(engine.getRecoveryStatistics().wal_records, 2);
+
+    std::string value;
+    EXPECT_EQ(engine.size(), 99);
+    EXPECT_TRUE(engine.get("key0", value));
+    EXPECT_EQ(value, "updated");
+    EXPECT_FALSE(engine.get("key1", value));
+    EXPECT_TRUE(engine.get("key50", value));
+    EXPECT_EQ(value, "value50");
+}
+
+TEST_F(KVEngineTest, CheckpointSyncsSnapshotBeforeClearingWAL) {
+    kvstore::KVEngine engine(config);
+    engine.put("key", "value");
+    EXPECT_EQ(engine.getStatistics().fsyncs, 0);
+
+    // One fsync for the snapshot file, one for its directory
+    EXPECT_TRUE(engine.checkpoint());
+    EXPECT_EQ(engine.getStatistics().fsyncs, 2);
+    EXPECT_EQ(engine.getStatistics().wal_size, 0);
+}
+
+TEST_F(KVEngineTest, FsyncWritesSyncBeforeReturning) {
+    {
+        kvstore::KVEngine engine(config);
+        engine.put("key", "value");
+        EXPECT_EQ(engine.getStatistics().fsyncs, 0);
+    }
+
+    config.fsync_writes = true;
+    kvstore::KVEngine engine(config);
+    engine.put("key", "updated");
+    EXPECT_EQ(engine.getStatistics().fsyncs, 1);
+
+    // One fsync per logged entry: the value and its deadline
+    engine.put("session", "value", 60000);
+    EXPECT_EQ(engine.getStatistics().fsyncs, 3);
+}
+
+TEST_F(KVEngineTest, SequenceSurvivesValueBytesAcrossReopens) {
+    // The next WAL sequence must come from the entries, not from bytes
+    // that merely look like one: a value of 0xff bytes once made it wrap
+    // to 0, below the snapshot's cut, and the next reopen skipped the
+    // writes made after it
+    kvstore_engine* engine = kvstore_open(config.wal_file.c_str(), 16, 0);
+    ASSERT_NE(engine, nullptr);
+    EXPECT_EQ(kvstore_put(engine, "k1", 2, "v1", 2, 0), KVSTORE_OK);
+    EXPECT_EQ(kvstore_checkpoint(engine), KVSTORE_OK);
+    EXPECT_EQ(kvstore_put(engine, "k2", 2, "\xfe\xff\xff\xff\xff\xff\xff\xff", 8, 0),
+              KVSTORE_OK);
+    kvstore_close(engine);
+
+    engine = kvstore_open(config.wal_file.c_str(), 16, 0);
+    ASSERT_NE(engine, nullptr);
+    EXPECT_EQ(kvstore_put(engine, "k3", 2, "v3", 2, 0), KVSTORE_OK);
+    EXPECT_EQ(kvstore_put(engine, "k4", 2, std::string(64, '\xff').data(), 64, 0),
+              KVSTORE_OK);
+    kvstore_close(engine);
+
+    engine = kvstore_open(config.wal_file.c_str(), 16, 0);
+    ASSERT_NE(engine, nullptr);
+    EXPECT_EQ(kvstore_put(engine, "k5", 2, "v5", 2, 0), KVSTORE_OK);
+    kvstore_close(engine);
+
+    engine = kvstore_open(config.wal_file.c_str(), 16, 0);
+    ASSERT_NE(engine, nullptr);
+    for (const char* key : {"k1", "k2", "k3", "k4", "k5"}) {
+        EXPECT_EQ(kvstore_exists(engine, key, 2), 1) << key;
+    }
+    EXPECT_EQ(kvstore_size(engine), 5);
+    kvstore_close(engine);
+}
+
+TEST_F(KVEngineTest, ClearRemovesPersistedData) {
+    {
+        kvstore::KVEngine engine(config);
+        engine.put("key1", "value1");
+        engine.checkpoint();
+        engine.put("key2", "value2");
+        engine.clear();
+        engine.put("key3", "value3");
+    }
+
+    kvstore::KVEngine engine(config);
+    std::string value;
+    EXPECT_EQ(engine.size(), 1);
+    EXPECT_TRUE(engine.get("key3", value));
+}
+
+TEST_F(KVEngineTest, ConcurrentWritesReplayInOrder) {
+    const int num_threads = 4;
+    const int num_operations = 500;
+
+    std::vector<std::string> expected(8);
+    {
+        kvstore::KVEngine engine(config);
+        std::vector<std::thread> threads;
+
+        // All threads hammer the same keys; the WAL must record the
+        // writes to each key in the order they were applied
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&, t]() {
+                for (int i = 0; i < num_operations; ++i) {
+                    engine.put("shared" + std::to_string(i % 8), std::to_string(t * num_operations + i));
+                }
+            });
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        for (int k = 0; k < 8; ++k) {
+            engine.get("shared" + std::to_string(k), expected[k]);
+        }
+    }
+
+    kvstore::KVEngine engine(config);
+    for (int k = 0; k < 8; ++k) {
+        std::string value;
+        EXPECT_TRUE(engine.get("shared" + std::to_string(k), value));
+        EXPECT_EQ(value, expected[k]);
+    }
+}
+
+TEST_F(KVEngineTest, IntegerCounters) {
+    kvstore::KVEngine engine(config);
+    int64_t result = 0;
+    std::string value;
+
+    EXPECT_EQ(engine.incrBy("hits", 1, result), kvstore::Status::OK);
+    EXPECT_EQ(result, 1);
+    EXPECT_EQ(engine.incrBy("hits", 41, result), kvstore::Status::OK);
+    EXPECT_EQ(result, 42);
+    EXPECT_EQ(engine.incrBy("hits", -50, result), kvstore::Status::OK);
+    EXPECT_EQ(result, -8);
+    EXPECT_TRUE(engine.get("hits", value));
+    EXPECT_EQ(value, "-8");
+
+    // Integer text written with PUT counts too
+    engine.put("text", "007");
+    EXPECT_EQ(engine.incrBy("text", 1, result), kvstore::Status::OK);
+    EXPECT_EQ(result, 8);
+
+    engine.put("name", "alice");
+    EXPECT_EQ(engine.incrBy("name", 1, result), kvstore::Status::NOT_INTEGER);
+    EXPECT_TRUE(engine.get("name", value));
+    EXPECT_EQ(value, "alice");
+
+    engine.put("max", std::to_string(INT64_MAX));
+    EXPECT_EQ(engine.incrBy("max", 1, result), kvstore::Status::OUT_OF_RANGE);
+    EXPECT_EQ(engine.incrBy("max", -1, result), kvstore::Status::OK);
+    EXPECT_EQ(engine.incrBy("hits", INT64_MIN, result), kvstore::Status::OUT_OF_RANGE);
+
+    // The expiry is kept
+    engine.expire("hits", 60000);
+    EXPECT_EQ(engine.incrBy("hits", 1, result), kvstore::Status::OK);
+    EXPECT_GT(engine.ttl("hits"), 0);
+}
+
+TEST_F(KVEngineTest, ConcurrentIncrementsAreAtomic) {
+    const int num_threads = 4;
+    const int num_increments = 1000;
+    {
+        kvstore::KVEngine engine(config);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&]() {
+                int64_t result;
+                for (int i = 0; i < num_increments; ++i) {
+                    engine.incrBy("counter", 1, result);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    kvstore::KVEngine engine(config);
+    std::string value;
+    EXPECT_TRUE(engine.get("counter", value));
+    EXPECT_EQ(value, std::to_string(num_threads * num_increments));
+}
+
+TEST_F(KVEngineTest, IntegerEncodingPreservesText) {
+    kvstore::KVEngine engine(config);
+
+    // Only canonical integers are encoded; everything reads back verbatim
+    for (const std::string text : {"0", "-1", "123", "9223372036854775807",
+                                   "-9223372036854775808", "007", "-0", "+5", " 5",
+                                   "9223372036854775808", "12a", ""}) {
+        engine.put("key", text);
+        std::string value;
+        EXPECT_TRUE(engine.get("key", value));
+        EXPECT_EQ(value, text);
+
+        std::string chunk;
+        size_t total = 0;
+        EXPECT_TRUE(engine.getRange("key", 1, 3, chunk, total));
+        EXPECT_EQ(total, text.size());
+        EXPECT_EQ(chunk, text.size() > 1 ? text.substr(1, 3) : "");
+    }
+}
+
+TEST_F(KVEngineTest, CountersReplayFromDeltas) {
+    int64_t result = 0;
+    {
+        kvstore::KVEngine engine(config);
+        for (int i = 0; i < 100; ++i) {
+            engine.incrBy("counter", 3, result);
+        }
+        engine.incrBy("other", -7, result);
+    }
+
+    // The first INCR is logged as a PUT, the rest as 8-byte deltas
+    size_t puts = 0, deltas = 0;
+    kvstore::WriteAheadLog wal(config.wal_file, false);
+    wal.replayEntries([&](const kvstore::WALEntry& entry) {
+        if (entry.op == kvstore::Operation::PUT) {
+            puts++;
+        } else if (entry.op == kvstore::Operation::INCR) {
+            EXPECT_EQ(entry.value.size(), sizeof(int64_t));
+            deltas++;
+        }
+    });
+    EXPECT_EQ(puts, 2);
+    EXPECT_EQ(deltas, 99);
+
+    {
+        kvstore::KVEngine engine(config);
+        std::string value;
+        EXPECT_TRUE(engine.get("counter", value));
+        EXPECT_EQ(value, "300");
+        EXPECT_TRUE(engine.get("other", value));
+        EXPECT_EQ(value, "-7");
+
+        // Checkpoints store the decimal text
+        EXPECT_TRUE(engine.checkpoint());
+        engine.incrBy("counter", 1, result);
+    }
+
+    kvstore::KVEngine engine(config);
+    std::string value;
+    EXPECT_TRUE(engine.get("counter", value));
+    EXPECT_EQ(value, "301");
+}
+
+TEST_F(KVEngineTest, PartialValueOperations) {
+    kvstore::KVEngine engine(config);
+    size_t length = 0;
+    std::string value;
+
+    EXPECT_EQ(engine.append("log", "hello", length), kvstore::Status::OK);
+    EXPECT_EQ(length, 5);
+    EXPECT_EQ(engine.append("log", " world", length), kvstore::Status::OK);
+    EXPECT_EQ(length, 11);
+    EXPECT_EQ(engine.valueLength("log"), 11);
+    EXPECT_EQ(engine.valueLength("missing"), 0);
+
+    EXPECT_EQ(engine.setRange("log", 6, "WORLD", length), kvstore::Status::OK);
+    EXPECT_EQ(length, 11);
+    EXPECT_TRUE(engine.get("log", value));
+    EXPECT_EQ(value, "hello WORLD");
+
+    // Past the end pads with zero bytes
+    EXPECT_EQ(engine.setRange("log", 13, "!", length), kvstore::Status::OK);
+    EXPECT_EQ(length, 14);
+    EXPECT_TRUE(engine.get("log", value));
+    EXPECT_EQ(value, std::string("hello WORLD\0\0!", 14));
+
+    // Redis GETRANGE offsets: inclusive, negative from the end
+    EXPECT_TRUE(engine.getSlice("log", 0, 4, value));
+    EXPECT_EQ(value, "hello");
+    EXPECT_TRUE(engine.getSlice("log", -1, -1, value));
+    EXPECT_EQ(value, "!");
+    EXPECT_TRUE(engine.getSlice("log", 6, 100, value));
+    EXPECT_EQ(value, std::string("WORLD\0\0!", 8));
+    EXPECT_TRUE(engine.getSlice("log", 5, 2, value));
+    EXPECT_EQ(value, "");
+    EXPECT_FALSE(engine.getSlice("missing", 0, -1, value));
+
+    // An empty SETRANGE does not create the key
+    EXPECT_EQ(engine.setRange("new", 3, "", length), kvstore::Status::OK);
+    EXPECT_EQ(length, 0);
+    EXPECT_FALSE(engine.exists("new"));
+
+    // Integer values switch to text and back
+    int64_t result = 0;
+    engine.incrBy("n", 12, result);
+    EXPECT_EQ(engine.append("n", "3", length), kvstore::Status::OK);
+    EXPECT_EQ(engine.incrBy("n", 1, result), kvstore::Status::OK);
+    EXPECT_EQ(result, 124);
+    EXPECT_EQ(engine.append("n", "x", length), kvstore::Status::OK);
+    EXPECT_EQ(engine.incrBy("n", 1, result), kvstore::Status::NOT_INTEGER);
+
+    EXPECT_EQ(engine.setRange("log", config.max_stream_value_size, "x", length),
+              kvstore::Status::OUT_OF_RANGE);
+}
+
+TEST_F(KVEngineTest, PartialWritesLogOnlyTheDelta) {
+    std::string big(65536, 'a');
+    size_t length = 0;
+    {
+        kvstore::KVEngine engine(config);
+        engine.put("blob", big);
+        uint64_t before = engine.getStatistics().wal_size;
+
+        for (int i = 0; i < 100; ++i) {
+            engine.append("blob", "0123456789", length);
+        }
+        engine.setRange("blob", 10, "XY", length);
+        engine.setRange("fresh", 2, "z", length);
+
+        // Each record is its header plus the changed bytes
+        EXPECT_LT(engine.getStatistics().wal_size - before, 100 * 64 + 2 * 64);
+    }
+
+    kvstore::KVEngine engine(config);
+    big += std::string(1000, ' ');
+    for (int i = 0; i < 100; ++i) {
+        big.replace(65536 + i * 10, 10, "0123456789");
+    }
+    big.replace(10, 2, "XY");
+
+    std::string value;
+    EXPECT_TRUE(engine.get("blob", value));
+    EXPECT_EQ(value, big);
+    EXPECT_TRUE(engine.get("fresh", value));
+    EXPECT_EQ(value, std::string("\0\0z", 3));
+}
+
+TEST_F(KVEngineTest, HashOperations) {
+    kvstore::KVEngine engine(config);
+    size_t count = 0;
+
+    EXPECT_EQ(engine.hset("user:1", {{"name", "ada"}, {"lang", "c++"}}, count),
+              kvstore::Status::OK);
+    EXPECT_EQ(count, 2);
+    EXPECT_EQ(engine.hset("user:1", {{"name", "grace"}, {"year", "1906"}}, count),
+              kvstore::Status::OK);
+    EXPECT_EQ(count, 1);
+    EXPECT_EQ(engine.type("user:1"), kvstore::ValueType::HASH);
+
+    std::string value;
+    EXPECT_EQ(engine.hget("user:1", "name", value), kvstore::Status::OK);
+    EXPECT_EQ(value, "grace");
+    EXPECT_EQ(engine.hget("user:1", "none", value), kvstore::Status::NOT_FOUND);
+    EXPECT_EQ(engine.hget("user:2", "name", value), kvstore::Status::NOT_FOUND);
+
+    std::vector<std::optional<std::string>> values;
+    EXPECT_EQ(engine.hmget("user:1", {"lang", "none", "year"}, values), kvstore::Status::OK);
+    ASSERT_EQ(values.size(), 3);
+    EXPECT_EQ(values[0], "c++");
+    EXPECT_FALSE(values[1]);
+    EXPECT_EQ(values[2], "1906");
+
+    kvstore::KVEngine::FieldValues pairs;
+    EXPECT_EQ(engine.hgetAll("user:1", pairs), kvstore::Status::OK);
+    EXPECT_EQ(pairs, (kvstore::KVEngine::FieldValues{
+        {"name", "grace"}, {"lang", "c++"}, {"year", "1906"}}));
+
+    int64_t result = 0;
+    EXPECT_EQ(engine.hincrBy("user:1", "year", 10, result), kvstore::Status::OK);
+    EXPECT_EQ(result, 1916);
+    EXPECT_EQ(engine.hincrBy("user:1", "visits", -1, result), kvstore::Status::OK);
+    EXPECT_EQ(result, -1);
+    EXPECT_EQ(engine.hincrBy("user:1", "name", 1, result), kvstore::Status::NOT_INTEGER);
+
+    EXPECT_EQ(engine.hdel("user:1", {"lang", "none"}, count), kvstore::Status::OK);
+    EXPECT_EQ(count, 1);
+    EXPECT_EQ(engine.hlen("user:1", count), kvstore::Status::OK);
+    EXPECT_EQ(count, 3);
+
+    // Removing the last field removes the key
+    EXPECT_EQ(engine.hdel("user:1", {"name", "year", "visits"}, count), kvstore::Status::OK);
+    EXPECT_EQ(count, 3);
+    EXPECT_FALSE(engine.exists("user:1"));
+    EXPECT_EQ(engine.type("user:1"), kvstore::ValueType::NONE);
+}
+
+TEST_F(KVEngineTest, HashTypeErrors) {
+    kvstore::KVEngine engine(config);
+    size_t count = 0;
+    int64_t result = 0;
+    std::string value;
+
+    engine.put("string", "text");
+    EXPECT_EQ(engine.hset("string", {{"f", "v"}}, count), kvstore::Status::WRONG_TYPE);
+    EXPECT_EQ(engine.hget("string", "f", value), kvstore::Status::WRONG_TYPE);
+    EXPECT_EQ(engine.hdel("string", {"f"}, count), kvstore::Status::WRONG_TYPE);
+
+    engine.hset("hash", {{"f", "v"}}, count);
+    EXPECT_FALSE(engine.get("hash", value));
+    EXPECT_EQ(engine.valueLength("hash"), 0);
+    EXPECT_EQ(engine.incrBy("hash", 1, result), kvstore::Status::WRONG_TYPE);
+    EXPECT_EQ(engine.append("hash", "x", count), kvstore::Status::WRONG_TYPE);
+    EXPECT_EQ(engine.setRange("hash", 0, "x", count), kvstore::Status::WRONG_TYPE);
+
+    // PUT replaces a value of any type; an expired key can change type
+    EXPECT_EQ(engine.put("hash", "text"), kvstore::Status::OK);
+    EXPECT_EQ(engine.type("hash"), kvstore::ValueType::STRING);
+    EXPECT_EQ(engine.put("string", "text", 1), kvstore::Status::OK);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_EQ(engine.hset("string", {{"f", "v"}}, count), kvstore::Status::OK);
+    EXPECT_EQ(engine.type("string"), kvstore::ValueType::HASH);
+}
+
+TEST_F(KVEngineTest, HashConvertsPastListpackLimits) {
+    kvstore::HashValue hash(4, 8);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(hash.set("f" + std::to_string(i), "v"));
+    }
+    EXPECT_TRUE(hash.compact());
+    EXPECT_FALSE(hash.set("f0", "updated"));
+    EXPECT_TRUE(hash.compact());
+
+    EXPECT_TRUE(hash.set("f4", "v"));
+    EXPECT_FALSE(hash.compact());
+    EXPECT_EQ(hash.size(), 5);
+
+    std::string value;
+    EXPECT_TRUE(hash.get("f0", value));
+    EXPECT_EQ(value, "updated");
+    EXPECT_TRUE(hash.erase("f0"));
+    EXPECT_FALSE(hash.contains("f0"));
+
+    // A long value converts too
+    kvstore::HashValue wide(4, 8);
+    wide.set("f", "short");
+    EXPECT_TRUE(wide.compact());
+    wide.set("f", "much longer value");
+    EXPECT_FALSE(wide.compact());
+    EXPECT_TRUE(wide.get("f", value));
+    EXPECT_EQ(value, "much longer value");
+}
+
+TEST_F(KVEngineTest, HashesReplayFromFieldRecords) {
+    config.hash_max_listpack_entries = 16;
+    size_t count = 0;
+    int64_t result = 0;
+    {
+        kvstore::KVEngine engine(config);
+        engine.hset("small", {{"a", "1"}, {"b", "2"}}, count);
+        for (int i = 0; i < 100; ++i) {
+            engine.hset("large", {{"field" + std::to_string(i), std::to_string(i)}}, count);
+        }
+        engine.checkpoint();
+
+        engine.hdel("small", {"a"}, count);
+        engine.hincrBy("small", "b", 40, result);
+        engine.hdel("large", {"field0", "field1"}, count);
+
+        // An expired hash's fields do not come back with the new one
+        engine.hset("session", {{"old", "x"}}, count);
+        engine.expire("session", 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        engine.hset("session", {{"new", "y"}}, count);
+    }
+
+    kvstore::KVEngine engine(config);
+    kvstore::KVEngine::FieldValues pairs;
+    EXPECT_EQ(engine.hgetAll("small", pairs), kvstore::Status::OK);
+    EXPECT_EQ(pairs, (kvstore::KVEngine::FieldValues{{"b", "42"}}));
+
+    EXPECT_EQ(engine.hlen("large", count), kvstore::Status::OK);
+    EXPECT_EQ(count, 98);
+    std::string value;
+    EXPECT_EQ(engine.hget("large", "field99", value), kvstore::Status::OK);
+    EXPECT_EQ(value, "99");
+
+    EXPECT_EQ(engine.hgetAll("session", pairs), kvstore::Status::OK);
+    EXPECT_EQ(pairs, (kvstore::KVEngine::FieldValues{{"new", "y"}}));
+    EXPECT_EQ(engine.ttl("session"), -1);
+}
+
+TEST_F(KVEngineTest, ListOperations) {
+    kvstore::KVEngine engine(config);
+    size_t length = 0;
+
+    EXPECT_EQ(engine.rpush("queue", {"b", "c"}, length), kvstore::Status::OK);
+    EXPECT_EQ(length, 2);
+    EXPECT_EQ(engine.lpush("queue", {"a", "z"}, length), kvstore::Status::OK);
+    EXPECT_EQ(length, 4);
+    EXPECT_EQ(engine.type("queue"), kvstore::ValueType::LIST);
+
+    std::vector<std::string> elements;
+    EXPECT_EQ(engine.lrange("queue", 0, -1, elements), kvstore::Status::OK);
+    EXPECT_EQ(elements, (std::vector<std::string>{"z", "a", "b", "c"}));
+    engine.lrange("queue", -3, 1, elements);
+    EXPECT_EQ(elements, (std::vector<std::string>{"a"}));
+    engine.lrange("queue", 5, 10, elements);
+    EXPECT_TRUE(elements.empty());
+
+    std::string element;
+    EXPECT_EQ(engine.lpop("queue", element), kvstore::Status::OK);
+    EXPECT_EQ(element, "z");
+    EXPECT_EQ(engine.rpop("queue", element), kvstore::Status::OK);
+    EXPECT_EQ(element, "c");
+    EXPECT_EQ(engine.llen("queue", length), kvstore::Status::OK);
+    EXPECT_EQ(length, 2);
+
+    // Popping the last element removes the key
+    engine.lpop("queue", element);
+    engine.lpop("queue", element);
+    EXPECT_EQ(engine.lpop("queue", element), kvstore::Status::NOT_FOUND);
+    EXPECT_FALSE(engine.exists("queue"));
+
+    engine.put("string", "text");
+    EXPECT_EQ(engine.rpush("string", {"x"}, length), kvstore::Status::WRONG_TYPE);
+    EXPECT_EQ(engine.lpop("string", element), kvstore::Status::WRONG_TYPE);
+}
+
+TEST_F(KVEngineTest, ListChunks) {
+    kvstore::ListValue list(4);
+    for (int i = 0; i < 10; ++i) {
+        list.pushBack(std::to_string(i));
+    }
+    list.pushFront("-1");
+    EXPECT_EQ(list.size(), 11);
+    EXPECT_EQ(list.chunkCount(), 4);
+
+    std::vector<std::string> elements;
+    list.range(3, 6, elements);
+    EXPECT_EQ(elements, (std::vector<std::string>{"2", "3", "4", "5"}));
+
+    std::string element;
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(list.popBack(element));
+    }
+    EXPECT_EQ(element, "7");
+    EXPECT_EQ(list.chunkCount(), 3);
+    EXPECT_TRUE(list.popFront(element));
+    EXPECT_EQ(element, "-1");
+    EXPECT_EQ(list.chunkCount(), 2);
+}
+
+TEST_F(KVEngineTest, ListsReplayFromRecords) {
+    config.list_max_listpack_size = 8;
+    size_t length = 0;
+    std::string element;
+    {
+        kvstore::KVEngine engine(config);
+        for (int i = 0; i < 100; ++i) {
+            engine.rpush("list", {std::to_string(i)}, length);
+        }
+        engine.checkpoint();
+
+        engine.lpop("list", element);
+        engine.rpop("list", element);
+        engine.lpush("list", {"x", "y"}, length);
+        engine.rpush("drained", {"a"}, length);
+        engine.lpop("drained", element);
+    }
+
+    kvstore::KVEngine engine(config);
+    std::vector<std::string> elements;
+    EXPECT_EQ(engine.lrange("list", 0, -1, elements), kvstore::Status::OK);
+    ASSERT_EQ(elements.size(), 100);
+    EXPECT_EQ(elements[0], "y");
+    EXPECT_EQ(elements[1], "x");
+    EXPECT_EQ(elements[2], "1");
+    EXPECT_EQ(elements.back(), "98");
+    EXPECT_FALSE(engine.exists("drained"));
+}
+
+TEST_F(KVEngineTest, BlockingPopWaitsForPush) {
+    kvstore::KVEngine engine(config);
+    size_t length = 0;
+
+    std::string key, element;
+    std::thread consumer([&]() {
+        EXPECT_EQ(engine.blpop({"jobs:high", "jobs:low"}, 0, key, element),
+                  kvstore::Status::OK);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    engine.rpush("jobs:low", {"job1"}, length);
+    consumer.join();
+
+    EXPECT_EQ(key, "jobs:low");
+    EXPECT_EQ(element, "job1");
+    EXPECT_FALSE(engine.exists("jobs:low"));
+
+    // An element already there is taken without waiting, first key first
+    engine.rpush("jobs:low", {"job2"}, length);
+    engine.rpush("jobs:high", {"job3", "job4"}, length);
+    EXPECT_EQ(engine.brpop({"jobs:high", "jobs:low"}, 0, key, element), kvstore::Status::OK);
+    EXPECT_EQ(key, "jobs:high");
+    EXPECT_EQ(element, "job4");
+}
+
+TEST_F(KVEngineTest, BlockingPopTimesOutOrIsCancelled) {
+    kvstore::KVEngine engine(config);
+    std::string key, element;
+
+    auto started = std::chrono::steady_clock::now();
+    EXPECT_EQ(engine.blpop({"empty"}, 50, key, element), kvstore::Status::NOT_FOUND);
+    EXPECT_GE(std::chrono::steady_clock::now() - started, std::chrono::milliseconds(50));
+
+    std::atomic<bool> cancel{false};
+    std::thread waiter([&]() {
+        EXPECT_EQ(engine.blpop({"empty"}, 0, key, element, [&]() { return cancel.load(); }),
+                  kvstore::Status::NOT_FOUND);
+    });
+    cancel = true;
+    waiter.join();
+
+    // A cancelled pop took nothing
+    size_t length = 0;
+    engine.rpush("empty", {"kept"}, length);
+    EXPECT_EQ(engine.llen("empty", length), kvstore::Status::OK);
+    EXPECT_EQ(length, 1);
+}
+
+TEST_F(KVEngineTest, BlockingPopsSharePushes) {
+    kvstore::KVEngine engine(config);
+    constexpr int kConsumers = 4;
+    constexpr int kJobs = 200;
+    std::atomic<int> received{0};
+
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < kConsumers; ++c) {
+        consumers.emplace_back([&]() {
+            std::string key, element;
+            while (engine.blpop({"jobs"}, 500, key, element) == kvstore::Status::OK) {
+                received++;
+            }
+        });
+    }
+    size_t length = 0;
+    for (int i = 0; i < kJobs; ++i) {
+        engine.rpush("jobs", {std::to_string(i)}, length);
+    }
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+    EXPECT_EQ(received, kJobs);
+}
+
+TEST_F(KVEngineTest, SortedSetOperations) {
+    kvstore::KVEngine engine(config);
+    size_t count = 0;
+
+    EXPECT_EQ(engine.zadd("board", {{"ann", 30}, {"bob", 10}, {"cat", 20}}, count),
+              kvstore::Status::OK);
+    EXPECT_EQ(count, 3);
+    EXPECT_EQ(engine.zadd("board", {{"bob", 40}, {"dan", 20}}, count), kvstore::Status::OK);
+    EXPECT_EQ(count, 1);
+    EXPECT_EQ(engine.type("board"), kvstore::ValueType::ZSET);
+
+    kvstore::KVEngine::ScoredMembers members;
+    EXPECT_EQ(engine.zrange("board", 0, -1, members), kvstore::Status::OK);
+    EXPECT_EQ(members, (kvstore::KVEngine::ScoredMembers{
+        {"cat", 20}, {"dan", 20}, {"ann", 30}, {"bob", 40}}));
+    engine.zrange("board", -2, -1, members);
+    EXPECT_EQ(members, (kvstore::KVEngine::ScoredMembers{{"ann", 30}, {"bob", 40}}));
+
+    EXPECT_EQ(engine.zrangeByScore("board", {20, true}, {40}, members), kvstore::Status::OK);
+    EXPECT_EQ(members, (kvstore::KVEngine::ScoredMembers{{"ann", 30}, {"bob", 40}}));
+    engine.zrangeByScore("board", {-INFINITY}, {INFINITY}, members, 1, 2);
+    EXPECT_EQ(members, (kvstore::KVEngine::ScoredMembers{{"dan", 20}, {"ann", 30}}));
+
+    size_t rank = 0;
+    EXPECT_EQ(engine.zrank("board", "ann", rank), kvstore::Status::OK);
+    EXPECT_EQ(rank, 2);
+    EXPECT_EQ(engine.zrank("board", "eve", rank), kvstore::Status::NOT_FOUND);
+
+    double score = 0;
+    EXPECT_EQ(engine.zincrBy("board", "cat", 25.5, score), kvstore::Status::OK);
+    EXPECT_EQ(score, 45.5);
+    EXPECT_EQ(engine.zrank("board", "cat", rank), kvstore::Status::OK);
+    EXPECT_EQ(rank, 3);
+    EXPECT_EQ(engine.zincrBy("board", "inf", INFINITY, score), kvstore::Status::OK);
+    EXPECT_EQ(engine.zincrBy("board", "inf", -INFINITY, score), kvstore::Status::OUT_OF_RANGE);
+    EXPECT_EQ(engine.zadd("board", {{"nan", NAN}}, count), kvstore::Status::OUT_OF_RANGE);
+
+    EXPECT_EQ(engine.zrem("board", {"inf", "eve", "bob"}, count), kvstore::Status::OK);
+    EXPECT_EQ(count, 2);
+    EXPECT_EQ(engine.zcard("board", count), kvstore::Status::OK);
+    EXPECT_EQ(count, 3);
+    EXPECT_EQ(engine.zscore("board", "dan", score), kvstore::Status::OK);
+    EXPECT_EQ(score, 20);
+
+    // Removing the last member removes the key
+    engine.zrem("board", {"ann", "cat", "dan"}, count);
+    EXPECT_FALSE(engine.exists("board"));
+
+    engine.put("string", "text");
+    EXPECT_EQ(engine.zadd("string", {{"a", 1}}, count), kvstore::Status::WRONG_TYPE);
+    EXPECT_EQ(engine.zrange("string", 0, -1, members), kvstore::Status::WRONG_TYPE);
+}
+
+TEST_F(KVEngineTest, SortedSetMatchesReference) {
+    kvstore::ZSetValue zset;
+    std::set<std::pair<double, std::string>> reference;
+    std::map<std::string, double> scores;
+    std::mt19937 random(42);
+
+    for (int i = 0; i < 20000; ++i) {
+        std::string member = "m" + std::to_string(random() % 2000);
+        if (random() % 4 == 0) {
+            EXPECT_EQ(zset.erase(member), scores.count(member) > 0);
+            if (scores.count(member)) {
+                reference.erase({scores[member], member});
+                scores.erase(member);
+            }
+        } else {
+            double score = static_cast<double>(random() % 500);
+            EXPECT_EQ(zset.add(member, score), scores.count(member) == 0);
+            if (scores.count(member)) {
+                reference.erase({scores[member], member});
+            }
+            scores[member] = score;
+            reference.insert({score, member});
+        }
+    }
+    ASSERT_EQ(zset.size(), reference.size());
+
+    // Every rank, in both directions
+    size_t expected_rank = 0;
+    for (const auto& [score, member] : reference) {
+        size_t rank = 0;
+        ASSERT_TRUE(zset.rank(member, rank));
+        EXPECT_EQ(rank, expected_rank);
+        zset.forEachInRank(expected_rank, expected_rank, [&](std::string_view at, double at_score) {
+            EXPECT_EQ(at, member);
+            EXPECT_EQ(at_score, score);
+        });
+        expected_rank++;
+    }
+
+    std::vector<std::string> in_range;
+    zset.forEachInScore({100, true}, {200}, 0, SIZE_MAX, [&](std::string_view member, double) {
+        in_range.emplace_back(member);
+    });
+    std::vector<std::string> expected;
+    for (const auto& [score, member] : reference) {
+        if (score > 100 && score <= 200) {
+            expected.push_back(member);
+        }
+    }
+    EXPECT_EQ(in_range, expected);
+}
+
+TEST_F(KVEngineTest, SortedSetsReplayFromRecords) {
+    size_t count = 0;
+    double score = 0;
+    {
+        kvstore::KVEngine engine(config);
+        for (int i = 0; i < 3000; ++i) {
+            engine.zadd("scores", {{"p" + std::to_string(i), i * 0.5}}, count);
+        }
+        engine.checkpoint();
+
+        engine.zincrBy("scores", "p0", 10000, score);
+        engine.zrem("scores", {"p1", "p2"}, count);
+        engine.zadd("scores", {{"neg", -1}}, count);
+    }
+
+    kvstore::KVEngine engine(config);
+    EXPECT_EQ(engine.zcard("scores", count), kvstore::Status::OK);
+    EXPECT_EQ(count, 2999);
+
+    kvstore::KVEngine::ScoredMembers members;
+    engine.zrange("scores", 0, 1, members);
+    EXPECT_EQ(members, (kvstore::KVEngine::ScoredMembers{{"neg", -1}, {"p3", 1.5}}));
+    engine.zrange("scores", -1, -1, members);
+    EXPECT_EQ(members, (kvstore::KVEngine::ScoredMembers{{"p0", 10000}}));
+}
+
+TEST_F(KVEngineTest, SetOperations) {
+    kvstore::KVEngine engine(config);
+    size_t count = 0;
+    bool found = false;
+
+    EXPECT_EQ(engine.sadd("tags", {"3", "1", "2", "1"}, count), kvstore::Status::OK);
+    EXPECT_EQ(count, 3);
+    EXPECT_EQ(engine.type("tags"), kvstore::ValueType::SET);
+    EXPECT_EQ(engine.sismember("tags", "2", found), kvstore::Status::OK);
+    EXPECT_TRUE(found);
+    engine.sismember("tags", "02", found);
+    EXPECT_FALSE(found);
+
+    std::vector<std::string> members;
+    engine.smembers("tags", members);
+    EXPECT_EQ(members, (std::vector<std::string>{"1", "2", "3"}));
+
+    engine.sadd("other", {"2", "3", "x"}, count);
+    engine.sinter({"tags", "other"}, members);
+    std::sort(members.begin(), members.end());
+    EXPECT_EQ(members, (std::vector<std::string>{"2", "3"}));
+    engine.sunion({"tags", "other"}, members);
+    std::sort(members.begin(), members.end());
+    EXPECT_EQ(members, (std::vector<std::string>{"1", "2", "3", "x"}));
+    engine.sinter({"tags", "missing"}, members);
+    EXPECT_TRUE(members.empty());
+
+    EXPECT_EQ(engine.srem("tags", {"1", "9"}, count), kvstore::Status::OK);
+    EXPECT_EQ(count, 1);
+    engine.srem("tags", {"2", "3"}, count);
+    EXPECT_FALSE(engine.exists("tags"));
+
+    engine.put("text", "value");
+    EXPECT_EQ(engine.sadd("text", {"a"}, count), kvstore::Status::WRONG_TYPE);
+    EXPECT_EQ(engine.sinter({"other", "text"}, members), kvstore::Status::WRONG_TYPE);
+    EXPECT_EQ(engine.sunion({"text"}, members), kvstore::Status::WRONG_TYPE);
+}
+
+TEST_F(KVEngineTest, SetIntsetEncoding) {
+    kvstore::SetValue set(4);
+    EXPECT_TRUE(set.add("-5"));
+    EXPECT_TRUE(set.add("10"));
+    EXPECT_TRUE(set.add("0"));
+    EXPECT_TRUE(set.compact());
+    EXPECT_EQ(set.integers(), (std::vector<int64_t>{-5, 0, 10}));
+
+    // Members that would not format back the same are not integers
+    int64_t value;
+    EXPECT_FALSE(kvstore::SetValue::toInteger("+1", value));
+    EXPECT_FALSE(kvstore::SetValue::toInteger("-0", value));
+    EXPECT_FALSE(kvstore::SetValue::toInteger("007", value));
+    EXPECT_FALSE(kvstore::SetValue::toInteger("99999999999999999999", value));
+    EXPECT_TRUE(kvstore::SetValue::toInteger("-9223372036854775808", value));
+
+    EXPECT_TRUE(set.add("+1"));
+    EXPECT_FALSE(set.compact());
+    EXPECT_TRUE(set.contains("10"));
+    EXPECT_TRUE(set.contains("+1"));
+    EXPECT_FALSE(set.contains("1"));
+    EXPECT_EQ(set.size(), 4);
+
+    kvstore::SetValue full(2);
+    full.add("1");
+    full.add("2");
+    EXPECT_TRUE(full.add("3"));
+    EXPECT_FALSE(full.compact());
+    EXPECT_EQ(full.size(), 3);
+}
+
+TEST_F(KVEngineTest, SetMergesMatchReference) {
+    std::mt19937 random(7);
+    for (int round = 0; round < 200; ++round) {
+        // Sizes and ranges vary so blocks overlap every way
+        std::set<int64_t> a, b;
+        size_t a_size = random() % 300, b_size = random() % 300;
+        int64_t range = 1 + random() % 1000;
+        while (a.size() < std::min<size_t>(a_size, range)) {
+            a.insert(static_cast<int64_t>(random() % range) - range / 2);
+        }
+        while (b.size() < std::min<size_t>(b_size, range)) {
+            b.insert(static_cast<int64_t>(random() % range) - range / 2);
+        }
+        std::vector<int64_t> va(a.begin(), a.end()), vb(b.begin(), b.end());
+
+        std::vector<int64_t> both, either;
+        std::set_intersection(va.begin(), va.end(), vb.begin(), vb.end(),
+                              std::back_inserter(both));
+        std::set_union(va.begin(), va.end(), vb.begin(), vb.end(), std::back_inserter(either));
+        EXPECT_EQ(kvstore::SetValue::intersect(va, vb), both);
+        EXPECT_EQ(kvstore::SetValue::intersect(vb, va), both);
+        EXPECT_EQ(kvstore::SetValue::unite(va, vb), either);
+    }
+}
+
+TEST_F(KVEngineTest, SetsReplayFromRecords) {
+    config.set_max_intset_entries = 100;
+    size_t count = 0;
+    {
+        kvstore::KVEngine engine(config);
+        for (int i = 0; i < 3000; ++i) {
+            engine.sadd("big", {std::to_string(i)}, count);
+        }
+        engine.sadd("small", {"5", "6"}, count);
+        engine.checkpoint();
+
+        engine.srem("big", {"0", "1"}, count);
+        engine.sadd("small", {"7"}, count);
+    }
+
+    kvstore::KVEngine engine(config);
+    EXPECT_EQ(engine.scard("big", count), kvstore::Status::OK);
+    EXPECT_EQ(count, 2998);
+    std::vector<std::string> members;
+    engine.sinter({"small", "big"}, members);
+    EXPECT_EQ(members, (std::vector<std::string>{"5", "6", "7"}));
+}
+
+TEST_F(KVEngineTest, HyperLogLogOperations) {
+    kvstore::KVEngine engine(config);
+    bool changed = false;
+    uint64_t count = 0;
+
+    EXPECT_EQ(engine.pfadd("visitors", {"a", "b", "c", "a"}, changed), kvstore::Status::OK);
+    EXPECT_TRUE(changed);
+    EXPECT_EQ(engine.type("visitors"), kvstore::ValueType::HLL);
+    engine.pfadd("visitors", {"b"}, changed);
+    EXPECT_FALSE(changed);
+    EXPECT_EQ(engine.pfcount({"visitors"}, count), kvstore::Status::OK);
+    EXPECT_EQ(count, 3);
+
+    engine.pfadd("empty", {}, changed);
+    EXPECT_TRUE(changed);
+    engine.pfcount({"empty", "missing"}, count);
+    EXPECT_EQ(count, 0);
+
+    engine.pfadd("other", {"c", "d"}, changed);
+    engine.pfcount({"visitors", "other"}, count);
+    EXPECT_EQ(count, 4);
+    EXPECT_EQ(engine.pfmerge("all", {"visitors", "other"}), kvstore::Status::OK);
+    engine.pfcount({"all"}, count);
+    EXPECT_EQ(count, 4);
+
+    engine.put("text", "value");
+    EXPECT_EQ(engine.pfadd("text", {"a"}, changed), kvstore::Status::WRONG_TYPE);
+    EXPECT_EQ(engine.pfcount({"all", "text"}, count), kvstore::Status::WRONG_TYPE);
+    EXPECT_EQ(engine.pfmerge("text", {"all"}), kvstore::Status::WRONG_TYPE);
+}
+
+TEST_F(KVEngineTest, HyperLogLogEstimates) {
+    kvstore::HyperLogLog hll(1000);
+    std::vector<uint8_t> registers(kvstore::HyperLogLog::kRegisters, 0);
+    size_t added = 0;
+    for (size_t target : {100, 1000, 10000, 100000, 1000000}) {
+        for (; added < target; ++added) {
+            hll.add("user:" + std::to_string(added));
+        }
+        EXPECT_EQ(hll.compact(), target <= 1000);   // 1000 elements set fewer registers
+        // Within 4 standard errors
+        double error = std::abs(static_cast<double>(hll.count()) - target) / target;
+        EXPECT_LT(error, 4 * 0.0081) << target;
+    }
+
+    // Sparse and dense encodings of the same registers agree
+    kvstore::HyperLogLog sparse(20000), dense(0);
+    for (int i = 0; i < 5000; ++i) {
+        sparse.add("e" + std::to_string(i));
+        dense.add("e" + std::to_string(i));
+    }
+    EXPECT_TRUE(sparse.compact());
+    EXPECT_FALSE(dense.compact());
+    EXPECT_EQ(sparse.count(), dense.count());
+
+    sparse.maxInto(registers.data());
+    EXPECT_EQ(kvstore::HyperLogLog::count(registers.data()), dense.count());
+    kvstore::HyperLogLog copy(0);
+    EXPECT_TRUE(copy.mergeSerialized(dense.serialize()));
+    EXPECT_EQ(copy.count(), dense.count());
+    EXPECT_EQ(copy.serialize(), dense.serialize());
+    EXPECT_EQ(dense.serialize().size(), 1 + kvstore::HyperLogLog::kDenseBytes);
+}
+
+TEST_F(KVEngineTest, HyperLogLogsReplayFromRecords) {
+    bool changed = false;
+    uint64_t small = 0, large = 0, merged = 0;
+    {
+        kvstore::KVEngine engine(config);
+        std::vector<std::string> elements;
+        for (int i = 0; i < 50000; ++i) {
+            elements.push_back("v" + std::to_string(i));
+        }
+        engine.pfadd("large", elements, changed);
+        engine.pfadd("small", {"x", "y"}, changed);
+        engine.checkpoint();
+
+        engine.pfadd("small", {"z"}, changed);
+        engine.pfmerge("merged", {"small", "large"});
+        engine.pfcount({"small"}, small);
+        engine.pfcount({"large"}, large);
+        engine.pfcount({"merged"}, merged);
+    }
+
+    kvstore::KVEngine engine(config);
+    uint64_t count = 0;
+    engine.pfcount({"small"}, count);
+    EXPECT_EQ(count, small);
+    engine.pfcount({"large"}, count);
+    EXPECT_EQ(count, large);
+    engine.pfcount({"merged"}, count);
+    EXPECT_EQ(count, merged);
+}
+
+TEST_F(KVEngineTest, BloomFilterOperations) {
+    kvstore::KVEngine engine(config);
+    std::vector<bool> flags;
+
+    EXPECT_EQ(engine.bfAdd("seen", {"a", "b", "a"}, flags), kvstore::Status::OK);
+    EXPECT_EQ(flags, (std::vector<bool>{true, true, false}));
+    EXPECT_EQ(engine.type("seen"), kvstore::ValueType::BLOOM);
+    engine.bfAdd("seen", {"b"}, flags);
+    EXPECT_EQ(flags, (std::vector<bool>{false}));
+
+    EXPECT_EQ(engine.bfExists("seen", {"a", "b", "c"}, flags), kvstore::Status::OK);
+    EXPECT_EQ(flags, (std::vector<bool>{true, true, false}));
+    engine.bfExists("missing", {"a"}, flags);
+    EXPECT_EQ(flags, (std::vector<bool>{false}));
+
+    EXPECT_EQ(engine.bfReserve("ids", 0.001, 1000, 2), kvstore::Status::OK);
+    EXPECT_EQ(engine.bfReserve("ids", 0.001, 1000, 2), kvstore::Status::KEY_EXISTS);
+    EXPECT_EQ(engine.bfReserve("bad", 1.5, 1000, 2), kvstore::Status::OUT_OF_RANGE);
+    EXPECT_EQ(engine.bfReserve("bad", 0.01, 0, 2), kvstore::Status::OUT_OF_RANGE);
+    EXPECT_EQ(engine.bfReserve("huge", 1e-9, uint64_t(1) << 40, 2),
+              kvstore::Status::OUT_OF_RANGE);
+    EXPECT_FALSE(engine.exists("bad"));
+
+    engine.put("text", "value");
+    EXPECT_EQ(engine.bfAdd("text", {"a"}, flags), kvstore::Status::WRONG_TYPE);
+    EXPECT_EQ(engine.bfExists("text", {"a"}, flags), kvstore::Status::WRONG_TYPE);
+}
+
+TEST_F(KVEngineTest, BloomFilterErrorRate) {
+    // Sized for the items, and grown from far too small: no false
+    // negatives, and false positives within the requested rate
+    for (uint64_t capacity : {uint64_t(20000), uint64_t(100)}) {
+        kvstore::BloomFilter filter(0.01, capacity, 2);
+        for (int i = 0; i < 20000; ++i) {
+            filter.add(kvstore::BloomFilter::hash("id:" + std::to_string(i)));
+        }
+        EXPECT_EQ(filter.layerCount() == 1, capacity == 20000);
+        for (int i = 0; i < 20000; ++i) {
+            ASSERT_TRUE(filter.contains(kvstore::BloomFilter::hash("id:" + std::to_string(i))));
+        }
+
+        int false_positives = 0;
+        for (int i = 0; i < 100000; ++i) {
+            false_positives += filter.contains(
+                kvstore::BloomFilter::hash("other:" + std::to_string(i))) ? 1 : 0;
+        }
+        EXPECT_LT(false_positives, 1250) << capacity;   // 1%, allowing for sampling noise
+    }
+}
+
+TEST_F(KVEngineTest, BloomFiltersReplayFromRecords) {
+    std::vector<bool> flags;
+    std::vector<std::string> items;
+    for (int i = 0; i < 5000; ++i) {
+        items.push_back("item" + std::to_string(i));
+    }
+    {
+        kvstore::KVEngine engine(config);
+        engine.bfReserve("grown", 0.01, 100, 4);
+        engine.bfAdd("grown", items, flags);
+        engine.checkpoint();
+
+        engine.bfAdd("grown", {"late"}, flags);
+        engine.bfAdd("fresh", {"x"}, flags);
+    }
+
+    kvstore::KVEngine engine(config);
+    engine.bfExists("grown", items, flags);
+    EXPECT_EQ(std::count(flags.begin(), flags.end(), true), 5000);
+    engine.bfExists("grown", {"late", "never"}, flags);
+    EXPECT_EQ(flags, (std::vector<bool>{true, false}));
+    engine.bfExists("fresh", {"x"}, flags);
+    EXPECT_EQ(flags, (std::vector<bool>{true}));
+}
+
+TEST_F(KVEngineTest, BitmapOperations) {
+    kvstore::KVEngine engine(config);
+    bool bit = true;
+
+    // Setting bit 7 creates a one-byte value; bit 0 is the high bit
+    EXPECT_EQ(engine.setBit("flags", 7, true, bit), kvstore::Status::OK);
+    EXPECT_FALSE(bit);
+    EXPECT_EQ(engine.setBit("flags", 1, true, bit), kvstore::Status::OK);
+    std::string value;
+    engine.get("flags", value);
+    EXPECT_EQ(value, std::string("\x41", 1));
+    EXPECT_EQ(engine.setBit("flags", 1, false, bit), kvstore::Status::OK);
+    EXPECT_TRUE(bit);
+    EXPECT_EQ(engine.getBit("flags", 7, bit), kvstore::Status::OK);
+    EXPECT_TRUE(bit);
+    EXPECT_EQ(engine.getBit("flags", 1000, bit), kvstore::Status::OK);
+    EXPECT_FALSE(bit);
+
+    // Clearing a bit past the end still zero-pads the value
+    EXPECT_EQ(engine.setBit("flags", 23, false, bit), kvstore::Status::OK);
+    EXPECT_EQ(engine.valueLength("flags"), 3);
+
+    // Counts and positions over byte ranges, negative from the end
+    engine.put("text", "foobar");
+    uint64_t count = 0;
+    EXPECT_EQ(engine.bitCount("text", 0, -1, count), kvstore::Status::OK);
+    EXPECT_EQ(count, 26);
+    engine.bitCount("text", 1, 1, count);
+    EXPECT_EQ(count, 6);
+    engine.bitCount("text", -2, -1, count);
+    EXPECT_EQ(count, 7);
+    engine.bitCount("text", 4, 2, count);
+    EXPECT_EQ(count, 0);
+    engine.bitCount("missing", 0, -1, count);
+    EXPECT_EQ(count, 0);
+
+    int64_t position = 0;
+    engine.put("ones", std::string("\xff\xf0\x00", 3));
+    EXPECT_EQ(engine.bitPos("ones", false, 0, std::nullopt, position), kvstore::Status::OK);
+    EXPECT_EQ(position, 12);
+    engine.bitPos("ones", true, 2, std::nullopt, position);
+    EXPECT_EQ(position, -1);
+    engine.put("full", std::string("\xff\xff", 2));
+    engine.bitPos("full", false, 0, std::nullopt, position);
+    EXPECT_EQ(position, 16);
+    engine.bitPos("full", false, 0, -1, position);
+    EXPECT_EQ(position, -1);
+    engine.bitPos("missing", false, 0, std::nullopt, position);
+    EXPECT_EQ(position, 0);
+    engine.bitPos("missing", true, 0, std::nullopt, position);
+    EXPECT_EQ(position, -1);
+
+    // Integers are bitmaps of their text
+    engine.put("number", "1");
+    engine.getBit("number", 7, bit);
+    EXPECT_TRUE(bit);
+    engine.setBit("number", 6, true, bit);
+    engine.get("number", value);
+    EXPECT_EQ(value, "3");
+
+    // BITOP pads shorter sources with zeros and replaces dest
+    size_t length = 0;
+    engine.put("a", std::string("\xf0\x0f", 2));
+    engine.put("b", std::string("\xff", 1));
+    engine.sadd("dest", {"x"}, length);
+    EXPECT_EQ(engine.bitOp(kvstore::BitOp::AND, "dest", {"a", "b"}, length),
+              kvstore::Status::OK);
+    EXPECT_EQ(length, 2);
+    engine.get("dest", value);
+    EXPECT_EQ(value, std::string("\xf0\x00", 2));
+    engine.bitOp(kvstore::BitOp::OR, "dest", {"a", "b", "missing"}, length);
+    engine.get("dest", value);
+    EXPECT_EQ(value, std::string("\xff\x0f", 2));
+    engine.bitOp(kvstore::BitOp::XOR, "dest", {"a", "b"}, length);
+    engine.get("dest", value);
+    EXPECT_EQ(value, std::string("\x0f\x0f", 2));
+    engine.bitOp(kvstore::BitOp::NOT, "dest", {"a"}, length);
+    engine.get("dest", value);
+    EXPECT_EQ(value, std::string("\x0f\xf0", 2));
+    EXPECT_EQ(engine.bitOp(kvstore::BitOp::NOT, "dest", {"a", "b"}, length),
+              kvstore::Status::OUT_OF_RANGE);
+
+    // An empty result deletes dest
+    EXPECT_EQ(engine.bitOp(kvstore::BitOp::OR, "dest", {"missing"}, length),
+              kvstore::Status::OK);
+    EXPECT_EQ(length, 0);
+    EXPECT_FALSE(engine.exists("dest"));
+
+    engine.sadd("set", {"x"}, length);
+    EXPECT_EQ(engine.setBit("set", 0, true, bit), kvstore::Status::WRONG_TYPE);
+    EXPECT_EQ(engine.bitCount("set", 0, -1, count), kvstore::Status::WRONG_TYPE);
+    EXPECT_EQ(engine.bitOp(kvstore::BitOp::AND, "dest", {"a", "set"}, length),
+              kvstore::Status::WRONG_TYPE);
+    EXPECT_EQ(engine.setBit("flags", config.max_stream_value_size * 8, true, bit),
+              kvstore::Status::OUT_OF_RANGE);
+}
+
+TEST_F(KVEngineTest, BitmapKernelsMatchReference) {
+    std::mt19937 random(11);
+    for (int round = 0; round < 200; ++round) {
+        // Lengths around the 8- and 32-byte steps, sparse and dense bytes
+        size_t size = random() % 100;
+        std::vector<unsigned char> a(size), b(size);
+        for (size_t i = 0; i < size; ++i) {
+            a[i] = round % 3 == 0 ? 0xff : static_cast<unsigned char>(random());
+            b[i] = round % 5 == 0 ? 0x00 : static_cast<unsigned char>(random());
+        }
+        if (size > 0 && round % 3 == 0) {
+            a[random() % size] ^= static_cast<unsigned char>(1 << (random() % 8));
+        }
+
+        uint64_t ones = 0;
+        int64_t first_one = -1, first_zero = -1;
+        for (size_t i = 0; i < size * 8; ++i) {
+            bool bit = (b[i / 8] >> (7 - i % 8)) & 1;
+            ones += bit;
+            if (bit && first_one < 0) {
+                first_one = static_cast<int64_t>(i);
+            }
+            bool a_bit = (a[i / 8] >> (7 - i % 8)) & 1;
+            if (!a_bit && first_zero < 0) {
+                first_zero = static_cast<int64_t>(i);
+            }
+        }
+        EXPECT_EQ(kvstore::Bitmap::count(b.data(), size), ones);
+        EXPECT_EQ(kvstore::Bitmap::position(b.data(), size, true), first_one);
+        EXPECT_EQ(kvstore::Bitmap::position(a.data(), size, false), first_zero);
+
+        std::vector<unsigned char> combined(a);
+        kvstore::Bitmap::combine(kvstore::BitOp::XOR, combined.data(), b.data(), size);
+        for (size_t i = 0; i < size; ++i) {
+            EXPECT_EQ(combined[i], a[i] ^ b[i]);
+        }
+    }
+}
+
+TEST_F(KVEngineTest, BitmapsReplayFromRecords) {
+    bool bit = false;
+    size_t length = 0;
+    {
+        kvstore::KVEngine engine(config);
+        for (uint64_t offset = 0; offset < 4096; offset += 3) {
+            engine.setBit("bits", offset, true, bit);
+        }
+        engine.checkpoint();
+
+        engine.setBit("bits", 0, false, bit);
+        engine.setBit("bits", 9000, true, bit);
+        engine.setBit("fresh", 20, true, bit);
+        engine.bitOp(kvstore::BitOp::OR, "merged", {"bits", "fresh"}, length);
+    }
+
+    kvstore::KVEngine engine(config);
+    uint64_t count = 0;
+    engine.bitCount("bits", 0, -1, count);
+    EXPECT_EQ(count, 1366);
+    engine.getBit("bits", 9000, bit);
+    EXPECT_TRUE(bit);
+    engine.getBit("bits", 0, bit);
+    EXPECT_FALSE(bit);
+    engine.bitCount("merged", 0, -1, count);
+    EXPECT_EQ(count, 1367);
+    EXPECT_EQ(engine.valueLength("fresh"), 3);
+}
+
+TEST_F(KVEngineTest, MemoryAccounting) {
+    kvstore::KVEngine engine(config);
+    EXPECT_EQ(engine.getStatistics().used_memory, 0);
+
+    engine.put("key", std::string(1000, 'x'));
+    size_t with_string = engine.getStatistics().used_memory;
+    EXPECT_GE(with_string, 1003);
+
+    size_t added = 0;
+    kvstore::KVEngine::FieldValues fields;
+    for (int i = 0; i < 200; ++i) {
+        fields.emplace_back("field" + std::to_string(i), std::string(50, 'v'));
+    }
+    engine.hset("hash", fields, added);
+    std::vector<std::string> members;
+    for (int i = 0; i < 200; ++i) {
+        members.push_back("member" + std::to_string(i));
+    }
+    engine.sadd("set", members, added);
+    size_t length = 0;
+    engine.lpush("list", members, length);
+    EXPECT_GE(engine.getStatistics().used_memory, with_string + 200 * 55 + 200 * 7 * 2);
+
+    engine.erase("hash");
+    engine.erase("set");
+    engine.erase("list");
+    EXPECT_EQ(engine.getStatistics().used_memory, with_string);
+    engine.clear();
+    EXPECT_EQ(engine.getStatistics().used_memory, 0);
+}
+
+TEST_F(KVEngineTest, MemoryQuotaRefusesWrites) {
+    config.max_memory = 4096;
+    kvstore::KVEngine engine(config);
+
+    kvstore::Status status = kvstore::Status::OK;
+    int written = 0;
+    while ((status = engine.put("key" + std::to_string(written), std::string(100, 'x'))) ==
+           kvstore::Status::OK) {
+        written++;
+    }
+    EXPECT_EQ(status, kvstore::Status::OUT_OF_MEMORY);
+    EXPECT_GT(written, 10);
+    EXPECT_EQ(engine.size(), static_cast<size_t>(written));
+    EXPECT_EQ(engine.getStatistics().evictions, 0);
+
+    size_t added = 0;
+    EXPECT_EQ(engine.sadd("set", {"a"}, added), kvstore::Status::OUT_OF_MEMORY);
+
+    // Deletes are always allowed and free room
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(engine.erase("key" + std::to_string(i)), kvstore::Status::OK);
+    }
+    EXPECT_EQ(engine.put("fits", "value"), kvstore::Status::OK);
+}
+
+TEST_F(KVEngineTest, AllKeysRandomEviction) {
+    config.max_memory = 8192;
+    config.eviction_policy = kvstore::EvictionPolicy::ALLKEYS_RANDOM;
+    {
+        kvstore::KVEngine engine(config);
+        for (int i = 0; i < 500; ++i) {
+            ASSERT_EQ(engine.put("key" + std::to_string(i), std::string(100, 'x')),
+                      kvstore::Status::OK);
+        }
+
+        auto stats = engine.getStatistics();
+        EXPECT_GT(stats.evictions, 0);
+        EXPECT_EQ(stats.item_count + stats.evictions, 500);
+        EXPECT_LE(stats.used_memory, 8192 + 200);
+        EXPECT_TRUE(engine.exists("key499"));
+    }
+
+    // Evictions are logged, so replay lands on the same keys
+    config.max_memory = 0;
+    kvstore::KVEngine engine(config);
+    EXPECT_LT(engine.size(), 500);
+    EXPECT_LE(engine.getStatistics().used_memory, 8192 + 200);
+}
+
+TEST_F(KVEngineTest, VolatileTtlEviction) {
+    config.max_memory = 8192;
+    config.eviction_policy = kvstore::EvictionPolicy::VOLATILE_TTL;
+    kvstore::KVEngine engine(config);
+
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_EQ(engine.put("plain" + std::to_string(i), std::string(100, 'x')),
+                  kvstore::Status::OK);
+    }
+    kvstore::Status status = kvstore::Status::OK;
+    for (int i = 0; i < 500 && status == kvstore::Status::OK; ++i) {
+        status = engine.put("temp" + std::to_string(i), std::string(100, 'x'), 60000);
+    }
+    EXPECT_GT(engine.getStatistics().evictions, 0);
+
+    // Only keys with a TTL are evicted; once none are left writes fail
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_TRUE(engine.exists("plain" + std::to_string(i)));
+    }
+    status = kvstore::Status::OK;
+    for (int i = 0; i < 500 && status == kvstore::Status::OK; ++i) {
+        status = engine.put("more" + std::to_string(i), std::string(100, 'x'));
+    }
+    EXPECT_EQ(status, kvstore::Status::OUT_OF_MEMORY);
+    EXPECT_EQ(engine.getStatistics().expiring_keys, 0);
+}
+
+TEST_F(KVEngineTest, NamespaceConfigs) {
+    config.databases = 3;
+    config.max_memory = 1000;
+    config.database_settings[1] = {{"max_memory", "5000"},
+                                   {"eviction_policy", "allkeys-random"},
+                                   {"num_segments", "8"}};
+
+    auto first = kvstore::ConfigManager::databaseConfig(config, 0);
+    auto second = kvstore::ConfigManager::databaseConfig(config, 1);
+    auto third = kvstore::ConfigManager::databaseConfig(config, 2);
+    EXPECT_EQ(first.wal_file, config.wal_file);
+    EXPECT_EQ(second.wal_file, config.wal_file + ".db1");
+    EXPECT_EQ(third.wal_file, config.wal_file + ".db2");
+    EXPECT_EQ(first.max_memory, 1000);
+    EXPECT_EQ(second.max_memory, 5000);
+    EXPECT_EQ(second.eviction_policy, kvstore::EvictionPolicy::ALLKEYS_RANDOM);
+    EXPECT_EQ(second.num_segments, 8);
+    EXPECT_EQ(third.eviction_policy, kvstore::EvictionPolicy::NOEVICTION);
+    EXPECT_EQ(third.num_segments, config.num_segments);
+
+    // Each namespace is its own engine, so clearing one leaves the rest
+    second.max_memory = 0;
+    {
+        kvstore::KVEngine engine(first);
+        kvstore::KVEngine other(second);
+        engine.put("key", "zero");
+        other.put("key", "one");
+        other.clear();
+        std::string value;
+        EXPECT_TRUE(engine.get("key", value));
+        EXPECT_EQ(value, "zero");
+        EXPECT_FALSE(other.exists("key"));
+    }
+    for (const auto& file : {second.wal_file, second.wal_file + ".snapshot"}) {
+        if (fs::exists(file)) {
+            fs::remove(file);
+        }
+    }
+}
+
+TEST_F(KVEngineTest, UnknownEvictionPolicyIsRejected) {
+    EXPECT_THROW(kvstore::ConfigManager::apply(config, "eviction_policy", "lru"),
+                 std::invalid_argument);
+    EXPECT_EQ(config.eviction_policy, kvstore::EvictionPolicy::NOEVICTION);
+
+    config.database_settings[1] = {{"eviction_policy", "allkeys-lru"}};
+    EXPECT_THROW(kvstore::ConfigManager::databaseConfig(config, 1), std::invalid_argument);
+
+    // Overrides are checked when the file is loaded
+    std::string config_file = "test_engine.conf";
+    {
+        std::ofstream file(config_file);
+        file << "db1.eviction_policy=volatile-lru\n";
+    }
+    try {
+        kvstore::ConfigManager::loadFromFile(config_file);
+        ADD_FAILURE() << "loadFromFile accepted an unknown eviction_policy";
+    } catch (const std::invalid_argument& e) {
+        EXPECT_NE(std::string(e.what()).find("volatile-lru"), std::string::npos);
+    }
+    fs::remove(config_file);
+}
+
+TEST_F(KVEngineTest, AutoTuneSizesFromHardware) {
+    config.auto_tune = true;
+    config.expected_keys = 100000;
+    config.min_workers = 2;
+
+    auto tuned = kvstore::AutoTuner::startupConfig(config, 8);
+    EXPECT_EQ(tuned.num_segments, 65536);   // 50000 rounded up to a power of two
+    EXPECT_EQ(tuned.num_workers, 2);
+
+    config.expected_keys = 0;
+    EXPECT_EQ(kvstore::AutoTuner::startupConfig(config, 8).num_segments, 128);
+
+    config.max_segments = 64;
+    EXPECT_EQ(kvstore::AutoTuner::startupConfig(config, 8).num_segments, 64);
+
+    config.auto_tune = false;
+    EXPECT_EQ(kvstore::AutoTuner::startupConfig(config, 8).num_segments, 16);
+}
+
+TEST_F(KVEngineTest, AutoTuneGrowsSegments) {
+    config.auto_tune = true;
+    config.tune_interval_ms = 0;    // tune() by hand
+    config.min_segments = 4;
+    config.max_segments = 4096;
+
+    {
+        kvstore::KVEngine engine(config);
+        size_t initial = engine.getStatistics().bucket_count;
+
+        size_t keys = initial * 20;
+        for (size_t i = 0; i < keys; ++i) {
+            engine.put("key" + std::to_string(i), "value");
+        }
+        EXPECT_EQ(engine.tune(), 1);
+
+        auto stats = engine.getStatistics();
+        EXPECT_EQ(stats.resizes, 1);
+        EXPECT_LE(stats.load_factor, kvstore::AutoTuner::kTargetLoadFactor);
+        EXPECT_EQ(engine.tune(), 0);
+
+        std::string value;
+        EXPECT_TRUE(engine.get("key0", value));
+        EXPECT_EQ(engine.size(), keys);
+    }
+
+    // Recovery resizes for the replayed keys
+    kvstore::KVEngine engine(config);
+    EXPECT_GT(engine.getStatistics().resizes, 0);
+    EXPECT_LE(engine.getStatistics().load_factor, kvstore::AutoTuner::kTargetLoadFactor);
+}
+
+TEST_F(KVEngineTest, AutoTuneKeepsBounds) {
+    kvstore::Config bounds;
+    bounds.min_segments = 8;
+    bounds.max_segments = 64;
+
+    kvstore::AutoTuner tuner(bounds, 16);
+    EXPECT_EQ(tuner.targetSegments(1000, 16, 0, 0), 64);
+    EXPECT_EQ(tuner.targetSegments(1000, 64, 0, 0), 64);
+
+    // Shrinks when nearly empty, but not below the initial count
+    EXPECT_EQ(tuner.targetSegments(1, 64, 0, 0), 32);
+    EXPECT_EQ(tuner.targetSegments(1, 32, 0, 0), 16);
+    EXPECT_EQ(tuner.targetSegments(1, 16, 0, 0), 16);
+
+    // Contention grows the segments even at a low load...
+    EXPECT_EQ(tuner.targetSegments(10, 16, 10000, 1000), 32);
+    // ...and keeps them from shrinking back
+    EXPECT_EQ(tuner.targetSegments(1, 32, 20000, 1000), 32);
+}
+
+TEST_F(KVEngineTest, CApi) {
+    kvstore_engine* engine = kvstore_open(config.wal_file.c_str(), 16, 0);
+    ASSERT_NE(engine, nullptr);
+
+    EXPECT_EQ(kvstore_put(engine, "key1", 4, "value1", 6, 0), KVSTORE_OK);
+    EXPECT_EQ(kvstore_put(engine, "bin", 3, "a\0b", 3, 0), KVSTORE_OK);
+    EXPECT_EQ(kvstore_exists(engine, "key1", 4), 1);
+    EXPECT_EQ(kvstore_size(engine), 2);
+
+    char* value = nullptr;
+    size_t value_len = 0;
+    ASSERT_EQ(kvstore_get(engine, "bin", 3, &value, &value_len), KVSTORE_OK);
+    EXPECT_EQ(std::string(value, value_len), std::string("a\0b", 3));
+    kvstore_free(value);
+
+    EXPECT_EQ(kvstore_get(engine, "missing", 7, &value, &value_len), KVSTORE_NOT_FOUND);
+    EXPECT_EQ(kvstore_get(engine, "key1", 4, nullptr, &value_len), KVSTORE_INVALID_ARGUMENT);
+
+    EXPECT_EQ(kvstore_expire(engine, "key1", 4, 60000), KVSTORE_OK);
+    EXPECT_GT(kvstore_ttl(engine, "key1", 4), 0);
+    EXPECT_EQ(kvstore_ttl(engine, "missing", 7), -2);
+
+    int64_t counter = 0;
+    EXPECT_EQ(kvstore_incrby(engine, "ctr", 3, 5, &counter), KVSTORE_OK);
+    EXPECT_EQ(counter, 5);
+    EXPECT_EQ(kvstore_incrby(engine, "key1", 4, 1, &counter), KVSTORE_NOT_INTEGER);
+    EXPECT_EQ(kvstore_incrby(engine, "ctr", 3, 1, nullptr), KVSTORE_INVALID_ARGUMENT);
+    EXPECT_EQ(kvstore_delete(engine, "ctr", 3), KVSTORE_OK);
+
+    size_t length = 0;
+    EXPECT_EQ(kvstore_append(engine, "log", 3, "ab", 2, &length), KVSTORE_OK);
+    EXPECT_EQ(kvstore_setrange(engine, "log", 3, 1, "XYZ", 3, &length), KVSTORE_OK);
+    EXPECT_EQ(length, 4);
+    EXPECT_EQ(kvstore_strlen(engine, "log", 3), 4);
+    EXPECT_EQ(kvstore_strlen(engine, "missing", 7), 0);
+    EXPECT_EQ(kvstore_delete(engine, "log", 3), KVSTORE_OK);
+
+    EXPECT_EQ(kvstore_checkpoint(engine), KVSTORE_OK);
+    EXPECT_EQ(kvstore_delete(engine, "bin", 3), KVSTORE_OK);
+    EXPECT_EQ(kvstore_delete(engine, "bin", 3), KVSTORE_NOT_FOUND);
+    kvstore_close(engine);
+
+    // 2 also fsyncs each write
+    engine = kvstore_open(config.wal_file.c_str(), 16, 2);
+    ASSERT_NE(engine, nullptr);
+    EXPECT_EQ(kvstore_size(engine), 1);
+    EXPECT_EQ(kvstore_put(engine, "key2", 4, "v", 1, 0), KVSTORE_OK);
+    EXPECT_EQ(kvstore_flush(engine), KVSTORE_OK);
+    EXPECT_EQ(kvstore_size(engine), 0);
+    kvstore_close(engine);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "hedge_policy.hpp"
+
+using std::chrono::microseconds;
+
+TEST(HedgePolicyTest, DelayIsPercentileOfRecentReads) {
+    kvstore::HedgeOptions options;
+    options.window_size = 1000;
+    options.min_samples = 100;
+    kvstore::HedgePolicy policy(options);
+
+    // 1us .. 1000us in random order: p95 of the window is 950us
+    std::vector<int> latencies(1000);
+    std::iota(latencies.begin(), latencies.end(), 1);
+    std::shuffle(latencies.begin(), latencies.end(), std::mt19937(42));
+    for (int latency : latencies) {
+        policy.record(microseconds(latency), false, false);
+    }
+    EXPECT_EQ(policy.delay(), microseconds(950));
+
+    // The window forgets old reads: after 1000 reads at 5ms, p95 is 5ms
+    for (int i = 0; i < 1000; ++i) {
+        policy.record(microseconds(5000), false, false);
+    }
+    EXPECT_EQ(policy.delay(), microseconds(5000));
+}
+
+TEST(HedgePolicyTest, InitialDelayUntilEnoughSamples) {
+    kvstore::HedgeOptions options;
+    options.initial_delay = microseconds(2000);
+    options.min_samples = 64;
+    kvstore::HedgePolicy policy(options);
+
+    for (int i = 0; i < 63; ++i) {
+        policy.record(microseconds(300), false, false);
+    }
+    EXPECT_EQ(policy.delay(), microseconds(2000));
+
+    policy.record(microseconds(300), false, false);
+    EXPECT_EQ(policy.delay(), microseconds(300));
+}
+
+TEST(HedgePolicyTest, DelayIsClamped) {
+    kvstore::HedgeOptions options;
+    options.min_samples = 10;
+    options.min_delay = microseconds(200);
+    options.max_delay = microseconds(10000);
+
+    kvstore::HedgePolicy fast(options);
+    kvstore::HedgePolicy slow(options);
+    for (int i = 0; i < 10; ++i) {
+        fast.record(microseconds(5), false, false);
+        slow.record(microseconds(1000000), false, false);
+    }
+    EXPECT_EQ(fast.delay(), microseconds(200));
+    EXPECT_EQ(slow.delay(), microseconds(10000));
+}
+
+TEST(HedgePolicyTest, BudgetCapsHedges) {
+    kvstore::HedgeOptions options;
+    options.max_hedge_ratio = 0.1;
+    options.hedge_burst = 5.0;
+    kvstore::HedgePolicy policy(options);
+
+    // A full burst, then nothing until reads earn more
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(policy.tryHedge());
+    }
+    EXPECT_FALSE(policy.tryHedge());
+
+    for (int i = 0; i < 10; ++i) {
+        policy.record(microseconds(100), false, false);
+    }
+    EXPECT_TRUE(policy.tryHedge());
+    EXPECT_FALSE(policy.tryHedge());
+    EXPECT_EQ(policy.getStatistics().throttled, 2);
+
+    // A primary that stalls for good: every read asks to hedge, and at
+    // most a tenth of them (plus the burst) are allowed
+    size_t hedged = 0;
+    for (int i = 0; i < 10000; ++i) {
+        bool hedge = policy.tryHedge();
+        hedged += hedge ? 1 : 0;
+        policy.record(microseconds(50000), hedge, hedge);
+    }
+    EXPECT_GE(hedged, 999);
+    EXPECT_LE(hedged, 1000 + 5);
+
+    auto stats = policy.getStatistics();
+    EXPECT_EQ(stats.reads, 10010);
+    EXPECT_EQ(stats.hedges, hedged);
+    EXPECT_EQ(stats.replica_wins, hedged);
+}
+
+TEST(HedgePolicyTest, BurstRefillsUpToCap) {
+    kvstore::HedgeOptions options;
+    options.max_hedge_ratio = 0.5;
+    options.hedge_burst = 3.0;
+    kvstore::HedgePolicy policy(options);
+
+    // Idle reads never bank more than the burst
+    for (int i = 0; i < 1000; ++i) {
+        policy.record(microseconds(100), false, false);
+    }
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(policy.tryHedge());
+    }
+    EXPECT_FALSE(policy.tryHedge());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
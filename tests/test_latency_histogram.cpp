@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "latency_histogram.hpp"
+
+TEST(LatencyHistogramTest, EmptyHistogram) {
+    kvstore::LatencyHistogram histogram;
+
+    EXPECT_EQ(histogram.count(), 0);
+    EXPECT_EQ(histogram.min(), 0);
+    EXPECT_EQ(histogram.max(), 0);
+    EXPECT_EQ(histogram.percentile(99.0), 0);
+}
+
+TEST(LatencyHistogramTest, SmallValuesAreExact) {
+    kvstore::LatencyHistogram histogram;
+
+    for (uint64_t i = 1; i <= 50; ++i) {
+        histogram.record(i);
+    }
+
+    EXPECT_EQ(histogram.count(), 50);
+    EXPECT_EQ(histogram.min(), 1);
+    EXPECT_EQ(histogram.max(), 50);
+    EXPECT_EQ(histogram.percentile(50.0), 25);
+    EXPECT_DOUBLE_EQ(histogram.mean(), 25.5);
+}
+
+TEST(LatencyHistogramTest, PercentilesWithinPrecision) {
+    kvstore::LatencyHistogram histogram;
+
+    // 1us .. 10ms in nanoseconds
+    for (uint64_t i = 1; i <= 10000; ++i) {
+        histogram.record(i * 1000);
+    }
+
+    for (double p : {50.0, 90.0, 99.0, 99.9}) {
+        double expected = p / 100.0 * 10000 * 1000;
+        double actual = static_cast<double>(histogram.percentile(p));
+        EXPECT_NEAR(actual, expected, expected * 0.035) << "p" << p;
+    }
+    EXPECT_EQ(histogram.percentile(100.0), 10000 * 1000);
+}
+
+TEST(LatencyHistogramTest, HugeValuesAreClamped) {
+    kvstore::LatencyHistogram histogram;
+
+    histogram.record(UINT64_MAX);
+    EXPECT_EQ(histogram.count(), 1);
+    EXPECT_GT(histogram.percentile(50.0), 0);
+}
+
+TEST(LatencyHistogramTest, MergeAndReset) {
+    kvstore::LatencyHistogram a, b;
+
+    a.record(10);
+    b.record(5);
+    b.record(1000);
+
+    a.merge(b);
+    EXPECT_EQ(a.count(), 3);
+    EXPECT_EQ(a.min(), 5);
+    EXPECT_EQ(a.max(), 1000);
+
+    a.reset();
+    EXPECT_EQ(a.count(), 0);
+    EXPECT_EQ(a.max(), 0);
+}
+
+TEST(LatencyHistogramTest, ConcurrentRecord) {
+    kvstore::LatencyHistogram histogram;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&]() {
+            for (uint64_t i = 0; i < 10000; ++i) {
+                histogram.record(i);
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(histogram.count(), 80000);
+    EXPECT_EQ(histogram.max(), 9999);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
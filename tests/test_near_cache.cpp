@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "near_cache.hpp"
+#include "client_tracker.hpp"
+
+class NearCacheTest : public ::testing::Test {
+protected:
+    kvstore::NearCacheOptions options;
+
+    void SetUp() override {
+        options.capacity = 4;
+        options.num_shards = 1;
+        options.ttl = std::chrono::milliseconds(60000);
+    }
+};
+
+TEST_F(NearCacheTest, BasicOperations) {
+    kvstore::NearCache<std::string, std::string> cache(options);
+    std::string value;
+
+    EXPECT_FALSE(cache.find("key1", value));
+
+    cache.insert("key1", "value1");
+    EXPECT_TRUE(cache.find("key1", value));
+    EXPECT_EQ(value, "value1");
+
+    cache.insert("key1", "value2");
+    EXPECT_TRUE(cache.find("key1", value));
+    EXPECT_EQ(value, "value2");
+    EXPECT_EQ(cache.size(), 1);
+
+    EXPECT_TRUE(cache.erase("key1"));
+    EXPECT_FALSE(cache.find("key1", value));
+    EXPECT_FALSE(cache.erase("key1"));
+}
+
+TEST_F(NearCacheTest, EvictsLeastRecentlyUsed) {
+    kvstore::NearCache<std::string, std::string> cache(options);
+    std::string value;
+
+    for (int i = 0; i < 4; ++i) {
+        cache.insert("key" + std::to_string(i), "value");
+    }
+
+    // Touch key0 so key1 becomes the eviction victim
+    EXPECT_TRUE(cache.find("key0", value));
+    cache.insert("key4", "value");
+
+    EXPECT_EQ(cache.size(), 4);
+    EXPECT_TRUE(cache.find("key0", value));
+    EXPECT_FALSE(cache.find("key1", value));
+    EXPECT_EQ(cache.getStatistics().evictions, 1);
+}
+
+TEST_F(NearCacheTest, EntriesExpireAfterTTL) {
+    options.ttl = std::chrono::milliseconds(20);
+    kvstore::NearCache<std::string, std::string> cache(options);
+    std::string value;
+
+    cache.insert("key1", "value1");
+    EXPECT_TRUE(cache.find("key1", value));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    EXPECT_FALSE(cache.find("key1", value));
+    EXPECT_EQ(cache.size(), 0);
+}
+
+TEST_F(NearCacheTest, Statistics) {
+    kvstore::NearCache<std::string, std::string> cache(options);
+    std::string value;
+
+    cache.insert("key1", "value1");
+    cache.find("key1", value);
+    cache.find("key1", value);
+    cache.find("missing", value);
+    cache.erase("key1");
+
+    auto stats = cache.getStatistics();
+    EXPECT_EQ(stats.hits, 2);
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.invalidations, 1);
+    EXPECT_NEAR(stats.hit_ratio, 2.0 / 3.0, 1e-9);
+}
+
+TEST_F(NearCacheTest, ConcurrentAccess) {
+    options.capacity = 1000;
+    options.num_shards = 8;
+    kvstore::NearCache<std::string, std::string> cache(options);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t]() {
+            std::string value;
+            for (int i = 0; i < 1000; ++i) {
+                std::string key = "key_" + std::to_string((t * 1000 + i) % 2000);
+                cache.insert(key, "value");
+                cache.find(key, value);
+                if (i % 10 == 0) {
+                    cache.erase(key);
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_LE(cache.size(), 1000);
+}
+
+TEST(ClientTrackerTest, TrackingIsOneShot) {
+    kvstore::ClientTracker tracker;
+
+    tracker.track("key1", 1);
+    tracker.track("key1", 2);
+    tracker.track("key1", 1); // Duplicate registration
+    tracker.track("key2", 2);
+    EXPECT_EQ(tracker.size(), 2);
+
+    auto ids = tracker.take("key1");
+    ASSERT_EQ(ids.size(), 2);
+    EXPECT_EQ(ids[0], 1);
+    EXPECT_EQ(ids[1], 2);
+
+    EXPECT_TRUE(tracker.take("key1").empty());
+
+    tracker.clear();
+    EXPECT_TRUE(tracker.take("key2").empty());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,291 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "kv_server.hpp"
+#include "kv_client.hpp"
+
+namespace fs = std::filesystem;
+
+// A server on a loopback port, driven through KVClient
+class KVServerTest : public ::testing::Test {
+protected:
+    kvstore::Config config;
+    std::unique_ptr<kvstore::KVServer> server;
+    std::unique_ptr<kvstore::KVClient> client;
+
+    void SetUp() override {
+        config.server_port = 16479;
+        config.wal_file = "test_server.wal";
+        config.sync_wal = false;
+        config.expiry_sweep_interval_ms = 0;
+        config.num_segments = 16;
+        config.max_value_size = 1024;
+        config.max_stream_value_size = 64 * 1024;
+        removeFiles();
+
+        server = std::make_unique<kvstore::KVServer>(config);
+        server->start(1);
+        client = std::make_unique<kvstore::KVClient>("127.0.0.1", config.server_port);
+    }
+
+    void TearDown() override {
+        client.reset();
+
+        // Connection threads are detached; let them see the close before
+        // the server goes away
+        for (int i = 0; i < 200 && server->getConnectionCount() > 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        server.reset();
+        removeFiles();
+    }
+
+    void removeFiles() {
+        for (const auto& file : {config.wal_file, config.wal_file + ".snapshot",
+                                 config.wal_file + ".snapshot.tmp"}) {
+            if (fs::exists(file)) {
+                fs::remove(file);
+            }
+        }
+    }
+
+    // Download key with getStream, chunk_size bytes at a time
+    bool download(kvstore::KVClient& from, const std::string& key, std::string& value,
+                  size_t chunk_size) {
+        value.clear();
+        return from.getStream(key, [&](const std::string& chunk) { value += chunk; },
+                              chunk_size);
+    }
+    
+    // Store data at key one bit at a time, so it may hold any byte (its
+    // last byte must not be zero)
+    void setBits(const std::string& key, const std::string& data) {
+        for (uint64_t bit = 0; bit < data.size() * 8; ++bit) {
+            if ((static_cast<unsigned char>(data[bit / 8]) >> (7 - bit % 8)) & 1) {
+                ASSERT_TRUE(client->setBit(key, bit, true).has_value());
+            }
+        }
+    }
+};
+
+TEST_F(KVServerTest, StreamLargeValue) {
+    // 40 chunks of 1000 bytes: a value 40 times max_value_size
+    std::vector<std::string> chunks;
+    std::string expected;
+    for (int i = 0; i < 40; ++i) {
+        chunks.push_back(std::string(1000, static_cast<char>('a' + i % 26)));
+        expected += chunks.back();
+    }
+    ASSERT_TRUE(client->putStream("large", chunks.begin(), chunks.end()));
+
+    std::string value;
+    ASSERT_TRUE(download(*client, "large", value, 700));
+    EXPECT_EQ(value, expected);
+
+    // A chunk size larger than max_value_size is served in pieces
+    ASSERT_TRUE(download(*client, "large", value, 1 << 20));
+    EXPECT_EQ(value, expected);
+
+    // An empty value downloads as nothing
+    ASSERT_TRUE(client->put("empty", ""));
+    ASSERT_TRUE(download(*client, "empty", value, 100));
+    EXPECT_TRUE(value.empty());
+}
+
+TEST_F(KVServerTest, StreamedValueAppearsAtomically) {
+    ASSERT_EQ(client->sendCommand("PUT.BEGIN \"staged\""), "OK");
+    ASSERT_EQ(client->sendCommand("PUT.CHUNK \"staged\" \"part one \""), "OK");
+    EXPECT_FALSE(client->exists("staged"));
+
+    ASSERT_EQ(client->sendCommand("PUT.CHUNK \"staged\" \"part two\""), "OK");
+    ASSERT_EQ(client->sendCommand("PUT.END \"staged\""), "OK");
+    EXPECT_EQ(client->get("staged"), "part one part two");
+}
+
+TEST_F(KVServerTest, AbortedUploadStoresNothing) {
+    ASSERT_TRUE(client->put("kept", "original"));
+    ASSERT_EQ(client->sendCommand("PUT.BEGIN \"kept\""), "OK");
+    ASSERT_EQ(client->sendCommand("PUT.CHUNK \"kept\" \"replacement\""), "OK");
+    ASSERT_EQ(client->sendCommand("PUT.ABORT \"kept\""), "OK");
+    EXPECT_EQ(client->get("kept"), "original");
+
+    // The upload is gone, not just paused
+    EXPECT_EQ(client->sendCommand("PUT.CHUNK \"kept\" \"more\"").rfind("ERROR", 0), 0);
+    EXPECT_EQ(client->sendCommand("PUT.END \"kept\"").rfind("ERROR", 0), 0);
+    EXPECT_EQ(client->get("kept"), "original");
+}
+
+TEST_F(KVServerTest, FailedUploadIsAborted) {
+    // A chunk over max_value_size fails, and putStream aborts the upload
+    std::vector<std::string> chunks = {"first", std::string(2000, 'x')};
+    EXPECT_FALSE(client->putStream("big_chunk", chunks.begin(), chunks.end()));
+    EXPECT_FALSE(client->exists("big_chunk"));
+    EXPECT_EQ(client->sendCommand("PUT.END \"big_chunk\"").rfind("ERROR", 0), 0);
+
+    // Past max_stream_value_size the server drops the upload itself
+    size_t sent = 0;
+    bool stored = client->putStream("too_large", [&](std::string& chunk) {
+        if (sent >= 2 * config.max_stream_value_size) {
+            return false;
+        }
+        chunk.assign(1000, 'y');
+        sent += chunk.size();
+        return true;
+    });
+    EXPECT_FALSE(stored);
+    EXPECT_LT(sent, 2 * config.max_stream_value_size);
+    EXPECT_FALSE(client->exists("too_large"));
+}
+
+TEST_F(KVServerTest, UploadsPerConnectionAreCapped) {
+    for (size_t i = 0; i < config.max_stream_uploads; ++i) {
+        ASSERT_EQ(client->sendCommand("PUT.BEGIN \"upload" + std::to_string(i) + "\""), "OK");
+    }
+    EXPECT_EQ(client->sendCommand("PUT.BEGIN \"one_more\"").rfind("ERROR", 0), 0);
+
+    // Restarting an upload in progress does not count again
+    EXPECT_EQ(client->sendCommand("PUT.BEGIN \"upload0\""), "OK");
+
+    // Another connection has its own allowance
+    kvstore::KVClient other("127.0.0.1", config.server_port);
+    EXPECT_EQ(other.sendCommand("PUT.BEGIN \"one_more\""), "OK");
+
+    // Finishing or aborting an upload frees its slot
+    ASSERT_EQ(client->sendCommand("PUT.END \"upload0\""), "OK");
+    ASSERT_EQ(client->sendCommand("PUT.ABORT \"upload1\""), "OK");
+    EXPECT_EQ(client->sendCommand("PUT.BEGIN \"one_more\""), "OK");
+    EXPECT_EQ(client->sendCommand("PUT.BEGIN \"two_more\""), "OK");
+    EXPECT_EQ(client->sendCommand("PUT.BEGIN \"three_more\"").rfind("ERROR", 0), 0);
+}
+
+TEST_F(KVServerTest, GetStreamErrorsReturnFalse) {
+    std::string value;
+    EXPECT_FALSE(download(*client, "missing", value, 100));
+
+    // Error replies carry spaces too; they must not parse as a size
+    std::string long_key(config.max_key_size + 1, 'k');
+    EXPECT_FALSE(download(*client, long_key, value, 100));
+
+    ASSERT_TRUE(client->hset("hash", {{"field", "value"}}).has_value());
+    EXPECT_FALSE(download(*client, "hash", value, 100));
+    EXPECT_TRUE(value.empty());
+}
+
+TEST_F(KVServerTest, GetStreamDetectsSizeChange) {
+    ASSERT_TRUE(client->put("changing", std::string(1000, 'a')));
+
+    // A second connection rewrites the value after the first chunk
+    kvstore::KVClient writer("127.0.0.1", config.server_port);
+    bool rewritten = false;
+    std::string received;
+    bool complete = client->getStream("changing", [&](const std::string& chunk) {
+        received += chunk;
+        if (!rewritten) {
+            writer.put("changing", std::string(600, 'b'));
+            rewritten = true;
+        }
+    }, 250);
+    EXPECT_FALSE(complete);
+    EXPECT_EQ(received, std::string(250, 'a'));
+
+    // Shrinking below the offset already read is caught as well
+    ASSERT_TRUE(client->put("shrinking", std::string(1000, 'a')));
+    rewritten = false;
+    complete = client->getStream("shrinking", [&](const std::string&) {
+        if (!rewritten) {
+            writer.del("shrinking");
+            writer.put("shrinking", "");
+            rewritten = true;
+        }
+    }, 250);
+    EXPECT_FALSE(complete);
+}
+
+TEST_F(KVServerTest, BinaryValuesKeepRepliesInSync) {
+    // Newlines and reply-like lines inside a value
+    const std::string binary = "line one\nOK\r\n$3\n*2\nNOT_FOUND\n\x01\xff";
+    setBits("binary", binary);
+    EXPECT_EQ(client->get("binary"), binary);
+    EXPECT_EQ(client->getRange("binary", 5, 12), binary.substr(5, 8));
+    
+    std::string value;
+    ASSERT_TRUE(download(*client, "binary", value, 7));
+    EXPECT_EQ(value, binary);
+    
+    ASSERT_EQ(client->bitOp("NOT", "inverted", {"binary"}), binary.size());
+    std::string inverted = binary;
+    for (auto& byte : inverted) {
+        byte = static_cast<char>(~byte);
+    }
+    EXPECT_EQ(client->get("inverted"), inverted);
+    
+    // The replies that follow still line up with their requests
+    EXPECT_TRUE(client->put("after", "value"));
+    EXPECT_EQ(client->get("after"), "value");
+    EXPECT_TRUE(client->ping());
+}
+
+TEST_F(KVServerTest, StoredDataIsNeverAStatusLine) {
+    ASSERT_TRUE(client->put("status", "NOT_FOUND"));
+    EXPECT_EQ(client->get("status"), "NOT_FOUND");
+    EXPECT_EQ(client->get("missing"), "NOT_FOUND");
+    
+    ASSERT_TRUE(client->hset("hash", {{"field", "NOT_FOUND"}, {"*1", "$0"}}).has_value());
+    EXPECT_EQ(client->hget("hash", "field"), "NOT_FOUND");
+    EXPECT_FALSE(client->hget("hash", "missing").has_value());
+    auto values = client->hmget("hash", {"missing", "field", "*1"});
+    ASSERT_EQ(values.size(), 3);
+    EXPECT_FALSE(values[0].has_value());
+    EXPECT_EQ(values[1], "NOT_FOUND");
+    EXPECT_EQ(values[2], "$0");
+    
+    std::vector<std::string> elements = {"ERROR not an error", "*2", "$5", ""};
+    ASSERT_TRUE(client->rpush("list", elements).has_value());
+    EXPECT_EQ(client->lrange("list", 0, -1), elements);
+    EXPECT_EQ(client->lpop("list"), "ERROR not an error");
+    EXPECT_TRUE(client->ping());
+}
+
+TEST_F(KVServerTest, ValuesThatLookLikePushes) {
+    ASSERT_TRUE(client->enableNearCache());
+    ASSERT_TRUE(client->enableServerTiming());
+    ASSERT_TRUE(client->put("cached", "original"));
+    EXPECT_EQ(client->get("cached"), "original");
+    
+    const std::vector<std::string> values = {">FLUSH", ">INVALIDATE cached", ">TIME 5", ">"};
+    for (size_t i = 0; i < values.size(); ++i) {
+        std::string key = "value" + std::to_string(i);
+        ASSERT_TRUE(client->put(key, values[i]));
+        EXPECT_EQ(client->get(key), values[i]);
+        EXPECT_EQ(client->hset("hash", {{values[i], values[i]}}), 1);
+    }
+    EXPECT_EQ(client->hget("hash", ">FLUSH"), ">FLUSH");
+    EXPECT_EQ(client->hgetAll("hash").size(), values.size());
+    
+    ASSERT_TRUE(client->rpush(">FLUSH", values).has_value());
+    EXPECT_EQ(client->lrange(">FLUSH", 0, -1), values);
+    auto popped = client->blpop({">FLUSH"}, std::chrono::milliseconds(100));
+    ASSERT_TRUE(popped.has_value());
+    EXPECT_EQ(popped->first, ">FLUSH");
+    EXPECT_EQ(popped->second, ">FLUSH");
+    
+    // None of them was taken for a push: the cached key is still local
+    auto before = client->nearCacheStats();
+    EXPECT_EQ(client->get("cached"), "original");
+    EXPECT_EQ(client->nearCacheStats().hits, before.hits + 1);
+    EXPECT_EQ(client->nearCacheStats().invalidations, before.invalidations);
+    
+    // ... while a real invalidation still gets through
+    kvstore::KVClient writer("127.0.0.1", config.server_port);
+    ASSERT_TRUE(writer.put("cached", "changed"));
+    EXPECT_EQ(client->get("cached"), "changed");
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
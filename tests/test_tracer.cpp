@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <set>
+#include <string>
+#include <sstream>
+#include <cstring>
+#include "tracer.hpp"
+#include "concurrent_hash_map.hpp"
+
+using kvstore::Tracer;
+using kvstore::TraceRequest;
+using kvstore::TraceSpan;
+
+namespace {
+
+size_t countNamed(const std::vector<std::pair<uint64_t, Tracer::Event>>& events,
+                  const char* name) {
+    size_t count = 0;
+    for (const auto& entry : events) {
+        if (std::strcmp(entry.second.name, name) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+}  // namespace
+
+TEST(TracerTest, NothingRecordedWhenStopped) {
+    auto& tracer = Tracer::instance();
+    tracer.start(1);
+    tracer.stop();
+
+    {
+        TraceRequest request;
+        TraceSpan span("idle");
+        EXPECT_FALSE(Tracer::sampling());
+    }
+    EXPECT_TRUE(tracer.events().empty());
+}
+
+TEST(TracerTest, RecordsNestedSpans) {
+    auto& tracer = Tracer::instance();
+    tracer.start(1);
+
+    kvstore::ConcurrentHashMap<std::string, std::string> map;
+    {
+        TraceRequest request;
+        TraceSpan outer("command");
+        map.insert("key", "value");
+    }
+    // Outside a request nothing is recorded
+    map.insert("other", "value");
+    tracer.stop();
+
+    auto events = tracer.events();
+    ASSERT_EQ(events.size(), 2);
+
+    // Inner spans end (and are recorded) first
+    const auto& inner = events[0].second;
+    const auto& outer = events[1].second;
+    EXPECT_STREQ(inner.name, "map.insert");
+    EXPECT_STREQ(outer.name, "command");
+    EXPECT_EQ(inner.request, outer.request);
+    EXPECT_NE(outer.request, 0);
+    EXPECT_GE(inner.start_ns, outer.start_ns);
+    EXPECT_LE(inner.start_ns + inner.duration_ns, outer.start_ns + outer.duration_ns);
+}
+
+TEST(TracerTest, SamplesOneInN) {
+    auto& tracer = Tracer::instance();
+    tracer.start(10);
+
+    for (int i = 0; i < 1000; ++i) {
+        TraceRequest request;
+        TraceSpan span("request");
+    }
+    tracer.stop();
+
+    EXPECT_EQ(tracer.events().size(), 100);
+}
+
+TEST(TracerTest, RingBufferKeepsLatestEvents) {
+    auto& tracer = Tracer::instance();
+    tracer.start(1, 8);
+
+    for (int i = 0; i < 20; ++i) {
+        TraceRequest request;
+        TraceSpan span("request");
+    }
+    tracer.stop();
+
+    auto events = tracer.events();
+    ASSERT_EQ(events.size(), 8);
+    for (size_t i = 1; i < events.size(); ++i) {
+        EXPECT_EQ(events[i].second.request, events[i - 1].second.request + 1);
+    }
+}
+
+TEST(TracerTest, PerThreadBuffers) {
+    auto& tracer = Tracer::instance();
+    tracer.start(1);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < 50; ++i) {
+                TraceRequest request;
+                TraceSpan span("request");
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    tracer.stop();
+
+    // Events of exited threads are kept
+    auto events = tracer.events();
+    EXPECT_EQ(countNamed(events, "request"), 200);
+
+    std::set<uint64_t> tids;
+    for (const auto& entry : events) {
+        tids.insert(entry.first);
+    }
+    EXPECT_EQ(tids.size(), 4);
+}
+
+TEST(TracerTest, StartDiscardsEarlierEvents) {
+    auto& tracer = Tracer::instance();
+    tracer.start(1);
+    {
+        TraceRequest request;
+        TraceSpan span("old");
+    }
+
+    tracer.start(1);
+    {
+        TraceRequest request;
+        TraceSpan span("new");
+    }
+    tracer.stop();
+
+    auto events = tracer.events();
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_STREQ(events[0].second.name, "new");
+}
+
+TEST(TracerTest, WritesChromeTrace) {
+    auto& tracer = Tracer::instance();
+    tracer.start(1);
+    {
+        TraceRequest request;
+        TraceSpan span("wal.append");
+    }
+    tracer.stop();
+
+    std::ostringstream out;
+    EXPECT_EQ(tracer.writeChromeTrace(out), 1);
+
+    std::string json = out.str();
+    EXPECT_EQ(json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["), 0);
+    EXPECT_NE(json.find("\"name\":\"wal.append\""), std::string::npos);
+    EXPECT_NE(json.find("\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(json.find("\"dur\":"), std::string::npos);
+    EXPECT_EQ(json.substr(json.size() - 4), "\n]}\n");
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,318 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <filesystem>
+#include "write_ahead_log.hpp"
+#include "latency_histogram.hpp"
+#include "workload.hpp"
+#include "benchmark_baseline.hpp"
+
+// WriteAheadLog throughput and durability benchmark. Sweeps writer
+// threads x record size x durability mode:
+//
+//   buffered  writeEntry with sync off: records sit in the stream buffer
+//   flush     writeEntry with sync on: each record is handed to the OS
+//             (kv_server's sync_wal=true)
+//   fsync     writeEntry, then sync(): each record is on stable storage
+//             before the call returns; concurrent writers share fsyncs
+//             (kv_server's fsync_writes=true)
+//
+// Commit latency is the time from the start of writeEntry until the
+// record is as durable as the mode makes it.
+//
+//   wal_benchmark --dir /mnt/data --threads 1,8 --sizes 128,4096 --json wal.json
+//
+// --trials repeats every configuration; with --save-baseline and
+// --compare the per-trial throughput and p99 are checked for significant
+// regressions against an earlier run.
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+enum class Mode {
+    BUFFERED,
+    FLUSH,
+    FSYNC
+};
+
+const char* modeName(Mode mode) {
+    switch (mode) {
+        case Mode::BUFFERED: return "buffered";
+        case Mode::FLUSH: return "flush";
+        case Mode::FSYNC: return "fsync";
+    }
+    return "?";
+}
+
+struct Options {
+    std::string dir = ".";
+    std::vector<size_t> threads = {1, 4, 8};
+    std::vector<size_t> sizes = {64, 1024, 16384};
+    std::vector<Mode> modes = {Mode::BUFFERED, Mode::FLUSH, Mode::FSYNC};
+    double duration = 2.0;
+    std::string json_file;
+    unsigned trials = 1;
+    std::string save_baseline;
+    std::string compare_baseline;
+    double threshold = 0.05;
+};
+
+struct RunResult {
+    Mode mode;
+    size_t threads;
+    size_t size;
+    double seconds;
+    kvstore::WriteAheadLog::Statistics stats;
+    kvstore::LatencyHistogram::Summary latency;
+};
+
+std::vector<size_t> parseList(const std::string& text) {
+    std::vector<size_t> values;
+    std::istringstream iss(text);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        values.push_back(std::stoul(item));
+    }
+    return values;
+}
+
+void usage(const char* program) {
+    std::cerr
+        << "Usage: " << program << " [options]\n"
+        << "  --dir DIR          Directory for the WAL files (.)\n"
+        << "  --threads LIST     Writer thread counts (1,4,8)\n"
+        << "  --sizes LIST       Value sizes in bytes (64,1024,16384)\n"
+        << "  --modes LIST       buffered,flush,fsync (all)\n"
+        << "  --duration SECONDS Time per configuration (2)\n"
+        << "  --json FILE        Also write the results as JSON\n"
+        << "  --trials N         Runs of each configuration (1)\n"
+        << "  --save-baseline F  Save the per-trial results as a baseline\n"
+        << "  --compare F        Flag significant regressions against a baseline\n"
+        << "  --threshold PCT    Smallest change --compare reports (5)\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--dir") {
+            options.dir = value;
+        } else if (arg == "--threads") {
+            options.threads = parseList(value);
+        } else if (arg == "--sizes") {
+            options.sizes = parseList(value);
+        } else if (arg == "--modes") {
+            options.modes.clear();
+            std::istringstream iss(value);
+            std::string item;
+            while (std::getline(iss, item, ',')) {
+                if (item == "buffered") {
+                    options.modes.push_back(Mode::BUFFERED);
+                } else if (item == "flush") {
+                    options.modes.push_back(Mode::FLUSH);
+                } else if (item == "fsync") {
+                    options.modes.push_back(Mode::FSYNC);
+                } else {
+                    return false;
+                }
+            }
+        } else if (arg == "--duration") {
+            options.duration = std::stod(value);
+        } else if (arg == "--json") {
+            options.json_file = value;
+        } else if (arg == "--trials") {
+            options.trials = std::max(1UL, std::stoul(value));
+        } else if (arg == "--save-baseline") {
+            options.save_baseline = value;
+        } else if (arg == "--compare") {
+            options.compare_baseline = value;
+        } else if (arg == "--threshold") {
+            options.threshold = std::stod(value) / 100.0;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+RunResult runConfiguration(const Options& options, Mode mode, size_t num_threads, size_t size) {
+    std::string file = (fs::path(options.dir) / "wal_benchmark.wal").string();
+    fs::remove(file);
+
+    kvstore::LatencyHistogram latency;
+    std::atomic<bool> stopping{false};
+    RunResult result{mode, num_threads, size, 0.0, {}, {}};
+
+    {
+        kvstore::WriteAheadLog wal(file, mode == Mode::FLUSH);
+
+        std::vector<std::thread> threads;
+        auto started = Clock::now();
+        for (size_t t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&, t]() {
+                std::string value = kvstore::makeValue(size, t);
+                uint64_t i = 0;
+                while (!stopping.load(std::memory_order_relaxed)) {
+                    std::string key = kvstore::formatKey(t * 1000000000ULL + i++, 16);
+
+                    auto begin = Clock::now();
+                    bool ok = wal.writeEntry(kvstore::Operation::PUT, key, value);
+                    if (ok && mode == Mode::FSYNC) {
+                        ok = wal.sync();
+                    }
+                    latency.record(static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            Clock::now() - begin).count()));
+
+                    if (!ok) {
+                        std::cerr << "WAL write failed" << std::endl;
+                        stopping = true;
+                    }
+                }
+            });
+        }
+
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.duration));
+        stopping = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        result.seconds = std::chrono::duration<double>(Clock::now() - started).count();
+        result.stats = wal.getStatistics();
+    }
+
+    result.latency = latency.summarize();
+    fs::remove(file);
+    return result;
+}
+
+double micros(uint64_t nanos) {
+    return nanos / 1000.0;
+}
+
+// Records made durable per fsync (fsync mode), or per OS hand-off
+double groupSize(const RunResult& result) {
+    if (result.mode == Mode::FSYNC && result.stats.fsyncs > 0) {
+        return static_cast<double>(result.stats.records) / result.stats.fsyncs;
+    }
+    if (result.mode == Mode::FLUSH && result.stats.flushes > 0) {
+        return static_cast<double>(result.stats.records) / result.stats.flushes;
+    }
+    return 0.0;
+}
+
+void printHeader() {
+    std::cout << std::left << std::setw(10) << "Mode" << std::right
+              << std::setw(8) << "Threads" << std::setw(8) << "Size"
+              << std::setw(12) << "Records/s" << std::setw(10) << "MB/s"
+              << std::setw(11) << "Fsyncs/s" << std::setw(8) << "Group"
+              << std::setw(10) << "p50(us)" << std::setw(10) << "p99"
+              << std::setw(10) << "p99.9" << std::setw(10) << "Max" << std::endl;
+}
+
+void printRow(const RunResult& result) {
+    double group = groupSize(result);
+    std::cout << std::left << std::setw(10) << modeName(result.mode) << std::right
+              << std::setw(8) << result.threads << std::setw(8) << result.size
+              << std::fixed << std::setprecision(0)
+              << std::setw(12) << result.stats.records / result.seconds
+              << std::setprecision(1)
+              << std::setw(10) << result.stats.bytes / result.seconds / (1024.0 * 1024.0)
+              << std::setprecision(0)
+              << std::setw(11) << result.stats.fsyncs / result.seconds
+              << std::setprecision(1) << std::setw(8);
+    if (group > 0) {
+        std::cout << group;
+    } else {
+        std::cout << "-";
+    }
+    std::cout << std::setw(10) << micros(result.latency.p50)
+              << std::setw(10) << micros(result.latency.p99)
+              << std::setw(10) << micros(result.latency.p999)
+              << std::setw(10) << micros(result.latency.max) << std::endl;
+}
+
+void writeJson(const std::string& file, const std::vector<RunResult>& results) {
+    std::ofstream out(file);
+    out << std::fixed << std::setprecision(3) << "{\n  \"results\": [";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"mode\": \"" << modeName(result.mode) << "\""
+            << ", \"threads\": " << result.threads
+            << ", \"value_size\": " << result.size
+            << ", \"seconds\": " << result.seconds
+            << ", \"records\": " << result.stats.records
+            << ", \"records_per_sec\": " << result.stats.records / result.seconds
+            << ", \"mb_per_sec\": " << result.stats.bytes / result.seconds / (1024.0 * 1024.0)
+            << ", \"fsyncs_per_sec\": " << result.stats.fsyncs / result.seconds
+            << ", \"group_size\": " << groupSize(result)
+            << ", \"p50_us\": " << micros(result.latency.p50)
+            << ", \"p99_us\": " << micros(result.latency.p99)
+            << ", \"p999_us\": " << micros(result.latency.p999)
+            << ", \"max_us\": " << micros(result.latency.max) << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        if (!parseOptions(argc, argv, options)) {
+            usage(argv[0]);
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::cout << "WAL benchmark in " << fs::absolute(options.dir) << ", "
+              << options.duration << "s per configuration\n" << std::endl;
+    printHeader();
+
+    std::vector<RunResult> results;
+    kvstore::BenchmarkBaseline baseline;
+    for (Mode mode : options.modes) {
+        for (size_t size : options.sizes) {
+            for (size_t threads : options.threads) {
+                std::string name = std::string(modeName(mode)) + "/threads:" +
+                                   std::to_string(threads) + "/size:" + std::to_string(size);
+
+                for (unsigned trial = 0; trial < options.trials; ++trial) {
+                    results.push_back(runConfiguration(options, mode, threads, size));
+                    const auto& result = results.back();
+                    printRow(result);
+
+                    baseline.add(name + "/records_per_sec",
+                                 result.stats.records / result.seconds, true);
+                    baseline.add(name + "/p99_us", micros(result.latency.p99), false);
+                }
+            }
+        }
+    }
+
+    if (!options.json_file.empty()) {
+        writeJson(options.json_file, results);
+    }
+    return baseline.saveOrCompare(options.save_baseline, options.compare_baseline,
+                                  options.threshold);
+}